@@ -71,15 +71,20 @@ else()
   set(BUILD_COMMAND_OPTS --target install --config Release)
 endif()
 
+set(GOOGLE_TEST_CXX_FLAGS ${CMAKE_CXX_FLAGS})
+
 if(MSVC)
   if(NOT MSVC_USE_STATIC_RUNTIME_LIBRARY)
     set(GOOGLE_TEST_CONFIG -Dgtest_force_shared_crt=ON)
   endif()
+else()
+  # 1.8.1自带-Werror, 新版gcc下会误报maybe-uninitialized
+  set(GOOGLE_TEST_CXX_FLAGS "${GOOGLE_TEST_CXX_FLAGS} -Wno-maybe-uninitialized")
 endif()
 
 execute_process(COMMAND ${CMAKE_COMMAND}
   -DCMAKE_INSTALL_PREFIX=${FROG_3RDPARTY_BINARY_DIR}/install/${BUILD_3RDPARTY_NAME}
-  -DCMAKE_CXX_FLAGS=${CMAKE_CXX_FLAGS}
+  -DCMAKE_CXX_FLAGS=${GOOGLE_TEST_CXX_FLAGS}
   -DCMAKE_MODULE_PATH=${CMAKE_MODULE_PATH}
   -DCMAKE_GENERATOR_PLATFORM=${CMAKE_GENERATOR_PLATFORM}
   -G ${CMAKE_GENERATOR}
@@ -0,0 +1,48 @@
+#pragma once
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdint.h>
+
+#include <string>
+
+extern "C" {
+    #include "lua.h"
+}
+
+// 在临时目录下搭一个最小运行环境(配置了调试端口但不挂接), 进程内只初始化一次
+#define def_benchmarkPoolService "benchPoolSvc"
+#define def_benchmarkDispatchService "benchDispatchSvc"
+
+class luaServiceEnv
+{
+public:
+    static luaServiceEnv* get();
+
+    bool ready() const
+    {
+        return m_bReady;
+    }
+
+    uint32_t createService(const char* szName, const char* szParam);
+
+    void preparePool(const char* szName, int32_t iCapacity);
+
+    int32_t poolReady(const char* szName);
+
+    void waitForPool(const char* szName, int32_t iCount);
+
+    void waitForServiceCount(int32_t iCount);
+
+    int32_t serviceCount() const;
+
+    bool isDebugAttached();
+
+private:
+    luaServiceEnv();
+
+    lua_State* m_pLuaState;
+    bool       m_bReady;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "benchmark/benchmark.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdio.h>
+
+extern "C" {
+    #include "thread_t.h"
+    #include "service_t.h"
+    #include "serviceCenter_t.h"
+    #include "serviceEvent_t.h"
+}
+
+#include "luaServiceEnv.h"
+
+// 向一个lua服务投递state.range(0)条文本消息, 服务收满后退出
+static void dispatchTextBurst(benchmark::State& state, const char* szMode)
+{
+    luaServiceEnv* pEnv = luaServiceEnv::get();
+    if (!pEnv->ready()) {
+        state.SkipWithError("lruntime env init error");
+        return;
+    }
+    if (pEnv->isDebugAttached()) {
+        state.SkipWithError("debugger attached");
+        return;
+    }
+
+    int32_t iBurst = (int32_t)state.range(0);
+    char    szParam[64];
+    snprintf(szParam, sizeof(szParam), "%d %s", iBurst, szMode);
+    for (auto _ : state) {
+        state.PauseTiming();
+        uint32_t    uiServiceID = pEnv->createService(def_benchmarkDispatchService, szParam);
+        service_tt* pService    = serviceCenter_gain(uiServiceID);
+        state.ResumeTiming();
+        if (pService == NULL) {
+            state.SkipWithError("create dispatch service error");
+            break;
+        }
+        for (int32_t i = 0; i < iBurst; ++i) {
+            while (!service_send(pService, 0, "ping", 4, DEF_EVENT_MSG | DEF_EVENT_MSG_TEXT, 0)) {
+                threadYield();
+            }
+        }
+        service_release(pService);
+        pEnv->waitForServiceCount(0);
+    }
+    state.SetItemsProcessed(state.iterations() * iBurst);
+}
+
+// 配置了C_debug_ip/C_debug_port但未挂接, 每次回调只多一次原子读
+static void BM_luaService_dispatchDetached(benchmark::State& state)
+{
+    dispatchTextBurst(state, "");
+}
+
+// 对照: 服务自身装上行/调用钩子, 相当于调试器常驻挂接
+static void BM_luaService_dispatchHooked(benchmark::State& state)
+{
+    dispatchTextBurst(state, "hook");
+}
+
+BENCHMARK(BM_luaService_dispatchDetached)->Arg(4096)->UseRealTime();
+BENCHMARK(BM_luaService_dispatchHooked)->Arg(4096)->UseRealTime();
+
+#endif
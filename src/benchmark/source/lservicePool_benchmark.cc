@@ -0,0 +1,51 @@
+#include "benchmark/benchmark.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include "luaServiceEnv.h"
+
+// 一次迭代突发创建state.range(0)个服务并等待它们全部退出
+static void BM_luaService_createCold(benchmark::State& state)
+{
+    luaServiceEnv* pEnv = luaServiceEnv::get();
+    if (!pEnv->ready()) {
+        state.SkipWithError("lruntime env init error");
+        return;
+    }
+    pEnv->preparePool(def_benchmarkPoolService, 0);
+    int32_t iBurst = (int32_t)state.range(0);
+    for (auto _ : state) {
+        for (int32_t i = 0; i < iBurst; ++i) {
+            benchmark::DoNotOptimize(pEnv->createService(def_benchmarkPoolService, NULL));
+        }
+        pEnv->waitForServiceCount(0);
+    }
+    state.SetItemsProcessed(state.iterations() * iBurst);
+}
+
+static void BM_luaService_createPooled(benchmark::State& state)
+{
+    luaServiceEnv* pEnv = luaServiceEnv::get();
+    if (!pEnv->ready()) {
+        state.SkipWithError("lruntime env init error");
+        return;
+    }
+    int32_t iBurst = (int32_t)state.range(0);
+    pEnv->preparePool(def_benchmarkPoolService, iBurst);
+    for (auto _ : state) {
+        state.PauseTiming();
+        pEnv->waitForPool(def_benchmarkPoolService, iBurst);
+        state.ResumeTiming();
+        for (int32_t i = 0; i < iBurst; ++i) {
+            benchmark::DoNotOptimize(pEnv->createService(def_benchmarkPoolService, NULL));
+        }
+        pEnv->waitForServiceCount(0);
+    }
+    pEnv->preparePool(def_benchmarkPoolService, 0);
+    state.SetItemsProcessed(state.iterations() * iBurst);
+}
+
+BENCHMARK(BM_luaService_createCold)->Arg(8)->Arg(64)->UseRealTime();
+BENCHMARK(BM_luaService_createPooled)->Arg(8)->Arg(64)->UseRealTime();
+
+#endif
@@ -0,0 +1,185 @@
+#include "luaServiceEnv.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+extern "C" {
+    #include "lauxlib.h"
+    #include "lualib.h"
+
+    #include "thread_t.h"
+    #include "service_t.h"
+    #include "serviceCenter_t.h"
+}
+
+#if defined(__APPLE__)
+#    define def_benchmarkModuleCPath "modules/?.dylib"
+#else
+#    define def_benchmarkModuleCPath "modules/?.so"
+#endif
+
+// 立即退出
+static const char* s_szPoolService = "local serviceCore = require \"serviceCore\"\n"
+                                     "local lservice = require \"lruntime.service\"\n"
+                                     "lservice.exit()\n";
+
+// 参数"count [hook]", 收满count条文本消息后退出, hook模拟挂接调试器时的行/调用钩子
+static const char* s_szDispatchService =
+    "local serviceCore = require \"serviceCore\"\n"
+    "local count, mode = string.match(..., \"(%d+)%s*(%a*)\")\n"
+    "count = tonumber(count)\n"
+    "serviceCore.start(function()\n"
+    "    if mode == \"hook\" then\n"
+    "        debug.sethook(function() end, \"crl\")\n"
+    "    end\n"
+    "    serviceCore.eventDispatch(serviceCore.eventText, function()\n"
+    "        count = count - 1\n"
+    "        if count == 0 then\n"
+    "            serviceCore.exit()\n"
+    "        end\n"
+    "    end)\n"
+    "end)\n";
+
+static bool writeFile(const std::string& path, const std::string& content)
+{
+    FILE* pFile = fopen(path.c_str(), "w");
+    if (pFile == NULL) {
+        return false;
+    }
+    fwrite(content.data(), 1, content.size(), pFile);
+    fclose(pFile);
+    return true;
+}
+
+static void countService(service_tt* pService, void* pUserData)
+{
+    ++*(int32_t*)pUserData;
+}
+
+luaServiceEnv* luaServiceEnv::get()
+{
+    static luaServiceEnv* s_pEnv = new luaServiceEnv();
+    return s_pEnv;
+}
+
+luaServiceEnv::luaServiceEnv()
+    : m_pLuaState(NULL)
+    , m_bReady(false)
+{
+    char szTemplate[] = "/tmp/frogBenchXXXXXX";
+    if (mkdtemp(szTemplate) == NULL || chdir(szTemplate) != 0) {
+        return;
+    }
+
+    if (symlink(DEF_BENCHMARK_RUNTIME_DIR, "modules") != 0) {
+        return;
+    }
+
+    std::string cfg = "C_node_id = 1\n"
+                      "C_concurrent_threads = 0\n"
+                      "C_log_path = \".\"\n"
+                      "C_log_name = \"_log\"\n"
+                      "C_log = false\n"
+                      "C_profile = false\n"
+                      "C_loader_path = \"" DEF_BENCHMARK_LUA_DIR "/library\"\n"
+                      "C_service_path = \".\"\n"
+                      "C_bootstrap = \"" def_benchmarkPoolService "\"\n"
+                      "C_debug_ip = \"127.0.0.1\"\n"
+                      "C_debug_port = \"9966\"\n";
+    if (!writeFile("cfg.lua", cfg) ||
+        !writeFile(def_benchmarkPoolService ".lua", s_szPoolService) ||
+        !writeFile(def_benchmarkDispatchService ".lua", s_szDispatchService)) {
+        return;
+    }
+
+    m_pLuaState = luaL_newstate();
+    luaL_openlibs(m_pLuaState);
+    if (luaL_dostring(m_pLuaState,
+                      "package.cpath = '" def_benchmarkModuleCPath "'\n"
+                      "local lenv = require 'lruntime.env'\n"
+                      "assert(lenv.init('cfg.lua'))\n"
+                      "return lenv") != LUA_OK) {
+        fprintf(stderr, "lruntime.env init error:%s\n", lua_tostring(m_pLuaState, -1));
+        return;
+    }
+    lua_setglobal(m_pLuaState, "lenv");
+    waitForServiceCount(0);
+    m_bReady = true;
+}
+
+uint32_t luaServiceEnv::createService(const char* szName, const char* szParam)
+{
+    lua_getglobal(m_pLuaState, "lenv");
+    lua_getfield(m_pLuaState, -1, "createService");
+    lua_pushstring(m_pLuaState, szName);
+    if (szParam) {
+        lua_pushstring(m_pLuaState, szParam);
+    }
+    else {
+        lua_pushnil(m_pLuaState);
+    }
+    lua_call(m_pLuaState, 2, 1);
+    uint32_t uiServiceID = (uint32_t)lua_tointeger(m_pLuaState, -1);
+    lua_pop(m_pLuaState, 2);
+    return uiServiceID;
+}
+
+void luaServiceEnv::preparePool(const char* szName, int32_t iCapacity)
+{
+    lua_getglobal(m_pLuaState, "lenv");
+    lua_getfield(m_pLuaState, -1, "servicePool");
+    lua_pushstring(m_pLuaState, szName);
+    lua_pushinteger(m_pLuaState, iCapacity);
+    lua_newtable(m_pLuaState);
+    lua_pushstring(m_pLuaState, "serviceCore");
+    lua_rawseti(m_pLuaState, -2, 1);
+    lua_call(m_pLuaState, 3, 0);
+    lua_pop(m_pLuaState, 1);
+}
+
+int32_t luaServiceEnv::poolReady(const char* szName)
+{
+    lua_getglobal(m_pLuaState, "lenv");
+    lua_getfield(m_pLuaState, -1, "servicePoolStatus");
+    lua_pushstring(m_pLuaState, szName);
+    lua_call(m_pLuaState, 1, 1);
+    int32_t iReady = (int32_t)lua_tointeger(m_pLuaState, -1);
+    lua_pop(m_pLuaState, 2);
+    return iReady;
+}
+
+void luaServiceEnv::waitForPool(const char* szName, int32_t iCount)
+{
+    while (poolReady(szName) < iCount) {
+        threadYield();
+    }
+}
+
+int32_t luaServiceEnv::serviceCount() const
+{
+    int32_t iCount = 0;
+    serviceCenter_foreachService(countService, &iCount);
+    return iCount;
+}
+
+void luaServiceEnv::waitForServiceCount(int32_t iCount)
+{
+    while (serviceCount() > iCount) {
+        threadYield();
+    }
+}
+
+bool luaServiceEnv::isDebugAttached()
+{
+    lua_getglobal(m_pLuaState, "lenv");
+    lua_getfield(m_pLuaState, -1, "isDebugAttached");
+    lua_call(m_pLuaState, 0, 1);
+    bool bAttached = lua_toboolean(m_pLuaState, -1) != 0;
+    lua_pop(m_pLuaState, 2);
+    return bAttached;
+}
+
+#endif
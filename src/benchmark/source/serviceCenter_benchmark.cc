@@ -0,0 +1,97 @@
+#include "benchmark/benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <inttypes.h>
+
+extern "C" {
+    #include "eventIO/eventIO_t.h"
+    #include "service_t.h"
+    #include "serviceCenter_t.h"
+}
+
+#define def_benchmarkServiceCount 64
+
+class serviceCenterData
+{
+public:
+    serviceCenterData();
+
+    uint32_t serviceID(uint32_t uiIndex) const
+    {
+        return m_serviceIDs[uiIndex % def_benchmarkServiceCount];
+    }
+
+private:
+    eventIO_tt* m_pEventIO;
+    service_tt* m_pServices[def_benchmarkServiceCount];
+    uint32_t    m_serviceIDs[def_benchmarkServiceCount];
+};
+
+serviceCenterData::serviceCenterData()
+{
+    m_pEventIO = createEventIO();
+    eventIO_setConcurrentThreads(m_pEventIO, 1);
+    eventIO_start(m_pEventIO, true);
+    serviceCenter_init(1);
+    for (int32_t i = 0; i < def_benchmarkServiceCount; ++i) {
+        m_pServices[i]  = createService(m_pEventIO);
+        m_serviceIDs[i] = service_start(m_pServices[i], NULL, NULL, NULL);
+    }
+}
+
+static serviceCenterData* getServiceCenterData()
+{
+    static serviceCenterData* s_pData = new serviceCenterData();
+    return s_pData;
+}
+
+static std::atomic<uint32_t> s_uiThreadSeed(0);
+
+static void BM_serviceCenter_gainRelease(benchmark::State& state)
+{
+    serviceCenterData* pData  = getServiceCenterData();
+    uint32_t           uiSeed = s_uiThreadSeed.fetch_add(7);
+    int64_t            iMiss  = 0;
+    for (auto _ : state) {
+        service_tt* pService = serviceCenter_gain(pData->serviceID(uiSeed++));
+        if (pService) {
+            service_release(pService);
+        }
+        else {
+            ++iMiss;
+        }
+    }
+    state.counters["miss"] = benchmark::Counter((double)iMiss, benchmark::Counter::kAvgThreads);
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_serviceCenter_gainSame(benchmark::State& state)
+{
+    serviceCenterData* pData       = getServiceCenterData();
+    uint32_t           uiServiceID = pData->serviceID(0);
+    for (auto _ : state) {
+        service_tt* pService = serviceCenter_gain(uiServiceID);
+        if (pService) {
+            service_release(pService);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_serviceCenter_gainStale(benchmark::State& state)
+{
+    serviceCenterData* pData       = getServiceCenterData();
+    uint32_t           uiServiceID = pData->serviceID(0) ^ (1 << 16);
+    for (auto _ : state) {
+        service_tt* pService = serviceCenter_gain(uiServiceID);
+        benchmark::DoNotOptimize(pService);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_serviceCenter_gainRelease)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_serviceCenter_gainSame)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK(BM_serviceCenter_gainStale)->ThreadRange(1, 32)->UseRealTime();
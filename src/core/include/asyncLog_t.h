@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "platform_t.h"
+
+// 异步日志: 每个线程一个单生产者环形缓冲, 由写线程批量写入常开的文件;
+// 缓冲满或单条超过64KB时丢弃并计数, 不阻塞调用线程
+
+struct asyncLogFile_s;
+typedef struct asyncLogFile_s asyncLogFile_tt;
+
+typedef enum
+{
+    eAsyncLogArg_nil = 0,
+    eAsyncLogArg_bool,
+    eAsyncLogArg_integer,
+    eAsyncLogArg_number,
+    eAsyncLogArg_string,
+} enAsyncLogArgType;
+
+// 结构化日志的一个参数, 字符串只需在asyncLog_writeStruct调用期间有效
+typedef struct asyncLogArg_s
+{
+    enAsyncLogArgType eType;
+    union
+    {
+        bool    bValue;
+        int64_t iValue;
+        double  fValue;
+        struct
+        {
+            const char* szValue;
+            size_t      nLength;
+        } str;
+    };
+} asyncLogArg_tt;
+
+// 第一次asyncLog_open时自动启动写线程, 进程退出时自动停止
+frCore_API void asyncLog_stop();
+
+// nMaxBytes超过该大小或uiIntervalSec距打开超过该秒数时轮转, 为0表示不限制
+frCore_API void asyncLog_setRotate(size_t nMaxBytes, uint32_t uiIntervalSec);
+
+frCore_API uint64_t asyncLog_getDropped();
+
+// 文件在写线程中第一次写入时打开
+frCore_API asyncLogFile_tt* asyncLog_open(const char* szPath);
+
+// 之前写入的内容会全部落盘后再关闭, 调用后不能再写
+frCore_API void asyncLog_close(asyncLogFile_tt* pFile);
+
+// 线程安全的localtime, 供各处拼日志行头使用
+frCore_API void asyncLog_localTime(time_t t, struct tm* pTm);
+
+// szText为一整行(不含换行), 返回false表示被丢弃(计入asyncLog_getDropped)
+frCore_API bool asyncLog_write(asyncLogFile_tt* pFile, const char* szText, size_t nLength);
+
+// 注册结构化日志格式, 如"player {player} enter scene {scene}", {name}按顺序对应参数;
+// 相同的格式返回相同的ID, 格式表满时返回0
+frCore_API uint32_t asyncLog_registerFormat(const char* szFormat);
+
+// bJson时结构化记录写成JSON行, 否则按格式展开成文本行
+frCore_API void asyncLog_setJson(asyncLogFile_tt* pFile, bool bJson);
+
+// 调用线程只拷贝格式ID和参数原始值, 展开由写线程完成; 返回false表示被丢弃
+frCore_API bool asyncLog_writeStruct(asyncLogFile_tt* pFile, uint32_t uiFormatID, int32_t iLevel,
+                                     uint32_t uiServiceID, const asyncLogArg_tt* pArgs,
+                                     int32_t iCount);
@@ -16,12 +16,14 @@ typedef int32_t SOCKET;
 #endif
 
 struct eventBuf_s;
+struct eventBufShared_s;
 struct eventTimer_s;
 struct eventWatcher_s;
 struct eventConnection_s;
 struct eventListenPort_s;
 
 typedef struct eventBuf_s        eventBuf_tt;
+typedef struct eventBufShared_s  eventBufShared_tt;
 typedef struct eventTimer_s      eventTimer_tt;
 typedef struct eventDgram_s      eventDgram_tt;
 typedef struct eventWatcher_s    eventWatcher_tt;
@@ -60,6 +62,25 @@ frCore_API uint32_t eventIO_getNumberOfConcurrentThreads(eventIO_tt* pEventIO);
 
 frCore_API int32_t eventIO_getIdleThreads(eventIO_tt* pEventIO);
 
+typedef struct eventIOLoopStats_s
+{
+    uint64_t uiWakeups;
+    uint64_t uiEvents;
+    uint64_t uiTasks;
+    uint64_t uiBusyNs;
+    uint64_t uiIdleNs;
+    uint64_t uiStallMs; // 本次唤醒已持续的时间, 在poller_wait中为0
+    int32_t  iConnections;
+} eventIOLoopStats_tt;
+
+// 返回写入pStats的事件循环线程数
+frCore_API int32_t eventIO_getLoopStats(eventIO_tt* pEventIO, eventIOLoopStats_tt* pStats,
+                                        int32_t iCount);
+
+// 返回触发的定时器总数, pMaxLagMs为上次调用以来的最大延迟
+frCore_API uint64_t eventIO_getTimerLag(eventIO_tt* pEventIO, double* pTotalLagMs,
+                                        uint64_t* pMaxLagMs);
+
 // eventTimer
 frCore_API eventTimer_tt* createEventTimer(eventIO_tt* pEventIO, void (*fn)(eventTimer_tt*, void*),
                                            bool bOnce, uint32_t uiIntervalMs, void* pUserData);
@@ -149,6 +170,12 @@ frCore_API size_t eventConnection_getWritePendingBytes(eventConnection_tt* pHand
 
 frCore_API size_t eventConnection_getReceiveBufLength(eventConnection_tt* pHandle);
 
+frCore_API uintptr_t eventConnection_getLoopKey(eventConnection_tt* pHandle);
+
+frCore_API void eventConnection_runInLoop(eventConnection_tt* pHandle, eventAsync_tt* pEventAsync,
+                                          void (*fnWork)(eventAsync_tt*),
+                                          void (*fnCancel)(eventAsync_tt*));
+
 // eventListenPort
 frCore_API eventListenPort_tt* createEventListenPort(eventIO_tt*           pEventIO,
                                                      const inetAddress_tt* pInetAddress, bool bTcp);
@@ -178,8 +205,19 @@ frCore_API eventBuf_tt* createEventBuf_move(ioBufVec_tt* pBufVec, int32_t iCount
                                             void (*fn)(eventConnection_tt*, void*, bool, uintptr_t),
                                             uintptr_t uiWriteUser);
 
+frCore_API eventBuf_tt* createEventBuf_shared(eventBufShared_tt* pShared,
+                                              void (*fn)(eventConnection_tt*, void*, bool, uintptr_t),
+                                              uintptr_t uiWriteUser);
+
 frCore_API void eventBuf_release(eventBuf_tt* pHandle);
 
+// eventBufShared
+frCore_API eventBufShared_tt* createEventBufShared(ioBufVec_tt* pBufVec, int32_t iCount);
+
+frCore_API void eventBufShared_addref(eventBufShared_tt* pHandle);
+
+frCore_API void eventBufShared_release(eventBufShared_tt* pHandle);
+
 // accept recvfrom
 frCore_API void setAcceptRecvFromFilterCallback(bool (*fn)(const inetAddress_tt*, const char*,
                                                            uint32_t));
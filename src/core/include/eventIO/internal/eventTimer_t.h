@@ -66,6 +66,7 @@ static inline void eventTimer_run(struct eventTimer_s* pHandle)
     heap_remove(&pHandle->pEventIO->timerHeap, &pHandle->node, timerLessThan);
     if (pHandle->bOnce) {
         pHandle->bActive = false;
+        metricsGauge_add(pHandle->pEventIO->pMetricsTimers, -1);
 
         bool bRunning = true;
         if (atomic_compare_exchange_strong(&pHandle->bRunning, &bRunning, false)) {
@@ -86,6 +87,7 @@ static inline void eventTimer_run(struct eventTimer_s* pHandle)
         }
         else {
             pHandle->bActive = false;
+            metricsGauge_add(pHandle->pEventIO->pMetricsTimers, -1);
             if (pHandle->fnCloseCallback) {
                 pHandle->fnCloseCallback(pHandle, pHandle->pUserData);
             }
@@ -126,6 +128,7 @@ static inline void inLoop_eventTimer_start(eventAsync_tt* pEventAsync)
 
             heap_insert(&pHandle->pEventIO->timerHeap, &pHandle->node, timerLessThan);
             pHandle->bActive = true;
+            metricsGauge_add(pHandle->pEventIO->pMetricsTimers, 1);
         }
         else {
             if (pHandle->fnCloseCallback) {
@@ -146,6 +149,7 @@ static inline void inLoop_eventTimer_stop(eventAsync_tt* pEventAsync)
     if (pHandle->bActive) {
         pHandle->bActive = false;
         heap_remove(&pHandle->pEventIO->timerHeap, &pHandle->node, timerLessThan);
+        metricsGauge_add(pHandle->pEventIO->pMetricsTimers, -1);
 
         if (pHandle->fnCloseCallback) {
             pHandle->fnCloseCallback(pHandle, pHandle->pUserData);
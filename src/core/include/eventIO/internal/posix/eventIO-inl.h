@@ -9,6 +9,7 @@
 #include "heap_t.h"
 #include "thread_t.h"
 #include "spinLock_t.h"
+#include "metrics_t.h"
 
 #include "eventIO/internal/posix/poller_t.h"
 #include "eventIO/eventAsync_t.h"
@@ -39,6 +40,15 @@ struct eventIO_s
     cond_tt     cond;
     atomic_bool bLoopRunning;
     atomic_int  iRefCount;
+    metricsCounter_tt*   pMetricsPosts;
+    metricsCounter_tt*   pMetricsAccepts;
+    metricsCounter_tt*   pMetricsBytesRead;
+    metricsCounter_tt*   pMetricsBytesWritten;
+    metricsGauge_tt*     pMetricsConnections;
+    metricsGauge_tt*     pMetricsTimers;
+    metricsHistogram_tt* pMetricsLoopTime;
+    metricsHistogram_tt* pMetricsTimerLag;
+    atomic_ullong        uiTimerLagMaxMs;
 };
 
 static inline bool eventIO_isRunning(struct eventIO_s* pEventIO)
@@ -53,6 +63,7 @@ static inline void eventIO_postQueued(struct eventIO_s* pEventIO, eventAsync_tt*
     if (atomic_load(&pEventIO->bLoopRunning)) {
         pEventAsync->fnWork   = fnWork;
         pEventAsync->fnCancel = fnCancel;
+        metricsCounter_inc(pEventIO->pMetricsPosts);
 
 #ifdef DEF_USE_SPINLOCK
         spinLock_lock(&pEventIO->queuedLock);
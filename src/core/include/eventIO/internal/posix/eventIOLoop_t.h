@@ -1,6 +1,7 @@
 #pragma once
 
 #include "eventIO/internal/posix/eventIO-inl.h"
+#include "time_t.h"
 
 #include <stdlib.h>
 #include <signal.h>
@@ -120,7 +121,7 @@ struct eventIO_s;
 typedef struct eventIOLoop_s
 {
     void (*fnStop)(struct eventIO_s*);
-    void (*fnDoEvents)(struct eventIO_s*);
+    uint32_t (*fnDoEvents)(struct eventIO_s*);
     struct eventIO_s* pEventIO;
     poller_tt*        pPoller;
     wakeupEvent_tt    wakeupEvent;
@@ -130,13 +131,48 @@ typedef struct eventIOLoop_s
     uint64_t          uiThreadId;
     bool              bRunning;
     atomic_int        iConnections;
+    atomic_ullong     uiWakeNs;
+    atomic_ullong     uiSleepNs;
 #ifdef DEF_USE_SPINLOCK
     spinLock_tt spinLock;
 #else
     mutex_tt mutex;
 #endif
+    metricsCounter_tt* pMetricsWakeups;
+    metricsCounter_tt* pMetricsEvents;
+    metricsCounter_tt* pMetricsTasks;
+    metricsCounter_tt* pMetricsBusyNs;
+    metricsCounter_tt* pMetricsIdleNs;
 } eventIOLoop_tt;
 
+// poller_wait返回后调用, uiIdleSinceNs为进入poller_wait的时间, 返回本次唤醒的时间
+static inline uint64_t eventIOLoop_wakeup(eventIOLoop_tt* pEventIOLoop, uint64_t uiIdleSinceNs,
+                                          int32_t iEvents)
+{
+    timespec_tt now;
+    getClockMonotonic(&now);
+    uint64_t uiNowNs = timespec_toNsec(&now);
+    atomic_store_explicit(&pEventIOLoop->uiWakeNs, uiNowNs, memory_order_relaxed);
+    metricsCounter_inc(pEventIOLoop->pMetricsWakeups);
+    if (iEvents > 0) {
+        metricsCounter_add(pEventIOLoop->pMetricsEvents, (uint64_t)iEvents);
+    }
+    metricsCounter_add(pEventIOLoop->pMetricsIdleNs, uiNowNs - uiIdleSinceNs);
+    return uiNowNs;
+}
+
+// 再次进入poller_wait之前调用, 返回值作为下一次空闲的起点
+static inline uint64_t eventIOLoop_sleep(eventIOLoop_tt* pEventIOLoop, uint64_t uiWakeNs)
+{
+    timespec_tt now;
+    getClockMonotonic(&now);
+    uint64_t uiNowNs = timespec_toNsec(&now);
+    metricsCounter_add(pEventIOLoop->pMetricsBusyNs, uiNowNs - uiWakeNs);
+    atomic_store_explicit(&pEventIOLoop->uiSleepNs, uiNowNs, memory_order_relaxed);
+    atomic_store_explicit(&pEventIOLoop->uiWakeNs, 0, memory_order_relaxed);
+    return uiNowNs;
+}
+
 static inline bool eventIOLoop_isInLoopThread(eventIOLoop_tt* pEventIOLoop)
 {
     return pEventIOLoop->uiThreadId == threadId();
@@ -148,6 +184,7 @@ static inline void eventIOLoop_queueInLoop(eventIOLoop_tt* pEventIOLoop, eventAs
 {
     pEventAsync->fnWork   = fnWork;
     pEventAsync->fnCancel = fnCancel;
+    metricsCounter_inc(pEventIOLoop->pEventIO->pMetricsPosts);
 
 #ifdef DEF_USE_SPINLOCK
     spinLock_lock(&pEventIOLoop->spinLock);
@@ -188,7 +225,7 @@ __UNUSED void eventIOLoop_init(eventIOLoop_tt* pEventIOLoop, struct eventIO_s* p
 __UNUSED void eventIOLoop_clear(eventIOLoop_tt* pEventIOLoop);
 
 __UNUSED bool eventIOLoop_start(eventIOLoop_tt* pEventIOLoop, int32_t hQueuedEvent,
-                                void (*fnDoEvents)(struct eventIO_s*));
+                                uint32_t (*fnDoEvents)(struct eventIO_s*));
 
 __UNUSED void eventIOLoop_stop(eventIOLoop_tt* pEventIOLoop);
 
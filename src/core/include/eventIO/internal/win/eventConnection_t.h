@@ -41,9 +41,17 @@ struct eventBuf_s
     eventConnection_overlappedPlus_tt overlapped;
     uint32_t                          uiLength;
     uintptr_t                         uiWriteUser;
+    struct eventBufShared_s*          pShared;
     char                              szStorage[];
 };
 
+struct eventBufShared_s
+{
+    atomic_int  iRefCount;
+    int32_t     iCount;
+    ioBufVec_tt bufVec[];
+};
+
 typedef void (*disconnectCallbackPtr)(struct eventConnection_s*, void*);
 
 struct eventListenPort_s;
@@ -13,6 +13,7 @@
 #include "thread_t.h"
 #include "log_t.h"
 #include "spinLock_t.h"
+#include "metrics_t.h"
 
 #define DEF_USE_SPINLOCK
 
@@ -41,6 +42,15 @@ struct eventIO_s
     atomic_bool bLoopNotified;
     cond_tt     cond;
     atomic_int  iRefCount;
+    metricsCounter_tt*   pMetricsPosts;
+    metricsCounter_tt*   pMetricsAccepts;
+    metricsCounter_tt*   pMetricsBytesRead;
+    metricsCounter_tt*   pMetricsBytesWritten;
+    metricsGauge_tt*     pMetricsConnections;
+    metricsGauge_tt*     pMetricsTimers;
+    metricsHistogram_tt* pMetricsLoopTime;
+    metricsHistogram_tt* pMetricsTimerLag;
+    atomic_ullong        uiTimerLagMaxMs;
 };
 
 static inline bool eventIO_isRunning(struct eventIO_s* pEventIO)
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utility_t.h"
+
+// 每个线程只有一个hazard槽, protect/clear 之间不可嵌套
+struct hazardPointer_s;
+typedef struct hazardPointer_s hazardPointer_tt;
+
+frCore_API hazardPointer_tt* createHazardPointer(void (*fnReclaim)(void*));
+
+// 回收所有已retire的对象并释放, 调用方需保证此时没有线程持有hazard
+frCore_API void hazardPointer_release(hazardPointer_tt* pHandle);
+
+frCore_API void* hazardPointer_protect(void* _Atomic* pSlot);
+
+frCore_API void hazardPointer_clear();
+
+frCore_API void hazardPointer_retire(hazardPointer_tt* pHandle, void* pData);
+
+frCore_API void hazardPointer_scan(hazardPointer_tt* pHandle);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utility_t.h"
+
+#ifdef _MSC_VER
+#    include <intrin.h>
+#endif
+
+// 对数-线性分桶(HDR风格): 每个2的幂区间再等分8份, 相对误差不超过12.5%
+#define DEF_LATENCY_HISTOGRAM_SUB_BITS 3
+#define DEF_LATENCY_HISTOGRAM_SUB_COUNT (1 << DEF_LATENCY_HISTOGRAM_SUB_BITS)
+#define DEF_LATENCY_HISTOGRAM_MAX_BITS 32
+#define DEF_LATENCY_HISTOGRAM_BUCKETS                                                  \
+    ((DEF_LATENCY_HISTOGRAM_MAX_BITS - DEF_LATENCY_HISTOGRAM_SUB_BITS + 1) *           \
+     DEF_LATENCY_HISTOGRAM_SUB_COUNT)
+
+// 单写者(同一时刻只有一个线程record), 读者可在任意线程无锁读取快照
+typedef struct latencyHistogram_s
+{
+    atomic_uint   uiBuckets[DEF_LATENCY_HISTOGRAM_BUCKETS];
+    atomic_ullong uiCount;
+    atomic_ullong uiMax;
+} latencyHistogram_tt;
+
+static inline int32_t latencyHistogram_bucket(uint64_t uiValue)
+{
+    if (uiValue < DEF_LATENCY_HISTOGRAM_SUB_COUNT) {
+        return (int32_t)uiValue;
+    }
+    if (uiValue >= ((uint64_t)1 << DEF_LATENCY_HISTOGRAM_MAX_BITS)) {
+        return DEF_LATENCY_HISTOGRAM_BUCKETS - 1;
+    }
+#if defined(_MSC_VER)
+    unsigned long ulIndex = 0;
+    _BitScanReverse64(&ulIndex, uiValue);
+    int32_t iExp = (int32_t)ulIndex;
+#else
+    int32_t iExp = 63 - __builtin_clzll(uiValue);
+#endif
+    int32_t iShift = iExp - DEF_LATENCY_HISTOGRAM_SUB_BITS;
+    return (iShift + 1) * DEF_LATENCY_HISTOGRAM_SUB_COUNT +
+           (int32_t)((uiValue >> iShift) & (DEF_LATENCY_HISTOGRAM_SUB_COUNT - 1));
+}
+
+// 单写者无需原子读改写, relaxed的load/store足够
+static inline void latencyHistogram_record(latencyHistogram_tt* pHistogram, uint64_t uiValue)
+{
+    atomic_uint* pBucket = &pHistogram->uiBuckets[latencyHistogram_bucket(uiValue)];
+    atomic_store_explicit(
+        pBucket, atomic_load_explicit(pBucket, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_store_explicit(&pHistogram->uiCount,
+                          atomic_load_explicit(&pHistogram->uiCount, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    if (uiValue > atomic_load_explicit(&pHistogram->uiMax, memory_order_relaxed)) {
+        atomic_store_explicit(&pHistogram->uiMax, uiValue, memory_order_relaxed);
+    }
+}
+
+frCore_API void latencyHistogram_init(latencyHistogram_tt* pHistogram);
+
+// 把pFrom的快照累加到pTo, pTo只能由调用方独占
+frCore_API void latencyHistogram_merge(latencyHistogram_tt* pTo, const latencyHistogram_tt* pFrom);
+
+frCore_API uint64_t latencyHistogram_count(const latencyHistogram_tt* pHistogram);
+
+frCore_API uint64_t latencyHistogram_max(const latencyHistogram_tt* pHistogram);
+
+// fPercentile取值(0, 100], 返回所在桶的上界, 没有样本时返回0
+frCore_API uint64_t latencyHistogram_percentile(const latencyHistogram_tt* pHistogram,
+                                                double                     fPercentile);
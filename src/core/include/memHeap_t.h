@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "utility_t.h"
+
+// 私有分配堆, 只能在创建线程上分配, 任意线程都可以用mem_free释放
+// 未启用mimalloc或mem函数被替换时createMemHeap返回NULL
+struct memHeap_s;
+typedef struct memHeap_s memHeap_tt;
+
+frCore_API memHeap_tt* createMemHeap();
+
+// 非创建线程调用时只释放句柄, 堆中的块交由mimalloc回收
+frCore_API void memHeap_release(memHeap_tt* pHandle);
+
+// 一次释放堆中所有的块, 只能在创建线程调用
+frCore_API bool memHeap_destroy(memHeap_tt* pHandle);
+
+frCore_API bool memHeap_isOwner(memHeap_tt* pHandle);
+
+frCore_API bool memHeap_contains(memHeap_tt* pHandle, const void* p);
+
+frCore_API void* memHeap_realloc(memHeap_tt* pHandle, void* p, size_t nSize);
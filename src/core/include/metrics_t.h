@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "utility_t.h"
+
+#define DEF_METRICS_SHARDS 16
+#define DEF_METRICS_HISTOGRAM_MAX_BUCKETS 32
+#define DEF_METRICS_MAX_COLLECTORS 16
+
+// 指标注册后在进程生命周期内一直有效, 指针可以长期持有
+// 名字可以带标签, 如 frog_xxx_total{loop="1"}, 同名不同标签的指标归为一族输出
+
+// 计数器按线程分片, 每片独占一个cache line, 写入只有一次relaxed的fetch_add
+typedef struct metricsShard_s
+{
+    atomic_ullong uiValue;
+    char          padding[64 - sizeof(atomic_ullong)];
+} metricsShard_tt;
+
+typedef struct metricsCounter_s
+{
+    metricsShard_tt shards[DEF_METRICS_SHARDS];
+} metricsCounter_tt;
+
+// double按位存放在atomic_ullong中
+typedef struct metricsGauge_s
+{
+    atomic_ullong uiBits;
+} metricsGauge_tt;
+
+typedef struct metricsHistogram_s
+{
+    int32_t       iBucketCount;
+    double        bounds[DEF_METRICS_HISTOGRAM_MAX_BUCKETS];
+    atomic_ullong uiBuckets[DEF_METRICS_HISTOGRAM_MAX_BUCKETS + 1];
+    atomic_ullong uiCount;
+    atomic_ullong uiSumBits;
+} metricsHistogram_tt;
+
+frCore_API int32_t metrics_nextShard();
+
+static inline int32_t metrics_shard()
+{
+    static _decl_threadLocal int32_t s_iShard = -1;
+    if (_UnLikely(s_iShard < 0)) {
+        s_iShard = metrics_nextShard();
+    }
+    return s_iShard;
+}
+
+static inline uint64_t metrics_doubleToBits(double fValue)
+{
+    uint64_t uiBits;
+    memcpy(&uiBits, &fValue, sizeof(uiBits));
+    return uiBits;
+}
+
+static inline double metrics_bitsToDouble(uint64_t uiBits)
+{
+    double fValue;
+    memcpy(&fValue, &uiBits, sizeof(fValue));
+    return fValue;
+}
+
+static inline void metricsCounter_add(metricsCounter_tt* pCounter, uint64_t uiValue)
+{
+    atomic_fetch_add_explicit(
+        &pCounter->shards[metrics_shard()].uiValue, uiValue, memory_order_relaxed);
+}
+
+static inline void metricsCounter_inc(metricsCounter_tt* pCounter)
+{
+    metricsCounter_add(pCounter, 1);
+}
+
+static inline void metricsGauge_set(metricsGauge_tt* pGauge, double fValue)
+{
+    atomic_store_explicit(&pGauge->uiBits, metrics_doubleToBits(fValue), memory_order_relaxed);
+}
+
+static inline void metricsGauge_add(metricsGauge_tt* pGauge, double fValue)
+{
+    uint64_t uiBits = atomic_load_explicit(&pGauge->uiBits, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(
+        &pGauge->uiBits,
+        &uiBits,
+        metrics_doubleToBits(metrics_bitsToDouble(uiBits) + fValue),
+        memory_order_relaxed,
+        memory_order_relaxed)) {
+    }
+}
+
+static inline double metricsGauge_get(metricsGauge_tt* pGauge)
+{
+    return metrics_bitsToDouble(atomic_load_explicit(&pGauge->uiBits, memory_order_relaxed));
+}
+
+frCore_API void metricsHistogram_observe(metricsHistogram_tt* pHistogram, double fValue);
+
+frCore_API uint64_t metricsCounter_get(metricsCounter_tt* pCounter);
+
+// 已存在同名指标时直接返回, 类型不一致返回NULL
+frCore_API metricsCounter_tt* metrics_registerCounter(const char* szName, const char* szHelp);
+
+frCore_API metricsGauge_tt* metrics_registerGauge(const char* szName, const char* szHelp);
+
+// pBounds为升序的桶上界, 为NULL时使用默认的1,2,5,10...分桶, 超过上限的部分截断
+frCore_API metricsHistogram_tt* metrics_registerHistogram(const char* szName, const char* szHelp,
+                                                         const double* pBounds, int32_t iCount);
+
+// 采集前回调, 用于在导出时刷新由外部状态计算出的gauge
+frCore_API bool metrics_addCollector(void (*fnCollect)(void*), void* pUserData);
+
+frCore_API void metrics_removeCollector(void (*fnCollect)(void*), void* pUserData);
+
+// 返回Prometheus文本格式, 由调用方mem_free
+frCore_API char* metrics_render(size_t* pLength);
@@ -0,0 +1,858 @@
+#include "asyncLog_t.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fs_t.h"
+#include "log_t.h"
+#include "metrics_t.h"
+#include "thread_t.h"
+#include "time_t.h"
+#include "utility_t.h"
+
+#define def_asyncLogRingBytes (256 * 1024)
+#define def_asyncLogMaxLine (def_asyncLogRingBytes / 4)
+#define def_asyncLogFlushMs 50
+#define def_asyncLogFileBuffer (64 * 1024)
+#define def_asyncLogMaxFormats 4096
+
+#define def_asyncLogKindText 0
+#define def_asyncLogKindStruct 1
+
+// 记录按16字节对齐, 环尾剩余空间不足时写一条pFile为NULL的跳过记录
+typedef struct asyncLogRecord_s
+{
+    asyncLogFile_tt* pFile;
+    uint32_t         uiLength;
+    uint32_t         uiKind;
+} asyncLogRecord_tt;
+
+// 结构化记录的负载: 头部之后依次是参数, 每个参数1字节类型加原始值, 字符串为4字节长度加内容
+typedef struct asyncLogStructHead_s
+{
+    uint32_t uiFormatID;
+    uint32_t uiServiceID;
+    int64_t  iTimeMs;
+    int32_t  iLevel;
+    int32_t  iCount;
+} asyncLogStructHead_tt;
+
+typedef struct asyncLogRing_s
+{
+    struct asyncLogRing_s* pNext;
+    atomic_bool            bActive;
+    atomic_ullong          uiDropped;
+    char*                  pBuffer;
+    atomic_size_t          nHead;
+    char                   padding[64];
+    atomic_size_t          nTail;
+} asyncLogRing_tt;
+
+struct asyncLogFile_s
+{
+    struct asyncLogFile_s* pNext;
+    char*                  szPath;
+    FILE*                  hFile;
+    size_t                 nWritten;
+    time_t                 openTime;
+    bool                   bDirty;
+    atomic_bool            bJson;
+    atomic_bool            bCloseRequested;
+    uint64_t               uiCloseRound;
+};
+
+typedef struct asyncLog_s
+{
+    mutex_tt           mutex;
+    cond_tt            cond;
+    thread_tt          thread;
+    atomic_bool        bRunning;
+    atomic_bool        bSync;
+    atomic_bool        bWakeup;
+    asyncLogFile_tt*   pFiles;
+    uint64_t           uiRound;
+    uint64_t           uiReportedDropped;
+    metricsCounter_tt* pMetricsDropped;
+    char*              pRender;
+    size_t             nRenderLength;
+    size_t             nRenderCapacity;
+    int64_t            iRenderSec;
+    struct tm          renderTime;
+} asyncLog_tt;
+
+static asyncLog_tt                        s_asyncLog;
+static _Atomic(asyncLogRing_tt*)          s_pRingHead        = NULL;
+static atomic_size_t                      s_nRotateBytes     = 0;
+static atomic_uint                        s_uiRotateSec      = 0;
+static _decl_threadLocal asyncLogRing_tt* s_pThreadRing      = NULL;
+static atomic_bool                        s_bAsyncLogInit    = false;
+static once_flag_tt                       s_asyncLogOnceFlag = ONCE_FLAG_INIT;
+static _Atomic(char*)                     s_formats[def_asyncLogMaxFormats];
+static atomic_uint                        s_uiFormatCount = 0;
+
+static inline size_t asyncLog_recordBytes(size_t nLength)
+{
+    return (sizeof(asyncLogRecord_tt) + nLength + 15) & ~(size_t)15;
+}
+
+static void asyncLogRing_exit(void* pArg)
+{
+    asyncLogRing_tt* pRing = (asyncLogRing_tt*)pArg;
+    atomic_store_explicit(&pRing->bActive, false, memory_order_release);
+}
+
+// 线程退出后环交给下一个新线程复用, 未写完的内容仍由写线程按序取走
+static asyncLogRing_tt* asyncLogRing_acquire()
+{
+    asyncLogRing_tt* pRing = atomic_load(&s_pRingHead);
+    while (pRing) {
+        bool bActive = false;
+        if (!atomic_load_explicit(&pRing->bActive, memory_order_relaxed) &&
+            atomic_compare_exchange_strong(&pRing->bActive, &bActive, true)) {
+            break;
+        }
+        pRing = pRing->pNext;
+    }
+
+    if (pRing == NULL) {
+        pRing          = mem_malloc(sizeof(asyncLogRing_tt));
+        pRing->pBuffer = mem_malloc(def_asyncLogRingBytes);
+        atomic_init(&pRing->bActive, true);
+        atomic_init(&pRing->uiDropped, 0);
+        atomic_init(&pRing->nHead, 0);
+        atomic_init(&pRing->nTail, 0);
+        asyncLogRing_tt* pHead = atomic_load(&s_pRingHead);
+        do {
+            pRing->pNext = pHead;
+        } while (!atomic_compare_exchange_weak(&s_pRingHead, &pHead, pRing));
+    }
+
+    setTlsValue(&s_pRingHead, asyncLogRing_exit, pRing, false);
+    s_pThreadRing = pRing;
+    return pRing;
+}
+
+static bool asyncLogFile_open(asyncLogFile_tt* pFile)
+{
+    pFile->hFile = fopen(pFile->szPath, "ab");
+    if (pFile->hFile == NULL) {
+        return false;
+    }
+    setvbuf(pFile->hFile, NULL, _IOFBF, def_asyncLogFileBuffer);
+    fseek(pFile->hFile, 0, SEEK_END);
+    long lSize      = ftell(pFile->hFile);
+    pFile->nWritten = lSize > 0 ? (size_t)lSize : 0;
+    pFile->openTime = time(NULL);
+    return true;
+}
+
+static void asyncLogFile_rotate(asyncLogFile_tt* pFile)
+{
+    fclose(pFile->hFile);
+    pFile->hFile = NULL;
+
+    struct tm tmNow;
+    asyncLog_localTime(time(NULL), &tmNow);
+    size_t  nLength  = strlen(pFile->szPath) + 48;
+    char*   szRotate = mem_malloc(nLength);
+    int32_t iLength  = snprintf(szRotate,
+                               nLength,
+                               "%s.%04d%02d%02d-%02d%02d%02d",
+                               pFile->szPath,
+                               tmNow.tm_year + 1900,
+                               tmNow.tm_mon + 1,
+                               tmNow.tm_mday,
+                               tmNow.tm_hour,
+                               tmNow.tm_min,
+                               tmNow.tm_sec);
+    // 同一秒内多次轮转时追加序号, 不覆盖已轮转的文件
+    for (int32_t i = 1; fs_find(szRotate); ++i) {
+        snprintf(szRotate + iLength, nLength - (size_t)iLength, ".%d", i);
+    }
+    fs_resetName(pFile->szPath, szRotate);
+    mem_free(szRotate);
+    asyncLogFile_open(pFile);
+}
+
+static void asyncLogFile_write(asyncLogFile_tt* pFile, const char* szText, size_t nLength)
+{
+    if (pFile->hFile == NULL && !asyncLogFile_open(pFile)) {
+        return;
+    }
+
+    size_t   nRotateBytes = atomic_load_explicit(&s_nRotateBytes, memory_order_relaxed);
+    uint32_t uiRotateSec  = atomic_load_explicit(&s_uiRotateSec, memory_order_relaxed);
+    if ((nRotateBytes != 0 && pFile->nWritten >= nRotateBytes) ||
+        (uiRotateSec != 0 && time(NULL) - pFile->openTime >= (time_t)uiRotateSec)) {
+        asyncLogFile_rotate(pFile);
+        if (pFile->hFile == NULL) {
+            return;
+        }
+    }
+
+    fwrite(szText, 1, nLength, pFile->hFile);
+    fputc('\n', pFile->hFile);
+    pFile->nWritten += nLength + 1;
+    pFile->bDirty = true;
+}
+
+static void asyncLogRender_append(asyncLog_tt* pAsyncLog, const char* pData, size_t nLength)
+{
+    if (pAsyncLog->nRenderLength + nLength > pAsyncLog->nRenderCapacity) {
+        size_t nCapacity = pAsyncLog->nRenderCapacity == 0 ? 1024 : pAsyncLog->nRenderCapacity;
+        while (pAsyncLog->nRenderLength + nLength > nCapacity) {
+            nCapacity *= 2;
+        }
+        pAsyncLog->pRender         = mem_realloc(pAsyncLog->pRender, nCapacity);
+        pAsyncLog->nRenderCapacity = nCapacity;
+    }
+    memcpy(pAsyncLog->pRender + pAsyncLog->nRenderLength, pData, nLength);
+    pAsyncLog->nRenderLength += nLength;
+}
+
+static void asyncLogRender_appendJsonString(asyncLog_tt* pAsyncLog, const char* pData,
+                                            size_t nLength)
+{
+    asyncLogRender_append(pAsyncLog, "\"", 1);
+    size_t nStart = 0;
+    for (size_t i = 0; i < nLength; ++i) {
+        unsigned char c = (unsigned char)pData[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        asyncLogRender_append(pAsyncLog, pData + nStart, i - nStart);
+        nStart = i + 1;
+        char szEscape[8];
+        int  iLength;
+        switch (c) {
+        case '"': iLength = snprintf(szEscape, sizeof(szEscape), "\\\""); break;
+        case '\\': iLength = snprintf(szEscape, sizeof(szEscape), "\\\\"); break;
+        case '\n': iLength = snprintf(szEscape, sizeof(szEscape), "\\n"); break;
+        case '\r': iLength = snprintf(szEscape, sizeof(szEscape), "\\r"); break;
+        case '\t': iLength = snprintf(szEscape, sizeof(szEscape), "\\t"); break;
+        default: iLength = snprintf(szEscape, sizeof(szEscape), "\\u%04x", c); break;
+        }
+        asyncLogRender_append(pAsyncLog, szEscape, (size_t)iLength);
+    }
+    asyncLogRender_append(pAsyncLog, pData + nStart, nLength - nStart);
+    asyncLogRender_append(pAsyncLog, "\"", 1);
+}
+
+// 解码一个参数并展开, 返回下一个参数的位置
+static const char* asyncLogRender_appendArg(asyncLog_tt* pAsyncLog, const char* pArg, bool bJson)
+{
+    char    szValue[64];
+    int32_t iLength = 0;
+    uint8_t uiType  = (uint8_t)*pArg++;
+    switch (uiType) {
+    case eAsyncLogArg_bool:
+    {
+        bool bValue = *pArg++ != 0;
+        iLength     = snprintf(szValue, sizeof(szValue), "%s", bValue ? "true" : "false");
+    } break;
+    case eAsyncLogArg_integer:
+    {
+        int64_t iValue;
+        memcpy(&iValue, pArg, sizeof(int64_t));
+        pArg += sizeof(int64_t);
+        iLength = snprintf(szValue, sizeof(szValue), "%lld", (long long)iValue);
+    } break;
+    case eAsyncLogArg_number:
+    {
+        double fValue;
+        memcpy(&fValue, pArg, sizeof(double));
+        pArg += sizeof(double);
+        if (bJson && !isfinite(fValue)) {
+            iLength = snprintf(szValue, sizeof(szValue), "null");
+        }
+        else {
+            iLength = snprintf(szValue, sizeof(szValue), bJson ? "%.17g" : "%.14g", fValue);
+        }
+    } break;
+    case eAsyncLogArg_string:
+    {
+        uint32_t uiLength;
+        memcpy(&uiLength, pArg, sizeof(uint32_t));
+        pArg += sizeof(uint32_t);
+        if (bJson) {
+            asyncLogRender_appendJsonString(pAsyncLog, pArg, uiLength);
+        }
+        else {
+            asyncLogRender_append(pAsyncLog, pArg, uiLength);
+        }
+        return pArg + uiLength;
+    }
+    default: iLength = snprintf(szValue, sizeof(szValue), bJson ? "null" : "nil"); break;
+    }
+    asyncLogRender_append(pAsyncLog, szValue, (size_t)iLength);
+    return pArg;
+}
+
+// 找到下一个{name}, 返回'{'的位置, 没有时返回NULL
+static const char* asyncLog_nextField(const char* szFormat, const char** ppName,
+                                      size_t* pNameLength)
+{
+    for (const char* p = strchr(szFormat, '{'); p != NULL; p = strchr(p + 1, '{')) {
+        const char* q = p + 1;
+        while ((*q >= 'a' && *q <= 'z') || (*q >= 'A' && *q <= 'Z') || (*q >= '0' && *q <= '9') ||
+               *q == '_' || *q == '.') {
+            ++q;
+        }
+        if (*q == '}' && q != p + 1) {
+            *ppName      = p + 1;
+            *pNameLength = (size_t)(q - p - 1);
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static void asyncLog_renderStruct(asyncLog_tt* pAsyncLog, const char* pPayload, bool bJson)
+{
+    asyncLogStructHead_tt head;
+    memcpy(&head, pPayload, sizeof(asyncLogStructHead_tt));
+    const char* pArg = pPayload + sizeof(asyncLogStructHead_tt);
+
+    const char* szFormat = NULL;
+    if (head.uiFormatID != 0 && head.uiFormatID <= atomic_load(&s_uiFormatCount)) {
+        szFormat = atomic_load_explicit(&s_formats[head.uiFormatID - 1], memory_order_acquire);
+    }
+    if (szFormat == NULL) {
+        szFormat = "?";
+    }
+    int32_t iLevel = head.iLevel;
+    if (iLevel < elog_trace || iLevel > eLog_fatal) {
+        iLevel = eLog_fatal;
+    }
+    const char* szLevel       = logErrorStrArray[iLevel];
+    size_t      nLevelLength  = strlen(szLevel);
+    while (nLevelLength > 0 && szLevel[nLevelLength - 1] == ' ') {
+        --nLevelLength;
+    }
+
+    // 同一秒内的记录复用上次的本地时间
+    if (pAsyncLog->iRenderSec != head.iTimeMs / 1000) {
+        pAsyncLog->iRenderSec = head.iTimeMs / 1000;
+        asyncLog_localTime((time_t)pAsyncLog->iRenderSec, &pAsyncLog->renderTime);
+    }
+    const struct tm* pTm = &pAsyncLog->renderTime;
+    char             szHead[128];
+    int32_t iHeadLength;
+    pAsyncLog->nRenderLength = 0;
+
+    const char* szName      = NULL;
+    size_t      nNameLength = 0;
+    int32_t     i           = 0;
+    if (bJson) {
+        iHeadLength = snprintf(szHead,
+                               sizeof(szHead),
+                               "{\"time\":\"%04d-%02d-%02d %02d:%02d:%02d.%03d\",\"level\":\"%.*s\","
+                               "\"service\":\"%08x\",\"fmt\":",
+                               pTm->tm_year + 1900,
+                               pTm->tm_mon + 1,
+                               pTm->tm_mday,
+                               pTm->tm_hour,
+                               pTm->tm_min,
+                               pTm->tm_sec,
+                               (int32_t)(head.iTimeMs % 1000),
+                               (int32_t)nLevelLength,
+                               szLevel,
+                               head.uiServiceID);
+        asyncLogRender_append(pAsyncLog, szHead, (size_t)iHeadLength);
+        asyncLogRender_appendJsonString(pAsyncLog, szFormat, strlen(szFormat));
+        const char* p = szFormat;
+        for (; i < head.iCount; ++i) {
+            p = asyncLog_nextField(p, &szName, &nNameLength);
+            if (p == NULL) {
+                break;
+            }
+            p += nNameLength + 2;
+            asyncLogRender_append(pAsyncLog, ",\"", 2);
+            asyncLogRender_append(pAsyncLog, szName, nNameLength);
+            asyncLogRender_append(pAsyncLog, "\":", 2);
+            pArg = asyncLogRender_appendArg(pAsyncLog, pArg, true);
+        }
+        // 多出的参数按位置命名
+        for (; i < head.iCount; ++i) {
+            iHeadLength = snprintf(szHead, sizeof(szHead), ",\"_%d\":", i + 1);
+            asyncLogRender_append(pAsyncLog, szHead, (size_t)iHeadLength);
+            pArg = asyncLogRender_appendArg(pAsyncLog, pArg, true);
+        }
+        asyncLogRender_append(pAsyncLog, "}", 1);
+        return;
+    }
+
+    iHeadLength = snprintf(szHead,
+                           sizeof(szHead),
+                           "[%s %d-%d-%d %d:%d:%d.%03d] service:[%08x] ",
+                           szLevel,
+                           pTm->tm_year + 1900,
+                           pTm->tm_mon + 1,
+                           pTm->tm_mday,
+                           pTm->tm_hour,
+                           pTm->tm_min,
+                           pTm->tm_sec,
+                           (int32_t)(head.iTimeMs % 1000),
+                           head.uiServiceID);
+    asyncLogRender_append(pAsyncLog, szHead, (size_t)iHeadLength);
+    const char* p = szFormat;
+    for (; i < head.iCount; ++i) {
+        const char* pField = asyncLog_nextField(p, &szName, &nNameLength);
+        if (pField == NULL) {
+            break;
+        }
+        asyncLogRender_append(pAsyncLog, p, (size_t)(pField - p));
+        pArg = asyncLogRender_appendArg(pAsyncLog, pArg, false);
+        p    = pField + nNameLength + 2;
+    }
+    asyncLogRender_append(pAsyncLog, p, strlen(p));
+    for (; i < head.iCount; ++i) {
+        asyncLogRender_append(pAsyncLog, " ", 1);
+        pArg = asyncLogRender_appendArg(pAsyncLog, pArg, false);
+    }
+}
+
+static void asyncLogFile_writeRecord(asyncLogFile_tt* pFile, uint32_t uiKind, const char* pPayload,
+                                     size_t nLength)
+{
+    if (uiKind == def_asyncLogKindStruct) {
+        asyncLog_renderStruct(
+            &s_asyncLog, pPayload, atomic_load_explicit(&pFile->bJson, memory_order_relaxed));
+        asyncLogFile_write(pFile, s_asyncLog.pRender, s_asyncLog.nRenderLength);
+    }
+    else {
+        asyncLogFile_write(pFile, pPayload, nLength);
+    }
+}
+
+static void asyncLogRing_drain(asyncLogRing_tt* pRing)
+{
+    size_t nTail = atomic_load_explicit(&pRing->nTail, memory_order_relaxed);
+    size_t nHead = atomic_load_explicit(&pRing->nHead, memory_order_acquire);
+    while (nTail != nHead) {
+        asyncLogRecord_tt* pRecord =
+            (asyncLogRecord_tt*)(pRing->pBuffer + (nTail & (def_asyncLogRingBytes - 1)));
+        if (pRecord->pFile) {
+            asyncLogFile_writeRecord(
+                pRecord->pFile, pRecord->uiKind, (const char*)(pRecord + 1), pRecord->uiLength);
+        }
+        nTail += asyncLog_recordBytes(pRecord->uiLength);
+    }
+    atomic_store_explicit(&pRing->nTail, nTail, memory_order_release);
+}
+
+// 关闭请求在下一轮完整的取空之后才释放文件, 保证关闭前写入其他线程环中的内容都已写出
+static void asyncLog_flushFiles(asyncLog_tt* pAsyncLog)
+{
+    mutex_lock(&pAsyncLog->mutex);
+    asyncLogFile_tt** ppFile = &pAsyncLog->pFiles;
+    while (*ppFile) {
+        asyncLogFile_tt* pFile = *ppFile;
+        if (pFile->bDirty) {
+            pFile->bDirty = false;
+            fflush(pFile->hFile);
+        }
+        if (pFile->uiCloseRound != 0 && pAsyncLog->uiRound > pFile->uiCloseRound) {
+            *ppFile = pFile->pNext;
+            if (pFile->hFile) {
+                fclose(pFile->hFile);
+            }
+            mem_free(pFile->szPath);
+            mem_free(pFile);
+            continue;
+        }
+        if (pFile->uiCloseRound == 0 && atomic_load(&pFile->bCloseRequested)) {
+            pFile->uiCloseRound = pAsyncLog->uiRound;
+        }
+        ppFile = &pFile->pNext;
+    }
+    mutex_unlock(&pAsyncLog->mutex);
+}
+
+static void asyncLog_drainAll(asyncLog_tt* pAsyncLog)
+{
+    ++pAsyncLog->uiRound;
+    uint64_t         uiDropped = 0;
+    asyncLogRing_tt* pRing     = atomic_load(&s_pRingHead);
+    while (pRing) {
+        asyncLogRing_drain(pRing);
+        uiDropped += atomic_load_explicit(&pRing->uiDropped, memory_order_relaxed);
+        pRing = pRing->pNext;
+    }
+
+    if (uiDropped != pAsyncLog->uiReportedDropped) {
+        uint64_t uiNew               = uiDropped - pAsyncLog->uiReportedDropped;
+        pAsyncLog->uiReportedDropped  = uiDropped;
+        if (pAsyncLog->pMetricsDropped) {
+            metricsCounter_add(pAsyncLog->pMetricsDropped, uiNew);
+        }
+        // 经由写线程自己的环写入默认日志, 下一轮写出
+        Log(eLog_warning,
+            "async log buffer full or line too long, dropped:%llu total:%llu",
+            (unsigned long long)uiNew,
+            (unsigned long long)uiDropped);
+    }
+    asyncLog_flushFiles(pAsyncLog);
+}
+
+static void asyncLog_threadLoop(void* pArg)
+{
+    asyncLog_tt* pAsyncLog       = (asyncLog_tt*)pArg;
+    pAsyncLog->pMetricsDropped = metrics_registerCounter("frog_log_dropped_total",
+                                                         "Log lines dropped by full buffers");
+    while (atomic_load(&pAsyncLog->bRunning)) {
+        mutex_lock(&pAsyncLog->mutex);
+        if (atomic_load(&pAsyncLog->bRunning) && !atomic_load(&pAsyncLog->bWakeup)) {
+            cond_timedwait(&pAsyncLog->cond, &pAsyncLog->mutex, def_asyncLogFlushMs * 1000000ULL);
+        }
+        atomic_store(&pAsyncLog->bWakeup, false);
+        mutex_unlock(&pAsyncLog->mutex);
+        asyncLog_drainAll(pAsyncLog);
+    }
+    // 最后两轮: 取空剩余内容并释放已请求关闭的文件
+    asyncLog_drainAll(pAsyncLog);
+    asyncLog_drainAll(pAsyncLog);
+}
+
+static void asyncLog_atExit(void)
+{
+    asyncLog_stop();
+}
+
+static void asyncLog_init(void)
+{
+    mutex_init(&s_asyncLog.mutex);
+    cond_init(&s_asyncLog.cond);
+    s_asyncLog.pFiles            = NULL;
+    s_asyncLog.uiRound           = 0;
+    s_asyncLog.uiReportedDropped = 0;
+    s_asyncLog.pMetricsDropped   = NULL;
+    s_asyncLog.pRender           = NULL;
+    s_asyncLog.nRenderLength     = 0;
+    s_asyncLog.nRenderCapacity   = 0;
+    s_asyncLog.iRenderSec        = -1;
+    atomic_init(&s_asyncLog.bRunning, true);
+    atomic_init(&s_asyncLog.bSync, false);
+    atomic_init(&s_asyncLog.bWakeup, false);
+    atomic_store(&s_bAsyncLogInit, true);
+    if (thread_start(&s_asyncLog.thread, asyncLog_threadLoop, &s_asyncLog) != eThreadSuccess) {
+        atomic_store(&s_asyncLog.bRunning, false);
+        atomic_store(&s_asyncLog.bSync, true);
+        return;
+    }
+    atexit(asyncLog_atExit);
+}
+
+void asyncLog_stop()
+{
+    if (!atomic_load(&s_bAsyncLogInit)) {
+        return;
+    }
+    mutex_lock(&s_asyncLog.mutex);
+    bool bRunning = atomic_exchange(&s_asyncLog.bRunning, false);
+    cond_signal(&s_asyncLog.cond);
+    mutex_unlock(&s_asyncLog.mutex);
+    if (!bRunning) {
+        return;
+    }
+    thread_join(s_asyncLog.thread);
+
+    // 写线程退出后改为同步写, 再取一次停止期间进入环中的内容
+    mutex_lock(&s_asyncLog.mutex);
+    atomic_store(&s_asyncLog.bSync, true);
+    asyncLogRing_tt* pRing = atomic_load(&s_pRingHead);
+    while (pRing) {
+        asyncLogRing_drain(pRing);
+        pRing = pRing->pNext;
+    }
+    asyncLogFile_tt* pFile = s_asyncLog.pFiles;
+    while (pFile) {
+        if (pFile->hFile) {
+            fflush(pFile->hFile);
+        }
+        pFile = pFile->pNext;
+    }
+    mutex_unlock(&s_asyncLog.mutex);
+}
+
+void asyncLog_setRotate(size_t nMaxBytes, uint32_t uiIntervalSec)
+{
+    atomic_store(&s_nRotateBytes, nMaxBytes);
+    atomic_store(&s_uiRotateSec, uiIntervalSec);
+}
+
+uint64_t asyncLog_getDropped()
+{
+    uint64_t         uiDropped = 0;
+    asyncLogRing_tt* pRing     = atomic_load(&s_pRingHead);
+    while (pRing) {
+        uiDropped += atomic_load_explicit(&pRing->uiDropped, memory_order_relaxed);
+        pRing = pRing->pNext;
+    }
+    return uiDropped;
+}
+
+asyncLogFile_tt* asyncLog_open(const char* szPath)
+{
+    callOnce(&s_asyncLogOnceFlag, asyncLog_init);
+
+    size_t           nLength = strlen(szPath);
+    asyncLogFile_tt* pFile   = mem_malloc(sizeof(asyncLogFile_tt));
+    pFile->szPath            = mem_malloc(nLength + 1);
+    memcpy(pFile->szPath, szPath, nLength + 1);
+    pFile->hFile        = NULL;
+    pFile->nWritten     = 0;
+    pFile->openTime     = 0;
+    pFile->bDirty       = false;
+    pFile->uiCloseRound = 0;
+    atomic_init(&pFile->bJson, false);
+    atomic_init(&pFile->bCloseRequested, false);
+
+    mutex_lock(&s_asyncLog.mutex);
+    pFile->pNext      = s_asyncLog.pFiles;
+    s_asyncLog.pFiles = pFile;
+    mutex_unlock(&s_asyncLog.mutex);
+    return pFile;
+}
+
+void asyncLog_close(asyncLogFile_tt* pFile)
+{
+    atomic_store(&pFile->bCloseRequested, true);
+}
+
+void asyncLog_localTime(time_t t, struct tm* pTm)
+{
+#if defined(_WINDOWS) || defined(_WIN32)
+    localtime_s(pTm, &t);
+#else
+    localtime_r(&t, pTm);
+#endif
+}
+
+static inline asyncLogRing_tt* asyncLogRing_current()
+{
+    asyncLogRing_tt* pRing = s_pThreadRing;
+    if (_UnLikely(pRing == NULL)) {
+        pRing = asyncLogRing_acquire();
+    }
+    return pRing;
+}
+
+// 超长的记录与缓冲满一样丢弃并计数, 同步写时也记在本线程的环上
+static bool asyncLog_dropOversize(size_t nLength)
+{
+    if (_UnLikely(nLength > def_asyncLogMaxLine)) {
+        atomic_fetch_add_explicit(&asyncLogRing_current()->uiDropped, 1, memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+// 在本线程的环中预留一条记录, 空间不足时计数并返回NULL
+static char* asyncLogRing_reserve(asyncLogFile_tt* pFile, uint32_t uiKind, size_t nLength,
+                                  asyncLogRing_tt** ppRing, size_t* pHead)
+{
+    asyncLogRing_tt* pRing = asyncLogRing_current();
+
+    size_t nBytes  = asyncLog_recordBytes(nLength);
+    size_t nHead   = atomic_load_explicit(&pRing->nHead, memory_order_relaxed);
+    size_t nTail   = atomic_load_explicit(&pRing->nTail, memory_order_acquire);
+    size_t nOffset = nHead & (def_asyncLogRingBytes - 1);
+    size_t nTotal  = nBytes;
+    if (def_asyncLogRingBytes - nOffset < nBytes) {
+        nTotal += def_asyncLogRingBytes - nOffset;
+    }
+    if (nHead - nTail + nTotal > def_asyncLogRingBytes) {
+        atomic_fetch_add_explicit(&pRing->uiDropped, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    if (nTotal != nBytes) {
+        asyncLogRecord_tt* pSkip = (asyncLogRecord_tt*)(pRing->pBuffer + nOffset);
+        pSkip->pFile             = NULL;
+        pSkip->uiLength = (uint32_t)(def_asyncLogRingBytes - nOffset - sizeof(asyncLogRecord_tt));
+        pSkip->uiKind   = def_asyncLogKindText;
+        nHead += def_asyncLogRingBytes - nOffset;
+        nOffset = 0;
+    }
+    asyncLogRecord_tt* pRecord = (asyncLogRecord_tt*)(pRing->pBuffer + nOffset);
+    pRecord->pFile             = pFile;
+    pRecord->uiLength          = (uint32_t)nLength;
+    pRecord->uiKind            = uiKind;
+    *ppRing                    = pRing;
+    *pHead                     = nHead + nBytes;
+    return (char*)(pRecord + 1);
+}
+
+static void asyncLogRing_commit(asyncLogRing_tt* pRing, size_t nHead)
+{
+    atomic_store_explicit(&pRing->nHead, nHead, memory_order_release);
+    // 积压过半时提前唤醒写线程, 其余情况按固定间隔批量写出;
+    // 写线程正在取环时置位的唤醒标记不会丢失
+    size_t nTail = atomic_load_explicit(&pRing->nTail, memory_order_relaxed);
+    if (nHead - nTail > def_asyncLogRingBytes / 2 &&
+        !atomic_load_explicit(&s_asyncLog.bWakeup, memory_order_relaxed) &&
+        !atomic_exchange(&s_asyncLog.bWakeup, true)) {
+        mutex_lock(&s_asyncLog.mutex);
+        cond_signal(&s_asyncLog.cond);
+        mutex_unlock(&s_asyncLog.mutex);
+    }
+}
+
+bool asyncLog_write(asyncLogFile_tt* pFile, const char* szText, size_t nLength)
+{
+    if (asyncLog_dropOversize(nLength)) {
+        return false;
+    }
+
+    // 写线程未运行(启动失败或已停止)时同步写出
+    if (_UnLikely(atomic_load_explicit(&s_asyncLog.bSync, memory_order_acquire))) {
+        mutex_lock(&s_asyncLog.mutex);
+        asyncLogFile_write(pFile, szText, nLength);
+        if (pFile->hFile) {
+            pFile->bDirty = false;
+            fflush(pFile->hFile);
+        }
+        mutex_unlock(&s_asyncLog.mutex);
+        return true;
+    }
+
+    asyncLogRing_tt* pRing = NULL;
+    size_t           nHead = 0;
+    char*            pData = asyncLogRing_reserve(pFile, def_asyncLogKindText, nLength, &pRing, &nHead);
+    if (pData == NULL) {
+        return false;
+    }
+    memcpy(pData, szText, nLength);
+    asyncLogRing_commit(pRing, nHead);
+    return true;
+}
+
+uint32_t asyncLog_registerFormat(const char* szFormat)
+{
+    callOnce(&s_asyncLogOnceFlag, asyncLog_init);
+
+    uint32_t uiCount = atomic_load_explicit(&s_uiFormatCount, memory_order_acquire);
+    for (uint32_t i = 0; i < uiCount; ++i) {
+        if (strcmp(atomic_load_explicit(&s_formats[i], memory_order_relaxed), szFormat) == 0) {
+            return i + 1;
+        }
+    }
+
+    uint32_t uiFormatID = 0;
+    mutex_lock(&s_asyncLog.mutex);
+    uint32_t i = 0;
+    uiCount    = atomic_load_explicit(&s_uiFormatCount, memory_order_relaxed);
+    for (; i < uiCount; ++i) {
+        if (strcmp(atomic_load_explicit(&s_formats[i], memory_order_relaxed), szFormat) == 0) {
+            uiFormatID = i + 1;
+            break;
+        }
+    }
+    if (uiFormatID == 0 && uiCount < def_asyncLogMaxFormats) {
+        size_t nLength = strlen(szFormat);
+        char*  pFormat = mem_malloc(nLength + 1);
+        memcpy(pFormat, szFormat, nLength + 1);
+        atomic_store_explicit(&s_formats[uiCount], pFormat, memory_order_release);
+        atomic_store_explicit(&s_uiFormatCount, uiCount + 1, memory_order_release);
+        uiFormatID = uiCount + 1;
+    }
+    mutex_unlock(&s_asyncLog.mutex);
+    return uiFormatID;
+}
+
+void asyncLog_setJson(asyncLogFile_tt* pFile, bool bJson)
+{
+    atomic_store(&pFile->bJson, bJson);
+}
+
+static size_t asyncLog_structBytes(const asyncLogArg_tt* pArgs, int32_t iCount)
+{
+    size_t nBytes = sizeof(asyncLogStructHead_tt);
+    for (int32_t i = 0; i < iCount; ++i) {
+        switch (pArgs[i].eType) {
+        case eAsyncLogArg_bool: nBytes += 2; break;
+        case eAsyncLogArg_integer:
+        case eAsyncLogArg_number: nBytes += 1 + 8; break;
+        case eAsyncLogArg_string: nBytes += 1 + sizeof(uint32_t) + pArgs[i].str.nLength; break;
+        default: nBytes += 1; break;
+        }
+    }
+    return nBytes;
+}
+
+static void asyncLog_encodeStruct(char* pData, const asyncLogStructHead_tt* pHead,
+                                  const asyncLogArg_tt* pArgs)
+{
+    memcpy(pData, pHead, sizeof(asyncLogStructHead_tt));
+    pData += sizeof(asyncLogStructHead_tt);
+    for (int32_t i = 0; i < pHead->iCount; ++i) {
+        *pData++ = (char)pArgs[i].eType;
+        switch (pArgs[i].eType) {
+        case eAsyncLogArg_bool: *pData++ = pArgs[i].bValue ? 1 : 0; break;
+        case eAsyncLogArg_integer:
+            memcpy(pData, &pArgs[i].iValue, sizeof(int64_t));
+            pData += sizeof(int64_t);
+            break;
+        case eAsyncLogArg_number:
+            memcpy(pData, &pArgs[i].fValue, sizeof(double));
+            pData += sizeof(double);
+            break;
+        case eAsyncLogArg_string:
+        {
+            uint32_t uiLength = (uint32_t)pArgs[i].str.nLength;
+            memcpy(pData, &uiLength, sizeof(uint32_t));
+            pData += sizeof(uint32_t);
+            memcpy(pData, pArgs[i].str.szValue, uiLength);
+            pData += uiLength;
+        } break;
+        default: break;
+        }
+    }
+}
+
+bool asyncLog_writeStruct(asyncLogFile_tt* pFile, uint32_t uiFormatID, int32_t iLevel,
+                          uint32_t uiServiceID, const asyncLogArg_tt* pArgs, int32_t iCount)
+{
+    timespec_tt ts;
+    getClockRealtime(&ts);
+    asyncLogStructHead_tt head;
+    head.uiFormatID  = uiFormatID;
+    head.uiServiceID = uiServiceID;
+    head.iTimeMs     = (int64_t)ts.iSec * 1000 + ts.iNsec / 1000000;
+    head.iLevel      = iLevel;
+    head.iCount      = iCount;
+
+    size_t nLength = asyncLog_structBytes(pArgs, iCount);
+    if (asyncLog_dropOversize(nLength)) {
+        return false;
+    }
+
+    if (_UnLikely(atomic_load_explicit(&s_asyncLog.bSync, memory_order_acquire))) {
+        char* pData = mem_malloc(nLength);
+        asyncLog_encodeStruct(pData, &head, pArgs);
+        mutex_lock(&s_asyncLog.mutex);
+        asyncLogFile_writeRecord(pFile, def_asyncLogKindStruct, pData, nLength);
+        if (pFile->hFile) {
+            pFile->bDirty = false;
+            fflush(pFile->hFile);
+        }
+        mutex_unlock(&s_asyncLog.mutex);
+        mem_free(pData);
+        return true;
+    }
+
+    asyncLogRing_tt* pRing = NULL;
+    size_t           nHead = 0;
+    char* pData = asyncLogRing_reserve(pFile, def_asyncLogKindStruct, nLength, &pRing, &nHead);
+    if (pData == NULL) {
+        return false;
+    }
+    asyncLog_encodeStruct(pData, &head, pArgs);
+    asyncLogRing_commit(pRing, nHead);
+    return true;
+}
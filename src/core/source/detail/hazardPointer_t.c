@@ -0,0 +1,190 @@
+#include "hazardPointer_t.h"
+
+#include <stdlib.h>
+
+#include "spinLock_t.h"
+#include "thread_t.h"
+
+typedef struct _decl_cpu_cache_align hazardRecord_s
+{
+    void* _Atomic          pHazard;
+    atomic_bool            bActive;
+    struct hazardRecord_s* pNext;
+} hazardRecord_tt;
+
+struct hazardPointer_s
+{
+    spinLock_tt spinLock;
+    void (*fnReclaim)(void*);
+    void**  ppRetired;
+    int32_t iRetiredCount;
+    int32_t iRetiredCapacity;
+};
+
+static hazardRecord_tt* _Atomic           s_pHazardRecordHead = NULL;
+static _decl_threadLocal hazardRecord_tt* s_pThreadRecord     = NULL;
+
+static void hazardRecord_exit(void* pData)
+{
+    hazardRecord_tt* pRecord = (hazardRecord_tt*)pData;
+    atomic_store(&pRecord->pHazard, NULL);
+    atomic_store(&pRecord->bActive, false);
+}
+
+static hazardRecord_tt* hazardRecord_acquire()
+{
+    hazardRecord_tt* pRecord = atomic_load(&s_pHazardRecordHead);
+    while (pRecord) {
+        bool bActive = false;
+        if (!atomic_load_explicit(&pRecord->bActive, memory_order_relaxed) &&
+            atomic_compare_exchange_strong(&pRecord->bActive, &bActive, true)) {
+            break;
+        }
+        pRecord = pRecord->pNext;
+    }
+
+    if (pRecord == NULL) {
+        pRecord = mem_malloc(sizeof(hazardRecord_tt));
+        atomic_init(&pRecord->pHazard, NULL);
+        atomic_init(&pRecord->bActive, true);
+        hazardRecord_tt* pHead = atomic_load(&s_pHazardRecordHead);
+        do {
+            pRecord->pNext = pHead;
+        } while (!atomic_compare_exchange_weak(&s_pHazardRecordHead, &pHead, pRecord));
+    }
+
+    setTlsValue(&s_pHazardRecordHead, hazardRecord_exit, pRecord, false);
+    s_pThreadRecord = pRecord;
+    return pRecord;
+}
+
+static bool hazardRecord_isProtected(void* pData)
+{
+    hazardRecord_tt* pRecord = atomic_load(&s_pHazardRecordHead);
+    while (pRecord) {
+        if (atomic_load(&pRecord->pHazard) == pData) {
+            return true;
+        }
+        pRecord = pRecord->pNext;
+    }
+    return false;
+}
+
+hazardPointer_tt* createHazardPointer(void (*fnReclaim)(void*))
+{
+    hazardPointer_tt* pHandle = mem_malloc(sizeof(hazardPointer_tt));
+    spinLock_init(&pHandle->spinLock);
+    pHandle->fnReclaim        = fnReclaim;
+    pHandle->ppRetired        = NULL;
+    pHandle->iRetiredCount    = 0;
+    pHandle->iRetiredCapacity = 0;
+    return pHandle;
+}
+
+void hazardPointer_release(hazardPointer_tt* pHandle)
+{
+    for (int32_t i = 0; i < pHandle->iRetiredCount; ++i) {
+        pHandle->fnReclaim(pHandle->ppRetired[i]);
+    }
+    if (pHandle->ppRetired) {
+        mem_free(pHandle->ppRetired);
+        pHandle->ppRetired = NULL;
+    }
+    mem_free(pHandle);
+}
+
+void* hazardPointer_protect(void* _Atomic* pSlot)
+{
+    hazardRecord_tt* pRecord = s_pThreadRecord;
+    if (_UnLikely(pRecord == NULL)) {
+        pRecord = hazardRecord_acquire();
+    }
+
+    void* pData = atomic_load(pSlot);
+    for (;;) {
+        atomic_store(&pRecord->pHazard, pData);
+        void* pCurrent = atomic_load(pSlot);
+        if (pCurrent == pData) {
+            return pData;
+        }
+        pData = pCurrent;
+    }
+}
+
+void hazardPointer_clear()
+{
+    hazardRecord_tt* pRecord = s_pThreadRecord;
+    if (pRecord) {
+        atomic_store_explicit(&pRecord->pHazard, NULL, memory_order_release);
+    }
+}
+
+void hazardPointer_retire(hazardPointer_tt* pHandle, void* pData)
+{
+    spinLock_lock(&pHandle->spinLock);
+    if (pHandle->iRetiredCount == pHandle->iRetiredCapacity) {
+        pHandle->iRetiredCapacity =
+            pHandle->iRetiredCapacity == 0 ? 16 : pHandle->iRetiredCapacity * 2;
+        pHandle->ppRetired =
+            mem_realloc(pHandle->ppRetired, pHandle->iRetiredCapacity * sizeof(void*));
+    }
+    pHandle->ppRetired[pHandle->iRetiredCount++] = pData;
+    spinLock_unlock(&pHandle->spinLock);
+    hazardPointer_scan(pHandle);
+}
+
+void hazardPointer_scan(hazardPointer_tt* pHandle)
+{
+    spinLock_lock(&pHandle->spinLock);
+    void**  ppRetired         = pHandle->ppRetired;
+    int32_t iRetiredCount     = pHandle->iRetiredCount;
+    int32_t iRetiredCapacity  = pHandle->iRetiredCapacity;
+    pHandle->ppRetired        = NULL;
+    pHandle->iRetiredCount    = 0;
+    pHandle->iRetiredCapacity = 0;
+    spinLock_unlock(&pHandle->spinLock);
+
+    if (ppRetired == NULL) {
+        return;
+    }
+
+    atomic_thread_fence(memory_order_seq_cst);
+
+    int32_t iKeepCount = 0;
+    for (int32_t i = 0; i < iRetiredCount; ++i) {
+        if (hazardRecord_isProtected(ppRetired[i])) {
+            ppRetired[iKeepCount++] = ppRetired[i];
+        }
+        else {
+            pHandle->fnReclaim(ppRetired[i]);
+        }
+    }
+
+    if (iKeepCount == 0) {
+        mem_free(ppRetired);
+        return;
+    }
+
+    spinLock_lock(&pHandle->spinLock);
+    if (pHandle->ppRetired == NULL) {
+        pHandle->ppRetired        = ppRetired;
+        pHandle->iRetiredCount    = iKeepCount;
+        pHandle->iRetiredCapacity = iRetiredCapacity;
+        ppRetired                 = NULL;
+    }
+    else {
+        if (pHandle->iRetiredCount + iKeepCount > pHandle->iRetiredCapacity) {
+            pHandle->iRetiredCapacity = pHandle->iRetiredCount + iKeepCount;
+            pHandle->ppRetired =
+                mem_realloc(pHandle->ppRetired, pHandle->iRetiredCapacity * sizeof(void*));
+        }
+        for (int32_t i = 0; i < iKeepCount; ++i) {
+            pHandle->ppRetired[pHandle->iRetiredCount++] = ppRetired[i];
+        }
+    }
+    spinLock_unlock(&pHandle->spinLock);
+
+    if (ppRetired) {
+        mem_free(ppRetired);
+    }
+}
@@ -0,0 +1,84 @@
+#include "latencyHistogram_t.h"
+
+static inline uint64_t latencyHistogram_upperBound(int32_t iBucket)
+{
+    if (iBucket < DEF_LATENCY_HISTOGRAM_SUB_COUNT) {
+        return (uint64_t)iBucket;
+    }
+    int32_t  iShift = iBucket / DEF_LATENCY_HISTOGRAM_SUB_COUNT - 1;
+    uint64_t uiLow  = (uint64_t)(DEF_LATENCY_HISTOGRAM_SUB_COUNT +
+                                iBucket % DEF_LATENCY_HISTOGRAM_SUB_COUNT)
+                     << iShift;
+    return uiLow + ((uint64_t)1 << iShift) - 1;
+}
+
+void latencyHistogram_init(latencyHistogram_tt* pHistogram)
+{
+    for (int32_t i = 0; i < DEF_LATENCY_HISTOGRAM_BUCKETS; ++i) {
+        atomic_init(&pHistogram->uiBuckets[i], 0);
+    }
+    atomic_init(&pHistogram->uiCount, 0);
+    atomic_init(&pHistogram->uiMax, 0);
+}
+
+void latencyHistogram_merge(latencyHistogram_tt* pTo, const latencyHistogram_tt* pFrom)
+{
+    uint64_t uiCount = 0;
+    for (int32_t i = 0; i < DEF_LATENCY_HISTOGRAM_BUCKETS; ++i) {
+        uint32_t uiBucket = atomic_load_explicit(
+            (atomic_uint*)&pFrom->uiBuckets[i], memory_order_relaxed);
+        if (uiBucket != 0) {
+            atomic_store_explicit(
+                &pTo->uiBuckets[i],
+                atomic_load_explicit(&pTo->uiBuckets[i], memory_order_relaxed) + uiBucket,
+                memory_order_relaxed);
+            uiCount += uiBucket;
+        }
+    }
+    // 桶计数与uiCount之间可能有撕裂, 以实际累加的桶为准
+    atomic_store_explicit(&pTo->uiCount,
+                          atomic_load_explicit(&pTo->uiCount, memory_order_relaxed) + uiCount,
+                          memory_order_relaxed);
+    uint64_t uiMax = atomic_load_explicit((atomic_ullong*)&pFrom->uiMax, memory_order_relaxed);
+    if (uiMax > atomic_load_explicit(&pTo->uiMax, memory_order_relaxed)) {
+        atomic_store_explicit(&pTo->uiMax, uiMax, memory_order_relaxed);
+    }
+}
+
+uint64_t latencyHistogram_count(const latencyHistogram_tt* pHistogram)
+{
+    return atomic_load_explicit((atomic_ullong*)&pHistogram->uiCount, memory_order_relaxed);
+}
+
+uint64_t latencyHistogram_max(const latencyHistogram_tt* pHistogram)
+{
+    return atomic_load_explicit((atomic_ullong*)&pHistogram->uiMax, memory_order_relaxed);
+}
+
+uint64_t latencyHistogram_percentile(const latencyHistogram_tt* pHistogram, double fPercentile)
+{
+    uint64_t uiCount = latencyHistogram_count(pHistogram);
+    if (uiCount == 0) {
+        return 0;
+    }
+
+    uint64_t uiRank = (uint64_t)(fPercentile / 100.0 * (double)uiCount + 0.5);
+    if (uiRank == 0) {
+        uiRank = 1;
+    }
+    else if (uiRank > uiCount) {
+        uiRank = uiCount;
+    }
+
+    uint64_t uiSeen = 0;
+    for (int32_t i = 0; i < DEF_LATENCY_HISTOGRAM_BUCKETS; ++i) {
+        uiSeen += atomic_load_explicit((atomic_uint*)&pHistogram->uiBuckets[i],
+                                       memory_order_relaxed);
+        if (uiSeen >= uiRank) {
+            uint64_t uiUpper = latencyHistogram_upperBound(i);
+            uint64_t uiMax   = latencyHistogram_max(pHistogram);
+            return uiUpper < uiMax ? uiUpper : uiMax;
+        }
+    }
+    return latencyHistogram_max(pHistogram);
+}
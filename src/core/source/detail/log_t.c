@@ -8,19 +8,20 @@
 
 #include <stdatomic.h>
 
+#include "asyncLog_t.h"
 #include "thread_t.h"
 #include "utility_t.h"
 #include "fs_t.h"
 
-static mutex_tt           s_mutexfile;
+static asyncLogFile_tt*   s_pLogFile         = NULL;
 static enLogSeverityLevel s_eLogLevel        = elog_trace;
 static logCustomPrintFunc s_fnlogCustomPrint = NULL;
-static int32_t            s_iCount           = 0;
+static atomic_int         s_iCount           = 0;
 
 static void initLogFile(void)
 {
-    mutex_init(&s_mutexfile);
     fs_mkdir("tmp");
+    s_pLogFile = asyncLog_open("tmp/output.log");
 }
 
 void logDefaultPrint(enLogSeverityLevel eLevel, const char* szMessage)
@@ -31,32 +32,36 @@ void logDefaultPrint(enLogSeverityLevel eLevel, const char* szMessage)
     static once_flag_tt in_init_flag = ONCE_FLAG_INIT;
     callOnce(&in_init_flag, initLogFile);
 
-    mutex_lock(&s_mutexfile);
-
-    FILE* f = fopen("tmp/output.log", "ab");
-
-    struct tm* pTm;
-    pTm = localtime(&SetTime);
-    pTm->tm_year += 1900;
-    pTm->tm_mon += 1;
-
-
-    fprintf(f,
-            "[%s %d-%d-%d %d:%d:%d] id:[%d] %s\n",
-            logErrorStrArray[eLevel],
-            pTm->tm_year,
-            pTm->tm_mon,
-            pTm->tm_mday,
-            pTm->tm_hour,
-            pTm->tm_min,
-            pTm->tm_sec,
-            s_iCount++,
-            szMessage);
-
-    fclose(f);
-    mutex_unlock(&s_mutexfile);
+    struct tm tmTime;
+    asyncLog_localTime(SetTime, &tmTime);
+
+    char    szHead[64];
+    int32_t iHeadLength = snprintf(szHead,
+                                   sizeof(szHead),
+                                   "[%s %d-%d-%d %d:%d:%d] id:[%d] ",
+                                   logErrorStrArray[eLevel],
+                                   tmTime.tm_year + 1900,
+                                   tmTime.tm_mon + 1,
+                                   tmTime.tm_mday,
+                                   tmTime.tm_hour,
+                                   tmTime.tm_min,
+                                   tmTime.tm_sec,
+                                   atomic_fetch_add_explicit(&s_iCount, 1, memory_order_relaxed));
+
+    size_t nMessageLength = strlen(szMessage);
+    size_t nLength        = (size_t)iHeadLength + nMessageLength;
+    char   szLine[512];
+    char*  pLine = nLength <= sizeof(szLine) ? szLine : mem_malloc(nLength);
+    memcpy(pLine, szHead, (size_t)iHeadLength);
+    memcpy(pLine + iHeadLength, szMessage, nMessageLength);
+    asyncLog_write(s_pLogFile, pLine, nLength);
+    if (pLine != szLine) {
+        mem_free(pLine);
+    }
 
     if (eLevel == eLog_fatal) {
+        // abort前把缓冲中的日志全部写出
+        asyncLog_stop();
         abort();
     }
 }
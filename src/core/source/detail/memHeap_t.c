@@ -0,0 +1,85 @@
+#include "memHeap_t.h"
+
+#ifdef _DEF_USE_MIMALLOC
+#    include "mimalloc.h"
+#endif
+
+#include <stdlib.h>
+
+struct memHeap_s
+{
+#ifdef _DEF_USE_MIMALLOC
+    mi_heap_t* pHeap;
+    mi_heap_t* pOwnerHeap;
+#else
+    void* pHeap;
+#endif
+};
+
+memHeap_tt* createMemHeap()
+{
+#ifdef _DEF_USE_MIMALLOC
+    if (mem_malloc != mi_malloc) {
+        return NULL;
+    }
+    memHeap_tt* pHandle = mem_malloc(sizeof(memHeap_tt));
+    pHandle->pHeap      = mi_heap_new();
+    pHandle->pOwnerHeap = mi_heap_get_default();
+    if (pHandle->pHeap == NULL) {
+        mem_free(pHandle);
+        return NULL;
+    }
+    return pHandle;
+#else
+    return NULL;
+#endif
+}
+
+void memHeap_release(memHeap_tt* pHandle)
+{
+#ifdef _DEF_USE_MIMALLOC
+    if (memHeap_isOwner(pHandle)) {
+        mi_heap_delete(pHandle->pHeap);
+    }
+#endif
+    mem_free(pHandle);
+}
+
+bool memHeap_destroy(memHeap_tt* pHandle)
+{
+#ifdef _DEF_USE_MIMALLOC
+    if (memHeap_isOwner(pHandle)) {
+        mi_heap_destroy(pHandle->pHeap);
+        mem_free(pHandle);
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool memHeap_isOwner(memHeap_tt* pHandle)
+{
+#ifdef _DEF_USE_MIMALLOC
+    return mi_heap_get_default() == pHandle->pOwnerHeap;
+#else
+    return false;
+#endif
+}
+
+bool memHeap_contains(memHeap_tt* pHandle, const void* p)
+{
+#ifdef _DEF_USE_MIMALLOC
+    return mi_heap_contains_block(pHandle->pHeap, p);
+#else
+    return false;
+#endif
+}
+
+void* memHeap_realloc(memHeap_tt* pHandle, void* p, size_t nSize)
+{
+#ifdef _DEF_USE_MIMALLOC
+    return mi_heap_realloc(pHandle->pHeap, p, nSize);
+#else
+    return mem_realloc(p, nSize);
+#endif
+}
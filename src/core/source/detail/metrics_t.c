@@ -0,0 +1,400 @@
+#include "metrics_t.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#    include <unistd.h>
+#endif
+
+#include "spinLock_t.h"
+
+enum enMetricsType
+{
+    eMetrics_counter,
+    eMetrics_gauge,
+    eMetrics_histogram,
+};
+
+typedef struct metricsEntry_s
+{
+    char*                  szName;
+    char*                  szHelp;
+    int32_t                iType;
+    void*                  pMetric;
+    struct metricsEntry_s* pNext;
+} metricsEntry_tt;
+
+typedef struct metricsCollector_s
+{
+    void (*fnCollect)(void*);
+    void* pUserData;
+} metricsCollector_tt;
+
+typedef struct metricsBuffer_s
+{
+    char*  pBuffer;
+    size_t nLength;
+    size_t nCapacity;
+} metricsBuffer_tt;
+
+static const double s_defaultBounds[] = {1,     2,     5,      10,     20,     50,     100,
+                                         200,   500,   1000,   2000,   5000,   10000,  20000,
+                                         50000, 1e5,   2e5,    5e5,    1e6,    2e6,    5e6};
+
+static spinLock_tt         s_lock        = {ATOMIC_FLAG_INIT};
+static metricsEntry_tt*    s_pEntryList  = NULL;
+static int32_t             s_iEntryCount = 0;
+static metricsCollector_tt s_collectors[DEF_METRICS_MAX_COLLECTORS];
+static int32_t             s_iCollectorCount = 0;
+static atomic_int          s_iNextShard      = 0;
+
+int32_t metrics_nextShard()
+{
+    return atomic_fetch_add_explicit(&s_iNextShard, 1, memory_order_relaxed) %
+           DEF_METRICS_SHARDS;
+}
+
+void metricsHistogram_observe(metricsHistogram_tt* pHistogram, double fValue)
+{
+    int32_t iBucket = 0;
+    while (iBucket < pHistogram->iBucketCount && fValue > pHistogram->bounds[iBucket]) {
+        ++iBucket;
+    }
+    atomic_fetch_add_explicit(&pHistogram->uiBuckets[iBucket], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pHistogram->uiCount, 1, memory_order_relaxed);
+    uint64_t uiBits = atomic_load_explicit(&pHistogram->uiSumBits, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(
+        &pHistogram->uiSumBits,
+        &uiBits,
+        metrics_doubleToBits(metrics_bitsToDouble(uiBits) + fValue),
+        memory_order_relaxed,
+        memory_order_relaxed)) {
+    }
+}
+
+uint64_t metricsCounter_get(metricsCounter_tt* pCounter)
+{
+    uint64_t uiValue = 0;
+    for (int32_t i = 0; i < DEF_METRICS_SHARDS; ++i) {
+        uiValue += atomic_load_explicit(&pCounter->shards[i].uiValue, memory_order_relaxed);
+    }
+    return uiValue;
+}
+
+static void* metrics_create(int32_t iType, const double* pBounds, int32_t iCount)
+{
+    switch (iType) {
+    case eMetrics_counter:
+    {
+        metricsCounter_tt* pCounter = mem_malloc(sizeof(metricsCounter_tt));
+        for (int32_t i = 0; i < DEF_METRICS_SHARDS; ++i) {
+            atomic_init(&pCounter->shards[i].uiValue, 0);
+        }
+        return pCounter;
+    }
+    case eMetrics_gauge:
+    {
+        metricsGauge_tt* pGauge = mem_malloc(sizeof(metricsGauge_tt));
+        atomic_init(&pGauge->uiBits, metrics_doubleToBits(0.0));
+        return pGauge;
+    }
+    default:
+    {
+        if (pBounds == NULL || iCount <= 0) {
+            pBounds = s_defaultBounds;
+            iCount  = (int32_t)(sizeof(s_defaultBounds) / sizeof(s_defaultBounds[0]));
+        }
+        if (iCount > DEF_METRICS_HISTOGRAM_MAX_BUCKETS) {
+            iCount = DEF_METRICS_HISTOGRAM_MAX_BUCKETS;
+        }
+        metricsHistogram_tt* pHistogram = mem_malloc(sizeof(metricsHistogram_tt));
+        pHistogram->iBucketCount        = iCount;
+        memcpy(pHistogram->bounds, pBounds, sizeof(double) * iCount);
+        for (int32_t i = 0; i <= DEF_METRICS_HISTOGRAM_MAX_BUCKETS; ++i) {
+            atomic_init(&pHistogram->uiBuckets[i], 0);
+        }
+        atomic_init(&pHistogram->uiCount, 0);
+        atomic_init(&pHistogram->uiSumBits, metrics_doubleToBits(0.0));
+        return pHistogram;
+    }
+    }
+}
+
+static void* metrics_register(const char* szName, const char* szHelp, int32_t iType,
+                              const double* pBounds, int32_t iCount)
+{
+    void* pMetric = NULL;
+    spinLock_lock(&s_lock);
+    metricsEntry_tt* pEntry = s_pEntryList;
+    while (pEntry) {
+        if (strcmp(pEntry->szName, szName) == 0) {
+            pMetric = pEntry->iType == iType ? pEntry->pMetric : NULL;
+            spinLock_unlock(&s_lock);
+            return pMetric;
+        }
+        pEntry = pEntry->pNext;
+    }
+
+    pEntry          = mem_malloc(sizeof(metricsEntry_tt));
+    pEntry->szName  = mem_strdup(szName);
+    pEntry->szHelp  = mem_strdup(szHelp ? szHelp : "");
+    pEntry->iType   = iType;
+    pEntry->pMetric = metrics_create(iType, pBounds, iCount);
+    pEntry->pNext   = s_pEntryList;
+    s_pEntryList    = pEntry;
+    ++s_iEntryCount;
+    pMetric = pEntry->pMetric;
+    spinLock_unlock(&s_lock);
+    return pMetric;
+}
+
+metricsCounter_tt* metrics_registerCounter(const char* szName, const char* szHelp)
+{
+    return metrics_register(szName, szHelp, eMetrics_counter, NULL, 0);
+}
+
+metricsGauge_tt* metrics_registerGauge(const char* szName, const char* szHelp)
+{
+    return metrics_register(szName, szHelp, eMetrics_gauge, NULL, 0);
+}
+
+metricsHistogram_tt* metrics_registerHistogram(const char* szName, const char* szHelp,
+                                               const double* pBounds, int32_t iCount)
+{
+    return metrics_register(szName, szHelp, eMetrics_histogram, pBounds, iCount);
+}
+
+bool metrics_addCollector(void (*fnCollect)(void*), void* pUserData)
+{
+    bool bSucc = false;
+    spinLock_lock(&s_lock);
+    if (s_iCollectorCount < DEF_METRICS_MAX_COLLECTORS) {
+        s_collectors[s_iCollectorCount].fnCollect = fnCollect;
+        s_collectors[s_iCollectorCount].pUserData = pUserData;
+        ++s_iCollectorCount;
+        bSucc = true;
+    }
+    spinLock_unlock(&s_lock);
+    return bSucc;
+}
+
+void metrics_removeCollector(void (*fnCollect)(void*), void* pUserData)
+{
+    spinLock_lock(&s_lock);
+    for (int32_t i = 0; i < s_iCollectorCount; ++i) {
+        if (s_collectors[i].fnCollect == fnCollect && s_collectors[i].pUserData == pUserData) {
+            s_collectors[i] = s_collectors[--s_iCollectorCount];
+            break;
+        }
+    }
+    spinLock_unlock(&s_lock);
+}
+
+static void metrics_collectProcess()
+{
+#if defined(__linux__)
+    static metricsGauge_tt* s_pResident = NULL;
+    if (s_pResident == NULL) {
+        s_pResident =
+            metrics_registerGauge("frog_process_resident_bytes", "Resident memory size in bytes");
+    }
+    FILE* pFile = fopen("/proc/self/statm", "r");
+    if (pFile) {
+        unsigned long ulSize     = 0;
+        unsigned long ulResident = 0;
+        if (fscanf(pFile, "%lu %lu", &ulSize, &ulResident) == 2) {
+            metricsGauge_set(s_pResident, (double)ulResident * (double)sysconf(_SC_PAGESIZE));
+        }
+        fclose(pFile);
+    }
+#endif
+}
+
+static void metricsBuffer_append(metricsBuffer_tt* pBuffer, const char* szFormat, ...)
+{
+    for (;;) {
+        va_list args;
+        va_start(args, szFormat);
+        int32_t iWritten = vsnprintf(pBuffer->pBuffer + pBuffer->nLength,
+                                     pBuffer->nCapacity - pBuffer->nLength,
+                                     szFormat,
+                                     args);
+        va_end(args);
+        if (iWritten < 0) {
+            return;
+        }
+        if ((size_t)iWritten < pBuffer->nCapacity - pBuffer->nLength) {
+            pBuffer->nLength += iWritten;
+            return;
+        }
+        pBuffer->nCapacity = (pBuffer->nCapacity + iWritten) * 2;
+        pBuffer->pBuffer   = mem_realloc(pBuffer->pBuffer, pBuffer->nCapacity);
+    }
+}
+
+// szName拆成族名和标签, 族名长度写入pFamilyLength, 返回'{'之后的标签内容(不含'}'), 无标签返回NULL
+static const char* metrics_splitName(const char* szName, int32_t* pFamilyLength,
+                                     int32_t* pLabelLength)
+{
+    const char* szBrace = strchr(szName, '{');
+    if (szBrace == NULL) {
+        *pFamilyLength = (int32_t)strlen(szName);
+        *pLabelLength  = 0;
+        return NULL;
+    }
+    *pFamilyLength      = (int32_t)(szBrace - szName);
+    const char* szLabel = szBrace + 1;
+    const char* szEnd   = strrchr(szLabel, '}');
+    *pLabelLength       = szEnd ? (int32_t)(szEnd - szLabel) : (int32_t)strlen(szLabel);
+    return *pLabelLength > 0 ? szLabel : NULL;
+}
+
+static void metrics_renderHistogram(metricsBuffer_tt* pBuffer, const char* szName,
+                                    metricsHistogram_tt* pHistogram)
+{
+    int32_t     iFamilyLength = 0;
+    int32_t     iLabelLength  = 0;
+    const char* szLabel       = metrics_splitName(szName, &iFamilyLength, &iLabelLength);
+    const char* szComma       = szLabel ? "," : "";
+    if (szLabel == NULL) {
+        szLabel = "";
+    }
+
+    uint64_t uiCumulative = 0;
+    for (int32_t i = 0; i <= pHistogram->iBucketCount; ++i) {
+        uiCumulative += atomic_load_explicit(&pHistogram->uiBuckets[i], memory_order_relaxed);
+        if (i < pHistogram->iBucketCount) {
+            metricsBuffer_append(pBuffer,
+                                 "%.*s_bucket{%.*s%sle=\"%.15g\"} %llu\n",
+                                 iFamilyLength,
+                                 szName,
+                                 iLabelLength,
+                                 szLabel,
+                                 szComma,
+                                 pHistogram->bounds[i],
+                                 (unsigned long long)uiCumulative);
+        }
+        else {
+            metricsBuffer_append(pBuffer,
+                                 "%.*s_bucket{%.*s%sle=\"+Inf\"} %llu\n",
+                                 iFamilyLength,
+                                 szName,
+                                 iLabelLength,
+                                 szLabel,
+                                 szComma,
+                                 (unsigned long long)uiCumulative);
+        }
+    }
+
+    const char* szOpen  = iLabelLength > 0 ? "{" : "";
+    const char* szClose = iLabelLength > 0 ? "}" : "";
+    metricsBuffer_append(
+        pBuffer,
+        "%.*s_sum%s%.*s%s %.15g\n",
+        iFamilyLength,
+        szName,
+        szOpen,
+        iLabelLength,
+        szLabel,
+        szClose,
+        metrics_bitsToDouble(atomic_load_explicit(&pHistogram->uiSumBits, memory_order_relaxed)));
+    metricsBuffer_append(
+        pBuffer,
+        "%.*s_count%s%.*s%s %llu\n",
+        iFamilyLength,
+        szName,
+        szOpen,
+        iLabelLength,
+        szLabel,
+        szClose,
+        (unsigned long long)atomic_load_explicit(&pHistogram->uiCount, memory_order_relaxed));
+}
+
+static int metrics_compareEntry(const void* pFirst, const void* pSecond)
+{
+    return strcmp((*(const metricsEntry_tt**)pFirst)->szName,
+                  (*(const metricsEntry_tt**)pSecond)->szName);
+}
+
+char* metrics_render(size_t* pLength)
+{
+    // 回调里可能注册新指标, 先复制一份在锁外执行
+    metricsCollector_tt collectors[DEF_METRICS_MAX_COLLECTORS];
+    spinLock_lock(&s_lock);
+    int32_t iCollectorCount = s_iCollectorCount;
+    memcpy(collectors, s_collectors, sizeof(metricsCollector_tt) * iCollectorCount);
+    spinLock_unlock(&s_lock);
+
+    metrics_collectProcess();
+    for (int32_t i = 0; i < iCollectorCount; ++i) {
+        collectors[i].fnCollect(collectors[i].pUserData);
+    }
+
+    static const char* const s_szTypeNames[] = {"counter", "gauge", "histogram"};
+
+    metricsBuffer_tt buffer;
+    buffer.nLength    = 0;
+    buffer.nCapacity  = 4096;
+    buffer.pBuffer    = mem_malloc(buffer.nCapacity);
+    buffer.pBuffer[0] = '\0';
+
+    spinLock_lock(&s_lock);
+    int32_t           iCount    = s_iEntryCount;
+    metricsEntry_tt** ppEntries = mem_malloc(sizeof(metricsEntry_tt*) * (iCount > 0 ? iCount : 1));
+    metricsEntry_tt*  pEntry    = s_pEntryList;
+    for (int32_t i = 0; i < iCount; ++i) {
+        ppEntries[i] = pEntry;
+        pEntry       = pEntry->pNext;
+    }
+    spinLock_unlock(&s_lock);
+
+    // 按名字排序, 同族的指标相邻输出
+    qsort(ppEntries, iCount, sizeof(metricsEntry_tt*), metrics_compareEntry);
+
+    const char* szLastFamily      = NULL;
+    int32_t     iLastFamilyLength = 0;
+    for (int32_t i = 0; i < iCount; ++i) {
+        pEntry                = ppEntries[i];
+        int32_t iFamilyLength = 0;
+        int32_t iLabelLength  = 0;
+        metrics_splitName(pEntry->szName, &iFamilyLength, &iLabelLength);
+        if (szLastFamily == NULL || iFamilyLength != iLastFamilyLength ||
+            strncmp(szLastFamily, pEntry->szName, iFamilyLength) != 0) {
+            szLastFamily      = pEntry->szName;
+            iLastFamilyLength = iFamilyLength;
+            if (pEntry->szHelp[0] != '\0') {
+                metricsBuffer_append(
+                    &buffer, "# HELP %.*s %s\n", iFamilyLength, pEntry->szName, pEntry->szHelp);
+            }
+            metricsBuffer_append(&buffer,
+                                 "# TYPE %.*s %s\n",
+                                 iFamilyLength,
+                                 pEntry->szName,
+                                 s_szTypeNames[pEntry->iType]);
+        }
+
+        switch (pEntry->iType) {
+        case eMetrics_counter:
+            metricsBuffer_append(&buffer,
+                                 "%s %llu\n",
+                                 pEntry->szName,
+                                 (unsigned long long)metricsCounter_get(pEntry->pMetric));
+            break;
+        case eMetrics_gauge:
+            metricsBuffer_append(
+                &buffer, "%s %.15g\n", pEntry->szName, metricsGauge_get(pEntry->pMetric));
+            break;
+        default:
+            metrics_renderHistogram(&buffer, pEntry->szName, pEntry->pMetric);
+            break;
+        }
+    }
+    mem_free(ppEntries);
+
+    if (pLength) {
+        *pLength = buffer.nLength;
+    }
+    return buffer.pBuffer;
+}
@@ -24,6 +24,7 @@ eventBuf_tt* createEventBuf(const char* pBuffer, int32_t iLength,
     pEventBuf->fnCallback  = fn;
     pEventBuf->uiWriteUser = uiWriteUser;
     pEventBuf->uiLength    = iLength;
+    pEventBuf->pShared     = NULL;
     memcpy(pEventBuf->szStorage, pBuffer, iLength);
     return pEventBuf;
 }
@@ -37,6 +38,7 @@ eventBuf_tt* createEventBuf_move(ioBufVec_tt* pBufVec, int32_t iCount,
     pEventBuf->fnCallback  = fn;
     pEventBuf->uiWriteUser = uiWriteUser;
     pEventBuf->uiLength    = (uint32_t)iCount | 0x80000000;
+    pEventBuf->pShared     = NULL;
     ioBufVec_tt* pBufWrite = (ioBufVec_tt*)pEventBuf->szStorage;
     for (int32_t i = 0; i < iCount; ++i) {
         pBufWrite[i].pBuf    = pBufVec[i].pBuf;
@@ -47,9 +49,28 @@ eventBuf_tt* createEventBuf_move(ioBufVec_tt* pBufVec, int32_t iCount,
     return pEventBuf;
 }
 
+eventBuf_tt* createEventBuf_shared(eventBufShared_tt* pShared,
+                                   void (*fn)(eventConnection_tt*, void*, bool, uintptr_t),
+                                   uintptr_t uiWriteUser)
+{
+    assert(pShared->iCount > 0);
+    eventBuf_tt* pEventBuf =
+        mem_malloc(sizeof(eventBuf_tt) + sizeof(ioBufVec_tt) * pShared->iCount);
+    pEventBuf->fnCallback  = fn;
+    pEventBuf->uiWriteUser = uiWriteUser;
+    pEventBuf->uiLength    = (uint32_t)pShared->iCount | 0x80000000;
+    pEventBuf->pShared     = pShared;
+    eventBufShared_addref(pShared);
+    memcpy(pEventBuf->szStorage, pShared->bufVec, sizeof(ioBufVec_tt) * pShared->iCount);
+    return pEventBuf;
+}
+
 void eventBuf_release(eventBuf_tt* pHandle)
 {
-    if (pHandle->uiLength & 0x80000000) {
+    if (pHandle->pShared) {
+        eventBufShared_release(pHandle->pShared);
+    }
+    else if (pHandle->uiLength & 0x80000000) {
         int32_t      iCount    = pHandle->uiLength & 0x7fffffff;
         ioBufVec_tt* pBufWrite = (ioBufVec_tt*)pHandle->szStorage;
         for (int32_t i = 0; i < iCount; ++i) {
@@ -59,6 +80,37 @@ void eventBuf_release(eventBuf_tt* pHandle)
     mem_free(pHandle);
 }
 
+eventBufShared_tt* createEventBufShared(ioBufVec_tt* pBufVec, int32_t iCount)
+{
+    assert(iCount > 0);
+    eventBufShared_tt* pHandle =
+        mem_malloc(sizeof(eventBufShared_tt) + sizeof(ioBufVec_tt) * iCount);
+    atomic_init(&pHandle->iRefCount, 1);
+    pHandle->iCount = iCount;
+    for (int32_t i = 0; i < iCount; ++i) {
+        pHandle->bufVec[i].pBuf    = pBufVec[i].pBuf;
+        pHandle->bufVec[i].iLength = pBufVec[i].iLength;
+        pBufVec[i].pBuf            = NULL;
+        pBufVec[i].iLength         = 0;
+    }
+    return pHandle;
+}
+
+void eventBufShared_addref(eventBufShared_tt* pHandle)
+{
+    atomic_fetch_add(&(pHandle->iRefCount), 1);
+}
+
+void eventBufShared_release(eventBufShared_tt* pHandle)
+{
+    if (atomic_fetch_sub(&(pHandle->iRefCount), 1) == 1) {
+        for (int32_t i = 0; i < pHandle->iCount; ++i) {
+            mem_free(pHandle->bufVec[i].pBuf);
+        }
+        mem_free(pHandle);
+    }
+}
+
 #define SHUTDOWN_WR SHUT_WR
 
 #ifndef MSG_NOSIGNAL
@@ -137,6 +189,7 @@ static inline void eventConnection_handleClose(eventConnection_tt* pHandle)
             if (pEventBuf->uiLength & 0x80000000) {
                 int32_t      iCount    = pEventBuf->uiLength & 0x7fffffff;
                 ioBufVec_tt* pBufWrite = (ioBufVec_tt*)pEventBuf->szStorage;
+                nWriteLength           = 0;
                 for (int32_t i = 0; i < iCount; ++i) {
                     nWriteLength += pBufWrite[i].iLength;
                 }
@@ -162,6 +215,7 @@ static inline void eventConnection_handleClose(eventConnection_tt* pHandle)
             pHandle->fnCloseCallback = NULL;
         }
         atomic_fetch_sub(&(pHandle->pEventIOLoop->iConnections), 1);
+        metricsGauge_add(pHandle->pEventIOLoop->pEventIO->pMetricsConnections, -1);
         eventConnection_release(pHandle);
     }
 }
@@ -211,6 +265,7 @@ static bool eventConnection_handleRecv(eventConnection_tt* pHandle)
     }
 
     if (iBytesRead > 0) {
+        metricsCounter_add(pHandle->pEventIOLoop->pEventIO->pMetricsBytesRead, iBytesRead);
         if ((size_t)(iBytesRead) <= nBytesWritable) {
             byteQueue_writeOffset(&pHandle->readByteQueue, iBytesRead);
 
@@ -286,6 +341,7 @@ static inline void eventConnection_sendCompleteCallback(eventConnection_tt* pHan
         if (pEventBuf->uiLength & 0x80000000) {
             int32_t      iCount    = pEventBuf->uiLength & 0x7fffffff;
             ioBufVec_tt* pBufWrite = (ioBufVec_tt*)pEventBuf->szStorage;
+            nLength                = 0;
             for (int32_t i = 0; i < iCount; ++i) {
                 nLength += pBufWrite[i].iLength;
             }
@@ -382,6 +438,7 @@ static inline void eventConnection_sendCompleteCallback(eventConnection_tt* pHan
 
         if (iBytesSent > 0) {
             pHandle->nWritten += iBytesSent;
+            metricsCounter_add(pHandle->pEventIOLoop->pEventIO->pMetricsBytesWritten, iBytesSent);
         }
         else {
             int32_t iError = errno;
@@ -803,6 +860,7 @@ static inline int32_t eventConnection_sendData(eventConnection_tt* pHandle, even
 
         if (iWritten >= 0) {
             nRemaining = iLength - iWritten;
+            metricsCounter_add(pHandle->pEventIOLoop->pEventIO->pMetricsBytesWritten, iWritten);
         }
         else {
             int32_t iError = errno;
@@ -1161,14 +1219,15 @@ bool eventConnection_isConnected(eventConnection_tt* pHandle)
 int32_t eventConnection_send(eventConnection_tt* pHandle, eventBuf_tt* pEventBuf)
 {
     if (atomic_load(&pHandle->iStatus) != eConnected) {
+        eventBuf_release(pEventBuf);
         return -1;
     }
 
+    pEventBuf->pEventConnection = pHandle;
     if (eventIOLoop_isInLoopThread(pHandle->pEventIOLoop)) {
         return eventConnection_sendData(pHandle, pEventBuf);
     }
     else {
-        pEventBuf->pEventConnection = pHandle;
         eventConnection_addref(pEventBuf->pEventConnection);
         eventIOLoop_runInLoop(pHandle->pEventIOLoop,
                               &pEventBuf->eventAsync,
@@ -1192,3 +1251,14 @@ size_t eventConnection_getReceiveBufLength(eventConnection_tt* pHandle)
 {
     return byteQueue_getCapacity(&pHandle->readByteQueue);
 }
+
+uintptr_t eventConnection_getLoopKey(eventConnection_tt* pHandle)
+{
+    return (uintptr_t)pHandle->pEventIOLoop;
+}
+
+void eventConnection_runInLoop(eventConnection_tt* pHandle, eventAsync_tt* pEventAsync,
+                               void (*fnWork)(eventAsync_tt*), void (*fnCancel)(eventAsync_tt*))
+{
+    eventIOLoop_runInLoop(pHandle->pEventIOLoop, pEventAsync, fnWork, fnCancel);
+}
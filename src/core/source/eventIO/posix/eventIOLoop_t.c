@@ -41,8 +41,9 @@ static void eventIOLoop_doEvents(eventIOLoop_tt* pEventIOLoop)
     mutex_unlock(&pEventIOLoop->mutex);
 #endif
 
-    eventAsync_tt* pEvent = NULL;
-    QUEUE*         pNode  = NULL;
+    eventAsync_tt* pEvent  = NULL;
+    QUEUE*         pNode   = NULL;
+    uint32_t       uiTasks = 0;
     while (!QUEUE_EMPTY(&queuePending)) {
         pNode = QUEUE_HEAD(&queuePending);
         QUEUE_REMOVE(pNode);
@@ -50,6 +51,7 @@ static void eventIOLoop_doEvents(eventIOLoop_tt* pEventIOLoop)
         pEvent = container_of(pNode, eventAsync_tt, node);
         if (eventIO_isRunning(pEventIOLoop->pEventIO)) {
             pEvent->fnWork(pEvent);
+            ++uiTasks;
         }
         else {
             if (pEvent->fnCancel) {
@@ -57,6 +59,7 @@ static void eventIOLoop_doEvents(eventIOLoop_tt* pEventIOLoop)
             }
         }
     }
+    metricsCounter_add(pEventIOLoop->pMetricsTasks, uiTasks);
 }
 
 static void eventIOLoop_queuedEvent(struct pollHandle_s* pHandle, int32_t iEvents)
@@ -65,7 +68,8 @@ static void eventIOLoop_queuedEvent(struct pollHandle_s* pHandle, int32_t iEvent
     if (iEvents & ePollerReadable) {
         char szBuf[128];
         if (read(pEventIOLoop->hQueuedEvent, szBuf, sizeof(szBuf)) > 0) {
-            pEventIOLoop->fnDoEvents(pEventIOLoop->pEventIO);
+            metricsCounter_add(pEventIOLoop->pMetricsTasks,
+                               pEventIOLoop->fnDoEvents(pEventIOLoop->pEventIO));
         }
     }
 }
@@ -81,6 +85,8 @@ void eventIOLoop_init(eventIOLoop_tt* pEventIOLoop, struct eventIO_s* pEventIO,
     pEventIOLoop->pEventIO     = pEventIO;
     eventIO_addref(pEventIOLoop->pEventIO);
     atomic_init(&pEventIOLoop->iConnections, 0);
+    atomic_init(&pEventIOLoop->uiWakeNs, 0);
+    atomic_init(&pEventIOLoop->uiSleepNs, 0);
     wakeupEvent_init(&pEventIOLoop->wakeupEvent);
     pollHandle_init(&pEventIOLoop->queuedHandle);
     QUEUE_INIT(&pEventIOLoop->queuePending);
@@ -131,7 +137,7 @@ void eventIOLoop_clear(eventIOLoop_tt* pEventIOLoop)
 }
 
 bool eventIOLoop_start(eventIOLoop_tt* pEventIOLoop, int32_t hQueuedEvent,
-                       void (*fnDoEvents)(struct eventIO_s*))
+                       uint32_t (*fnDoEvents)(struct eventIO_s*))
 {
     pEventIOLoop->uiThreadId = threadId();
     pEventIOLoop->fnDoEvents = fnDoEvents;
@@ -172,6 +178,10 @@ void eventIOLoop_threadRun(void* pArg)
     pEventIOLoop->uiThreadId     = threadId();
     eventIO_tt* pEventIO         = pEventIOLoop->pEventIO;
     int32_t     iEvents          = 0;
+    timespec_tt time;
+    getClockMonotonic(&time);
+    uint64_t uiIdleSinceNs = timespec_toNsec(&time);
+    atomic_store(&pEventIOLoop->uiSleepNs, uiIdleSinceNs);
     while (pEventIOLoop->bRunning) {
         atomic_fetch_add(&pEventIO->iIdleThreads, 1);
         iEvents = poller_wait(pEventIOLoop->pPoller, -1);
@@ -179,9 +189,11 @@ void eventIOLoop_threadRun(void* pArg)
         if (iEvents == -1) {
             break;
         }
-        else if (iEvents > 0) {
+        uint64_t uiWakeNs = eventIOLoop_wakeup(pEventIOLoop, uiIdleSinceNs, iEvents);
+        if (iEvents > 0) {
             poller_dispatch(pEventIOLoop->pPoller, iEvents);
         }
+        uiIdleSinceNs = eventIOLoop_sleep(pEventIOLoop, uiWakeNs);
     }
     eventIOLoop_clear(pEventIOLoop);
 }
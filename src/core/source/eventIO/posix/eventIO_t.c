@@ -55,7 +55,7 @@ static inline void queuedEvent_clear(eventIO_tt* pEventIO)
     }
 }
 
-static inline void eventIO_doEvents(eventIO_tt* pEventIO)
+static inline uint32_t eventIO_doEvents(eventIO_tt* pEventIO)
 {
     QUEUE queuePending;
 #ifdef DEF_USE_SPINLOCK
@@ -70,8 +70,9 @@ static inline void eventIO_doEvents(eventIO_tt* pEventIO)
     mutex_unlock(&pEventIO->queuedLock);
 #endif
 
-    eventAsync_tt* pEvent = NULL;
-    QUEUE*         pNode  = NULL;
+    eventAsync_tt* pEvent  = NULL;
+    QUEUE*         pNode   = NULL;
+    uint32_t       uiTasks = 0;
     while (!QUEUE_EMPTY(&queuePending)) {
         pNode = QUEUE_HEAD(&queuePending);
         QUEUE_REMOVE(pNode);
@@ -79,6 +80,7 @@ static inline void eventIO_doEvents(eventIO_tt* pEventIO)
         pEvent = container_of(pNode, eventAsync_tt, node);
         if (atomic_load(&pEventIO->bLoopRunning)) {
             pEvent->fnWork(pEvent);
+            ++uiTasks;
         }
         else {
             if (pEvent->fnCancel) {
@@ -86,6 +88,7 @@ static inline void eventIO_doEvents(eventIO_tt* pEventIO)
             }
         }
     }
+    return uiTasks;
 }
 
 typedef struct eventIOStopAsync_s
@@ -117,6 +120,7 @@ static inline void eventIO_loopStop(eventIO_tt* pEventIO)
 
 struct eventIOLoop_s* eventIO_connectionLoop(struct eventIO_s* pEventIO)
 {
+    metricsGauge_add(pEventIO->pMetricsConnections, 1);
     if (pEventIO->uiCocurrentThreads == 0) {
         atomic_fetch_add(&pEventIO->pEventIOLoop->iConnections, 1);
         return pEventIO->pEventIOLoop;
@@ -150,6 +154,7 @@ void eventIO_queueInLoop(eventIO_tt* pEventIO, eventAsync_tt* pEventAsync,
     else {
         pEventAsync->fnWork   = fnWork;
         pEventAsync->fnCancel = fnCancel;
+        metricsCounter_inc(pEventIO->pMetricsPosts);
         mutex_lock(&pEventIO->mutex);
         QUEUE_INSERT_TAIL(&pEventIO->queuePending, &pEventAsync->node);
         cond_signal(&pEventIO->cond);
@@ -177,6 +182,7 @@ void eventIO_runInLoop(eventIO_tt* pEventIO, eventAsync_tt* pEventAsync,
         else {
             pEventAsync->fnWork   = fnWork;
             pEventAsync->fnCancel = fnCancel;
+            metricsCounter_inc(pEventIO->pMetricsPosts);
             mutex_lock(&pEventIO->mutex);
             QUEUE_INSERT_TAIL(&pEventIO->queuePending, &pEventAsync->node);
             cond_signal(&pEventIO->cond);
@@ -185,6 +191,41 @@ void eventIO_runInLoop(eventIO_tt* pEventIO, eventAsync_tt* pEventAsync,
     }
 }
 
+static inline void eventIO_registerMetrics(eventIO_tt* pEventIO)
+{
+    pEventIO->pMetricsPosts =
+        metrics_registerCounter("frog_eventio_posts_total", "Tasks posted to event loops");
+    pEventIO->pMetricsAccepts =
+        metrics_registerCounter("frog_eventio_accepts_total", "Accepted tcp connections");
+    pEventIO->pMetricsBytesRead =
+        metrics_registerCounter("frog_eventio_read_bytes_total", "Bytes read from sockets");
+    pEventIO->pMetricsBytesWritten =
+        metrics_registerCounter("frog_eventio_written_bytes_total", "Bytes written to sockets");
+    pEventIO->pMetricsConnections =
+        metrics_registerGauge("frog_eventio_connections", "Connections bound to event loops");
+    pEventIO->pMetricsTimers = metrics_registerGauge("frog_eventio_timers", "Armed timers");
+    pEventIO->pMetricsLoopTime = metrics_registerHistogram(
+        "frog_eventio_loop_iteration_us", "Event loop busy time per iteration in us", NULL, 0);
+    pEventIO->pMetricsTimerLag = metrics_registerHistogram(
+        "frog_eventio_timer_lag_ms", "Delay between timer deadline and callback in ms", NULL, 0);
+}
+
+static void eventIO_registerLoopMetrics(eventIOLoop_tt* pEventIOLoop, uint32_t uiIndex)
+{
+    char szName[128];
+    snprintf(szName, sizeof(szName), "frog_eventio_loop_wakeups_total{loop=\"%u\"}", uiIndex);
+    pEventIOLoop->pMetricsWakeups = metrics_registerCounter(szName, "Event loop wakeups");
+    snprintf(szName, sizeof(szName), "frog_eventio_loop_events_total{loop=\"%u\"}", uiIndex);
+    pEventIOLoop->pMetricsEvents = metrics_registerCounter(szName, "Poller events dispatched");
+    snprintf(szName, sizeof(szName), "frog_eventio_loop_tasks_total{loop=\"%u\"}", uiIndex);
+    pEventIOLoop->pMetricsTasks = metrics_registerCounter(szName, "Queued tasks run by event loop");
+    snprintf(szName, sizeof(szName), "frog_eventio_loop_busy_ns_total{loop=\"%u\"}", uiIndex);
+    pEventIOLoop->pMetricsBusyNs = metrics_registerCounter(szName, "Event loop busy time in ns");
+    snprintf(szName, sizeof(szName), "frog_eventio_loop_idle_ns_total{loop=\"%u\"}", uiIndex);
+    pEventIOLoop->pMetricsIdleNs =
+        metrics_registerCounter(szName, "Event loop time spent in poller wait in ns");
+}
+
 eventIO_tt* createEventIO()
 {
     eventIO_tt* pEventIO = mem_malloc(sizeof(eventIO_tt));
@@ -214,6 +255,8 @@ eventIO_tt* createEventIO()
     atomic_init(&pEventIO->uiCocurrentRunning, 0);
     atomic_init(&pEventIO->iRefCount, 1);
     atomic_init(&pEventIO->bLoopRunning, false);
+    atomic_init(&pEventIO->uiTimerLagMaxMs, 0);
+    eventIO_registerMetrics(pEventIO);
     return pEventIO;
 }
 
@@ -234,6 +277,58 @@ uint32_t eventIO_getNumberOfConcurrentThreads(eventIO_tt* pEventIO)
     return pEventIO->uiCocurrentThreads;
 }
 
+int32_t eventIO_getLoopStats(eventIO_tt* pEventIO, eventIOLoopStats_tt* pStats, int32_t iCount)
+{
+    if (pEventIO->pEventIOLoop == NULL) {
+        return 0;
+    }
+    int32_t iLoops =
+        pEventIO->uiCocurrentThreads == 0 ? 1 : (int32_t)pEventIO->uiCocurrentThreads;
+    if (iLoops > iCount) {
+        iLoops = iCount;
+    }
+
+    timespec_tt now;
+    getClockMonotonic(&now);
+    uint64_t uiNowNs = timespec_toNsec(&now);
+    for (int32_t i = 0; i < iLoops; ++i) {
+        eventIOLoop_tt* pEventIOLoop = &pEventIO->pEventIOLoop[i];
+        pStats[i].uiWakeups          = metricsCounter_get(pEventIOLoop->pMetricsWakeups);
+        pStats[i].uiEvents           = metricsCounter_get(pEventIOLoop->pMetricsEvents);
+        pStats[i].uiTasks            = metricsCounter_get(pEventIOLoop->pMetricsTasks);
+        pStats[i].uiBusyNs           = metricsCounter_get(pEventIOLoop->pMetricsBusyNs);
+        pStats[i].uiIdleNs           = metricsCounter_get(pEventIOLoop->pMetricsIdleNs);
+        pStats[i].iConnections       = atomic_load(&pEventIOLoop->iConnections);
+        // 计入尚未结束的这一段忙碌或空闲时间
+        uint64_t uiWakeNs  = atomic_load_explicit(&pEventIOLoop->uiWakeNs, memory_order_relaxed);
+        uint64_t uiSleepNs = atomic_load_explicit(&pEventIOLoop->uiSleepNs, memory_order_relaxed);
+        pStats[i].uiStallMs = 0;
+        if (uiWakeNs != 0) {
+            if (uiNowNs > uiWakeNs) {
+                pStats[i].uiBusyNs += uiNowNs - uiWakeNs;
+                pStats[i].uiStallMs = (uiNowNs - uiWakeNs) / 1000000;
+            }
+        }
+        else if (uiSleepNs != 0 && uiNowNs > uiSleepNs) {
+            pStats[i].uiIdleNs += uiNowNs - uiSleepNs;
+        }
+    }
+    return iLoops;
+}
+
+uint64_t eventIO_getTimerLag(eventIO_tt* pEventIO, double* pTotalLagMs, uint64_t* pMaxLagMs)
+{
+    metricsHistogram_tt* pHistogram = pEventIO->pMetricsTimerLag;
+    if (pTotalLagMs) {
+        *pTotalLagMs = metrics_bitsToDouble(
+            atomic_load_explicit(&pHistogram->uiSumBits, memory_order_relaxed));
+    }
+    if (pMaxLagMs) {
+        *pMaxLagMs = atomic_exchange(&pEventIO->uiTimerLagMaxMs, 0);
+    }
+    return atomic_load_explicit(&pHistogram->uiCount, memory_order_relaxed);
+}
+
 void eventIO_addref(eventIO_tt* pEventIO)
 {
     atomic_fetch_add(&(pEventIO->iRefCount), 1);
@@ -272,6 +367,7 @@ bool eventIO_start(eventIO_tt* pEventIO, bool bTimerEventOff)
         pEventIO->pEventIOLoop = mem_malloc(sizeof(eventIOLoop_tt) * pEventIO->uiCocurrentThreads);
         for (uint32_t i = 0; i < pEventIO->uiCocurrentThreads; ++i) {
             eventIOLoop_init(&(pEventIO->pEventIOLoop[i]), pEventIO, eventIO_loopStop);
+            eventIO_registerLoopMetrics(&(pEventIO->pEventIOLoop[i]), i);
             if (!eventIOLoop_start(
                     &(pEventIO->pEventIOLoop[i]), pEventIO->hQueuedEvent[0], eventIO_doEvents)) {
                 return false;
@@ -283,6 +379,7 @@ bool eventIO_start(eventIO_tt* pEventIO, bool bTimerEventOff)
     else {
         pEventIO->pEventIOLoop = mem_malloc(sizeof(eventIOLoop_tt));
         eventIOLoop_init(pEventIO->pEventIOLoop, pEventIO, NULL);
+        eventIO_registerLoopMetrics(pEventIO->pEventIOLoop, 0);
         if (!eventIOLoop_start(
                 pEventIO->pEventIOLoop, pEventIO->hQueuedEvent[0], eventIO_doEvents)) {
             return false;
@@ -322,6 +419,22 @@ static inline int32_t eventIO_nextTimeout(const eventIO_tt* pEventIO)
     return (int32_t)(pHandle->uiTimeout - pEventIO->uiLoopTime);
 }
 
+static inline void eventIO_observeTimerLag(eventIO_tt* pEventIO, uint64_t uiDeadlineMs)
+{
+    timespec_tt now;
+    getClockMonotonic(&now);
+    uint64_t uiNowMs = timespec_toMsec(&now);
+    uint64_t uiLagMs = uiNowMs > uiDeadlineMs ? uiNowMs - uiDeadlineMs : 0;
+    metricsHistogram_observe(pEventIO->pMetricsTimerLag, (double)uiLagMs);
+    uint64_t uiMaxMs = atomic_load_explicit(&pEventIO->uiTimerLagMaxMs, memory_order_relaxed);
+    while (uiLagMs > uiMaxMs && !atomic_compare_exchange_weak_explicit(&pEventIO->uiTimerLagMaxMs,
+                                                                       &uiMaxMs,
+                                                                       uiLagMs,
+                                                                       memory_order_relaxed,
+                                                                       memory_order_relaxed)) {
+    }
+}
+
 static inline void eventIO_runTimers(eventIO_tt* pEventIO)
 {
     struct heap_node* pHeadNode = NULL;
@@ -333,10 +446,19 @@ static inline void eventIO_runTimers(eventIO_tt* pEventIO)
 
         pHandle = container_of(pHeadNode, eventTimer_tt, node);
         if (pHandle->uiTimeout > pEventIO->uiLoopTime) break;
+        eventIO_observeTimerLag(pEventIO, pHandle->uiTimeout);
         eventTimer_run(pHandle);
     }
 }
 
+static inline void eventIO_observeLoopTime(eventIO_tt* pEventIO, const timespec_tt* pStart)
+{
+    timespec_tt now;
+    getClockMonotonic(&now);
+    metricsHistogram_observe(pEventIO->pMetricsLoopTime,
+                             (double)(timespec_toNsec(&now) - timespec_toNsec(pStart)) / 1000.0);
+}
+
 static void eventIOLoop_main(eventIOLoop_tt* pEventIOLoop)
 {
     pEventIOLoop->uiThreadId = threadId();
@@ -345,6 +467,9 @@ static void eventIOLoop_main(eventIOLoop_tt* pEventIOLoop)
     timespec_tt time;
     int32_t     iTimeout = -1;
     int32_t     iEvents  = 0;
+    getClockMonotonic(&time);
+    uint64_t uiIdleSinceNs = timespec_toNsec(&time);
+    atomic_store(&pEventIOLoop->uiSleepNs, uiIdleSinceNs);
 
     while (pEventIOLoop->bRunning) {
         if (!pEventIO->bTimerEventOff) {
@@ -359,7 +484,9 @@ static void eventIOLoop_main(eventIOLoop_tt* pEventIOLoop)
         if (iEvents == -1) {
             break;
         }
-        else if (iEvents == 0) {
+
+        uint64_t uiWakeNs = eventIOLoop_wakeup(pEventIOLoop, uiIdleSinceNs, iEvents);
+        if (iEvents == 0) {
             pEventIO->uiLoopTime += iTimeout;
             if (!pEventIO->bTimerEventOff) {
                 eventIO_runTimers(pEventIO);
@@ -367,11 +494,13 @@ static void eventIOLoop_main(eventIOLoop_tt* pEventIOLoop)
         }
         else {
             if (!pEventIO->bTimerEventOff) {
-                getClockMonotonic(&time);
-                pEventIO->uiLoopTime = timespec_toMsec(&time);
+                pEventIO->uiLoopTime = (uiWakeNs + 999999) / 1000000;
             }
             poller_dispatch(pEventIOLoop->pPoller, iEvents);
         }
+        uiIdleSinceNs = eventIOLoop_sleep(pEventIOLoop, uiWakeNs);
+        metricsHistogram_observe(pEventIO->pMetricsLoopTime,
+                                 (double)(uiIdleSinceNs - uiWakeNs) / 1000.0);
     }
     eventIOLoop_clear(pEventIOLoop);
 }
@@ -464,6 +593,7 @@ void eventIO_dispatch(eventIO_tt* pEventIO)
                     iWaitTimeout = eventIO_nextTimeout(pEventIO);
                 }
             }
+            eventIO_observeLoopTime(pEventIO, &time);
         }
         mutex_lock(&pEventIO->mutex);
         QUEUE_MOVE(&pEventIO->queuePending, &queuePending);
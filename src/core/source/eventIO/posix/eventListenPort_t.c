@@ -116,6 +116,7 @@ static inline void eventListenPort_handleEvent(struct pollHandle_s* pHandle, int
                 accept(pListenHandle->hSocket, inetAddress_getSockaddr(&remoteAddr), &addrlen);
 #endif
             if (hConnectSocket != -1) {
+                metricsCounter_inc(pEventListenPort->pEventIO->pMetricsAccepts);
 #ifndef def_ACCEPT4
                 setNonBlockAndCloseOnExec(hConnectSocket);
 #endif
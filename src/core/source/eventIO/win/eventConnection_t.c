@@ -23,6 +23,7 @@ eventBuf_tt* createEventBuf(const char* pBuffer, int32_t iLength,
     pEventBuf->fnCallback  = fn;
     pEventBuf->uiWriteUser = uiWriteUser;
     pEventBuf->uiLength    = iLength;
+    pEventBuf->pShared     = NULL;
     memcpy(pEventBuf->szStorage, pBuffer, iLength);
     return pEventBuf;
 }
@@ -38,6 +39,7 @@ eventBuf_tt* createEventBuf_move(ioBufVec_tt* pBufVec, int32_t iCount,
     pEventBuf->fnCallback  = fn;
     pEventBuf->uiWriteUser = uiWriteUser;
     pEventBuf->uiLength    = (uint32_t)iCount | 0x80000000;
+    pEventBuf->pShared     = NULL;
     ioBufVec_tt* pBufWrite = (ioBufVec_tt*)pEventBuf->szStorage;
     for (int32_t i = 0; i < iCount; ++i) {
         pBufWrite[i].pBuf    = pBufVec[i].pBuf;
@@ -48,9 +50,30 @@ eventBuf_tt* createEventBuf_move(ioBufVec_tt* pBufVec, int32_t iCount,
     return pEventBuf;
 }
 
+eventBuf_tt* createEventBuf_shared(eventBufShared_tt* pShared,
+                                   void (*fn)(eventConnection_tt*, void*, bool, uintptr_t),
+                                   uintptr_t uiWriteUser)
+{
+    assert(pShared->iCount > 0);
+    eventBuf_tt* pEventBuf =
+        mem_malloc(sizeof(eventBuf_tt) + sizeof(ioBufVec_tt) * pShared->iCount);
+    pEventBuf->overlapped.eOperation = eSendOp;
+    bzero(&(pEventBuf->overlapped._Overlapped), sizeof(OVERLAPPED));
+    pEventBuf->fnCallback  = fn;
+    pEventBuf->uiWriteUser = uiWriteUser;
+    pEventBuf->uiLength    = (uint32_t)pShared->iCount | 0x80000000;
+    pEventBuf->pShared     = pShared;
+    eventBufShared_addref(pShared);
+    memcpy(pEventBuf->szStorage, pShared->bufVec, sizeof(ioBufVec_tt) * pShared->iCount);
+    return pEventBuf;
+}
+
 void eventBuf_release(eventBuf_tt* pHandle)
 {
-    if (pHandle->uiLength & 0x80000000) {
+    if (pHandle->pShared) {
+        eventBufShared_release(pHandle->pShared);
+    }
+    else if (pHandle->uiLength & 0x80000000) {
         int32_t      iCount    = pHandle->uiLength & 0x7fffffff;
         ioBufVec_tt* pBufWrite = (ioBufVec_tt*)pHandle->szStorage;
         for (int32_t i = 0; i < iCount; ++i) {
@@ -60,6 +83,37 @@ void eventBuf_release(eventBuf_tt* pHandle)
     mem_free(pHandle);
 }
 
+eventBufShared_tt* createEventBufShared(ioBufVec_tt* pBufVec, int32_t iCount)
+{
+    assert(iCount > 0);
+    eventBufShared_tt* pHandle =
+        mem_malloc(sizeof(eventBufShared_tt) + sizeof(ioBufVec_tt) * iCount);
+    atomic_init(&pHandle->iRefCount, 1);
+    pHandle->iCount = iCount;
+    for (int32_t i = 0; i < iCount; ++i) {
+        pHandle->bufVec[i].pBuf    = pBufVec[i].pBuf;
+        pHandle->bufVec[i].iLength = pBufVec[i].iLength;
+        pBufVec[i].pBuf            = NULL;
+        pBufVec[i].iLength         = 0;
+    }
+    return pHandle;
+}
+
+void eventBufShared_addref(eventBufShared_tt* pHandle)
+{
+    atomic_fetch_add(&(pHandle->iRefCount), 1);
+}
+
+void eventBufShared_release(eventBufShared_tt* pHandle)
+{
+    if (atomic_fetch_sub(&(pHandle->iRefCount), 1) == 1) {
+        for (int32_t i = 0; i < pHandle->iCount; ++i) {
+            mem_free(pHandle->bufVec[i].pBuf);
+        }
+        mem_free(pHandle);
+    }
+}
+
 static inline void setKeepAlive(int32_t hSocket, bool bOnOff)
 {
     int32_t iOptval = bOnOff ? 1 : 0;
@@ -862,3 +916,14 @@ size_t eventConnection_getReceiveBufLength(eventConnection_tt* pHandle)
 {
     return byteQueue_getCapacity(&pHandle->readByteQueue);
 }
+
+uintptr_t eventConnection_getLoopKey(eventConnection_tt* pHandle)
+{
+    return (uintptr_t)pHandle->pEventIO;
+}
+
+void eventConnection_runInLoop(eventConnection_tt* pHandle, eventAsync_tt* pEventAsync,
+                               void (*fnWork)(eventAsync_tt*), void (*fnCancel)(eventAsync_tt*))
+{
+    eventIO_runInLoop(pHandle->pEventIO, pEventAsync, fnWork, fnCancel);
+}
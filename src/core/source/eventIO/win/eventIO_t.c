@@ -261,6 +261,25 @@ static inline size_t Min(const size_t a, const size_t b)
     return a <= b ? a : b;
 }
 
+static inline void eventIO_registerMetrics(eventIO_tt* pEventIO)
+{
+    pEventIO->pMetricsPosts =
+        metrics_registerCounter("frog_eventio_posts_total", "Tasks posted to event loops");
+    pEventIO->pMetricsAccepts =
+        metrics_registerCounter("frog_eventio_accepts_total", "Accepted tcp connections");
+    pEventIO->pMetricsBytesRead =
+        metrics_registerCounter("frog_eventio_read_bytes_total", "Bytes read from sockets");
+    pEventIO->pMetricsBytesWritten =
+        metrics_registerCounter("frog_eventio_written_bytes_total", "Bytes written to sockets");
+    pEventIO->pMetricsConnections =
+        metrics_registerGauge("frog_eventio_connections", "Connections bound to event loops");
+    pEventIO->pMetricsTimers = metrics_registerGauge("frog_eventio_timers", "Armed timers");
+    pEventIO->pMetricsLoopTime = metrics_registerHistogram(
+        "frog_eventio_loop_iteration_us", "Event loop busy time per iteration in us", NULL, 0);
+    pEventIO->pMetricsTimerLag = metrics_registerHistogram(
+        "frog_eventio_timer_lag_ms", "Delay between timer deadline and callback in ms", NULL, 0);
+}
+
 eventIO_tt* createEventIO()
 {
     socketStartup();
@@ -289,6 +308,8 @@ eventIO_tt* createEventIO()
     atomic_init(&pEventIO->uiCocurrentRunning, 0);
     atomic_init(&pEventIO->bLoopNotified, true);
     atomic_init(&pEventIO->bLoopRunning, false);
+    atomic_init(&pEventIO->uiTimerLagMaxMs, 0);
+    eventIO_registerMetrics(pEventIO);
     return pEventIO;
 }
 
@@ -302,6 +323,7 @@ void eventIO_queueInLoop(eventIO_tt* pEventIO, eventAsync_tt* pEventAsync,
 {
     pEventAsync->fnWork   = fnWork;
     pEventAsync->fnCancel = fnCancel;
+    metricsCounter_inc(pEventIO->pMetricsPosts);
 
     if (pEventIO->uiCocurrentThreads == 0) {
         mutex_lock(&pEventIO->mutex);
@@ -353,6 +375,25 @@ int32_t eventIO_getIdleThreads(eventIO_tt* pEventIO)
     return atomic_load(&pEventIO->iIdleThreads);
 }
 
+// IOCP的工作线程共享完成端口, 暂不区分线程统计
+int32_t eventIO_getLoopStats(eventIO_tt* pEventIO, eventIOLoopStats_tt* pStats, int32_t iCount)
+{
+    return 0;
+}
+
+uint64_t eventIO_getTimerLag(eventIO_tt* pEventIO, double* pTotalLagMs, uint64_t* pMaxLagMs)
+{
+    metricsHistogram_tt* pHistogram = pEventIO->pMetricsTimerLag;
+    if (pTotalLagMs) {
+        *pTotalLagMs = metrics_bitsToDouble(
+            atomic_load_explicit(&pHistogram->uiSumBits, memory_order_relaxed));
+    }
+    if (pMaxLagMs) {
+        *pMaxLagMs = atomic_exchange(&pEventIO->uiTimerLagMaxMs, 0);
+    }
+    return atomic_load_explicit(&pHistogram->uiCount, memory_order_relaxed);
+}
+
 uint32_t eventIO_getNumberOfConcurrentThreads(eventIO_tt* pEventIO)
 {
     return pEventIO->uiCocurrentThreads;
@@ -414,6 +455,22 @@ static inline int32_t eventIO_nextTimeout(const eventIO_tt* pEventIO)
     return (int32_t)(pHandle->uiTimeout - pEventIO->uiLoopTime);
 }
 
+static inline void eventIO_observeTimerLag(eventIO_tt* pEventIO, uint64_t uiDeadlineMs)
+{
+    timespec_tt now;
+    getClockMonotonic(&now);
+    uint64_t uiNowMs = timespec_toMsec(&now);
+    uint64_t uiLagMs = uiNowMs > uiDeadlineMs ? uiNowMs - uiDeadlineMs : 0;
+    metricsHistogram_observe(pEventIO->pMetricsTimerLag, (double)uiLagMs);
+    uint64_t uiMaxMs = atomic_load_explicit(&pEventIO->uiTimerLagMaxMs, memory_order_relaxed);
+    while (uiLagMs > uiMaxMs && !atomic_compare_exchange_weak_explicit(&pEventIO->uiTimerLagMaxMs,
+                                                                       &uiMaxMs,
+                                                                       uiLagMs,
+                                                                       memory_order_relaxed,
+                                                                       memory_order_relaxed)) {
+    }
+}
+
 static inline void eventIO_runTimers(eventIO_tt* pEventIO)
 {
     struct heap_node* pHeadNode = NULL;
@@ -425,6 +482,7 @@ static inline void eventIO_runTimers(eventIO_tt* pEventIO)
 
         pHandle = container_of(pHeadNode, eventTimer_tt, node);
         if (pHandle->uiTimeout > pEventIO->uiLoopTime) break;
+        eventIO_observeTimerLag(pEventIO, pHandle->uiTimeout);
         eventTimer_run(pHandle);
     }
 }
@@ -489,12 +547,16 @@ static void eventIO_queuedCompletionStatusEx(eventIO_tt* pEventIO)
                         } break;
                         case eRecvOp:
                         {
+                            metricsCounter_add(pEventIO->pMetricsBytesRead,
+                                               pOverlappedEntrys[i].dwNumberOfBytesTransferred);
                             eventConnection_onRecv(pEventConnection,
                                                    pOverlappedPlus,
                                                    pOverlappedEntrys[i].dwNumberOfBytesTransferred);
                         } break;
                         case eSendOp:
                         {
+                            metricsCounter_add(pEventIO->pMetricsBytesWritten,
+                                               pOverlappedEntrys[i].dwNumberOfBytesTransferred);
                             eventConnection_onSend(pEventConnection,
                                                    pOverlappedPlus,
                                                    pOverlappedEntrys[i].dwNumberOfBytesTransferred);
@@ -510,6 +572,7 @@ static void eventIO_queuedCompletionStatusEx(eventIO_tt* pEventIO)
                                               acceptOverlappedPlus_tt,
                                               _Overlapped);
                         eventListenPort_tt* pEventListenPort = pOverlappedPlus->pEventListenPort;
+                        metricsCounter_inc(pEventIO->pMetricsAccepts);
                         eventListenPort_onAccept(pEventListenPort,
                                                  pOverlappedPlus,
                                                  pOverlappedEntrys[i].dwNumberOfBytesTransferred);
@@ -655,10 +718,12 @@ static void eventIO_queuedCompletionStatus(eventIO_tt* pEventIO)
                     } break;
                     case eRecvOp:
                     {
+                        metricsCounter_add(pEventIO->pMetricsBytesRead, dwTransferred);
                         eventConnection_onRecv(pEventConnection, pOverlappedPlus, dwTransferred);
                     } break;
                     case eSendOp:
                     {
+                        metricsCounter_add(pEventIO->pMetricsBytesWritten, dwTransferred);
                         eventConnection_onSend(pEventConnection, pOverlappedPlus, dwTransferred);
                     } break;
                     }
@@ -670,6 +735,7 @@ static void eventIO_queuedCompletionStatus(eventIO_tt* pEventIO)
                     acceptOverlappedPlus_tt* pOverlappedPlus =
                         CONTAINING_RECORD(lpOverlapped, acceptOverlappedPlus_tt, _Overlapped);
                     eventListenPort_tt* pEventListenPort = pOverlappedPlus->pEventListenPort;
+                    metricsCounter_inc(pEventIO->pMetricsAccepts);
                     eventListenPort_onAccept(pEventListenPort, pOverlappedPlus, dwTransferred);
                 }
             } break;
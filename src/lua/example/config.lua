@@ -1,5 +1,6 @@
 local platform = ...
 
+-- 0-255, 服务ID的bit23-30
 C_node_id = 1
 
 C_concurrent_threads = -1
@@ -21,3 +22,17 @@ C_bootstrap = "bootstrap"
 C_debug_ip = "127.0.0.1"
 
 C_debug_port = "9966"
+
+C_debug_attach = false
+
+C_luacache_share = true
+
+C_trace_sample = 0
+
+C_log_rotate_size = 0
+
+C_log_rotate_interval = 0
+
+C_log_event_json = false
+
+-- C_metrics_listen = "127.0.0.1:9100"
@@ -0,0 +1,53 @@
+local lchannelGroup = require "lruntime.channelGroup"
+local lmsgpack = require "lruntime.msgpack"
+
+local setmetatable_f = setmetatable
+
+local eventMsgSend <const> 		= 0x20
+local eventMsgText <const> 		= 0x10
+
+local msgCodec_t = lmsgpack
+
+local channelGroup = {}
+channelGroup.__index = channelGroup
+
+function channelGroup:add(address)
+	return self.handle:add(address)
+end
+
+function channelGroup:remove(address)
+	return self.handle:remove(address)
+end
+
+function channelGroup:clear()
+	self.handle:clear()
+end
+
+function channelGroup:count()
+	return self.handle:count()
+end
+
+function channelGroup:sendText(msg, exclude)
+	return self.handle:broadcast(eventMsgText, msg, exclude)
+end
+
+function channelGroup:sendBuf(msg, sz, exclude)
+	return self.handle:broadcast(eventMsgSend, msg, sz, exclude)
+end
+
+function channelGroup:send(...)
+	return self.handle:broadcast(eventMsgSend, msgCodec_t.encode(...))
+end
+
+function channelGroup:sendExclude(exclude, ...)
+	local msg, sz = msgCodec_t.encode(...)
+	return self.handle:broadcast(eventMsgSend, msg, sz, exclude)
+end
+
+local _M = {}
+
+function _M.new()
+	return setmetatable_f({ handle = lchannelGroup.new() }, channelGroup)
+end
+
+return _M
@@ -66,5 +66,29 @@ for i, x in ipairs(modes) do
     end
 end
 
+-- Structured logging: only the format id and raw field values leave Lua,
+-- the text (or JSON line) is built on the log writer thread.
+-- log.struct.info("player {player} enter scene {scene}", playerID, sceneName)
+local formatIds = {}
+
+local formatId = function(fmt)
+    local id = formatIds[fmt]
+    if not id then
+        id = serviceCore.logFormat(fmt)
+        formatIds[fmt] = id
+    end
+    return id
+end
+
+log.struct = {}
+for i, x in ipairs(modes) do
+    log.struct[x.name] = function(fmt, ...)
+        if i < levels[log.level] then
+            return
+        end
+        serviceCore.logStruct(x.level, formatId(fmt), ...)
+    end
+end
+
 
 return log
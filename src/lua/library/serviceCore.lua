@@ -19,7 +19,6 @@ local error_f = error
 local coroutine_t = coroutine
 local coroutine_create_f = coroutine_t.create
 local coroutine_yield_f = coroutine_t.yield
-local coroutine_resume_f = coroutine_t.resume
 
 local string_t = string
 local string_format_f = string_t.format
@@ -93,8 +92,48 @@ local sleepCoroutineToToken_t = {}
 local watchingTokenToAddress_t = {}
 local responseToAddress_t = {}
 
+local sampleThread_f = nil
+local coroutine_resume_f = lservice.resume
+
+-- 被追踪的协程及其所属的span, trace_n为其数量加上当前派发是否被追踪, 为0时不做任何切换
+local trace_f = lservice.trace
+local setTrace_f = lservice.setTrace
+local coroutineToTrace_t = {}
+local coroutineToSpan_t = {}
+local trace_n = 0
+
+local function co_traceBind_f(co)
+	local traceID, spanID = trace_f()
+	if traceID ~= 0 then
+		if not coroutineToTrace_t[co] then
+			trace_n = trace_n + 1
+		end
+		coroutineToTrace_t[co] = traceID
+		coroutineToSpan_t[co] = spanID
+	end
+end
+
+local function co_traceUnbind_f(co)
+	if coroutineToTrace_t[co] then
+		coroutineToTrace_t[co] = nil
+		coroutineToSpan_t[co] = nil
+		trace_n = trace_n - 1
+	end
+end
+
 local function co_resume_f(co, ...)
 	running_co = co
+	if sampleThread_f then
+		sampleThread_f(co)
+	end
+	if trace_n > 0 then
+		local traceID = coroutineToTrace_t[co]
+		if traceID then
+			setTrace_f(traceID, coroutineToSpan_t[co])
+		else
+			setTrace_f(0, 0)
+		end
+	end
 	return coroutine_resume_f(co, ...)
 end
 
@@ -116,13 +155,23 @@ local function co_create_f(func)
 					coroutineToToken_t[co] = nil
 					coroutineToAddress_t[co] = nil
 				end
+				if trace_n > 0 then
+					co_traceUnbind_f(co)
+				end
 				func = nil
 				coroutineReuse_t[#coroutineReuse_t+1] = co
 				func = coroutine_yield_f("SUSPEND")
 				func(coroutine_yield_f())
 			end
 		end)
+		if trace_n > 0 then
+			co_traceBind_f(co)
+		end
 	else
+		-- 先绑定再恢复, 否则未绑定的协程恢复时会清掉当前的追踪上下文
+		if trace_n > 0 then
+			co_traceBind_f(co)
+		end
 		local _co = running_co
 		co_resume_f(co, func)
 		running_co = _co
@@ -175,6 +224,9 @@ function suspend_f(co, result, command)
 			coroutineToAddress_t[co] = nil;
 			coroutineToToken_t[co] = nil
 		end
+		if trace_n > 0 then
+			co_traceUnbind_f(co)
+		end
 		serviceCore.async(function() end)
 		error_f(debug_traceback_f(co,tostring_f(command)))
 	end
@@ -494,8 +546,11 @@ function serviceCore.wakeup(co)
 end
 
 function serviceCore.callBuf(address, msg, sz)
-	local token = lservice.send(address,eventMsgCall,nil,msg,sz)
+	local token, err = lservice.send(address,eventMsgCall,nil,msg,sz)
 	if token == nil then
+		if err == "overload" then
+			error_f("call to overloaded " .. serviceCore.addressToString(address))
+		end
 		error_f("call to invalid " .. serviceCore.addressToString(address))
 	end
 	return yield_call_f(address, token)
@@ -505,13 +560,28 @@ function serviceCore.call(address, ...)
 	return msgCodec_t.decode(serviceCore.callBuf(address, msgCodec_t.encode(...)))
 end
 
+function serviceCore.callPriorityBuf(address, msg, sz)
+	local token = lservice.sendPriority(address,eventMsgCall,nil,msg,sz)
+	if token == nil then
+		error_f("call to invalid " .. serviceCore.addressToString(address))
+	end
+	return yield_call_f(address, token)
+end
+
+function serviceCore.callPriority(address, ...)
+	return msgCodec_t.decode(serviceCore.callPriorityBuf(address, msgCodec_t.encode(...)))
+end
+
 function serviceCore.command(address, ...)
 	return lservice.command(address, 0, lmsgpack.encode(...) ) ~= nil
 end
 
 function serviceCore.callCommand(address, ...)
-	local token = lservice.command(address,nil,lmsgpack.encode(...))
+	local token, err = lservice.command(address,nil,lmsgpack.encode(...))
 	if token == nil then
+		if err == "overload" then
+			error_f("command call to overloaded " .. serviceCore.addressToString(address))
+		end
 		error_f("command call to invalid " .. serviceCore.addressToString(address))
 	end
 	return lmsgpack.decode(yield_call_f(address, token))
@@ -590,6 +660,22 @@ function serviceCore.send(address, ...)
 	return serviceCore.sendBuf(address, msgCodec_t.encode(...))
 end
 
+function serviceCore.sendPriority(address, ...)
+	return lservice.sendPriority(address, eventMsgSend, 0, msgCodec_t.encode(...)) ~= nil
+end
+
+function serviceCore.multicastText(addresses, msg, sz)
+	return lservice.multicast(addresses, eventMsgText, msg, sz)
+end
+
+function serviceCore.multicastBuf(addresses, msg, sz)
+	return lservice.multicast(addresses, eventMsgSend, msg, sz)
+end
+
+function serviceCore.multicast(addresses, ...)
+	return serviceCore.multicastBuf(addresses, msgCodec_t.encode(...))
+end
+
 function serviceCore.genResponse(encode)
 	encode = encode or msgCodec_t.encode
 	local token = assert_f(coroutineToToken_t[running_co], "no token")
@@ -688,7 +774,7 @@ function serviceCore.clearRunningToken()
 	coroutineToToken_t[running_co] = nil
 end
 
-function serviceCore.dispatch(...)
+local function dispatch_f(...)
 	local succ,err = pcall_f(eventDispatch_f,...)
 	while true do
 		local co = table_remove_f(asyncQueue_t,1)
@@ -705,9 +791,49 @@ function serviceCore.dispatch(...)
 			end
 		end
 	end
+	return succ, err
+end
+
+-- 被追踪的派发多两个参数traceID, spanID
+function serviceCore.dispatch(event, source, token, msg, length, traceID)
+	if traceID then
+		trace_n = trace_n + 1
+	end
+	local succ,err = dispatch_f(event, source, token, msg, length)
+	if traceID then
+		trace_n = trace_n - 1
+	end
 	assert_f(succ, tostring_f(err))
 end
 
+-- 当前协程所属追踪的traceID(16进制), 未被追踪返回nil, 可用于日志关联
+function serviceCore.traceID()
+	local traceID = trace_f()
+	if traceID ~= 0 then
+		return string_format_f("%016x", traceID)
+	end
+	return nil
+end
+
+-- 每条消息单独带traceback保护, 出错的消息当场逐条记录, 不影响同批的其他消息
+local function dispatchBatch_f(events, count)
+	for i = 1, count * 5, 5 do
+		local succ, err = xpcall_f(serviceCore.dispatch, debug_traceback_f, events[i], events[i + 1], events[i + 2], events[i + 3], events[i + 4])
+		if not succ then
+			lservice.logCallbackError(events[i], events[i + 1], events[i + 2], tostring_f(err))
+		end
+	end
+end
+
+-- 批量模式下一次C->Lua调用分发多条消息, 单条消息出错不影响同批的其他消息
+function serviceCore.setBatchDispatch(enable)
+	if enable then
+		lservice.setBatchCallback(dispatchBatch_f)
+	else
+		lservice.setBatchCallback(nil)
+	end
+end
+
 function serviceCore.setMsgCodec(codec)
 	if codec then
 		local ret = msgCodec_t
@@ -742,7 +868,12 @@ end
 
 serviceCore.sendClose = lservice.sendClose
 serviceCore.self = lservice.self
+serviceCore.setMailboxLimit = lservice.setMailboxLimit
+serviceCore.setGC = lservice.setGC
+serviceCore.setMemoryQuota = lservice.setMemoryQuota
 serviceCore.log = lservice.log
+serviceCore.logStruct = lservice.logStruct
+serviceCore.logFormat = lservice.logFormat
 serviceCore.localPrint = lservice.localPrint
 serviceCore.bindName = lservice.bindName
 serviceCore.createService = lservice.createService
@@ -880,7 +1011,7 @@ end
 
 function defaultCommand._status()
 	local status = {}
-	status.cost,status.count,status.queue = lservice.status()
+	status.cost,status.count,status.queue,status.memory,status.memoryPeak,status.memoryQuota = lservice.status()
 	serviceCore.replyCommand(status)
 end
 
@@ -908,6 +1039,42 @@ function defaultCommand._profileoff()
 	lservice.setProfile(false)
 end
 
+function defaultCommand._samplestart(hz)
+	local ok = lservice.sampleStart(hz)
+	if ok then
+		sampleThread_f = lservice.sampleThread
+	end
+	serviceCore.replyCommand(ok)
+end
+
+function defaultCommand._samplestop()
+	sampleThread_f = nil
+	lservice.sampleStop()
+	serviceCore.replyCommand(true)
+end
+
+function defaultCommand._sampledump(prefix)
+	serviceCore.replyCommand(lservice.sampleDump(prefix))
+end
+
+function defaultCommand._heapstart(sampleBytes)
+	lservice.heapStart(sampleBytes)
+	serviceCore.replyCommand(true)
+end
+
+function defaultCommand._heapstop()
+	lservice.heapStop()
+	serviceCore.replyCommand(true)
+end
+
+function defaultCommand._heapsnapshot()
+	serviceCore.replyCommand(lservice.heapSnapshot())
+end
+
+function defaultCommand._heapdump(diff, count)
+	serviceCore.replyCommand(lservice.heapDump(diff, count))
+end
+
 function defaultCommand._run(source, filename, ...)
 	local inject = require "inject"
 	local args = table.pack(...)
@@ -1,4 +1,5 @@
 local serviceCore = require "serviceCore"
+local lenv = require "lruntime.env"
 
 serviceCore.start(function()
     local log = serviceCore.createService("logService")
@@ -13,6 +14,13 @@ serviceCore.start(function()
     local console = serviceCore.createService("consoleService")
     serviceCore.call(console, "start", "127.0.0.1:23")
 
+    -- 指标接口只在配置了C_metrics_listen时开放
+    local metricsAddress = lenv.metricsListen()
+    if metricsAddress then
+        local metrics = serviceCore.createService("metricsService")
+        serviceCore.call(metrics, "start", metricsAddress)
+    end
+
     serviceCore.launch("example/example")
 
     serviceCore.exit()
@@ -55,6 +55,12 @@ function cmdlineCommand.help()
 		services = "show all service list",
 		status = "show all service status",
 		luamem = "show all service lua state memory",
+		latency = "show all service mailbox wait time(us) p50/p99/p999",
+		loops = "show event loop thread utilisation and timer lag. loops [intervalMs]",
+		slowlog = "show recent slow dispatches with lua stack. slowlog [count]",
+		top = "refresh per service cpu/msgs/queue/mem/traffic. top [cpu|msgs|queue|mem|send|recv|name] [intervalMs] [count]",
+		tracesample = "set the sampling rate of traces started by channel messages. tracesample [rate 0~1]",
+		traceexport = "append buffered trace spans to file as json lines. traceexport filename",
 		luagc = " all service run collectgarbage \"collect\"",
 		exit = "exit service. exit address",
 		launch = "lanuch a new lua service. launch filename [opt param]",
@@ -64,6 +70,14 @@ function cmdlineCommand.help()
 		logoff =  "log off. logoff address",
 		profileon =  "profile on. profileon address",
 		profileoff =  "profile off. profileoff address",
+		samplestart = "start sampling lua stacks. samplestart address|all [hz]",
+		samplestop = "stop sampling lua stacks. samplestop address|all",
+		sampledump = "dump sampled folded stacks. sampledump address|all [filename]",
+		heapstart = "start sampling lua allocations by call site. heapstart address [sampleBytes]",
+		heapstop = "stop lua heap profiling. heapstop address",
+		heapdump = "show live bytes by allocation site. heapdump address [count]",
+		heapsnapshot = "remember live bytes as the base of heapdiff. heapsnapshot address",
+		heapdiff = "show live bytes grown since heapsnapshot. heapdiff address [count]",
 		ping = "test service. ping address",
 		call = "run call service. call address cmdline",
 		callCommand = "run callCommand service. callCommand address cmdline",
@@ -72,7 +86,9 @@ function cmdlineCommand.help()
 		cacheabandon = "abandon a lua file cache. cacheabandon filename",
 		channels = " all channel status",
 		debughelp = "show debug help cmd",
-		debug = "start a service debugger. debug address"
+		debug = "start a service debugger. debug address",
+		debugattach = "attach ide debugger to all lua service (C_debug_ip/C_debug_port)",
+		debugdetach = "detach ide debugger from all lua service",
 	}
 end
 
@@ -88,6 +104,155 @@ function cmdlineCommand.luamem()
 	return serviceCore.callCommand("_localS", "mem")
 end
 
+local function format_latency(v)
+	return string.format("count:%d\tp50:%d\tp99:%d\tp999:%d\tmax:%d",v.count,v.p50,v.p99,v.p999,v.max)
+end
+
+function cmdlineCommand.latency()
+	local list = {}
+	local latency, total = lenv.serviceLatency()
+	for k,v in pairs(latency) do
+		list[serviceCore.addressToString(k)] = format_latency(v)
+	end
+	list.total = format_latency(total)
+	return list
+end
+
+function cmdlineCommand.loops(intervalMs)
+	intervalMs = math.tointeger(tonumber(intervalMs)) or 1000
+	local before, timerBefore = lenv.loopStats()
+	if not before then
+		return
+	end
+	serviceCore.sleep(intervalMs)
+	local after, timer = lenv.loopStats()
+
+	local list = {}
+	local busyThreads = 0
+	for i,v in ipairs(after) do
+		local b = before[i]
+		local wakeups = v.wakeups - b.wakeups
+		local busy = v.busy - b.busy
+		local total = busy + v.idle - b.idle
+		local util = total > 0 and busy / total or 0
+		busyThreads = busyThreads + util
+		list[string.format("loop%02d", i - 1)] = string.format(
+			"busy:%.1f%%\twakeups/s:%d\tevents/wakeup:%.2f\ttasks/wakeup:%.2f\tstall(ms):%d\tconnections:%d",
+			util * 100,
+			wakeups * 1000 // intervalMs,
+			wakeups > 0 and (v.events - b.events) / wakeups or 0,
+			wakeups > 0 and (v.tasks - b.tasks) / wakeups or 0,
+			v.stall,
+			v.connections)
+	end
+	local fired = timer.fired - timerBefore.fired
+	list.timers = string.format("fired:%d\tavgLag(ms):%.2f\tmaxLag(ms):%d",
+		fired, fired > 0 and (timer.lag - timerBefore.lag) / fired or 0, timer.maxLag)
+	list.total = string.format("threads:%d\tbusyThreads:%.2f", #after, busyThreads)
+	return list
+end
+
+local topColumns = {
+	cpu = function(v) return v.cpu end,
+	msgs = function(v) return v.msgs end,
+	queue = function(v) return v.queue end,
+	mem = function(v) return v.memory end,
+	send = function(v) return v.send end,
+	recv = function(v) return v.recv end,
+}
+
+local function top_frame(print, before, after, elapsedMs, sortBy)
+	local rows = {}
+	for k,v in pairs(after) do
+		local b = before[k]
+		if b then
+			table.insert(rows, {
+				address = k,
+				name = v.name or "",
+				cpu = (v.busy - b.busy) / (elapsedMs * 10000),
+				msgs = (v.processed - b.processed) * 1000 / elapsedMs,
+				queue = v.queue,
+				memory = v.memory,
+				send = (v.send - b.send) * 1000 / elapsedMs,
+				recv = (v.recv - b.recv) * 1000 / elapsedMs,
+			})
+		end
+	end
+	local column = topColumns[sortBy]
+	if column then
+		table.sort(rows, function(a, b)
+			local x, y = column(a), column(b)
+			if x ~= y then
+				return x > y
+			end
+			return a.address < b.address
+		end)
+	else
+		table.sort(rows, function(a, b) return a.name < b.name end)
+	end
+
+	print(string.format("<top %s services:%d sort:%s", os.date("%H:%M:%S"), #rows, sortBy))
+	print(string.format("%-10s %-16s %7s %9s %7s %10s %10s %10s",
+		"address", "name", "cpu%", "msgs/s", "queue", "mem(KB)", "send(B/s)", "recv(B/s)"))
+	for _,v in ipairs(rows) do
+		print(string.format("%-10s %-16s %7.1f %9d %7d %10d %10d %10d",
+			serviceCore.addressToString(v.address), v.name, v.cpu, math.floor(v.msgs), v.queue,
+			v.memory // 1024, math.floor(v.send), math.floor(v.recv)))
+	end
+end
+
+-- 只读取C侧计数器, 不打断也不给服务发消息
+function codeCommand.top(cmd)
+	local sortBy = cmd[2] or "cpu"
+	if not topColumns[sortBy] and sortBy ~= "name" then
+		return "unknown column " .. sortBy
+	end
+	local intervalMs = math.max(math.tointeger(tonumber(cmd[3])) or 1000, 100)
+	local count = math.tointeger(tonumber(cmd[4])) or 10
+	local before = lenv.serviceStats()
+	local timer = serviceCore.getClockMonotonic()
+	for _ = 1, count do
+		serviceCore.sleep(intervalMs)
+		local after = lenv.serviceStats()
+		local now = serviceCore.getClockMonotonic()
+		top_frame(cmd.print, before, after, math.max(now - timer, 1), sortBy)
+		before, timer = after, now
+	end
+end
+
+function cmdlineCommand.slowlog(count)
+	count = math.tointeger(tonumber(count)) or 10
+	local logs = lenv.slowLog()
+	local list = {}
+	for i = math.max(#logs - count + 1, 1), #logs do
+		local v = logs[i]
+		local line = string.format("%s\tservice:%s\tsource:%s\tevent:0x%02x\telapsed(ms):%d",
+			os.date("%Y-%m-%d %H:%M:%S", v.time // 1000),
+			serviceCore.addressToString(v.service),
+			serviceCore.addressToString(v.source),
+			v.event,
+			v.elapsed)
+		if v.stack then
+			line = line .. "\n" .. v.stack
+		end
+		list[string.format("%03d", i)] = line
+	end
+	return list
+end
+
+function cmdlineCommand.tracesample(rate)
+	local prev = lenv.traceSample(tonumber(rate))
+	return { prev = prev, rate = lenv.traceSample() }
+end
+
+function cmdlineCommand.traceexport(filename)
+	local count = lenv.traceExport(filename or "trace.jsonl")
+	if not count then
+		return "export error"
+	end
+	return { count = count }
+end
+
 function cmdlineCommand.luagc()
 	serviceCore.command("_localS", "gc")
 end
@@ -117,6 +282,16 @@ function cmdlineCommand.channels()
 	return list
 end
 
+function cmdlineCommand.debugattach()
+	if not lenv.debugAttach(true) then
+		return "C_debug_ip/C_debug_port not set"
+	end
+end
+
+function cmdlineCommand.debugdetach()
+	lenv.debugAttach(false)
+end
+
 function cmdlineCommand.cacheabandon(filename)
 	lenv.luacacheAbandon(filename)
 end
@@ -169,6 +344,77 @@ function cmdlineCommand.profileoff(address)
 	serviceCore.command(address,"_profileoff")
 end
 
+function cmdlineCommand.samplestart(address, hz)
+	if address == "all" then
+		serviceCore.command("_localS", "samplestart", tonumber(hz))
+		return
+	end
+	return tostring(serviceCore.callCommand(address,"_samplestart",tonumber(hz)))
+end
+
+function cmdlineCommand.samplestop(address)
+	if address == "all" then
+		serviceCore.command("_localS", "samplestop")
+	else
+		serviceCore.command(address,"_samplestop")
+	end
+end
+
+function cmdlineCommand.sampledump(address, filename)
+	local folded, count
+	if address == "all" then
+		folded, count = serviceCore.callCommand("_localS", "sampledump")
+	else
+		folded, count = serviceCore.callCommand(address,"_sampledump",address)
+	end
+	if not filename then
+		return folded
+	end
+	local f, err = io.open(filename, "w")
+	if not f then
+		return err
+	end
+	f:write(folded)
+	f:close()
+	return string.format("%d samples write to %s", count, filename)
+end
+
+function cmdlineCommand.heapstart(address, sampleBytes)
+	return tostring(serviceCore.callCommand(address, "_heapstart", math.tointeger(tonumber(sampleBytes))))
+end
+
+function cmdlineCommand.heapstop(address)
+	return tostring(serviceCore.callCommand(address, "_heapstop"))
+end
+
+function cmdlineCommand.heapsnapshot(address)
+	if not serviceCore.callCommand(address, "_heapsnapshot") then
+		return "heap profiler not started"
+	end
+end
+
+local function heap_dump(address, diff, count)
+	local sites, total = serviceCore.callCommand(address, "_heapdump", diff, math.tointeger(tonumber(count)) or 20)
+	if not sites then
+		return "heap profiler not started"
+	end
+	local list = {}
+	for i,v in ipairs(sites) do
+		list[string.format("%03d", i)] = string.format("%s:%d	samples:%d	alloc:%d	%s",
+			diff and "grow" or "live", v.live, v.samples, v.alloc, v.site)
+	end
+	list.total = string.format("live:%d", total)
+	return list
+end
+
+function cmdlineCommand.heapdump(address, count)
+	return heap_dump(address, false, count)
+end
+
+function cmdlineCommand.heapdiff(address, count)
+	return heap_dump(address, true, count)
+end
+
 function cmdlineCommand.ping(address)
 	local timer = serviceCore.getClockMonotonic()
 	local ok = pcall(serviceCore.ping, address)
@@ -236,6 +482,7 @@ local function cmdlineDispatch_f(channel,cmdline,print)
 		f = codeCommand[cmd]
 		if f then
 			split.channel = channel
+			split.print = print
 			split[1] = cmdline
 			ok, list = pcall(f,split)
 		else
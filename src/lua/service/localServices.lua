@@ -34,6 +34,31 @@ function command.gc()
 	end
 end
 
+function command.samplestart(hz)
+	for k,_ in pairs(services) do
+		serviceCore.command(k,"_samplestart",hz)
+	end
+end
+
+function command.samplestop()
+	for k,_ in pairs(services) do
+		serviceCore.command(k,"_samplestop")
+	end
+end
+
+function command.sampledump()
+	local stacks = {}
+	local total = 0
+	for k,_ in pairs(services) do
+		local ok, folded, count = pcall(serviceCore.callCommand,k,"_sampledump",serviceCore.addressToString(k))
+		if ok and count > 0 then
+			table.insert(stacks, folded)
+			total = total + count
+		end
+	end
+	serviceCore.replyCommand(table.concat(stacks), total)
+end
+
 function command.list()
 	local list = {}
 	for k,v in pairs(services) do
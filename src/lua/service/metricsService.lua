@@ -0,0 +1,39 @@
+local serviceCore = require "serviceCore"
+local httpResponse = require "http.response"
+local lmetrics = require "lruntime.metrics"
+
+local metricsHeaders = { ["content-type"] = "text/plain; version=0.0.4" }
+
+local function metrics(_,response)
+	response(200,metricsHeaders,lmetrics.render())
+end
+
+local command = {}
+
+function command.start(szAddress)
+	httpResponse.register("/metrics",metrics)
+	if not httpResponse.start({address = szAddress}) then
+		serviceCore.log("metrics listen error address:" .. szAddress)
+		return false
+	end
+	serviceCore.log("metrics start listen:" .. szAddress)
+	return true
+end
+
+function command.stop()
+	httpResponse.stop()
+	return true
+end
+
+function command.render()
+	return lmetrics.render()
+end
+
+serviceCore.start(function()
+	serviceCore.bindName("metrics")
+
+	serviceCore.eventDispatch(serviceCore.eventCall, function(_,cmd,...)
+		local func = assert(command[cmd])
+		serviceCore.reply(func(...))
+	end)
+end)
@@ -1,9 +1,30 @@
 local serviceCore = require "serviceCore"
 local lenv = require "lruntime.env"
 
+local command = {}
+
+-- 单次派发超过该时间(ms)记录慢日志并抓取调用栈, 0关闭
+local slowBudgetMs = 200
+
+function command.memory()
+	return lenv.serviceMemory()
+end
+
+function command.latency()
+	return lenv.serviceLatency()
+end
+
 serviceCore.start(function()
 	serviceCore.eventDispatch(serviceCore.eventText, function(source)
 		serviceCore.log(string.format("monitor service exception serviceId:%08x",source))
 	end)
-	lenv.monitorStart(serviceCore.self(),5000)
+	serviceCore.eventDispatch(serviceCore.eventCall, function(_,cmd,...)
+		local f = command[cmd]
+		if f then
+			serviceCore.reply(f(...))
+		else
+			serviceCore.reply(nil)
+		end
+	end)
+	lenv.monitorStart(serviceCore.self(),5000,slowBudgetMs)
 end)
\ No newline at end of file
@@ -29,12 +29,43 @@ __UNUSED const char* luaConfig_getLogService();
 
 __UNUSED int32_t luaConfig_getServerNodeID();
 
+__UNUSED const char* luaConfig_getClusterListen();
+
+// 指标接口的监听地址, 未配置时为NULL
+__UNUSED const char* luaConfig_getMetricsListen();
+
+__UNUSED int32_t luaConfig_getClusterNodeCount();
+
+__UNUSED const char* luaConfig_getClusterNode(int32_t iIndex, int32_t* pNodeId);
+
+__UNUSED int32_t luaConfig_getClusterAllowCount();
+
+__UNUSED const char* const* luaConfig_getClusterAllow();
+
 __UNUSED int32_t luaConfig_getConcurrentThreads();
 
+// 外部消息开始追踪的比例, 0~1
+__UNUSED double luaConfig_getTraceSample();
+
+__UNUSED int32_t luaConfig_getTraceCapacity();
+
+// 日志文件超过该字节数时轮转, 0表示不按大小轮转
+__UNUSED int64_t luaConfig_getLogRotateSize();
+
+// 日志文件打开超过该秒数时轮转, 0表示不按时间轮转
+__UNUSED int32_t luaConfig_getLogRotateInterval();
+
+// 结构化日志是否写成JSON行
+__UNUSED bool luaConfig_isLogEventJson();
+
 __UNUSED bool luaConfig_isLog();
 
 __UNUSED bool luaConfig_isProfile();
 
+__UNUSED bool luaConfig_isShareProto();
+
+__UNUSED bool luaConfig_isDebugAttach();
+
 __UNUSED const char* luaConfig_getDebug_ip();
 
 __UNUSED const char* luaConfig_getDebug_port();
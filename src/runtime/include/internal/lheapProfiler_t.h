@@ -0,0 +1,40 @@
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lua.h"
+
+#include "utility_t.h"
+
+#define DEF_HEAP_PROFILER_DEFAULT_SAMPLE 65536
+#define DEF_HEAP_PROFILER_MIN_SAMPLE 256
+
+struct lheapProfiler_s;
+typedef struct lheapProfiler_s lheapProfiler_tt;
+
+// 每分配nSampleBytes字节采样一次, 被采样的块代表这段区间内的全部分配
+__UNUSED lheapProfiler_tt* createHeapProfiler(size_t nSampleBytes);
+
+__UNUSED void lheapProfiler_release(lheapProfiler_tt* pProfiler);
+
+// 在分配器中调用, pOld为NULL表示新分配, pNew为NULL表示释放;
+// 返回true表示产生了待定位的采样, 需要在下一条Lua指令的钩子里调用lheapProfiler_resolve
+__UNUSED bool lheapProfiler_update(lheapProfiler_tt* pProfiler, void* pOld, void* pNew,
+                                   size_t nOldSize, size_t nNewSize);
+
+__UNUSED bool lheapProfiler_hasPending(lheapProfiler_tt* pProfiler);
+
+// 把待定位的采样归到L当前的调用点(source:line), 不能在分配器内调用
+__UNUSED void lheapProfiler_resolve(lheapProfiler_tt* pProfiler, lua_State* L);
+
+// 以当前各调用点的存活字节作为之后diff的基线
+__UNUSED void lheapProfiler_snapshot(lheapProfiler_tt* pProfiler);
+
+// 压入按存活字节(bDiff时为相对基线的增量)降序的前iCount个调用点:
+// { { site, live, samples, alloc }, ... }, 以及估算的存活总字节
+__UNUSED void lheapProfiler_push(lheapProfiler_tt* pProfiler, lua_State* L, bool bDiff,
+                                 int32_t iCount);
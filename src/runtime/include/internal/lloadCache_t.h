@@ -2,16 +2,21 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "utility_t.h"
 
 struct lua_State;
 
-__UNUSED void luaCache_init();
+// bShareProto为true时同一文件只编译一次, 各lua_State共享Proto
+__UNUSED void luaCache_init(bool bShareProto);
 
 __UNUSED void luaCache_clear();
 
+// 关闭lua_State, 并释放它对共享Proto持有者的引用, 加载过缓存的lua_State都应由此关闭
+__UNUSED void luaCache_closeState(struct lua_State* L);
+
 __UNUSED void luaCache_on();
 
 __UNUSED void luaCache_off();
@@ -0,0 +1,40 @@
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lua.h"
+
+#include "utility_t.h"
+
+#define DEF_SAMPLER_DEFAULT_HZ 1000
+#define DEF_SAMPLER_MAX_HZ 10000
+
+struct lsamplerStacks_s;
+typedef struct lsamplerStacks_s lsamplerStacks_tt;
+
+__UNUSED void lsampler_init();
+
+__UNUSED void lsampler_clear();
+
+// 采样节拍线程按引用计数启停, 频率取最近一次acquire的iHz
+__UNUSED bool lsampler_acquire(int32_t iHz);
+
+__UNUSED void lsampler_release();
+
+// 每个采样周期加一, 服务在节拍变化后的第一次计数钩子里记录一次调用栈
+__UNUSED uint32_t lsampler_getTick();
+
+__UNUSED lsamplerStacks_tt* createSamplerStacks();
+
+__UNUSED void lsamplerStacks_release(lsamplerStacks_tt* pStacks);
+
+// 记录L当前的调用栈, 相同的栈合并计数
+__UNUSED void lsamplerStacks_record(lsamplerStacks_tt* pStacks, lua_State* L);
+
+__UNUSED uint64_t lsamplerStacks_count(lsamplerStacks_tt* pStacks);
+
+// 以折叠栈格式("root;...;leaf count\n")压入一个字符串, szPrefix非NULL时作为每条栈的根帧
+__UNUSED void lsamplerStacks_push(lsamplerStacks_tt* pStacks, lua_State* L, const char* szPrefix);
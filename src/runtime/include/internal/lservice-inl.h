@@ -2,8 +2,48 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "utility_t.h"
 
-__UNUSED uint32_t createLuaService(const char* szServiceName, const char* pParam, size_t nLength);
+#define DEF_LUA_GC_INCREMENTAL 0
+#define DEF_LUA_GC_GENERATIONAL 1
+
+// 0表示沿用lua的默认值, iIdleStep为邮箱处理空后单步回收的KB数, 0表示不做
+typedef struct lserviceGc_s
+{
+    int32_t iMode;
+    int32_t iPause;
+    int32_t iStepMul;
+    int32_t iStepSize;
+    int32_t iMinorMul;
+    int32_t iMajorMul;
+    int32_t iIdleStep;
+} lserviceGc_tt;
+
+// nMemoryQuota为0表示不限制, bHeap只在单工作线程时生效
+typedef struct lserviceOption_s
+{
+    lserviceGc_tt gc;
+    size_t        nMemoryQuota;
+    bool          bHeap;
+} lserviceOption_tt;
+
+struct lserviceContext_s;
+
+// 创建lua_State, 打开库并加载服务脚本, 预先require szModules中';'分隔的模块, 尚未绑定service
+__UNUSED struct lserviceContext_s* createLuaServiceContext(const char* szServiceName,
+                                                           const char* szModules);
+
+__UNUSED void lserviceContext_release(struct lserviceContext_s* pContext);
+
+// 挂接/卸载调试器, 各服务在下一次回调时安装或移除钩子; 未配置C_debug_ip/C_debug_port时挂接失败
+__UNUSED bool lserviceDebug_attach(bool bAttach);
+
+__UNUSED bool lserviceDebug_isAttached();
+
+// 优先从lservicePool取预热好的lua_State
+__UNUSED uint32_t createLuaService(const char* szServiceName, const char* pParam, size_t nLength,
+                                   const lserviceOption_tt* pOption);
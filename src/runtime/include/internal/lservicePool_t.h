@@ -0,0 +1,26 @@
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utility_t.h"
+
+struct lserviceContext_s;
+
+__UNUSED void lservicePool_init();
+
+__UNUSED void lservicePool_clear();
+
+// 为服务脚本szName维持iCapacity个预热好的lua_State, iCapacity为0时清空该池
+// szModules为';'分隔的预先require的模块, 加载时还没有service句柄, 调用服务接口会报错
+__UNUSED bool lservicePool_prepare(const char* szName, int32_t iCapacity, const char* szModules);
+
+__UNUSED struct lserviceContext_s* lservicePool_take(const char* szName);
+
+// szName为NULL时丢弃所有池中已预热的lua_State, 脚本热更后调用
+__UNUSED void lservicePool_flush(const char* szName);
+
+__UNUSED bool lservicePool_status(const char* szName, int32_t* pReady, int32_t* pCapacity,
+                                  uint64_t* pHit, uint64_t* pMiss);
@@ -0,0 +1,171 @@
+
+
+#include "channel/lchannelGroup_t.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lauxlib.h"
+#include "lua.h"
+#include "lualib.h"
+
+#include "channel/channelGroup_t.h"
+
+#define def_excludeStackCount 64
+
+typedef struct lchannelGroup_s
+{
+    channelGroup_tt* pHandle;
+} lchannelGroup_tt;
+
+static inline channelGroup_tt* lchannelGroup_check(lua_State* L)
+{
+    lchannelGroup_tt* pChannelGroupL = (lchannelGroup_tt*)luaL_checkudata(L, 1, "channelGroup");
+    luaL_argcheck(L, pChannelGroupL != NULL, 1, "invalid user data");
+    if (pChannelGroupL->pHandle == NULL) {
+        luaL_error(L, "channelGroup closed");
+    }
+    return pChannelGroupL->pHandle;
+}
+
+static int32_t lchannelGroup_new(lua_State* L)
+{
+    lchannelGroup_tt* pChannelGroupL =
+        (lchannelGroup_tt*)lua_newuserdatauv(L, sizeof(lchannelGroup_tt), 0);
+    pChannelGroupL->pHandle = createChannelGroup();
+    luaL_getmetatable(L, "channelGroup");
+    lua_setmetatable(L, -2);
+    return 1;
+}
+
+static int32_t lchannelGroup_add(lua_State* L)
+{
+    channelGroup_tt* pHandle = lchannelGroup_check(L);
+    uint32_t         uiID    = (uint32_t)luaL_checkinteger(L, 2);
+    lua_pushboolean(L, channelGroup_add(pHandle, uiID));
+    return 1;
+}
+
+static int32_t lchannelGroup_remove(lua_State* L)
+{
+    channelGroup_tt* pHandle = lchannelGroup_check(L);
+    uint32_t         uiID    = (uint32_t)luaL_checkinteger(L, 2);
+    lua_pushboolean(L, channelGroup_remove(pHandle, uiID));
+    return 1;
+}
+
+static int32_t lchannelGroup_clear(lua_State* L)
+{
+    channelGroup_tt* pHandle = lchannelGroup_check(L);
+    channelGroup_clear(pHandle);
+    return 0;
+}
+
+static int32_t lchannelGroup_count(lua_State* L)
+{
+    channelGroup_tt* pHandle = lchannelGroup_check(L);
+    lua_pushinteger(L, channelGroup_getCount(pHandle));
+    return 1;
+}
+
+// group:broadcast(event, msg [,sz] [,exclude])
+static int32_t lchannelGroup_broadcast(lua_State* L)
+{
+    channelGroup_tt* pHandle = lchannelGroup_check(L);
+    uint32_t         uiEvent = (uint32_t)luaL_checkinteger(L, 2);
+
+    const char* pBuffer       = NULL;
+    size_t      nLength       = 0;
+    int32_t     iExcludeIndex = 4;
+
+    int32_t iMsgInputType = lua_type(L, 3);
+    switch (iMsgInputType) {
+    case LUA_TSTRING:
+    {
+        pBuffer = lua_tolstring(L, 3, &nLength);
+    } break;
+    case LUA_TLIGHTUSERDATA:
+    {
+        pBuffer       = (const char*)lua_touserdata(L, 3);
+        nLength       = luaL_checkinteger(L, 4);
+        iExcludeIndex = 5;
+    } break;
+    default: luaL_error(L, "invalid param %s", lua_typename(L, lua_type(L, 3)));
+    }
+
+    if (nLength > 0xFFFFFF) {
+        return luaL_error(L, "broadcast length > 15M");
+    }
+
+    int32_t iExcludeCount = 0;
+    switch (lua_type(L, iExcludeIndex)) {
+    case LUA_TNONE:
+    case LUA_TNIL: break;
+    case LUA_TNUMBER: iExcludeCount = 1; break;
+    case LUA_TTABLE: iExcludeCount = (int32_t)lua_rawlen(L, iExcludeIndex); break;
+    default:
+        luaL_error(L, "invalid exclude %s", lua_typename(L, lua_type(L, iExcludeIndex)));
+    }
+
+    // 排除列表由调用方决定长度, 超过栈上容量时放到userdata里由GC回收
+    uint32_t  stackExcludeIDs[def_excludeStackCount];
+    uint32_t* excludeIDs = stackExcludeIDs;
+    if (iExcludeCount > def_excludeStackCount) {
+        excludeIDs = (uint32_t*)lua_newuserdatauv(L, iExcludeCount * sizeof(uint32_t), 0);
+    }
+    if (lua_type(L, iExcludeIndex) == LUA_TNUMBER) {
+        excludeIDs[0] = (uint32_t)lua_tointeger(L, iExcludeIndex);
+    }
+    else {
+        for (int32_t i = 0; i < iExcludeCount; ++i) {
+            lua_rawgeti(L, iExcludeIndex, i + 1);
+            excludeIDs[i] = (uint32_t)lua_tointeger(L, -1);
+            lua_pop(L, 1);
+        }
+    }
+
+    lua_pushinteger(
+        L,
+        channelGroup_broadcast(
+            pHandle, pBuffer, (int32_t)nLength, uiEvent, 0, excludeIDs, iExcludeCount));
+    return 1;
+}
+
+static int32_t lchannelGroup_gc(lua_State* L)
+{
+    lchannelGroup_tt* pChannelGroupL = (lchannelGroup_tt*)luaL_checkudata(L, 1, "channelGroup");
+    luaL_argcheck(L, pChannelGroupL != NULL, 1, "invalid user data");
+    if (pChannelGroupL->pHandle) {
+        channelGroup_release(pChannelGroupL->pHandle);
+        pChannelGroupL->pHandle = NULL;
+    }
+    return 0;
+}
+
+int32_t luaopen_lruntime_channelGroup(struct lua_State* L)
+{
+#ifdef luaL_checkversion
+    luaL_checkversion(L);
+#endif
+
+    luaL_newmetatable(L, "channelGroup");
+    /* metatable.__index = metatable */
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -2, "__index");
+
+    struct luaL_Reg lua_channelGroupFuncs[] = {{"add", lchannelGroup_add},
+                                               {"remove", lchannelGroup_remove},
+                                               {"clear", lchannelGroup_clear},
+                                               {"count", lchannelGroup_count},
+                                               {"broadcast", lchannelGroup_broadcast},
+                                               {"__close", lchannelGroup_gc},
+                                               {"__gc", lchannelGroup_gc},
+                                               {NULL, NULL}};
+    luaL_setfuncs(L, lua_channelGroupFuncs, 0);
+    lua_pop(L, 1);
+
+    luaL_Reg lualib_channelGroup[] = {{"new", lchannelGroup_new}, {NULL, NULL}};
+    luaL_newlib(L, lualib_channelGroup);
+    return 1;
+}
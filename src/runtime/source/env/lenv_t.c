@@ -9,6 +9,8 @@
 #include "lua.h"
 #include "lualib.h"
 
+#include "latencyHistogram_t.h"
+#include "asyncLog_t.h"
 #include "log_t.h"
 #include "thread_t.h"
 #include "utility_t.h"
@@ -17,8 +19,10 @@
 #include "openssl/crypt_t.h"
 
 #include "channel/channelCenter_t.h"
+#include "clusterRouter_t.h"
 #include "serviceCenter_t.h"
 #include "serviceMonitor_t.h"
+#include "serviceTrace_t.h"
 #include "service_t.h"
 
 #include "internal/lconfig_t.h"
@@ -26,6 +30,8 @@
 #include "internal/lpackagePath_t.h"
 
 #include "internal/lservice-inl.h"
+#include "internal/lsampler_t.h"
+#include "internal/lservicePool_t.h"
 
 static eventIOThread_tt* s_pEventIOThread = NULL;
 
@@ -41,7 +47,7 @@ static void inLoop_bootstrap_start(eventAsync_tt* pEventAsync)
     if (szParam) {
         nLength = strlen(szParam);
     }
-    if (createLuaService(luaConfig_getBootstrap(), szParam, nLength) == 0) {
+    if (createLuaService(luaConfig_getBootstrap(), szParam, nLength, NULL) == 0) {
         Log(eLog_error, "bootstrap service create error");
         if (s_pEventIOThread) {
             eventIOThread_stop(s_pEventIOThread, false);
@@ -78,9 +84,36 @@ static int32_t lenv_init(lua_State* L)
 
     dnsStartup();
     serviceCenter_init(luaConfig_getServerNodeID());
+    if (luaConfig_getClusterListen() || luaConfig_getClusterNodeCount() > 0) {
+        if (!clusterRouter_init(pEventIO,
+                                luaConfig_getServerNodeID(),
+                                luaConfig_getClusterListen(),
+                                luaConfig_getClusterAllow(),
+                                luaConfig_getClusterAllowCount())) {
+            Log(eLog_error, "cluster router init error");
+        }
+        else {
+            for (int32_t i = 0; i < luaConfig_getClusterNodeCount(); ++i) {
+                int32_t     iNodeId   = 0;
+                const char* szAddress = luaConfig_getClusterNode(i, &iNodeId);
+                clusterRouter_addPeer(iNodeId, szAddress);
+            }
+        }
+    }
     serviceMonitor_init(eventIO_getNumberOfConcurrentThreads(pEventIO));
+    serviceTrace_init((uint32_t)luaConfig_getTraceCapacity());
+    serviceTrace_setSampleRate((uint32_t)(luaConfig_getTraceSample() * 1000000));
+    asyncLog_setRotate(luaConfig_getLogRotateSize() > 0 ? (size_t)luaConfig_getLogRotateSize() : 0,
+                       luaConfig_getLogRotateInterval() > 0
+                           ? (uint32_t)luaConfig_getLogRotateInterval()
+                           : 0);
     channelCenter_init();
-    luaCache_init();
+    luaCache_init(luaConfig_isShareProto());
+    lservicePool_init();
+    lsampler_init();
+    if (luaConfig_isDebugAttach() && !lserviceDebug_attach(true)) {
+        Log(eLog_error, "debugger attach error: C_debug_ip/C_debug_port not set");
+    }
     eventAsync_tt* pEventAsync = mem_malloc(sizeof(eventAsync_tt));
     eventIO_queueInLoop(pEventIO, pEventAsync, inLoop_bootstrap_start, inLoop_bootstrap_stop);
     eventIO_release(pEventIO);
@@ -112,23 +145,32 @@ static int32_t lenv_exit(lua_State* L)
     }
 
     channelCenter_clear();
+    clusterRouter_clear();
     serviceMonitor_clear();
+    serviceTrace_clear();
     serviceCenter_clear();
+    lservicePool_clear();
+    lsampler_clear();
+    lserviceDebug_attach(false);
     luaCache_clear();
     dnsCleanup();
     luaConfig_clear();
     return 0;
 }
 
+// monitorStart(serviceID, intervalMs, [slowBudgetMs])
 static int32_t lenv_monitorStart(lua_State* L)
 {
     uint32_t    serviceID      = (uint32_t)luaL_checkinteger(L, 1);
     bool        bSucc          = false;
     service_tt* pServiceHandle = serviceCenter_gain(serviceID);
     if (pServiceHandle) {
-        uint32_t uiIntervalMs = (uint32_t)luaL_checkinteger(L, 2);
-        bSucc                 = serviceMonitor_start(
-            serviceID, eventIOThread_getEventIO(s_pEventIOThread), uiIntervalMs);
+        uint32_t uiIntervalMs   = (uint32_t)luaL_checkinteger(L, 2);
+        uint32_t uiSlowBudgetMs = (uint32_t)luaL_optinteger(L, 3, 0);
+        bSucc                   = serviceMonitor_start(serviceID,
+                                     eventIOThread_getEventIO(s_pEventIOThread),
+                                     uiIntervalMs,
+                                     uiSlowBudgetMs);
         service_release(pServiceHandle);
     }
     lua_pushboolean(L, bSucc ? 1 : 0);
@@ -147,6 +189,351 @@ static int32_t lenv_monitorWaitForCount(lua_State* L)
     return 1;
 }
 
+// 遍历时持有服务表读锁, 只把计数器复制出来, 解锁后再构造lua表
+typedef struct lenvServiceRow_s
+{
+    uint32_t        uiServiceID;
+    size_t          nMemoryPeak;
+    serviceStats_tt stats;
+    char*           szName;
+} lenvServiceRow_tt;
+
+typedef struct lenvServiceRows_s
+{
+    lenvServiceRow_tt* pRows;
+    int32_t            iCount;
+    int32_t            iCapacity;
+} lenvServiceRows_tt;
+
+static void lenv_copyServiceRow(service_tt* pService, void* pUserData)
+{
+    lenvServiceRows_tt* pRows = (lenvServiceRows_tt*)pUserData;
+    if (pRows->iCount == pRows->iCapacity) {
+        pRows->iCapacity = pRows->iCapacity == 0 ? 64 : pRows->iCapacity * 2;
+        pRows->pRows = mem_realloc(pRows->pRows, sizeof(lenvServiceRow_tt) * pRows->iCapacity);
+    }
+    lenvServiceRow_tt* pRow = &pRows->pRows[pRows->iCount++];
+    pRow->uiServiceID       = service_getID(pService);
+    pRow->szName            = NULL;
+    service_getMemoryUsage(pService, &pRow->nMemoryPeak);
+    service_getStats(pService, &pRow->stats);
+}
+
+static int lenv_compareServiceRow(const void* pLeft, const void* pRight)
+{
+    uint32_t uiLeft  = ((const lenvServiceRow_tt*)pLeft)->uiServiceID;
+    uint32_t uiRight = ((const lenvServiceRow_tt*)pRight)->uiServiceID;
+    return uiLeft < uiRight ? -1 : (uiLeft > uiRight ? 1 : 0);
+}
+
+static void lenv_copyServiceName(uint32_t uiServiceID, const char* szName, void* pUserData)
+{
+    lenvServiceRows_tt* pRows = (lenvServiceRows_tt*)pUserData;
+    lenvServiceRow_tt   key;
+    key.uiServiceID         = uiServiceID;
+    lenvServiceRow_tt* pRow = bsearch(
+        &key, pRows->pRows, pRows->iCount, sizeof(lenvServiceRow_tt), lenv_compareServiceRow);
+    if (pRow && pRow->szName == NULL) {
+        pRow->szName = mem_strdup(szName);
+    }
+}
+
+static void lenv_copyServiceRows(lenvServiceRows_tt* pRows, bool bName)
+{
+    pRows->pRows     = NULL;
+    pRows->iCount    = 0;
+    pRows->iCapacity = 0;
+    serviceCenter_foreachService(lenv_copyServiceRow, pRows);
+    if (bName && pRows->iCount > 0) {
+        qsort(pRows->pRows, pRows->iCount, sizeof(lenvServiceRow_tt), lenv_compareServiceRow);
+        serviceCenter_foreachName(lenv_copyServiceName, NULL, pRows);
+    }
+}
+
+static void lenv_freeServiceRows(lenvServiceRows_tt* pRows)
+{
+    for (int32_t i = 0; i < pRows->iCount; ++i) {
+        if (pRows->pRows[i].szName) {
+            mem_free(pRows->pRows[i].szName);
+        }
+    }
+    if (pRows->pRows) {
+        mem_free(pRows->pRows);
+    }
+}
+
+// { [serviceID] = { memory = bytes, peak = bytes } }
+static int32_t lenv_serviceMemory(lua_State* L)
+{
+    lenvServiceRows_tt rows;
+    lenv_copyServiceRows(&rows, false);
+    lua_createtable(L, 0, rows.iCount);
+    for (int32_t i = 0; i < rows.iCount; ++i) {
+        lenvServiceRow_tt* pRow = &rows.pRows[i];
+        lua_createtable(L, 0, 2);
+        lua_pushinteger(L, (lua_Integer)pRow->stats.nMemory);
+        lua_setfield(L, -2, "memory");
+        lua_pushinteger(L, (lua_Integer)pRow->nMemoryPeak);
+        lua_setfield(L, -2, "peak");
+        lua_rawseti(L, -2, pRow->uiServiceID);
+    }
+    lenv_freeServiceRows(&rows);
+    return 1;
+}
+
+// 直接读取各服务的计数器, 不向服务发消息:
+// { [serviceID] = { processed, busy(ns), queue, memory, send, recv, [name] } }
+static int32_t lenv_serviceStats(lua_State* L)
+{
+    lenvServiceRows_tt rows;
+    lenv_copyServiceRows(&rows, true);
+    lua_createtable(L, 0, rows.iCount);
+    for (int32_t i = 0; i < rows.iCount; ++i) {
+        lenvServiceRow_tt* pRow = &rows.pRows[i];
+        lua_createtable(L, 0, 7);
+        lua_pushinteger(L, (lua_Integer)pRow->stats.uiProcessed);
+        lua_setfield(L, -2, "processed");
+        lua_pushinteger(L, (lua_Integer)pRow->stats.uiBusyNs);
+        lua_setfield(L, -2, "busy");
+        lua_pushinteger(L, pRow->stats.uiQueueSize);
+        lua_setfield(L, -2, "queue");
+        lua_pushinteger(L, (lua_Integer)pRow->stats.nMemory);
+        lua_setfield(L, -2, "memory");
+        lua_pushinteger(L, (lua_Integer)pRow->stats.uiSendBytes);
+        lua_setfield(L, -2, "send");
+        lua_pushinteger(L, (lua_Integer)pRow->stats.uiRecvBytes);
+        lua_setfield(L, -2, "recv");
+        if (pRow->szName) {
+            lua_pushstring(L, pRow->szName);
+            lua_setfield(L, -2, "name");
+        }
+        lua_rawseti(L, -2, pRow->uiServiceID);
+    }
+    lenv_freeServiceRows(&rows);
+    return 1;
+}
+
+// 同样只在锁内把各服务的分位数算出来, 解锁后再构造lua表
+typedef struct lenvLatencyRow_s
+{
+    uint32_t uiServiceID;
+    uint64_t uiCount;
+    uint64_t uiP50;
+    uint64_t uiP99;
+    uint64_t uiP999;
+    uint64_t uiMax;
+} lenvLatencyRow_tt;
+
+typedef struct lenvLatency_s
+{
+    latencyHistogram_tt total;
+    lenvLatencyRow_tt*  pRows;
+    int32_t             iCount;
+    int32_t             iCapacity;
+} lenvLatency_tt;
+
+static void lenv_summarizeLatency(lenvLatencyRow_tt* pRow, const latencyHistogram_tt* pHistogram)
+{
+    pRow->uiCount = latencyHistogram_count(pHistogram);
+    pRow->uiP50   = latencyHistogram_percentile(pHistogram, 50.0);
+    pRow->uiP99   = latencyHistogram_percentile(pHistogram, 99.0);
+    pRow->uiP999  = latencyHistogram_percentile(pHistogram, 99.9);
+    pRow->uiMax   = latencyHistogram_max(pHistogram);
+}
+
+static void lenv_pushLatency(lua_State* L, const lenvLatencyRow_tt* pRow)
+{
+    lua_createtable(L, 0, 5);
+    lua_pushinteger(L, (lua_Integer)pRow->uiCount);
+    lua_setfield(L, -2, "count");
+    lua_pushinteger(L, (lua_Integer)pRow->uiP50);
+    lua_setfield(L, -2, "p50");
+    lua_pushinteger(L, (lua_Integer)pRow->uiP99);
+    lua_setfield(L, -2, "p99");
+    lua_pushinteger(L, (lua_Integer)pRow->uiP999);
+    lua_setfield(L, -2, "p999");
+    lua_pushinteger(L, (lua_Integer)pRow->uiMax);
+    lua_setfield(L, -2, "max");
+}
+
+static void lenv_copyServiceLatency(service_tt* pService, void* pUserData)
+{
+    lenvLatency_tt* pLatency = (lenvLatency_tt*)pUserData;
+    if (pLatency->iCount == pLatency->iCapacity) {
+        pLatency->iCapacity = pLatency->iCapacity == 0 ? 64 : pLatency->iCapacity * 2;
+        pLatency->pRows =
+            mem_realloc(pLatency->pRows, sizeof(lenvLatencyRow_tt) * pLatency->iCapacity);
+    }
+    latencyHistogram_tt histogram;
+    latencyHistogram_init(&histogram);
+    service_mergeQueueLatency(pService, &histogram);
+    latencyHistogram_merge(&pLatency->total, &histogram);
+    lenvLatencyRow_tt* pRow = &pLatency->pRows[pLatency->iCount++];
+    pRow->uiServiceID       = service_getID(pService);
+    lenv_summarizeLatency(pRow, &histogram);
+}
+
+// 邮箱等待时间(微秒): { [serviceID] = { count, p50, p99, p999, max } }, 所有服务合并后的total
+static int32_t lenv_serviceLatency(lua_State* L)
+{
+    lenvLatency_tt* pLatency = mem_malloc(sizeof(lenvLatency_tt));
+    latencyHistogram_init(&pLatency->total);
+    pLatency->pRows     = NULL;
+    pLatency->iCount    = 0;
+    pLatency->iCapacity = 0;
+    serviceCenter_foreachService(lenv_copyServiceLatency, pLatency);
+
+    lua_createtable(L, 0, pLatency->iCount);
+    for (int32_t i = 0; i < pLatency->iCount; ++i) {
+        lenv_pushLatency(L, &pLatency->pRows[i]);
+        lua_rawseti(L, -2, pLatency->pRows[i].uiServiceID);
+    }
+    lenvLatencyRow_tt total;
+    lenv_summarizeLatency(&total, &pLatency->total);
+    lenv_pushLatency(L, &total);
+    if (pLatency->pRows) {
+        mem_free(pLatency->pRows);
+    }
+    mem_free(pLatency);
+    return 2;
+}
+
+// 事件循环线程: { { wakeups, events, tasks, busy(ns), idle(ns), stall(ms), connections }, ... },
+// 定时器: { fired, lag(ms累计), maxLag(ms, 上次调用以来) }
+static int32_t lenv_loopStats(lua_State* L)
+{
+    eventIO_tt* pEventIO = s_pEventIOThread ? eventIOThread_getEventIO(s_pEventIOThread) : NULL;
+    if (pEventIO == NULL) {
+        return 0;
+    }
+
+    int32_t iCount = (int32_t)eventIO_getNumberOfConcurrentThreads(pEventIO);
+    if (iCount == 0) {
+        iCount = 1;
+    }
+    eventIOLoopStats_tt* pStats = mem_malloc(sizeof(eventIOLoopStats_tt) * iCount);
+    iCount                      = eventIO_getLoopStats(pEventIO, pStats, iCount);
+    lua_createtable(L, iCount, 0);
+    for (int32_t i = 0; i < iCount; ++i) {
+        lua_createtable(L, 0, 7);
+        lua_pushinteger(L, (lua_Integer)pStats[i].uiWakeups);
+        lua_setfield(L, -2, "wakeups");
+        lua_pushinteger(L, (lua_Integer)pStats[i].uiEvents);
+        lua_setfield(L, -2, "events");
+        lua_pushinteger(L, (lua_Integer)pStats[i].uiTasks);
+        lua_setfield(L, -2, "tasks");
+        lua_pushinteger(L, (lua_Integer)pStats[i].uiBusyNs);
+        lua_setfield(L, -2, "busy");
+        lua_pushinteger(L, (lua_Integer)pStats[i].uiIdleNs);
+        lua_setfield(L, -2, "idle");
+        lua_pushinteger(L, (lua_Integer)pStats[i].uiStallMs);
+        lua_setfield(L, -2, "stall");
+        lua_pushinteger(L, pStats[i].iConnections);
+        lua_setfield(L, -2, "connections");
+        lua_rawseti(L, -2, i + 1);
+    }
+    mem_free(pStats);
+
+    double   fTotalLagMs = 0.0;
+    uint64_t uiMaxLagMs  = 0;
+    uint64_t uiFired     = eventIO_getTimerLag(pEventIO, &fTotalLagMs, &uiMaxLagMs);
+    lua_createtable(L, 0, 3);
+    lua_pushinteger(L, (lua_Integer)uiFired);
+    lua_setfield(L, -2, "fired");
+    lua_pushnumber(L, fTotalLagMs);
+    lua_setfield(L, -2, "lag");
+    lua_pushinteger(L, (lua_Integer)uiMaxLagMs);
+    lua_setfield(L, -2, "maxLag");
+    return 2;
+}
+
+typedef struct lenvSlowLogs_s
+{
+    serviceSlowLog_tt* pLogs;
+    int32_t            iCount;
+    int32_t            iCapacity;
+} lenvSlowLogs_tt;
+
+// 回调在监控的锁内执行, 这里只做拷贝, 压栈放到锁外
+static void lenv_copySlowLog(const serviceSlowLog_tt* pLog, void* pUserData)
+{
+    lenvSlowLogs_tt* pSlowLogs = (lenvSlowLogs_tt*)pUserData;
+    if (pSlowLogs->iCount == pSlowLogs->iCapacity) {
+        pSlowLogs->iCapacity = pSlowLogs->iCapacity ? pSlowLogs->iCapacity * 2 : 16;
+        pSlowLogs->pLogs =
+            mem_realloc(pSlowLogs->pLogs, sizeof(serviceSlowLog_tt) * pSlowLogs->iCapacity);
+    }
+    serviceSlowLog_tt* pCopy = &pSlowLogs->pLogs[pSlowLogs->iCount++];
+    *pCopy                   = *pLog;
+    if (pLog->szStack) {
+        size_t nLength = strlen(pLog->szStack);
+        char*  szStack = mem_malloc(nLength + 1);
+        memcpy(szStack, pLog->szStack, nLength + 1);
+        pCopy->szStack = szStack;
+    }
+}
+
+// 最近的慢派发记录, 由旧到新: { { time, service, source, event, elapsed(ms), stack }, ... }
+static int32_t lenv_slowLog(lua_State* L)
+{
+    lenvSlowLogs_tt slowLogs = {NULL, 0, 0};
+    serviceMonitor_foreachSlowLog(lenv_copySlowLog, &slowLogs);
+    lua_createtable(L, slowLogs.iCount, 0);
+    for (int32_t i = 0; i < slowLogs.iCount; ++i) {
+        serviceSlowLog_tt* pLog = &slowLogs.pLogs[i];
+        lua_createtable(L, 0, 6);
+        lua_pushinteger(L, (lua_Integer)pLog->uiTime);
+        lua_setfield(L, -2, "time");
+        lua_pushinteger(L, pLog->uiServiceID);
+        lua_setfield(L, -2, "service");
+        lua_pushinteger(L, pLog->uiSourceID);
+        lua_setfield(L, -2, "source");
+        lua_pushinteger(L, pLog->iEvent);
+        lua_setfield(L, -2, "event");
+        lua_pushinteger(L, pLog->uiElapsedMs);
+        lua_setfield(L, -2, "elapsed");
+        if (pLog->szStack) {
+            lua_pushstring(L, pLog->szStack);
+            lua_setfield(L, -2, "stack");
+        }
+        lua_rawseti(L, -2, i + 1);
+    }
+    for (int32_t i = 0; i < slowLogs.iCount; ++i) {
+        if (slowLogs.pLogs[i].szStack) {
+            mem_free((void*)slowLogs.pLogs[i].szStack);
+        }
+    }
+    if (slowLogs.pLogs) {
+        mem_free(slowLogs.pLogs);
+    }
+    return 1;
+}
+
+// traceSample([rate]), 设置外部消息开始追踪的比例(0~1), 返回之前的比例
+static int32_t lenv_traceSample(lua_State* L)
+{
+    lua_pushnumber(L, serviceTrace_getSampleRate() / 1000000.0);
+    if (!lua_isnoneornil(L, 1)) {
+        lua_Number fRate = luaL_checknumber(L, 1);
+        luaL_argcheck(L, fRate >= 0 && fRate <= 1, 1, "rate must be in [0, 1]");
+        serviceTrace_setSampleRate((uint32_t)(fRate * 1000000));
+    }
+    return 1;
+}
+
+// traceExport(filename), 把缓冲中的span以JSON lines追加到文件, 返回条数
+static int32_t lenv_traceExport(lua_State* L)
+{
+    const char* szFileName = luaL_checkstring(L, 1);
+    int32_t     iCount     = serviceTrace_export(szFileName);
+    if (iCount < 0) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushinteger(L, iCount);
+    return 1;
+}
+
 static int32_t lenv_luacacheOn(lua_State* L)
 {
     luaCache_on();
@@ -156,13 +543,102 @@ static int32_t lenv_luacacheOn(lua_State* L)
 static int32_t lenv_luacacheOff(lua_State* L)
 {
     luaCache_off();
+    lservicePool_flush(NULL);
     return 0;
 }
 
 static int32_t lenv_luacacheAbandon(lua_State* L)
 {
     const char* szFileName = luaL_checkstring(L, 1);
-    lua_pushboolean(L, luaCache_abandon(szFileName));
+    bool        bAbandon   = luaCache_abandon(szFileName);
+    // 预热的lua_State可能已require了被替换的模块, 全部重建
+    lservicePool_flush(NULL);
+    lua_pushboolean(L, bAbandon);
+    return 1;
+}
+
+// 宿主侧创建服务, 返回服务ID, 失败返回0
+static int32_t lenv_createService(lua_State* L)
+{
+    const char* szName  = luaL_checkstring(L, 1);
+    size_t      nLength = 0;
+    const char* pParam  = luaL_optlstring(L, 2, NULL, &nLength);
+    if (s_pEventIOThread == NULL) {
+        lua_pushinteger(L, 0);
+        return 1;
+    }
+    lua_pushinteger(L, createLuaService(szName, pParam, nLength, NULL));
+    return 1;
+}
+
+// servicePool(name, count [, {modules}])
+static int32_t lenv_servicePool(lua_State* L)
+{
+    const char* szName    = luaL_checkstring(L, 1);
+    int32_t     iCapacity = (int32_t)luaL_checkinteger(L, 2);
+    if (lua_isnoneornil(L, 3)) {
+        lua_pushboolean(L, lservicePool_prepare(szName, iCapacity, NULL));
+        return 1;
+    }
+
+    luaL_checktype(L, 3, LUA_TTABLE);
+    luaL_Buffer b;
+    luaL_buffinit(L, &b);
+    lua_Integer iCount = luaL_len(L, 3);
+    for (lua_Integer i = 1; i <= iCount; ++i) {
+        lua_rawgeti(L, 3, i);
+        if (!lua_isstring(L, -1)) {
+            return luaL_error(L, "servicePool module #%d is not a string", (int32_t)i);
+        }
+        if (i > 1) {
+            luaL_addchar(&b, ';');
+        }
+        luaL_addvalue(&b);
+    }
+    luaL_pushresult(&b);
+    lua_pushboolean(L, lservicePool_prepare(szName, iCapacity, lua_tostring(L, -1)));
+    return 1;
+}
+
+// ready, capacity, hit, miss
+static int32_t lenv_servicePoolStatus(lua_State* L)
+{
+    const char* szName    = luaL_checkstring(L, 1);
+    int32_t     iReady    = 0;
+    int32_t     iCapacity = 0;
+    uint64_t    uiHit     = 0;
+    uint64_t    uiMiss    = 0;
+    if (!lservicePool_status(szName, &iReady, &iCapacity, &uiHit, &uiMiss)) {
+        return 0;
+    }
+    lua_pushinteger(L, iReady);
+    lua_pushinteger(L, iCapacity);
+    lua_pushinteger(L, (lua_Integer)uiHit);
+    lua_pushinteger(L, (lua_Integer)uiMiss);
+    return 4;
+}
+
+// debugAttach(bool), 返回是否成功
+static int32_t lenv_debugAttach(lua_State* L)
+{
+    lua_pushboolean(L, lserviceDebug_attach(lua_toboolean(L, 1)));
+    return 1;
+}
+
+static int32_t lenv_isDebugAttached(lua_State* L)
+{
+    lua_pushboolean(L, lserviceDebug_isAttached());
+    return 1;
+}
+
+// 配置的指标接口地址, 未配置时返回nil
+static int32_t lenv_metricsListen(lua_State* L)
+{
+    const char* szAddress = luaConfig_getMetricsListen();
+    if (szAddress == NULL) {
+        return 0;
+    }
+    lua_pushstring(L, szAddress);
     return 1;
 }
 
@@ -180,9 +656,22 @@ int32_t luaopen_lruntime_env(lua_State* L)
                              {"monitorStart", lenv_monitorStart},
                              {"monitorStop", lenv_monitorStop},
                              {"monitorWaitForCount", lenv_monitorWaitForCount},
+                             {"serviceMemory", lenv_serviceMemory},
+                             {"serviceLatency", lenv_serviceLatency},
+                             {"serviceStats", lenv_serviceStats},
+                             {"loopStats", lenv_loopStats},
+                             {"slowLog", lenv_slowLog},
+                             {"traceSample", lenv_traceSample},
+                             {"traceExport", lenv_traceExport},
                              {"luacacheOn", lenv_luacacheOn},
                              {"luacacheOff", lenv_luacacheOff},
                              {"luacacheAbandon", lenv_luacacheAbandon},
+                             {"createService", lenv_createService},
+                             {"servicePool", lenv_servicePool},
+                             {"servicePoolStatus", lenv_servicePoolStatus},
+                             {"debugAttach", lenv_debugAttach},
+                             {"isDebugAttached", lenv_isDebugAttached},
+                             {"metricsListen", lenv_metricsListen},
                              {NULL, NULL}};
 
     luaL_newlib(L, lualib_env);
@@ -13,6 +13,7 @@
 #include "internal/lpackagePath_t.h"
 #include "log_t.h"
 #include "platform_t.h"
+#include "serviceCenter_t.h"
 
 static void* lua_config_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
 {
@@ -26,6 +27,12 @@ static void* lua_config_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
         return mem_realloc(ptr, nsize);
 }
 
+typedef struct luaClusterNode_s
+{
+    int32_t iNodeId;
+    char*   szAddress;
+} luaClusterNode_tt;
+
 typedef struct luaConfig_s
 {
     char*   szLoaderPath;
@@ -36,10 +43,25 @@ typedef struct luaConfig_s
     char*   szBootstrapParam;
     char*   szDebug_ip;
     char*   szDebug_port;
+    char*   szClusterListen;
+    char*   szMetricsListen;
+
+    luaClusterNode_tt* pClusterNodes;
+    int32_t            iClusterNodeCount;
+    char**             ppClusterAllow;
+    int32_t            iClusterAllowCount;
+
     int32_t iServerNodeId;
     int32_t iConcurrentThreads;
+    int32_t iTraceCapacity;
+    double  fTraceSample;
+    int64_t iLogRotateSize;
+    int32_t iLogRotateInterval;
+    bool    bLogEventJson;
     bool    bLog;
     bool    bProfile;
+    bool    bShareProto;
+    bool    bDebugAttach;
 } luaConfig_tt;
 
 static luaConfig_tt* s_pLuaConfig = NULL;
@@ -92,6 +114,92 @@ static void luaConfig_set_debug_port(const char* debug_port)
     }
 }
 
+static void luaConfig_setClusterListen(const char* szAddress)
+{
+    if (s_pLuaConfig != NULL) {
+        if (s_pLuaConfig->szClusterListen != NULL) {
+            mem_free(s_pLuaConfig->szClusterListen);
+            s_pLuaConfig->szClusterListen = NULL;
+        }
+
+        if (szAddress) {
+            s_pLuaConfig->szClusterListen = mem_strdup(szAddress);
+        }
+    }
+}
+
+// C_metrics_listen = "ip:port", 为空时启动服务不开放指标接口
+static void luaConfig_setMetricsListen(const char* szAddress)
+{
+    if (s_pLuaConfig != NULL) {
+        if (s_pLuaConfig->szMetricsListen != NULL) {
+            mem_free(s_pLuaConfig->szMetricsListen);
+            s_pLuaConfig->szMetricsListen = NULL;
+        }
+
+        if (szAddress) {
+            s_pLuaConfig->szMetricsListen = mem_strdup(szAddress);
+        }
+    }
+}
+
+// C_cluster_nodes = { [nodeId] = "ip:port", ... }
+static void luaConfig_setClusterNodes(lua_State* L, int32_t iIndex)
+{
+    if (s_pLuaConfig == NULL || lua_type(L, iIndex) != LUA_TTABLE) {
+        return;
+    }
+
+    int32_t iCount = 0;
+    lua_pushnil(L);
+    while (lua_next(L, iIndex) != 0) {
+        if (lua_isinteger(L, -2) && lua_type(L, -1) == LUA_TSTRING) {
+            ++iCount;
+        }
+        lua_pop(L, 1);
+    }
+
+    if (iCount == 0) {
+        return;
+    }
+
+    s_pLuaConfig->pClusterNodes     = mem_malloc(sizeof(luaClusterNode_tt) * iCount);
+    s_pLuaConfig->iClusterNodeCount = 0;
+    lua_pushnil(L);
+    while (lua_next(L, iIndex) != 0) {
+        if (lua_isinteger(L, -2) && lua_type(L, -1) == LUA_TSTRING) {
+            luaClusterNode_tt* pNode =
+                &s_pLuaConfig->pClusterNodes[s_pLuaConfig->iClusterNodeCount++];
+            pNode->iNodeId   = (int32_t)lua_tointeger(L, -2);
+            pNode->szAddress = mem_strdup(lua_tostring(L, -1));
+        }
+        lua_pop(L, 1);
+    }
+}
+
+// C_cluster_allow = { "ip", ... }, 为空时不限制接入的节点地址
+static void luaConfig_setClusterAllow(lua_State* L, int32_t iIndex)
+{
+    if (s_pLuaConfig == NULL || lua_type(L, iIndex) != LUA_TTABLE) {
+        return;
+    }
+
+    int32_t iCount = (int32_t)lua_rawlen(L, iIndex);
+    if (iCount == 0) {
+        return;
+    }
+
+    s_pLuaConfig->ppClusterAllow     = mem_malloc(sizeof(char*) * iCount);
+    s_pLuaConfig->iClusterAllowCount = 0;
+    for (int32_t i = 1; i <= iCount; ++i) {
+        if (lua_rawgeti(L, iIndex, i) == LUA_TSTRING) {
+            s_pLuaConfig->ppClusterAllow[s_pLuaConfig->iClusterAllowCount++] =
+                mem_strdup(lua_tostring(L, -1));
+        }
+        lua_pop(L, 1);
+    }
+}
+
 static void luaConfig_setServicePath(const char* szPath)
 {
     if (s_pLuaConfig != NULL) {
@@ -181,10 +289,23 @@ bool luaConfig_init(lua_State* L)
     s_pLuaConfig->szLogService       = NULL;
     s_pLuaConfig->szDebug_ip         = NULL;
     s_pLuaConfig->szDebug_port       = NULL;
+    s_pLuaConfig->szClusterListen    = NULL;
+    s_pLuaConfig->szMetricsListen    = NULL;
+    s_pLuaConfig->pClusterNodes      = NULL;
+    s_pLuaConfig->iClusterNodeCount  = 0;
+    s_pLuaConfig->ppClusterAllow     = NULL;
+    s_pLuaConfig->iClusterAllowCount = 0;
     s_pLuaConfig->iServerNodeId      = 0;
     s_pLuaConfig->iConcurrentThreads = 0;
+    s_pLuaConfig->iTraceCapacity     = 0;
+    s_pLuaConfig->fTraceSample       = 0.0;
+    s_pLuaConfig->iLogRotateSize     = 0;
+    s_pLuaConfig->iLogRotateInterval = 0;
+    s_pLuaConfig->bLogEventJson      = false;
     s_pLuaConfig->bProfile           = false;
     s_pLuaConfig->bLog               = false;
+    s_pLuaConfig->bShareProto        = false;
+    s_pLuaConfig->bDebugAttach       = false;
 
     lua_getglobal(pLuaState, "C_loader_path");
     const char* szLoaderPath = lua_tostring(pLuaState, -1);
@@ -228,13 +349,54 @@ bool luaConfig_init(lua_State* L)
 
     lua_getglobal(pLuaState, "C_node_id");
     s_pLuaConfig->iServerNodeId = (int32_t)lua_tointeger(pLuaState, -1);
-    s_pLuaConfig->iServerNodeId &= 0x7ff;
+    if (s_pLuaConfig->iServerNodeId < 0 || s_pLuaConfig->iServerNodeId >= DEF_SERVICE_NODE_COUNT) {
+        Log(eLog_error, "C_node_id:%d out of range [0,%d)", s_pLuaConfig->iServerNodeId,
+            DEF_SERVICE_NODE_COUNT);
+    }
+    s_pLuaConfig->iServerNodeId &= DEF_SERVICE_NODE_COUNT - 1;
+    lua_pop(pLuaState, 1);
+
+    lua_getglobal(pLuaState, "C_cluster_listen");
+    const char* szClusterListen = lua_tostring(pLuaState, -1);
+    luaConfig_setClusterListen(szClusterListen);
+    lua_pop(pLuaState, 1);
+
+    lua_getglobal(pLuaState, "C_metrics_listen");
+    luaConfig_setMetricsListen(lua_tostring(pLuaState, -1));
+    lua_pop(pLuaState, 1);
+
+    lua_getglobal(pLuaState, "C_cluster_nodes");
+    luaConfig_setClusterNodes(pLuaState, lua_gettop(pLuaState));
+    lua_pop(pLuaState, 1);
+
+    lua_getglobal(pLuaState, "C_cluster_allow");
+    luaConfig_setClusterAllow(pLuaState, lua_gettop(pLuaState));
     lua_pop(pLuaState, 1);
 
     lua_getglobal(pLuaState, "C_concurrent_threads");
     s_pLuaConfig->iConcurrentThreads = (int32_t)lua_tointeger(pLuaState, -1);
     lua_pop(pLuaState, 1);
 
+    lua_getglobal(pLuaState, "C_trace_sample");
+    s_pLuaConfig->fTraceSample = lua_tonumber(pLuaState, -1);
+    lua_pop(pLuaState, 1);
+
+    lua_getglobal(pLuaState, "C_trace_capacity");
+    s_pLuaConfig->iTraceCapacity = (int32_t)lua_tointeger(pLuaState, -1);
+    lua_pop(pLuaState, 1);
+
+    lua_getglobal(pLuaState, "C_log_rotate_size");
+    s_pLuaConfig->iLogRotateSize = (int64_t)lua_tointeger(pLuaState, -1);
+    lua_pop(pLuaState, 1);
+
+    lua_getglobal(pLuaState, "C_log_rotate_interval");
+    s_pLuaConfig->iLogRotateInterval = (int32_t)lua_tointeger(pLuaState, -1);
+    lua_pop(pLuaState, 1);
+
+    lua_getglobal(pLuaState, "C_log_event_json");
+    s_pLuaConfig->bLogEventJson = lua_toboolean(pLuaState, -1) ? true : false;
+    lua_pop(pLuaState, 1);
+
     lua_getglobal(pLuaState, "C_log");
     s_pLuaConfig->bLog = lua_toboolean(pLuaState, 1) ? true : false;
     lua_pop(pLuaState, 1);
@@ -243,6 +405,14 @@ bool luaConfig_init(lua_State* L)
     s_pLuaConfig->bProfile = lua_toboolean(pLuaState, 1) ? true : false;
     lua_pop(pLuaState, 1);
 
+    lua_getglobal(pLuaState, "C_luacache_share");
+    s_pLuaConfig->bShareProto = lua_toboolean(pLuaState, -1) ? true : false;
+    lua_pop(pLuaState, 1);
+
+    lua_getglobal(pLuaState, "C_debug_attach");
+    s_pLuaConfig->bDebugAttach = lua_toboolean(pLuaState, -1) ? true : false;
+    lua_pop(pLuaState, 1);
+
     lua_close(pLuaState);
     return true;
 }
@@ -290,6 +460,34 @@ void luaConfig_clear()
             s_pLuaConfig->szLogService = NULL;
         }
 
+        if (s_pLuaConfig->szClusterListen) {
+            mem_free(s_pLuaConfig->szClusterListen);
+            s_pLuaConfig->szClusterListen = NULL;
+        }
+
+        if (s_pLuaConfig->szMetricsListen) {
+            mem_free(s_pLuaConfig->szMetricsListen);
+            s_pLuaConfig->szMetricsListen = NULL;
+        }
+
+        if (s_pLuaConfig->pClusterNodes) {
+            for (int32_t i = 0; i < s_pLuaConfig->iClusterNodeCount; ++i) {
+                mem_free(s_pLuaConfig->pClusterNodes[i].szAddress);
+            }
+            mem_free(s_pLuaConfig->pClusterNodes);
+            s_pLuaConfig->pClusterNodes     = NULL;
+            s_pLuaConfig->iClusterNodeCount = 0;
+        }
+
+        if (s_pLuaConfig->ppClusterAllow) {
+            for (int32_t i = 0; i < s_pLuaConfig->iClusterAllowCount; ++i) {
+                mem_free(s_pLuaConfig->ppClusterAllow[i]);
+            }
+            mem_free(s_pLuaConfig->ppClusterAllow);
+            s_pLuaConfig->ppClusterAllow     = NULL;
+            s_pLuaConfig->iClusterAllowCount = 0;
+        }
+
         mem_free(s_pLuaConfig);
         s_pLuaConfig = NULL;
     }
@@ -370,12 +568,82 @@ int32_t luaConfig_getServerNodeID()
     return s_pLuaConfig->iServerNodeId;
 }
 
+const char* luaConfig_getClusterListen()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->szClusterListen;
+}
+
+const char* luaConfig_getMetricsListen()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->szMetricsListen;
+}
+
+int32_t luaConfig_getClusterNodeCount()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->iClusterNodeCount;
+}
+
+const char* luaConfig_getClusterNode(int32_t iIndex, int32_t* pNodeId)
+{
+    assert(s_pLuaConfig);
+    if (iIndex < 0 || iIndex >= s_pLuaConfig->iClusterNodeCount) {
+        return NULL;
+    }
+    *pNodeId = s_pLuaConfig->pClusterNodes[iIndex].iNodeId;
+    return s_pLuaConfig->pClusterNodes[iIndex].szAddress;
+}
+
+int32_t luaConfig_getClusterAllowCount()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->iClusterAllowCount;
+}
+
+const char* const* luaConfig_getClusterAllow()
+{
+    assert(s_pLuaConfig);
+    return (const char* const*)s_pLuaConfig->ppClusterAllow;
+}
+
 int32_t luaConfig_getConcurrentThreads()
 {
     assert(s_pLuaConfig);
     return s_pLuaConfig->iConcurrentThreads;
 }
 
+double luaConfig_getTraceSample()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->fTraceSample;
+}
+
+int32_t luaConfig_getTraceCapacity()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->iTraceCapacity;
+}
+
+int64_t luaConfig_getLogRotateSize()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->iLogRotateSize;
+}
+
+int32_t luaConfig_getLogRotateInterval()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->iLogRotateInterval;
+}
+
+bool luaConfig_isLogEventJson()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->bLogEventJson;
+}
+
 bool luaConfig_isProfile()
 {
     assert(s_pLuaConfig);
@@ -386,4 +654,16 @@ bool luaConfig_isLog()
 {
     assert(s_pLuaConfig);
     return s_pLuaConfig->bLog;
+}
+
+bool luaConfig_isShareProto()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->bShareProto;
+}
+
+bool luaConfig_isDebugAttach()
+{
+    assert(s_pLuaConfig);
+    return s_pLuaConfig->bDebugAttach;
 }
\ No newline at end of file
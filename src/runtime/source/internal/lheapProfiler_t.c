@@ -0,0 +1,412 @@
+
+
+#include "internal/lheapProfiler_t.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lauxlib.h"
+
+#define def_heapMaxSite 128
+#define def_heapMaxPending 64
+#define def_heapInitBlock 256
+#define def_heapInitSite 64
+#define def_heapSitePending 0xFFFFFFFF
+#define def_heapSiteUnknown 0
+
+typedef struct lheapSite_s
+{
+    uint64_t uiHash;
+    char*    szSite;
+    size_t   nLength;
+    int64_t  iLiveBytes;
+    int64_t  iLiveSamples;
+    uint64_t uiAllocBytes;
+    int64_t  iBaseBytes;
+} lheapSite_tt;
+
+// 只记录被采样的块
+typedef struct lheapBlock_s
+{
+    void*    pBlock;
+    uint32_t uiSite;
+    size_t   nWeight;
+} lheapBlock_tt;
+
+struct lheapProfiler_s
+{
+    int64_t        iSampleBytes;
+    int64_t        iCountdown;
+    lheapBlock_tt* pBlocks;
+    uint32_t       uiBlockCapacity;
+    uint32_t       uiBlockUsed;
+    lheapSite_tt*  pSites;
+    uint32_t       uiSiteCount;
+    uint32_t       uiSiteCapacity;
+    uint32_t*      pSiteSlots; // 调用点哈希, 存下标加一
+    uint32_t       uiSlotCapacity;
+    void*          pendings[def_heapMaxPending];
+    int32_t        iPendingCount;
+};
+
+static inline uint32_t lheapProfiler_hashBlock(const void* pBlock, uint32_t uiMask)
+{
+    uint64_t uiHash = (uint64_t)(uintptr_t)pBlock >> 4;
+    return (uint32_t)((uiHash * 0x9E3779B97F4A7C15ULL) >> 32) & uiMask;
+}
+
+static inline uint64_t lheapProfiler_hashSite(const char* szSite, size_t nLength)
+{
+    uint64_t uiHash = 14695981039346656037ULL;
+    for (size_t i = 0; i < nLength; ++i) {
+        uiHash ^= (uint8_t)szSite[i];
+        uiHash *= 1099511628211ULL;
+    }
+    return uiHash;
+}
+
+static lheapBlock_tt* lheapProfiler_findBlock(lheapProfiler_tt* pProfiler, const void* pBlock)
+{
+    uint32_t uiMask  = pProfiler->uiBlockCapacity - 1;
+    uint32_t uiIndex = lheapProfiler_hashBlock(pBlock, uiMask);
+    for (;;) {
+        lheapBlock_tt* pSlot = &pProfiler->pBlocks[uiIndex];
+        if (pSlot->pBlock == pBlock) {
+            return pSlot;
+        }
+        if (pSlot->pBlock == NULL) {
+            return NULL;
+        }
+        uiIndex = (uiIndex + 1) & uiMask;
+    }
+}
+
+static void lheapProfiler_insertBlock(lheapBlock_tt* pBlocks, uint32_t uiCapacity,
+                                      const lheapBlock_tt* pBlock)
+{
+    uint32_t uiMask  = uiCapacity - 1;
+    uint32_t uiIndex = lheapProfiler_hashBlock(pBlock->pBlock, uiMask);
+    while (pBlocks[uiIndex].pBlock != NULL) {
+        uiIndex = (uiIndex + 1) & uiMask;
+    }
+    pBlocks[uiIndex] = *pBlock;
+}
+
+// 线性探测的后移删除, 不留墓碑
+static void lheapProfiler_eraseBlock(lheapProfiler_tt* pProfiler, lheapBlock_tt* pSlot)
+{
+    uint32_t uiMask  = pProfiler->uiBlockCapacity - 1;
+    uint32_t uiHole  = (uint32_t)(pSlot - pProfiler->pBlocks);
+    uint32_t uiIndex = uiHole;
+    for (;;) {
+        uiIndex             = (uiIndex + 1) & uiMask;
+        lheapBlock_tt* pCur = &pProfiler->pBlocks[uiIndex];
+        if (pCur->pBlock == NULL) {
+            break;
+        }
+        uint32_t uiHome = lheapProfiler_hashBlock(pCur->pBlock, uiMask);
+        if (((uiIndex - uiHome) & uiMask) >= ((uiIndex - uiHole) & uiMask)) {
+            pProfiler->pBlocks[uiHole] = *pCur;
+            uiHole                     = uiIndex;
+        }
+    }
+    pProfiler->pBlocks[uiHole].pBlock = NULL;
+    --pProfiler->uiBlockUsed;
+}
+
+static void lheapProfiler_addBlock(lheapProfiler_tt* pProfiler, const lheapBlock_tt* pBlock)
+{
+    if ((pProfiler->uiBlockUsed + 1) * 4 >= pProfiler->uiBlockCapacity * 3) {
+        uint32_t       uiCapacity = pProfiler->uiBlockCapacity * 2;
+        lheapBlock_tt* pBlocks    = mem_malloc(sizeof(lheapBlock_tt) * uiCapacity);
+        memset(pBlocks, 0, sizeof(lheapBlock_tt) * uiCapacity);
+        for (uint32_t i = 0; i < pProfiler->uiBlockCapacity; ++i) {
+            if (pProfiler->pBlocks[i].pBlock) {
+                lheapProfiler_insertBlock(pBlocks, uiCapacity, &pProfiler->pBlocks[i]);
+            }
+        }
+        mem_free(pProfiler->pBlocks);
+        pProfiler->pBlocks         = pBlocks;
+        pProfiler->uiBlockCapacity = uiCapacity;
+    }
+    lheapProfiler_insertBlock(pProfiler->pBlocks, pProfiler->uiBlockCapacity, pBlock);
+    ++pProfiler->uiBlockUsed;
+}
+
+static void lheapProfiler_growSlots(lheapProfiler_tt* pProfiler)
+{
+    uint32_t  uiCapacity = pProfiler->uiSlotCapacity * 2;
+    uint32_t* pSlots     = mem_malloc(sizeof(uint32_t) * uiCapacity);
+    memset(pSlots, 0, sizeof(uint32_t) * uiCapacity);
+    for (uint32_t i = 0; i < pProfiler->uiSiteCount; ++i) {
+        uint32_t uiIndex = (uint32_t)pProfiler->pSites[i].uiHash & (uiCapacity - 1);
+        while (pSlots[uiIndex] != 0) {
+            uiIndex = (uiIndex + 1) & (uiCapacity - 1);
+        }
+        pSlots[uiIndex] = i + 1;
+    }
+    mem_free(pProfiler->pSiteSlots);
+    pProfiler->pSiteSlots     = pSlots;
+    pProfiler->uiSlotCapacity = uiCapacity;
+}
+
+static uint32_t lheapProfiler_site(lheapProfiler_tt* pProfiler, const char* szSite, size_t nLength)
+{
+    uint64_t uiHash  = lheapProfiler_hashSite(szSite, nLength);
+    uint32_t uiMask  = pProfiler->uiSlotCapacity - 1;
+    uint32_t uiIndex = (uint32_t)uiHash & uiMask;
+    while (pProfiler->pSiteSlots[uiIndex] != 0) {
+        lheapSite_tt* pSite = &pProfiler->pSites[pProfiler->pSiteSlots[uiIndex] - 1];
+        if (pSite->uiHash == uiHash && pSite->nLength == nLength &&
+            memcmp(pSite->szSite, szSite, nLength) == 0) {
+            return pProfiler->pSiteSlots[uiIndex] - 1;
+        }
+        uiIndex = (uiIndex + 1) & uiMask;
+    }
+
+    if (pProfiler->uiSiteCount == pProfiler->uiSiteCapacity) {
+        pProfiler->uiSiteCapacity *= 2;
+        pProfiler->pSites =
+            mem_realloc(pProfiler->pSites, sizeof(lheapSite_tt) * pProfiler->uiSiteCapacity);
+    }
+    uint32_t      uiSite = pProfiler->uiSiteCount++;
+    lheapSite_tt* pSite  = &pProfiler->pSites[uiSite];
+    memset(pSite, 0, sizeof(lheapSite_tt));
+    pSite->uiHash  = uiHash;
+    pSite->nLength = nLength;
+    pSite->szSite  = mem_malloc(nLength + 1);
+    memcpy(pSite->szSite, szSite, nLength);
+    pSite->szSite[nLength]          = '\0';
+    pProfiler->pSiteSlots[uiIndex] = uiSite + 1;
+    if (pProfiler->uiSiteCount * 4 >= pProfiler->uiSlotCapacity * 3) {
+        lheapProfiler_growSlots(pProfiler);
+    }
+    return uiSite;
+}
+
+static inline void lheapProfiler_account(lheapProfiler_tt* pProfiler, uint32_t uiSite,
+                                         int64_t iWeight, int64_t iSamples)
+{
+    if (uiSite != def_heapSitePending) {
+        lheapSite_tt* pSite = &pProfiler->pSites[uiSite];
+        pSite->iLiveBytes += iWeight;
+        pSite->iLiveSamples += iSamples;
+        if (iWeight > 0) {
+            pSite->uiAllocBytes += (uint64_t)iWeight;
+        }
+    }
+}
+
+static void lheapProfiler_replacePending(lheapProfiler_tt* pProfiler, void* pOld, void* pNew)
+{
+    for (int32_t i = 0; i < pProfiler->iPendingCount; ++i) {
+        if (pProfiler->pendings[i] == pOld) {
+            if (pNew) {
+                pProfiler->pendings[i] = pNew;
+            }
+            else {
+                pProfiler->pendings[i] = pProfiler->pendings[--pProfiler->iPendingCount];
+            }
+            return;
+        }
+    }
+}
+
+lheapProfiler_tt* createHeapProfiler(size_t nSampleBytes)
+{
+    if (nSampleBytes < DEF_HEAP_PROFILER_MIN_SAMPLE) {
+        nSampleBytes = DEF_HEAP_PROFILER_MIN_SAMPLE;
+    }
+    lheapProfiler_tt* pProfiler = mem_malloc(sizeof(lheapProfiler_tt));
+    pProfiler->iSampleBytes     = (int64_t)nSampleBytes;
+    // 起始位置错开, 避免所有服务在相同的分配序号上采样
+    pProfiler->iCountdown      = (int64_t)(rand() % nSampleBytes) + 1;
+    pProfiler->uiBlockCapacity = def_heapInitBlock;
+    pProfiler->uiBlockUsed     = 0;
+    pProfiler->pBlocks         = mem_malloc(sizeof(lheapBlock_tt) * def_heapInitBlock);
+    memset(pProfiler->pBlocks, 0, sizeof(lheapBlock_tt) * def_heapInitBlock);
+    pProfiler->uiSiteCount    = 0;
+    pProfiler->uiSiteCapacity = def_heapInitSite;
+    pProfiler->pSites         = mem_malloc(sizeof(lheapSite_tt) * def_heapInitSite);
+    pProfiler->uiSlotCapacity = def_heapInitSite * 2;
+    pProfiler->pSiteSlots     = mem_malloc(sizeof(uint32_t) * pProfiler->uiSlotCapacity);
+    memset(pProfiler->pSiteSlots, 0, sizeof(uint32_t) * pProfiler->uiSlotCapacity);
+    pProfiler->iPendingCount = 0;
+    // 下标0: 来不及定位调用点的采样
+    lheapProfiler_site(pProfiler, "?", 1);
+    return pProfiler;
+}
+
+void lheapProfiler_release(lheapProfiler_tt* pProfiler)
+{
+    for (uint32_t i = 0; i < pProfiler->uiSiteCount; ++i) {
+        mem_free(pProfiler->pSites[i].szSite);
+    }
+    mem_free(pProfiler->pSites);
+    mem_free(pProfiler->pSiteSlots);
+    mem_free(pProfiler->pBlocks);
+    mem_free(pProfiler);
+}
+
+bool lheapProfiler_update(lheapProfiler_tt* pProfiler, void* pOld, void* pNew, size_t nOldSize,
+                          size_t nNewSize)
+{
+    lheapBlock_tt block = {.pBlock = NULL, .uiSite = def_heapSitePending, .nWeight = 0};
+    bool          bSampled = false;
+    if (pOld && pProfiler->uiBlockUsed > 0) {
+        lheapBlock_tt* pSlot = lheapProfiler_findBlock(pProfiler, pOld);
+        if (pSlot) {
+            block    = *pSlot;
+            bSampled = true;
+            lheapProfiler_eraseBlock(pProfiler, pSlot);
+        }
+    }
+
+    if (pNew == NULL) {
+        if (bSampled) {
+            if (block.uiSite == def_heapSitePending) {
+                lheapProfiler_replacePending(pProfiler, pOld, NULL);
+            }
+            lheapProfiler_account(pProfiler, block.uiSite, -(int64_t)block.nWeight, -1);
+        }
+        return false;
+    }
+
+    int64_t iIntervals = 0;
+    if (nNewSize > nOldSize) {
+        pProfiler->iCountdown -= (int64_t)(nNewSize - nOldSize);
+        if (pProfiler->iCountdown <= 0) {
+            iIntervals = 1 + (-pProfiler->iCountdown) / pProfiler->iSampleBytes;
+            pProfiler->iCountdown += iIntervals * pProfiler->iSampleBytes;
+        }
+    }
+
+    if (iIntervals == 0) {
+        // 未触发采样时, 被采样过的块跟随realloc换地址, 归属不变
+        if (bSampled) {
+            block.pBlock = pNew;
+            lheapProfiler_addBlock(pProfiler, &block);
+            if (block.uiSite == def_heapSitePending && pOld != pNew) {
+                lheapProfiler_replacePending(pProfiler, pOld, pNew);
+            }
+        }
+        return false;
+    }
+
+    if (bSampled) {
+        if (block.uiSite == def_heapSitePending) {
+            lheapProfiler_replacePending(pProfiler, pOld, NULL);
+        }
+        lheapProfiler_account(pProfiler, block.uiSite, -(int64_t)block.nWeight, -1);
+    }
+    else {
+        block.nWeight = 0;
+    }
+    block.pBlock = pNew;
+    block.nWeight += (size_t)(iIntervals * pProfiler->iSampleBytes);
+    if (pProfiler->iPendingCount < def_heapMaxPending) {
+        block.uiSite                                        = def_heapSitePending;
+        pProfiler->pendings[pProfiler->iPendingCount++] = pNew;
+    }
+    else {
+        block.uiSite = def_heapSiteUnknown;
+        lheapProfiler_account(pProfiler, block.uiSite, (int64_t)block.nWeight, 1);
+    }
+    lheapProfiler_addBlock(pProfiler, &block);
+    return block.uiSite == def_heapSitePending;
+}
+
+bool lheapProfiler_hasPending(lheapProfiler_tt* pProfiler)
+{
+    return pProfiler->iPendingCount > 0;
+}
+
+void lheapProfiler_resolve(lheapProfiler_tt* pProfiler, lua_State* L)
+{
+    if (pProfiler->iPendingCount == 0) {
+        return;
+    }
+
+    // 取第一个有行号的Lua帧
+    char      szSite[def_heapMaxSite];
+    int32_t   iLength = 0;
+    lua_Debug debug;
+    for (int32_t iLevel = 0; lua_getstack(L, iLevel, &debug); ++iLevel) {
+        lua_getinfo(L, "Sl", &debug);
+        if (debug.currentline > 0) {
+            iLength = snprintf(
+                szSite, def_heapMaxSite, "%s:%d", debug.short_src, debug.currentline);
+            break;
+        }
+    }
+    if (iLength <= 0) {
+        iLength = snprintf(szSite, def_heapMaxSite, "[C]");
+    }
+    else if (iLength >= def_heapMaxSite) {
+        iLength = def_heapMaxSite - 1;
+    }
+
+    uint32_t uiSite = lheapProfiler_site(pProfiler, szSite, (size_t)iLength);
+    for (int32_t i = 0; i < pProfiler->iPendingCount; ++i) {
+        lheapBlock_tt* pSlot = lheapProfiler_findBlock(pProfiler, pProfiler->pendings[i]);
+        if (pSlot && pSlot->uiSite == def_heapSitePending) {
+            pSlot->uiSite = uiSite;
+            lheapProfiler_account(pProfiler, uiSite, (int64_t)pSlot->nWeight, 1);
+        }
+    }
+    pProfiler->iPendingCount = 0;
+}
+
+void lheapProfiler_snapshot(lheapProfiler_tt* pProfiler)
+{
+    for (uint32_t i = 0; i < pProfiler->uiSiteCount; ++i) {
+        pProfiler->pSites[i].iBaseBytes = pProfiler->pSites[i].iLiveBytes;
+    }
+}
+
+static int lheapProfiler_compare(const void* pLeft, const void* pRight)
+{
+    int64_t iLeft  = ((const lheapSite_tt*)pLeft)->iBaseBytes;
+    int64_t iRight = ((const lheapSite_tt*)pRight)->iBaseBytes;
+    return iLeft < iRight ? 1 : (iLeft > iRight ? -1 : 0);
+}
+
+void lheapProfiler_push(lheapProfiler_tt* pProfiler, lua_State* L, bool bDiff, int32_t iCount)
+{
+    // 压栈时的分配同样会进入分析器, 先拷出再排序; iBaseBytes在副本中复用为排序键
+    uint32_t      uiSiteCount = pProfiler->uiSiteCount;
+    lheapSite_tt* pSites      = mem_malloc(sizeof(lheapSite_tt) * uiSiteCount);
+    memcpy(pSites, pProfiler->pSites, sizeof(lheapSite_tt) * uiSiteCount);
+    int64_t iTotal = 0;
+    for (uint32_t i = 0; i < uiSiteCount; ++i) {
+        iTotal += pSites[i].iLiveBytes;
+        pSites[i].iBaseBytes = bDiff ? pSites[i].iLiveBytes - pSites[i].iBaseBytes
+                                     : pSites[i].iLiveBytes;
+    }
+    qsort(pSites, uiSiteCount, sizeof(lheapSite_tt), lheapProfiler_compare);
+
+    if (iCount <= 0 || (uint32_t)iCount > uiSiteCount) {
+        iCount = (int32_t)uiSiteCount;
+    }
+    lua_createtable(L, iCount, 0);
+    int32_t iIndex = 0;
+    for (int32_t i = 0; i < iCount; ++i) {
+        lheapSite_tt* pSite = &pSites[i];
+        if (pSite->iBaseBytes == 0) {
+            continue;
+        }
+        lua_createtable(L, 0, 4);
+        lua_pushlstring(L, pSite->szSite, pSite->nLength);
+        lua_setfield(L, -2, "site");
+        lua_pushinteger(L, (lua_Integer)pSite->iBaseBytes);
+        lua_setfield(L, -2, "live");
+        lua_pushinteger(L, (lua_Integer)pSite->iLiveSamples);
+        lua_setfield(L, -2, "samples");
+        lua_pushinteger(L, (lua_Integer)pSite->uiAllocBytes);
+        lua_setfield(L, -2, "alloc");
+        lua_rawseti(L, -2, ++iIndex);
+    }
+    mem_free(pSites);
+    lua_pushinteger(L, (lua_Integer)iTotal);
+}
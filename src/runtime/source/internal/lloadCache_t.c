@@ -16,13 +16,31 @@
 #include "thread_t.h"
 #include "utility_t.h"
 
+// 共享的Proto归pProtoState所有, 关闭它会释放所有已clone出去的函数引用的Proto;
+// 缓存节点和每个clone过的lua_State各持有一个引用, 最后一个引用释放时才关闭
+typedef struct luaProtoOwner_s
+{
+    lua_State* pProtoState;
+    atomic_int iRefCount;
+} luaProtoOwner_tt;
+
+// 记录一个lua_State引用过的所有Proto持有者, 以轻量用户数据存放在它的注册表中
+typedef struct luaProtoRefs_s
+{
+    luaProtoOwner_tt** ppOwners;
+    int32_t            iCount;
+    int32_t            iCapacity;
+} luaProtoRefs_tt;
+
 typedef struct luaload_cache_s
 {
     RB_ENTRY(luaload_cache_s)
     entry;
-    char*  szName;
-    char*  pCodeCache;
-    size_t nCodeLength;
+    char*             szName;
+    char*             pCodeCache;
+    size_t            nCodeLength;
+    luaProtoOwner_tt* pOwner;
+    const void*       pProto;
 } luaload_cache_tt;
 
 static int32_t lualoadCacheNodeCmp(struct luaload_cache_s* pNode1, struct luaload_cache_s* pNode2)
@@ -40,14 +58,88 @@ typedef struct lualoadCache_s
 {
     rwlock_tt             rwlock;
     atomic_bool           bActive;
+    bool                  bShareProto;
     luaload_cache_tree_tt cacheTree;
 } lualoadCache_tt;
 
 static lualoadCache_tt s_lualoadCache;
 
-void luaCache_init()
+static const char s_protoRefsKey = 0;
+
+static void* lua_cache_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    (void)ud;
+    (void)osize;
+    if (nsize == 0) {
+        mem_free(ptr);
+        return NULL;
+    }
+    else
+        return mem_realloc(ptr, nsize);
+}
+
+static void luaProtoOwner_release(luaProtoOwner_tt* pOwner)
+{
+    if (atomic_fetch_sub(&(pOwner->iRefCount), 1) == 1) {
+        lua_close(pOwner->pProtoState);
+        mem_free(pOwner);
+    }
+}
+
+// 先在注册表里占好位置再分配, 占位时内存不足抛出的错误不会泄漏
+static luaProtoRefs_tt* luaCache_getRefs(lua_State* L)
+{
+    luaProtoRefs_tt* pRefs = NULL;
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, &s_protoRefsKey) == LUA_TLIGHTUSERDATA) {
+        pRefs = (luaProtoRefs_tt*)lua_touserdata(L, -1);
+    }
+    lua_pop(L, 1);
+    if (pRefs == NULL) {
+        lua_pushboolean(L, 0);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &s_protoRefsKey);
+        pRefs            = mem_malloc(sizeof(luaProtoRefs_tt));
+        pRefs->ppOwners  = NULL;
+        pRefs->iCount    = 0;
+        pRefs->iCapacity = 0;
+        lua_pushlightuserdata(L, pRefs);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &s_protoRefsKey);
+    }
+    return pRefs;
+}
+
+// 同一个lua_State对同一个持有者只记一次引用
+static void luaCache_addRef(luaProtoRefs_tt* pRefs, luaProtoOwner_tt* pOwner)
+{
+    for (int32_t i = 0; i < pRefs->iCount; ++i) {
+        if (pRefs->ppOwners[i] == pOwner) {
+            return;
+        }
+    }
+    if (pRefs->iCount == pRefs->iCapacity) {
+        pRefs->iCapacity = pRefs->iCapacity == 0 ? 16 : pRefs->iCapacity * 2;
+        pRefs->ppOwners =
+            mem_realloc(pRefs->ppOwners, sizeof(luaProtoOwner_tt*) * pRefs->iCapacity);
+    }
+    atomic_fetch_add(&(pOwner->iRefCount), 1);
+    pRefs->ppOwners[pRefs->iCount++] = pOwner;
+}
+
+static void luaCache_freeNode(luaload_cache_tt* pCache)
+{
+    if (pCache->pOwner) {
+        luaProtoOwner_release(pCache->pOwner);
+    }
+    mem_free(pCache->szName);
+    if (pCache->pCodeCache) {
+        mem_free(pCache->pCodeCache);
+    }
+    mem_free(pCache);
+}
+
+void luaCache_init(bool bShareProto)
 {
     atomic_init(&s_lualoadCache.bActive, true);
+    s_lualoadCache.bShareProto = bShareProto;
     RB_INIT(&s_lualoadCache.cacheTree);
     rwlock_init(&s_lualoadCache.rwlock);
 }
@@ -60,13 +152,31 @@ void luaCache_clear()
     RB_FOREACH_SAFE(pCache, luaload_cache_tree_s, &s_lualoadCache.cacheTree, pIter)
     {
         RB_REMOVE(luaload_cache_tree_s, &s_lualoadCache.cacheTree, pCache);
-        mem_free(pCache->szName);
-        mem_free(pCache->pCodeCache);
-        mem_free(pCache);
+        luaCache_freeNode(pCache);
     }
     rwlock_destroy(&s_lualoadCache.rwlock);
 }
 
+void luaCache_closeState(struct lua_State* L)
+{
+    luaProtoRefs_tt* pRefs = NULL;
+    if (lua_rawgetp(L, LUA_REGISTRYINDEX, &s_protoRefsKey) == LUA_TLIGHTUSERDATA) {
+        pRefs = (luaProtoRefs_tt*)lua_touserdata(L, -1);
+    }
+    lua_pop(L, 1);
+    lua_close(L);
+
+    if (pRefs) {
+        for (int32_t i = 0; i < pRefs->iCount; ++i) {
+            luaProtoOwner_release(pRefs->ppOwners[i]);
+        }
+        if (pRefs->ppOwners) {
+            mem_free(pRefs->ppOwners);
+        }
+        mem_free(pRefs);
+    }
+}
+
 int32_t writerCache(struct lua_State* L, const void* p, size_t sz, void* ud)
 {
     luaload_cache_tt* pCache = (luaload_cache_tt*)ud;
@@ -95,9 +205,7 @@ bool luaCache_abandon(const char* szFileName)
         RB_FOREACH_SAFE(pCache, luaload_cache_tree_s, &s_lualoadCache.cacheTree, pIter)
         {
             RB_REMOVE(luaload_cache_tree_s, &s_lualoadCache.cacheTree, pCache);
-            mem_free(pCache->szName);
-            mem_free(pCache->pCodeCache);
-            mem_free(pCache);
+            luaCache_freeNode(pCache);
         }
         rwlock_wrunlock(&s_lualoadCache.rwlock);
     }
@@ -113,52 +221,146 @@ bool luaCache_abandon(const char* szFileName)
         }
 
         RB_REMOVE(luaload_cache_tree_s, &s_lualoadCache.cacheTree, pCache);
-        mem_free(pCache->szName);
-        mem_free(pCache->pCodeCache);
-        mem_free(pCache);
+        luaCache_freeNode(pCache);
         rwlock_wrunlock(&s_lualoadCache.rwlock);
     }
     return true;
 }
 
-int32_t loadfileCache(struct lua_State* L, const char* szFileName)
+// 锁内只查找节点并取得引用: 共享模式登记持有者, 否则复制一份字节码;
+// clone和加载都可能因内存配额抛出错误, 放在锁外进行, 不会跳过解锁
+static void luaCache_takeNode(luaProtoRefs_tt* pRefs, luaload_cache_tt* pNode,
+                              const void** ppProto, char** ppCode, size_t* pCodeLength)
+{
+    if (pNode->pProto) {
+        luaCache_addRef(pRefs, pNode->pOwner);
+        *ppProto = pNode->pProto;
+    }
+    else {
+        *ppCode = mem_malloc(pNode->nCodeLength);
+        memcpy(*ppCode, pNode->pCodeCache, pNode->nCodeLength);
+        *pCodeLength = pNode->nCodeLength;
+    }
+}
+
+static int32_t luaCache_pushNode(lua_State* L, const void* pProto, char* pCode, size_t nCodeLength,
+                                 const char* szFileName)
+{
+    if (pProto) {
+        lua_clonefunction(L, pProto);
+        return LUA_OK;
+    }
+    int32_t stat = luaL_loadbuffer(L, pCode, nCodeLength, szFileName);
+    mem_free(pCode);
+    return stat;
+}
+
+// 在锁外编译, 共享模式下在独立的lua_State中编译一次并标记为共享, 之后各服务只clone闭包;
+// 否则函数直接加载到L的栈顶
+static luaload_cache_tt* luaCache_createNode(lua_State* L, const char* szFileName, int32_t* pStat)
+{
+    luaload_cache_tt* pCache = NULL;
+    if (s_lualoadCache.bShareProto) {
+        lua_State* pProtoState = lua_newstate(lua_cache_alloc, NULL);
+        lua_gc(pProtoState, LUA_GCSTOP, 0);
+        *pStat = luaL_loadfilex_(pProtoState, szFileName, NULL);
+        if (*pStat != LUA_OK) {
+            size_t      nLength = 0;
+            const char* szError = lua_tolstring(pProtoState, -1, &nLength);
+            char*       pError  = mem_malloc(nLength);
+            memcpy(pError, szError, nLength);
+            lua_close(pProtoState);
+            // pushlstring可能抛出, 先释放掉独立的lua_State
+            lua_pushlstring(L, pError, nLength);
+            mem_free(pError);
+            return NULL;
+        }
+        lua_sharefunction(pProtoState, -1);
+        pCache                      = mem_malloc(sizeof(luaload_cache_tt));
+        pCache->pCodeCache          = NULL;
+        pCache->nCodeLength         = 0;
+        pCache->pOwner              = mem_malloc(sizeof(luaProtoOwner_tt));
+        pCache->pOwner->pProtoState = pProtoState;
+        atomic_init(&pCache->pOwner->iRefCount, 1);
+        pCache->pProto = lua_topointer(pProtoState, -1);
+    }
+    else {
+        *pStat = luaL_loadfilex_(L, szFileName, NULL);
+        if (*pStat != LUA_OK) {
+            return NULL;
+        }
+        pCache              = mem_malloc(sizeof(luaload_cache_tt));
+        pCache->pCodeCache  = NULL;
+        pCache->nCodeLength = 0;
+        pCache->pOwner      = NULL;
+        pCache->pProto      = NULL;
+        Check(lua_dump(L, writerCache, pCache, 0) == 0);
+    }
+    pCache->szName = mem_strdup(szFileName);
+    return pCache;
+}
+
+static int32_t luaCache_load(lua_State* L, const char* szFileName)
 {
     if (!atomic_load(&s_lualoadCache.bActive)) {
-        return luaL_loadfile(L, szFileName);
+        return luaL_loadfilex_(L, szFileName, NULL);
+    }
+
+    luaProtoRefs_tt* pRefs = NULL;
+    if (s_lualoadCache.bShareProto) {
+        pRefs = luaCache_getRefs(L);
     }
 
     luaload_cache_tt dataNode;
     dataNode.szName = (char*)szFileName;
 
-    luaload_cache_tt* pNode = NULL;
+    const void*       pProto      = NULL;
+    char*             pCode       = NULL;
+    size_t            nCodeLength = 0;
+    luaload_cache_tt* pNode       = NULL;
     rwlock_rdlock(&s_lualoadCache.rwlock);
     pNode = RB_FIND(luaload_cache_tree_s, &s_lualoadCache.cacheTree, &dataNode);
     if (pNode != NULL) {
-        Check(luaL_loadbuffer(L, pNode->pCodeCache, pNode->nCodeLength, szFileName) == LUA_OK);
-        rwlock_rdunlock(&s_lualoadCache.rwlock);
-        return LUA_OK;
+        luaCache_takeNode(pRefs, pNode, &pProto, &pCode, &nCodeLength);
     }
     rwlock_rdunlock(&s_lualoadCache.rwlock);
-
-    rwlock_wrlock(&s_lualoadCache.rwlock);
-    pNode = RB_FIND(luaload_cache_tree_s, &s_lualoadCache.cacheTree, &dataNode);
     if (pNode != NULL) {
-        Check(luaL_loadbuffer(L, pNode->pCodeCache, pNode->nCodeLength, szFileName) == LUA_OK);
-        rwlock_wrunlock(&s_lualoadCache.rwlock);
-        return LUA_OK;
+        return luaCache_pushNode(L, pProto, pCode, nCodeLength, szFileName);
     }
 
-    int32_t stat = luaL_loadfile(L, szFileName);
-    if (stat == LUA_OK) {
-        luaload_cache_tt* pCache = mem_malloc(sizeof(luaload_cache_tt));
-        pCache->szName           = mem_strdup(szFileName);
-        pCache->pCodeCache       = NULL;
-        pCache->nCodeLength      = 0;
-        Check(lua_dump(L, writerCache, pCache, 0) == 0);
+    int32_t           stat   = LUA_OK;
+    luaload_cache_tt* pCache = luaCache_createNode(L, szFileName, &stat);
+    if (pCache == NULL) {
+        return stat;
+    }
+
+    // 并发编译了同一个文件时保留先插入的节点
+    rwlock_wrlock(&s_lualoadCache.rwlock);
+    pNode = RB_FIND(luaload_cache_tree_s, &s_lualoadCache.cacheTree, &dataNode);
+    if (pNode == NULL) {
         Check(RB_INSERT(luaload_cache_tree_s, &s_lualoadCache.cacheTree, pCache) == NULL);
+        pNode  = pCache;
+        pCache = NULL;
+    }
+    if (pNode->pProto) {
+        luaCache_addRef(pRefs, pNode->pOwner);
+        pProto = pNode->pProto;
     }
     rwlock_wrunlock(&s_lualoadCache.rwlock);
-    return stat;
+
+    if (pCache) {
+        luaCache_freeNode(pCache);
+    }
+    // 非共享模式下函数已经在栈顶
+    if (pProto) {
+        lua_clonefunction(L, pProto);
+    }
+    return LUA_OK;
+}
+
+int32_t loadfileCache(struct lua_State* L, const char* szFileName)
+{
+    return luaCache_load(L, szFileName);
 }
 
 // lua src loadlib.c
@@ -280,40 +482,6 @@ int32_t loadCache(struct lua_State* L)
         return 1;
     }
 
-    if (!atomic_load(&s_lualoadCache.bActive)) {
-        return checkload(L, luaL_loadfile(L, szFileName) == LUA_OK, szFileName);
-    }
-
-    luaload_cache_tt dataNode;
-    dataNode.szName = (char*)szFileName;
-
-    luaload_cache_tt* pNode = NULL;
-    rwlock_rdlock(&s_lualoadCache.rwlock);
-    pNode = RB_FIND(luaload_cache_tree_s, &s_lualoadCache.cacheTree, &dataNode);
-    if (pNode != NULL) {
-        int32_t stat = luaL_loadbuffer(L, pNode->pCodeCache, pNode->nCodeLength, szFileName);
-        rwlock_rdunlock(&s_lualoadCache.rwlock);
-        return checkload(L, stat == LUA_OK, szFileName);
-    }
-    rwlock_rdunlock(&s_lualoadCache.rwlock);
-
-    rwlock_wrlock(&s_lualoadCache.rwlock);
-    pNode = RB_FIND(luaload_cache_tree_s, &s_lualoadCache.cacheTree, &dataNode);
-    if (pNode != NULL) {
-        int32_t stat = luaL_loadbuffer(L, pNode->pCodeCache, pNode->nCodeLength, szFileName);
-        rwlock_wrunlock(&s_lualoadCache.rwlock);
-        return checkload(L, stat == LUA_OK, szFileName);
-    }
-
-    int32_t stat = luaL_loadfile(L, szFileName);
-    if (stat == LUA_OK) {
-        luaload_cache_tt* pCache = mem_malloc(sizeof(luaload_cache_tt));
-        pCache->szName           = mem_strdup(szFileName);
-        pCache->pCodeCache       = NULL;
-        pCache->nCodeLength      = 0;
-        Check(lua_dump(L, writerCache, pCache, 0) == 0);
-        Check(RB_INSERT(luaload_cache_tree_s, &s_lualoadCache.cacheTree, pCache) == NULL);
-    }
-    rwlock_wrunlock(&s_lualoadCache.rwlock);
+    int32_t stat = luaCache_load(L, szFileName);
     return checkload(L, stat == LUA_OK, szFileName);
 }
\ No newline at end of file
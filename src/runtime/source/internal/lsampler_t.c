@@ -0,0 +1,297 @@
+
+
+#include "internal/lsampler_t.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lauxlib.h"
+
+#include "log_t.h"
+#include "thread_t.h"
+#include "time_t.h"
+
+#define def_samplerMaxDepth 64
+#define def_samplerMaxFrame 128
+#define def_samplerInitBucket 64
+
+typedef struct lsamplerStack_s
+{
+    uint64_t uiHash;
+    uint64_t uiCount;
+    size_t   nLength;
+    char*    szStack;
+} lsamplerStack_tt;
+
+struct lsamplerStacks_s
+{
+    lsamplerStack_tt* pBuckets;
+    uint32_t          uiBucketCount;
+    uint32_t          uiUsed;
+    uint64_t          uiSamples;
+};
+
+typedef struct lsampler_s
+{
+    mutex_tt    mutex;
+    thread_tt   thread;
+    int32_t     iRefCount;
+    atomic_bool bRunning;
+    atomic_uint uiIntervalUs;
+    atomic_uint uiTick;
+} lsampler_tt;
+
+static lsampler_tt* s_pSampler = NULL;
+
+static void lsampler_threadLoop(void* pArg)
+{
+    lsampler_tt* pSampler = (lsampler_tt*)pArg;
+    while (atomic_load(&pSampler->bRunning)) {
+        uint32_t    uiIntervalUs = atomic_load_explicit(&pSampler->uiIntervalUs, memory_order_relaxed);
+        timespec_tt tsSleep      = {.iSec  = (int32_t)(uiIntervalUs / 1000000),
+                                    .iNsec = (int32_t)(uiIntervalUs % 1000000) * 1000};
+        sleep_for(&tsSleep);
+        atomic_fetch_add_explicit(&pSampler->uiTick, 1, memory_order_release);
+    }
+}
+
+void lsampler_init()
+{
+    if (s_pSampler != NULL) {
+        return;
+    }
+    s_pSampler            = mem_malloc(sizeof(lsampler_tt));
+    s_pSampler->iRefCount = 0;
+    atomic_init(&s_pSampler->bRunning, false);
+    atomic_init(&s_pSampler->uiIntervalUs, 1000000 / DEF_SAMPLER_DEFAULT_HZ);
+    atomic_init(&s_pSampler->uiTick, 0);
+    mutex_init(&s_pSampler->mutex);
+}
+
+void lsampler_clear()
+{
+    if (s_pSampler == NULL) {
+        return;
+    }
+    mutex_lock(&s_pSampler->mutex);
+    if (s_pSampler->iRefCount > 0) {
+        s_pSampler->iRefCount = 0;
+        atomic_store(&s_pSampler->bRunning, false);
+        thread_join(s_pSampler->thread);
+    }
+    mutex_unlock(&s_pSampler->mutex);
+    mutex_destroy(&s_pSampler->mutex);
+    mem_free(s_pSampler);
+    s_pSampler = NULL;
+}
+
+bool lsampler_acquire(int32_t iHz)
+{
+    if (s_pSampler == NULL) {
+        return false;
+    }
+    if (iHz <= 0) {
+        iHz = DEF_SAMPLER_DEFAULT_HZ;
+    }
+    else if (iHz > DEF_SAMPLER_MAX_HZ) {
+        iHz = DEF_SAMPLER_MAX_HZ;
+    }
+
+    bool bSucc = true;
+    mutex_lock(&s_pSampler->mutex);
+    atomic_store(&s_pSampler->uiIntervalUs, 1000000 / iHz);
+    if (s_pSampler->iRefCount == 0) {
+        atomic_store(&s_pSampler->bRunning, true);
+        if (thread_start(&s_pSampler->thread, lsampler_threadLoop, s_pSampler) != eThreadSuccess) {
+            Log(eLog_error, "sampler thread start error");
+            atomic_store(&s_pSampler->bRunning, false);
+            bSucc = false;
+        }
+    }
+    if (bSucc) {
+        ++s_pSampler->iRefCount;
+    }
+    mutex_unlock(&s_pSampler->mutex);
+    return bSucc;
+}
+
+void lsampler_release()
+{
+    if (s_pSampler == NULL) {
+        return;
+    }
+    mutex_lock(&s_pSampler->mutex);
+    if (s_pSampler->iRefCount > 0 && --s_pSampler->iRefCount == 0) {
+        atomic_store(&s_pSampler->bRunning, false);
+        thread_join(s_pSampler->thread);
+    }
+    mutex_unlock(&s_pSampler->mutex);
+}
+
+uint32_t lsampler_getTick()
+{
+    return s_pSampler ? atomic_load_explicit(&s_pSampler->uiTick, memory_order_acquire) : 0;
+}
+
+lsamplerStacks_tt* createSamplerStacks()
+{
+    lsamplerStacks_tt* pStacks = mem_malloc(sizeof(lsamplerStacks_tt));
+    pStacks->uiBucketCount     = def_samplerInitBucket;
+    pStacks->uiUsed            = 0;
+    pStacks->uiSamples         = 0;
+    pStacks->pBuckets          = mem_malloc(sizeof(lsamplerStack_tt) * def_samplerInitBucket);
+    memset(pStacks->pBuckets, 0, sizeof(lsamplerStack_tt) * def_samplerInitBucket);
+    return pStacks;
+}
+
+void lsamplerStacks_release(lsamplerStacks_tt* pStacks)
+{
+    for (uint32_t i = 0; i < pStacks->uiBucketCount; ++i) {
+        if (pStacks->pBuckets[i].szStack) {
+            mem_free(pStacks->pBuckets[i].szStack);
+        }
+    }
+    mem_free(pStacks->pBuckets);
+    mem_free(pStacks);
+}
+
+static inline uint64_t lsamplerStacks_hash(const char* szStack, size_t nLength)
+{
+    uint64_t uiHash = 14695981039346656037ULL;
+    for (size_t i = 0; i < nLength; ++i) {
+        uiHash ^= (uint8_t)szStack[i];
+        uiHash *= 1099511628211ULL;
+    }
+    return uiHash;
+}
+
+static lsamplerStack_tt* lsamplerStacks_slot(lsamplerStack_tt* pBuckets, uint32_t uiBucketCount,
+                                             uint64_t uiHash, const char* szStack,
+                                             size_t nLength)
+{
+    uint32_t uiIndex = (uint32_t)uiHash & (uiBucketCount - 1);
+    for (;;) {
+        lsamplerStack_tt* pSlot = &pBuckets[uiIndex];
+        if (pSlot->szStack == NULL ||
+            (pSlot->uiHash == uiHash && pSlot->nLength == nLength &&
+             memcmp(pSlot->szStack, szStack, nLength) == 0)) {
+            return pSlot;
+        }
+        uiIndex = (uiIndex + 1) & (uiBucketCount - 1);
+    }
+}
+
+static void lsamplerStacks_grow(lsamplerStacks_tt* pStacks)
+{
+    uint32_t          uiBucketCount = pStacks->uiBucketCount * 2;
+    lsamplerStack_tt* pBuckets      = mem_malloc(sizeof(lsamplerStack_tt) * uiBucketCount);
+    memset(pBuckets, 0, sizeof(lsamplerStack_tt) * uiBucketCount);
+    for (uint32_t i = 0; i < pStacks->uiBucketCount; ++i) {
+        lsamplerStack_tt* pOld = &pStacks->pBuckets[i];
+        if (pOld->szStack) {
+            *lsamplerStacks_slot(
+                pBuckets, uiBucketCount, pOld->uiHash, pOld->szStack, pOld->nLength) = *pOld;
+        }
+    }
+    mem_free(pStacks->pBuckets);
+    pStacks->pBuckets      = pBuckets;
+    pStacks->uiBucketCount = uiBucketCount;
+}
+
+static int32_t lsamplerStacks_frame(lua_State* L, lua_Debug* pDebug, char* szFrame)
+{
+    lua_getinfo(L, "Sn", pDebug);
+    const char* szName = pDebug->name ? pDebug->name : "?";
+    int32_t     iLength;
+    if (*pDebug->what == 'C') {
+        iLength = snprintf(szFrame, def_samplerMaxFrame, "%s [C]", szName);
+    }
+    else if (*pDebug->what == 'm') {
+        iLength = snprintf(szFrame, def_samplerMaxFrame, "main %s", pDebug->short_src);
+    }
+    else {
+        iLength = snprintf(
+            szFrame, def_samplerMaxFrame, "%s %s:%d", szName, pDebug->short_src, pDebug->linedefined);
+    }
+    if (iLength >= def_samplerMaxFrame) {
+        iLength = def_samplerMaxFrame - 1;
+    }
+    // ';'是折叠栈的帧分隔符
+    for (int32_t i = 0; i < iLength; ++i) {
+        if (szFrame[i] == ';') {
+            szFrame[i] = ',';
+        }
+    }
+    return iLength;
+}
+
+void lsamplerStacks_record(lsamplerStacks_tt* pStacks, lua_State* L)
+{
+    char      szFrames[def_samplerMaxDepth][def_samplerMaxFrame];
+    int32_t   frameLengths[def_samplerMaxDepth];
+    int32_t   iDepth = 0;
+    lua_Debug debug;
+    while (iDepth < def_samplerMaxDepth && lua_getstack(L, iDepth, &debug)) {
+        frameLengths[iDepth] = lsamplerStacks_frame(L, &debug, szFrames[iDepth]);
+        ++iDepth;
+    }
+    if (iDepth == 0) {
+        return;
+    }
+
+    // 折叠栈从根帧开始
+    char   szStack[def_samplerMaxDepth * def_samplerMaxFrame];
+    size_t nLength = 0;
+    for (int32_t i = iDepth - 1; i >= 0; --i) {
+        memcpy(szStack + nLength, szFrames[i], frameLengths[i]);
+        nLength += frameLengths[i];
+        if (i > 0) {
+            szStack[nLength++] = ';';
+        }
+    }
+
+    ++pStacks->uiSamples;
+    uint64_t          uiHash = lsamplerStacks_hash(szStack, nLength);
+    lsamplerStack_tt* pSlot =
+        lsamplerStacks_slot(pStacks->pBuckets, pStacks->uiBucketCount, uiHash, szStack, nLength);
+    if (pSlot->szStack) {
+        ++pSlot->uiCount;
+        return;
+    }
+
+    pSlot->uiHash  = uiHash;
+    pSlot->uiCount = 1;
+    pSlot->nLength = nLength;
+    pSlot->szStack = mem_malloc(nLength);
+    memcpy(pSlot->szStack, szStack, nLength);
+    if (++pStacks->uiUsed * 4 >= pStacks->uiBucketCount * 3) {
+        lsamplerStacks_grow(pStacks);
+    }
+}
+
+uint64_t lsamplerStacks_count(lsamplerStacks_tt* pStacks)
+{
+    return pStacks->uiSamples;
+}
+
+void lsamplerStacks_push(lsamplerStacks_tt* pStacks, lua_State* L, const char* szPrefix)
+{
+    luaL_Buffer b;
+    luaL_buffinit(L, &b);
+    char szCount[32];
+    for (uint32_t i = 0; i < pStacks->uiBucketCount; ++i) {
+        lsamplerStack_tt* pSlot = &pStacks->pBuckets[i];
+        if (pSlot->szStack == NULL) {
+            continue;
+        }
+        if (szPrefix) {
+            luaL_addstring(&b, szPrefix);
+            luaL_addchar(&b, ';');
+        }
+        luaL_addlstring(&b, pSlot->szStack, pSlot->nLength);
+        snprintf(szCount, sizeof(szCount), " %llu\n", (unsigned long long)pSlot->uiCount);
+        luaL_addstring(&b, szCount);
+    }
+    luaL_pushresult(&b);
+}
@@ -0,0 +1,298 @@
+
+
+#include "internal/lservicePool_t.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_t.h"
+#include "thread_t.h"
+
+#include "internal/lservice-inl.h"
+
+typedef struct lservicePoolEntry_s
+{
+    char*                       szName;
+    char*                       szModules;
+    int32_t                     iCapacity;
+    int32_t                     iReadyCount;
+    struct lserviceContext_s**  ppReady;
+    uint32_t                    uiGeneration;
+    uint64_t                    uiHit;
+    uint64_t                    uiMiss;
+    struct lservicePoolEntry_s* pNext;
+} lservicePoolEntry_tt;
+
+typedef struct lservicePool_s
+{
+    mutex_tt              mutex;
+    cond_tt               cond;
+    thread_tt             thread;
+    bool                  bRunning;
+    lservicePoolEntry_tt* pEntryList;
+} lservicePool_tt;
+
+static lservicePool_tt* s_pServicePool = NULL;
+
+static lservicePoolEntry_tt* lservicePool_find(const char* szName)
+{
+    lservicePoolEntry_tt* pEntry = s_pServicePool->pEntryList;
+    while (pEntry) {
+        if (strcmp(pEntry->szName, szName) == 0) {
+            return pEntry;
+        }
+        pEntry = pEntry->pNext;
+    }
+    return NULL;
+}
+
+static lservicePoolEntry_tt* lservicePool_findHungry()
+{
+    lservicePoolEntry_tt* pEntry = s_pServicePool->pEntryList;
+    while (pEntry) {
+        if (pEntry->iReadyCount < pEntry->iCapacity) {
+            return pEntry;
+        }
+        pEntry = pEntry->pNext;
+    }
+    return NULL;
+}
+
+// 需持有锁, 返回被摘下的lua_State数量, 由调用方在锁外释放
+static int32_t lservicePoolEntry_detach(lservicePoolEntry_tt* pEntry,
+                                        struct lserviceContext_s*** pppReady)
+{
+    int32_t iCount       = pEntry->iReadyCount;
+    *pppReady            = pEntry->ppReady;
+    pEntry->ppReady      = NULL;
+    pEntry->iReadyCount  = 0;
+    pEntry->uiGeneration = pEntry->uiGeneration + 1;
+    if (pEntry->iCapacity > 0) {
+        pEntry->ppReady = mem_malloc(sizeof(struct lserviceContext_s*) * pEntry->iCapacity);
+    }
+    return iCount;
+}
+
+static void lservicePool_releaseReady(struct lserviceContext_s** ppReady, int32_t iCount)
+{
+    for (int32_t i = 0; i < iCount; ++i) {
+        lserviceContext_release(ppReady[i]);
+    }
+    if (ppReady) {
+        mem_free(ppReady);
+    }
+}
+
+static void lservicePool_threadLoop(void* pArg)
+{
+    lservicePool_tt* pPool = (lservicePool_tt*)pArg;
+    mutex_lock(&pPool->mutex);
+    while (pPool->bRunning) {
+        lservicePoolEntry_tt* pEntry = lservicePool_findHungry();
+        if (pEntry == NULL) {
+            cond_wait(&pPool->cond, &pPool->mutex);
+            continue;
+        }
+
+        uint32_t uiGeneration = pEntry->uiGeneration;
+        char*    szModules    = pEntry->szModules ? mem_strdup(pEntry->szModules) : NULL;
+        mutex_unlock(&pPool->mutex);
+
+        struct lserviceContext_s* pContext = createLuaServiceContext(pEntry->szName, szModules);
+        if (szModules) {
+            mem_free(szModules);
+        }
+
+        mutex_lock(&pPool->mutex);
+        if (pContext == NULL) {
+            // 脚本有错时不再反复预热, 等待下一次prepare, 已预热的也一并作废
+            Log(eLog_error, "service pool %s prepare error", pEntry->szName);
+            pEntry->iCapacity                  = 0;
+            struct lserviceContext_s** ppReady = NULL;
+            int32_t                    iCount  = lservicePoolEntry_detach(pEntry, &ppReady);
+            mutex_unlock(&pPool->mutex);
+            lservicePool_releaseReady(ppReady, iCount);
+            mutex_lock(&pPool->mutex);
+            continue;
+        }
+
+        if (uiGeneration == pEntry->uiGeneration && pEntry->iReadyCount < pEntry->iCapacity) {
+            pEntry->ppReady[pEntry->iReadyCount++] = pContext;
+        }
+        else {
+            mutex_unlock(&pPool->mutex);
+            lserviceContext_release(pContext);
+            mutex_lock(&pPool->mutex);
+        }
+    }
+    mutex_unlock(&pPool->mutex);
+}
+
+void lservicePool_init()
+{
+    if (s_pServicePool != NULL) {
+        return;
+    }
+
+    s_pServicePool             = mem_malloc(sizeof(lservicePool_tt));
+    s_pServicePool->bRunning   = true;
+    s_pServicePool->pEntryList = NULL;
+    mutex_init(&s_pServicePool->mutex);
+    cond_init(&s_pServicePool->cond);
+    if (thread_start(&s_pServicePool->thread, lservicePool_threadLoop, s_pServicePool) !=
+        eThreadSuccess) {
+        Log(eLog_error, "service pool thread start error");
+        cond_destroy(&s_pServicePool->cond);
+        mutex_destroy(&s_pServicePool->mutex);
+        mem_free(s_pServicePool);
+        s_pServicePool = NULL;
+    }
+}
+
+void lservicePool_clear()
+{
+    if (s_pServicePool == NULL) {
+        return;
+    }
+
+    mutex_lock(&s_pServicePool->mutex);
+    s_pServicePool->bRunning = false;
+    cond_signal(&s_pServicePool->cond);
+    mutex_unlock(&s_pServicePool->mutex);
+    thread_join(s_pServicePool->thread);
+
+    lservicePoolEntry_tt* pEntry = s_pServicePool->pEntryList;
+    while (pEntry) {
+        lservicePoolEntry_tt* pNext = pEntry->pNext;
+        lservicePool_releaseReady(pEntry->ppReady, pEntry->iReadyCount);
+        if (pEntry->szModules) {
+            mem_free(pEntry->szModules);
+        }
+        mem_free(pEntry->szName);
+        mem_free(pEntry);
+        pEntry = pNext;
+    }
+
+    cond_destroy(&s_pServicePool->cond);
+    mutex_destroy(&s_pServicePool->mutex);
+    mem_free(s_pServicePool);
+    s_pServicePool = NULL;
+}
+
+bool lservicePool_prepare(const char* szName, int32_t iCapacity, const char* szModules)
+{
+    if (s_pServicePool == NULL || iCapacity < 0) {
+        return false;
+    }
+
+    struct lserviceContext_s** ppReady = NULL;
+    int32_t                    iCount  = 0;
+
+    mutex_lock(&s_pServicePool->mutex);
+    lservicePoolEntry_tt* pEntry = lservicePool_find(szName);
+    if (pEntry == NULL) {
+        pEntry               = mem_malloc(sizeof(lservicePoolEntry_tt));
+        pEntry->szName       = mem_strdup(szName);
+        pEntry->szModules    = szModules ? mem_strdup(szModules) : NULL;
+        pEntry->iCapacity    = 0;
+        pEntry->iReadyCount  = 0;
+        pEntry->ppReady      = NULL;
+        pEntry->uiGeneration = 0;
+        pEntry->uiHit        = 0;
+        pEntry->uiMiss       = 0;
+        pEntry->pNext        = s_pServicePool->pEntryList;
+        s_pServicePool->pEntryList = pEntry;
+    }
+    else if ((pEntry->szModules == NULL) != (szModules == NULL) ||
+             (szModules && strcmp(pEntry->szModules, szModules) != 0)) {
+        // 预加载的模块变了, 之前预热的lua_State全部作废
+        if (pEntry->szModules) {
+            mem_free(pEntry->szModules);
+        }
+        pEntry->szModules = szModules ? mem_strdup(szModules) : NULL;
+        iCount            = lservicePoolEntry_detach(pEntry, &ppReady);
+    }
+
+    if (iCapacity < pEntry->iReadyCount) {
+        ppReady = mem_malloc(sizeof(struct lserviceContext_s*) * (pEntry->iReadyCount - iCapacity));
+        for (int32_t i = iCapacity; i < pEntry->iReadyCount; ++i) {
+            ppReady[iCount++] = pEntry->ppReady[i];
+        }
+        pEntry->iReadyCount = iCapacity;
+    }
+
+    if (iCapacity > pEntry->iCapacity) {
+        pEntry->ppReady =
+            mem_realloc(pEntry->ppReady, sizeof(struct lserviceContext_s*) * iCapacity);
+    }
+    pEntry->iCapacity = iCapacity;
+    cond_signal(&s_pServicePool->cond);
+    mutex_unlock(&s_pServicePool->mutex);
+
+    lservicePool_releaseReady(ppReady, iCount);
+    return true;
+}
+
+struct lserviceContext_s* lservicePool_take(const char* szName)
+{
+    if (s_pServicePool == NULL) {
+        return NULL;
+    }
+
+    struct lserviceContext_s* pContext = NULL;
+    mutex_lock(&s_pServicePool->mutex);
+    lservicePoolEntry_tt* pEntry = lservicePool_find(szName);
+    if (pEntry && pEntry->iCapacity > 0) {
+        if (pEntry->iReadyCount > 0) {
+            pContext = pEntry->ppReady[--pEntry->iReadyCount];
+            ++pEntry->uiHit;
+        }
+        else {
+            ++pEntry->uiMiss;
+        }
+        cond_signal(&s_pServicePool->cond);
+    }
+    mutex_unlock(&s_pServicePool->mutex);
+    return pContext;
+}
+
+void lservicePool_flush(const char* szName)
+{
+    if (s_pServicePool == NULL) {
+        return;
+    }
+
+    mutex_lock(&s_pServicePool->mutex);
+    lservicePoolEntry_tt* pEntry = s_pServicePool->pEntryList;
+    while (pEntry) {
+        if (szName == NULL || strcmp(pEntry->szName, szName) == 0) {
+            struct lserviceContext_s** ppReady = NULL;
+            int32_t                    iCount  = lservicePoolEntry_detach(pEntry, &ppReady);
+            mutex_unlock(&s_pServicePool->mutex);
+            lservicePool_releaseReady(ppReady, iCount);
+            mutex_lock(&s_pServicePool->mutex);
+        }
+        pEntry = pEntry->pNext;
+    }
+    cond_signal(&s_pServicePool->cond);
+    mutex_unlock(&s_pServicePool->mutex);
+}
+
+bool lservicePool_status(const char* szName, int32_t* pReady, int32_t* pCapacity, uint64_t* pHit,
+                         uint64_t* pMiss)
+{
+    if (s_pServicePool == NULL) {
+        return false;
+    }
+
+    mutex_lock(&s_pServicePool->mutex);
+    lservicePoolEntry_tt* pEntry = lservicePool_find(szName);
+    if (pEntry) {
+        *pReady    = pEntry->iReadyCount;
+        *pCapacity = pEntry->iCapacity;
+        *pHit      = pEntry->uiHit;
+        *pMiss     = pEntry->uiMiss;
+    }
+    mutex_unlock(&s_pServicePool->mutex);
+    return pEntry != NULL;
+}
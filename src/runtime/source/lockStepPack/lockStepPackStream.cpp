@@ -115,10 +115,11 @@ codecStream_tt* lockStepPackStreamCreate()
     lockStepPackStream_tt* pHandle =
         (lockStepPackStream_tt*)mem_malloc(sizeof(lockStepPackStream_tt));
     atomic_init(&pHandle->iRefCount, 1);
-    pHandle->codec.fnReceive   = lockStepPackStream_receive;
-    pHandle->codec.fnWrite     = lockStepPackStream_write;
-    pHandle->codec.fnWriteMove = lockStepPackStream_writeMove;
-    pHandle->codec.fnAddref    = lockStepPackStream_addref;
-    pHandle->codec.fnRelease   = lockStepPackStream_release;
+    pHandle->codec.fnReceive      = lockStepPackStream_receive;
+    pHandle->codec.fnWrite        = lockStepPackStream_write;
+    pHandle->codec.fnWriteMove    = lockStepPackStream_writeMove;
+    pHandle->codec.fnEncodeShared = NULL;
+    pHandle->codec.fnAddref       = lockStepPackStream_addref;
+    pHandle->codec.fnRelease      = lockStepPackStream_release;
     return &pHandle->codec;
 }
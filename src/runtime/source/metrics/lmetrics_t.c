@@ -0,0 +1,162 @@
+
+
+#include "metrics/lmetrics_t.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lauxlib.h"
+#include "lua.h"
+#include "lualib.h"
+
+#include "metrics_t.h"
+
+// 指标在进程内常驻, userdata只保存指针, 不需要__gc
+
+static void lmetrics_pushHandle(lua_State* L, void* pMetric, const char* szMetatable)
+{
+    if (pMetric == NULL) {
+        lua_pushnil(L);
+        return;
+    }
+    void** ppHandle = (void**)lua_newuserdatauv(L, sizeof(void*), 0);
+    *ppHandle       = pMetric;
+    luaL_getmetatable(L, szMetatable);
+    lua_setmetatable(L, -2);
+}
+
+static int32_t lmetrics_counter(lua_State* L)
+{
+    const char* szName = luaL_checkstring(L, 1);
+    const char* szHelp = luaL_optstring(L, 2, NULL);
+    lmetrics_pushHandle(L, metrics_registerCounter(szName, szHelp), "metricsCounter");
+    return 1;
+}
+
+static int32_t lmetrics_gauge(lua_State* L)
+{
+    const char* szName = luaL_checkstring(L, 1);
+    const char* szHelp = luaL_optstring(L, 2, NULL);
+    lmetrics_pushHandle(L, metrics_registerGauge(szName, szHelp), "metricsGauge");
+    return 1;
+}
+
+// histogram(name, [help], [{bound1, bound2, ...}])
+static int32_t lmetrics_histogram(lua_State* L)
+{
+    const char* szName = luaL_checkstring(L, 1);
+    const char* szHelp = luaL_optstring(L, 2, NULL);
+    double      bounds[DEF_METRICS_HISTOGRAM_MAX_BUCKETS];
+    int32_t     iCount = 0;
+    if (lua_istable(L, 3)) {
+        int32_t iLength = (int32_t)luaL_len(L, 3);
+        if (iLength > DEF_METRICS_HISTOGRAM_MAX_BUCKETS) {
+            iLength = DEF_METRICS_HISTOGRAM_MAX_BUCKETS;
+        }
+        for (int32_t i = 1; i <= iLength; ++i) {
+            lua_rawgeti(L, 3, i);
+            bounds[iCount] = luaL_checknumber(L, -1);
+            lua_pop(L, 1);
+            if (iCount > 0 && bounds[iCount] <= bounds[iCount - 1]) {
+                return luaL_error(L, "histogram bounds must be ascending");
+            }
+            ++iCount;
+        }
+    }
+    lmetrics_pushHandle(
+        L, metrics_registerHistogram(szName, szHelp, bounds, iCount), "metricsHistogram");
+    return 1;
+}
+
+static int32_t lmetrics_render(lua_State* L)
+{
+    size_t nLength  = 0;
+    char*  szBuffer = metrics_render(&nLength);
+    lua_pushlstring(L, szBuffer, nLength);
+    mem_free(szBuffer);
+    return 1;
+}
+
+static int32_t lmetricsCounter_inc(lua_State* L)
+{
+    metricsCounter_tt* pCounter = *(metricsCounter_tt**)luaL_checkudata(L, 1, "metricsCounter");
+    lua_Integer        iValue   = luaL_optinteger(L, 2, 1);
+    luaL_argcheck(L, iValue >= 0, 2, "counter can only increase");
+    metricsCounter_add(pCounter, (uint64_t)iValue);
+    return 0;
+}
+
+static int32_t lmetricsCounter_get(lua_State* L)
+{
+    metricsCounter_tt* pCounter = *(metricsCounter_tt**)luaL_checkudata(L, 1, "metricsCounter");
+    lua_pushinteger(L, (lua_Integer)metricsCounter_get(pCounter));
+    return 1;
+}
+
+static int32_t lmetricsGauge_set(lua_State* L)
+{
+    metricsGauge_tt* pGauge = *(metricsGauge_tt**)luaL_checkudata(L, 1, "metricsGauge");
+    metricsGauge_set(pGauge, luaL_checknumber(L, 2));
+    return 0;
+}
+
+static int32_t lmetricsGauge_add(lua_State* L)
+{
+    metricsGauge_tt* pGauge = *(metricsGauge_tt**)luaL_checkudata(L, 1, "metricsGauge");
+    metricsGauge_add(pGauge, luaL_optnumber(L, 2, 1));
+    return 0;
+}
+
+static int32_t lmetricsGauge_get(lua_State* L)
+{
+    metricsGauge_tt* pGauge = *(metricsGauge_tt**)luaL_checkudata(L, 1, "metricsGauge");
+    lua_pushnumber(L, metricsGauge_get(pGauge));
+    return 1;
+}
+
+static int32_t lmetricsHistogram_observe(lua_State* L)
+{
+    metricsHistogram_tt* pHistogram =
+        *(metricsHistogram_tt**)luaL_checkudata(L, 1, "metricsHistogram");
+    metricsHistogram_observe(pHistogram, luaL_checknumber(L, 2));
+    return 0;
+}
+
+static void lmetrics_newMetatable(lua_State* L, const char* szName, const luaL_Reg* pFuncs)
+{
+    luaL_newmetatable(L, szName);
+    /* metatable.__index = metatable */
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -2, "__index");
+    luaL_setfuncs(L, pFuncs, 0);
+    lua_pop(L, 1);
+}
+
+int32_t luaopen_lruntime_metrics(struct lua_State* L)
+{
+#ifdef luaL_checkversion
+    luaL_checkversion(L);
+#endif
+
+    luaL_Reg lua_counterFuncs[] = {
+        {"inc", lmetricsCounter_inc}, {"get", lmetricsCounter_get}, {NULL, NULL}};
+    lmetrics_newMetatable(L, "metricsCounter", lua_counterFuncs);
+
+    luaL_Reg lua_gaugeFuncs[] = {{"set", lmetricsGauge_set},
+                                 {"add", lmetricsGauge_add},
+                                 {"get", lmetricsGauge_get},
+                                 {NULL, NULL}};
+    lmetrics_newMetatable(L, "metricsGauge", lua_gaugeFuncs);
+
+    luaL_Reg lua_histogramFuncs[] = {{"observe", lmetricsHistogram_observe}, {NULL, NULL}};
+    lmetrics_newMetatable(L, "metricsHistogram", lua_histogramFuncs);
+
+    luaL_Reg lualib_metrics[] = {{"counter", lmetrics_counter},
+                                 {"gauge", lmetrics_gauge},
+                                 {"histogram", lmetrics_histogram},
+                                 {"render", lmetrics_render},
+                                 {NULL, NULL}};
+    luaL_newlib(L, lualib_metrics);
+    return 1;
+}
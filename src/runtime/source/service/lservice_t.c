@@ -3,6 +3,7 @@
 #include "service/lservice_t.h"
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -11,7 +12,10 @@
 #include "lua.h"
 #include "lualib.h"
 
+#include "asyncLog_t.h"
 #include "log_t.h"
+#include "memHeap_t.h"
+#include "spinLock_t.h"
 #include "thread_t.h"
 #include "time_t.h"
 #include "utility_t.h"
@@ -20,18 +24,25 @@
 #include "channel/channel_t.h"
 #include "eventIO/eventIOThread_t.h"
 #include "eventIO/eventIO_t.h"
+#include "clusterRouter_t.h"
 #include "serviceCenter_t.h"
 #include "serviceEvent_t.h"
+#include "serviceMonitor_t.h"
+#include "serviceTrace_t.h"
 #include "service_t.h"
 
 #include "internal/lconfig_t.h"
 #include "internal/lloadCache_t.h"
 #include "internal/lpackagePath_t.h"
+#include "internal/lsampler_t.h"
 
 #include "internal/lconnector_t.h"
 #include "internal/ldnsResolve_t.h"
 #include "internal/lenv-inl.h"
+#include "internal/lheapProfiler_t.h"
 #include "internal/llistenPort_t.h"
+#include "internal/lservice-inl.h"
+#include "internal/lservicePool_t.h"
 #include "internal/ltimerWatcher_t.h"
 
 #ifndef MAX_PATH
@@ -39,6 +50,8 @@
 #endif
 
 #define def_MAX_ERROR_STR 256
+#define def_gcIdleStep 16
+#define def_samplerCountStep 1000
 
 static int32_t traceback(lua_State* L)
 {
@@ -53,27 +66,152 @@ static int32_t traceback(lua_State* L)
 
 typedef struct lserviceContext_s
 {
-    service_tt* pHandle;
-    uint32_t    uiGenToken;
-    lua_State*  pLuaState;
-    FILE*       pLogFile;
-    bool        bProfile;
-    bool        bLog;
-    int32_t     iLogCount;
-    uint64_t    uiProfileCost;
-    uint64_t    uiProfileTimer;
-    uint64_t    uiCallbackCount;
+    service_tt*        pHandle;
+    uint32_t           uiGenToken;
+    lua_State*         pLuaState;
+    asyncLogFile_tt*   pLogFile;
+    bool               bProfile;
+    bool               bLog;
+    int32_t            iLogCount;
+    uint64_t           uiProfileCost;
+    uint64_t           uiProfileTimer;
+    uint64_t           uiCallbackCount;
+    lserviceGc_tt      gc;
+    memHeap_tt*        pHeap;
+    bool               bHeap;
+    bool               bClosing;
+    size_t             nMemory;
+    size_t             nMemoryPeak;
+    size_t             nMemoryQuota;
+    uint32_t           uiDebugGeneration;
+    bool               bDebugAttached;
+    bool               bSampling;
+    uint32_t           uiSampleTick;
+    lsamplerStacks_tt* pSampler;
+    lheapProfiler_tt*  pHeapProfiler;
+    spinLock_tt        runningLock;
+    lua_State*         pRunningThread;
+    atomic_uint        uiSlowRequest;
 } lserviceContext_tt;
 
+static _decl_threadLocal lserviceContext_tt* s_pRunningContext = NULL;
+
+#define def_logStructMaxArgs 32
+
+// 各服务的结构化日志共用一个文件
+static asyncLogFile_tt* s_pEventLogFile    = NULL;
+static once_flag_tt     s_eventLogOnceFlag = ONCE_FLAG_INIT;
+
+// 调试器挂接代数, 奇数表示已挂接; 服务在下一次回调时比对并安装或卸载钩子
+static atomic_uint s_uiDebugGeneration = 0;
+
+static void lserviceContext_heapSample(lserviceContext_tt* pService);
+static void lserviceContext_hook(lua_State* L, lua_Debug* pDebug);
+
 static void* lua_custom_alloc(void* ud, void* ptr, size_t osize, size_t nsize)
 {
+    lserviceContext_tt* pService = (lserviceContext_tt*)ud;
+    size_t              nOldSize = ptr ? osize : 0;
     if (nsize == 0) {
-        mem_free(ptr);
+        if (ptr) {
+            pService->nMemory -= osize;
+            if (_UnLikely(pService->pHeapProfiler != NULL)) {
+                lheapProfiler_update(pService->pHeapProfiler, ptr, NULL, osize, 0);
+            }
+            // 关闭时私有堆中的块随堆一起销毁
+            if (!pService->bClosing || !memHeap_contains(pService->pHeap, ptr)) {
+                mem_free(ptr);
+            }
+        }
+        return NULL;
+    }
+
+    if (nsize > nOldSize && pService->nMemoryQuota != 0 &&
+        pService->nMemory + (nsize - nOldSize) > pService->nMemoryQuota) {
         return NULL;
     }
+
+    if (pService->bHeap && pService->pHeap == NULL && s_pRunningContext == pService) {
+        pService->pHeap = createMemHeap();
+        pService->bHeap = pService->pHeap != NULL;
+    }
+
+    void* p = NULL;
+    if (pService->pHeap && memHeap_isOwner(pService->pHeap)) {
+        p = memHeap_realloc(pService->pHeap, ptr, nsize);
+    }
     else {
-        return mem_realloc(ptr, nsize);
+        p = mem_realloc(ptr, nsize);
+    }
+
+    if (p) {
+        pService->nMemory = pService->nMemory - nOldSize + nsize;
+        if (pService->nMemory > pService->nMemoryPeak) {
+            pService->nMemoryPeak = pService->nMemory;
+        }
+        if (_UnLikely(pService->pHeapProfiler != NULL) &&
+            lheapProfiler_update(pService->pHeapProfiler, ptr, p, nOldSize, nsize)) {
+            lserviceContext_heapSample(pService);
+        }
+    }
+    return p;
+}
+
+static inline void lserviceContext_publishMemory(lserviceContext_tt* pService)
+{
+    if (pService->pHandle) {
+        service_setMemoryUsage(pService->pHandle, pService->nMemory, pService->nMemoryPeak);
+    }
+}
+
+static void lserviceGc_init(lserviceGc_tt* pGc)
+{
+    pGc->iMode     = DEF_LUA_GC_INCREMENTAL;
+    pGc->iPause    = 0;
+    pGc->iStepMul  = 0;
+    pGc->iStepSize = 0;
+    pGc->iMinorMul = 0;
+    pGc->iMajorMul = 0;
+    pGc->iIdleStep = def_gcIdleStep;
+}
+
+static int32_t lserviceGc_field(lua_State* L, int32_t iIndex, const char* szField, int32_t iValue)
+{
+    if (lua_getfield(L, iIndex, szField) != LUA_TNIL) {
+        lua_Integer iField = luaL_checkinteger(L, -1);
+        if (iField < 0 || iField > 0x7fffffff) {
+            luaL_error(L, "invalid gc %s", szField);
+        }
+        iValue = (int32_t)iField;
+    }
+    lua_pop(L, 1);
+    return iValue;
+}
+
+// { mode = "incremental"|"generational", pause, stepmul, stepsize, minormul, majormul, idleStep }
+static void lserviceGc_parse(lua_State* L, int32_t iIndex, lserviceGc_tt* pGc)
+{
+    static const char* const modeNames[] = {"incremental", "generational", NULL};
+    luaL_checktype(L, iIndex, LUA_TTABLE);
+    if (lua_getfield(L, iIndex, "mode") != LUA_TNIL) {
+        pGc->iMode = luaL_checkoption(L, -1, NULL, modeNames) == 0 ? DEF_LUA_GC_INCREMENTAL
+                                                                   : DEF_LUA_GC_GENERATIONAL;
+    }
+    lua_pop(L, 1);
+    pGc->iPause    = lserviceGc_field(L, iIndex, "pause", pGc->iPause);
+    pGc->iStepMul  = lserviceGc_field(L, iIndex, "stepmul", pGc->iStepMul);
+    pGc->iStepSize = lserviceGc_field(L, iIndex, "stepsize", pGc->iStepSize);
+    pGc->iMinorMul = lserviceGc_field(L, iIndex, "minormul", pGc->iMinorMul);
+    pGc->iMajorMul = lserviceGc_field(L, iIndex, "majormul", pGc->iMajorMul);
+    pGc->iIdleStep = lserviceGc_field(L, iIndex, "idleStep", pGc->iIdleStep);
+}
+
+static int32_t lserviceGc_apply(lua_State* L, const lserviceGc_tt* pGc)
+{
+    if (pGc->iMode == DEF_LUA_GC_GENERATIONAL) {
+        return lua_gc(L, LUA_GCGEN, pGc->iMinorMul, pGc->iMajorMul);
     }
+    return lua_gc(L, LUA_GCINC, pGc->iPause, pGc->iStepMul, pGc->iStepSize);
 }
 
 static uint32_t lserviceContext_genToken(lserviceContext_tt* pService)
@@ -87,20 +225,29 @@ static uint32_t lserviceContext_genToken(lserviceContext_tt* pService)
 
 static bool lserviceContext_send(lserviceContext_tt* pService, uint32_t uiDestination,
                                  const void* pBuffer, int32_t iLength, uint32_t uiFlag,
-                                 uint32_t uiToken)
+                                 uint32_t uiToken, bool bPriority, bool* pOverload)
 {
     service_tt* pServiceHandle = serviceCenter_gain(uiDestination);
     if (pServiceHandle) {
-        bool bSucc = service_send(pServiceHandle,
-                                  service_getID(pService->pHandle),
-                                  pBuffer,
-                                  iLength,
-                                  DEF_EVENT_MSG | uiFlag,
-                                  uiToken);
+        int32_t iResult = service_post(pServiceHandle,
+                                       service_getID(pService->pHandle),
+                                       pBuffer,
+                                       iLength,
+                                       DEF_EVENT_MSG | uiFlag,
+                                       uiToken,
+                                       bPriority);
+        if (pOverload) {
+            *pOverload = iResult == DEF_SERVICE_SEND_OVERLOAD;
+        }
         service_release(pServiceHandle);
-        return bSucc;
-    }
-    return false;
+        return iResult == DEF_SERVICE_SEND_OK;
+    }
+    return clusterRouter_send(uiDestination,
+                              service_getID(pService->pHandle),
+                              pBuffer,
+                              iLength,
+                              DEF_EVENT_MSG | uiFlag,
+                              uiToken);
 }
 
 static bool lserviceContext_redirect(uint32_t sourceID, uint32_t uiDestinationID,
@@ -113,7 +260,7 @@ static bool lserviceContext_redirect(uint32_t sourceID, uint32_t uiDestinationID
         service_release(pServiceHandle);
         return bSucc;
     }
-    return false;
+    return clusterRouter_send(uiDestinationID, sourceID, pBuffer, nLength, uiFlag, uiToken);
 }
 
 static bool channelSend(uint32_t uiDestination, const void* pBuffer, int32_t iLength,
@@ -132,53 +279,59 @@ static void lserviceContext_localPrint(lserviceContext_tt* pService, const char*
                                        const char* szText, bool bConsole)
 {
     if (pService->pLogFile == NULL) {
-        size_t nLength = strlen(luaConfig_getLogPath());
-        char   tmp[nLength + 16];
+        const char* szBootstrapParam = luaConfig_getBootstrapParam();
+        size_t      nLength          = strlen(luaConfig_getLogPath()) +
+                             (szBootstrapParam ? strlen(szBootstrapParam) : 6);
+        char        tmp[nLength + 16];
         sprintf(tmp,
                 "%s/%s-%08x.log",
                 luaConfig_getLogPath(),
                 luaConfig_getBootstrapParam(),
                 service_getID(pService->pHandle));
-        pService->pLogFile = fopen(tmp, "ab");
+        pService->pLogFile = asyncLog_open(tmp);
     }
 
     ++pService->iLogCount;
     time_t SetTime;
     time(&SetTime);
-    struct tm* pTm;
-    pTm = localtime(&SetTime);
-    pTm->tm_year += 1900;
-    pTm->tm_mon += 1;
+    struct tm tmTime;
+    asyncLog_localTime(SetTime, &tmTime);
+    tmTime.tm_year += 1900;
+    tmTime.tm_mon += 1;
 
+    char    szLine[512];
+    int32_t iLength;
     if (eLevel == NULL || strlen(eLevel) == 0) {
-        fprintf(pService->pLogFile,
-                "[%s %d-%d-%d %d:%d:%d] logCount:[%d] enLogSeverityLevel is null !!!! \n",
-                "FATAL",
-                pTm->tm_year,
-                pTm->tm_mon,
-                pTm->tm_mday,
-                pTm->tm_hour,
-                pTm->tm_min,
-                pTm->tm_sec,
-                pService->iLogCount);
-        fflush(pService->pLogFile);
+        iLength = snprintf(szLine,
+                           sizeof(szLine),
+                           "[%s %d-%d-%d %d:%d:%d] logCount:[%d] enLogSeverityLevel is null !!!! ",
+                           "FATAL",
+                           tmTime.tm_year,
+                           tmTime.tm_mon,
+                           tmTime.tm_mday,
+                           tmTime.tm_hour,
+                           tmTime.tm_min,
+                           tmTime.tm_sec,
+                           pService->iLogCount);
+        asyncLog_write(pService->pLogFile, szLine, (size_t)iLength);
         return;
     }
 
     enLogSeverityLevel ele = (enLogSeverityLevel)atoi(eLevel);
     if (elog_trace > ele || eLog_fatal < ele) {
-        fprintf(pService->pLogFile,
-                "[%s %d-%d-%d %d:%d:%d] logCount:[%d] enLogSeverityLevel error !!!! eLevel:%d\n",
-                "FATAL",
-                pTm->tm_year,
-                pTm->tm_mon,
-                pTm->tm_mday,
-                pTm->tm_hour,
-                pTm->tm_min,
-                pTm->tm_sec,
-                pService->iLogCount,
-                ele);
-        fflush(pService->pLogFile);
+        iLength = snprintf(szLine,
+                           sizeof(szLine),
+                           "[%s %d-%d-%d %d:%d:%d] logCount:[%d] enLogSeverityLevel error !!!! eLevel:%d",
+                           "FATAL",
+                           tmTime.tm_year,
+                           tmTime.tm_mon,
+                           tmTime.tm_mday,
+                           tmTime.tm_hour,
+                           tmTime.tm_min,
+                           tmTime.tm_sec,
+                           pService->iLogCount,
+                           ele);
+        asyncLog_write(pService->pLogFile, szLine, (size_t)iLength);
         return;
     }
 
@@ -186,29 +339,41 @@ static void lserviceContext_localPrint(lserviceContext_tt* pService, const char*
         printf("%s[%s %d-%d-%d %d:%d:%d]%s %s\n",
                logErrorColorArray[ele],
                logErrorStrArray[ele],
-               pTm->tm_year,
-               pTm->tm_mon,
-               pTm->tm_mday,
-               pTm->tm_hour,
-               pTm->tm_min,
-               pTm->tm_sec,
+               tmTime.tm_year,
+               tmTime.tm_mon,
+               tmTime.tm_mday,
+               tmTime.tm_hour,
+               tmTime.tm_min,
+               tmTime.tm_sec,
                NONE,
                szText);
     }
 
-
-    fprintf(pService->pLogFile,
-            "[%s %d-%d-%d %d:%d:%d] logCount:[%d] %s\n",
-            logErrorStrArray[ele],
-            pTm->tm_year,
-            pTm->tm_mon,
-            pTm->tm_mday,
-            pTm->tm_hour,
-            pTm->tm_min,
-            pTm->tm_sec,
-            pService->iLogCount,
-            szText);
-    fflush(pService->pLogFile);
+    // 行头放在栈上拼, 正文过长时才在堆上拼整行
+    iLength = snprintf(szLine,
+                       sizeof(szLine),
+                       "[%s %d-%d-%d %d:%d:%d] logCount:[%d] ",
+                       logErrorStrArray[ele],
+                       tmTime.tm_year,
+                       tmTime.tm_mon,
+                       tmTime.tm_mday,
+                       tmTime.tm_hour,
+                       tmTime.tm_min,
+                       tmTime.tm_sec,
+                       pService->iLogCount);
+    size_t nTextLength = strlen(szText);
+    size_t nLength     = (size_t)iLength + nTextLength;
+    if (nLength <= sizeof(szLine)) {
+        memcpy(szLine + iLength, szText, nTextLength);
+        asyncLog_write(pService->pLogFile, szLine, nLength);
+    }
+    else {
+        char* pLine = mem_malloc(nLength);
+        memcpy(pLine, szLine, (size_t)iLength);
+        memcpy(pLine + iLength, szText, nTextLength);
+        asyncLog_write(pService->pLogFile, pLine, nLength);
+        mem_free(pLine);
+    }
 }
 
 static void llog(lserviceContext_tt* pService, const char* szFmt, ...)
@@ -267,6 +432,179 @@ static void llog(lserviceContext_tt* pService, const char* szFmt, ...)
     }
 }
 
+static const char* s_szDebugAttach = "local dbg = require('frog_debug')\n"
+                                     "dbg.startDebugServer('%s', %d)\n"
+                                     "dbg.addLuaState()\n";
+
+static const char* s_szDebugDetach = "local dbg = package.loaded['frog_debug']\n"
+                                     "if dbg and dbg.removeLuaState then\n"
+                                     "    dbg.removeLuaState()\n"
+                                     "end\n";
+
+static void addLuaState(lua_State* L, const char* debug_ip, const char* debug_port)
+{
+    if (NULL == debug_ip) {
+        return;
+    }
+
+    if (NULL == debug_port) {
+        return;
+    }
+
+    int port = strtol(debug_port, NULL, 10);
+
+    char loadstr[256];
+    snprintf(loadstr, sizeof(loadstr), s_szDebugAttach, debug_ip, port);
+
+    int oldn = lua_gettop(L);
+    if (luaL_dostring(L, loadstr) != LUA_OK) {
+        Log(eLog_error, "[ERROR] addLuaState error!! err:%s", lua_tostring(L, -1));
+    }
+    lua_settop(L, oldn);
+}
+
+static void removeLuaState(lua_State* L)
+{
+    int oldn = lua_gettop(L);
+    if (luaL_dostring(L, s_szDebugDetach) != LUA_OK) {
+        Log(eLog_error, "[ERROR] removeLuaState error!! err:%s", lua_tostring(L, -1));
+    }
+    lua_settop(L, oldn);
+    lua_sethook(L, NULL, 0, 0);
+}
+
+static void lserviceContext_syncDebug(lserviceContext_tt* pService, uint32_t uiGeneration)
+{
+    pService->uiDebugGeneration = uiGeneration;
+    bool bAttach                = (uiGeneration & 1) != 0;
+    if (bAttach == pService->bDebugAttached) {
+        return;
+    }
+    pService->bDebugAttached = bAttach;
+    if (bAttach) {
+        addLuaState(pService->pLuaState, luaConfig_getDebug_ip(), luaConfig_getDebug_port());
+    }
+    else {
+        removeLuaState(pService->pLuaState);
+        // 调试器卸载时清掉了主线程的钩子, 采样中则重新装上
+        if (pService->bSampling) {
+            lua_sethook(
+                pService->pLuaState, lserviceContext_hook, LUA_MASKCOUNT, def_samplerCountStep);
+        }
+    }
+}
+
+// 未挂接调试器时每次回调只多一次原子读
+static inline void lserviceContext_checkDebug(lserviceContext_tt* pService)
+{
+    uint32_t uiGeneration = atomic_load_explicit(&s_uiDebugGeneration, memory_order_acquire);
+    if (_UnLikely(uiGeneration != pService->uiDebugGeneration)) {
+        lserviceContext_syncDebug(pService, uiGeneration);
+    }
+}
+
+bool lserviceDebug_attach(bool bAttach)
+{
+    if (bAttach && (luaConfig_getDebug_ip() == NULL || luaConfig_getDebug_port() == NULL)) {
+        return false;
+    }
+
+    uint32_t uiGeneration = atomic_load(&s_uiDebugGeneration);
+    while (((uiGeneration & 1) != 0) != bAttach) {
+        if (atomic_compare_exchange_weak(&s_uiDebugGeneration, &uiGeneration, uiGeneration + 1)) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool lserviceDebug_isAttached()
+{
+    return (atomic_load(&s_uiDebugGeneration) & 1) != 0;
+}
+
+// 计数钩子只比较节拍, 节拍在本次回调中变化过才记录调用栈; 停止采样后钩子在各协程上自行卸载
+// 慢派发的快照请求也走这个钩子, 由监控线程异步安装, 在服务线程中取栈
+static void lserviceContext_hook(lua_State* L, lua_Debug* pDebug)
+{
+    lserviceContext_tt* pService = s_pRunningContext;
+    if (pService == NULL) {
+        return;
+    }
+    if (_UnLikely(atomic_load_explicit(&pService->uiSlowRequest, memory_order_relaxed) != 0)) {
+        uint32_t uiSlowID = atomic_exchange(&pService->uiSlowRequest, 0);
+        if (uiSlowID != 0) {
+            luaL_traceback(L, L, NULL, 0);
+            serviceMonitor_slowSnapshot(uiSlowID, lua_tostring(L, -1));
+            lua_pop(L, 1);
+        }
+    }
+    if (_UnLikely(pService->pHeapProfiler != NULL) &&
+        lheapProfiler_hasPending(pService->pHeapProfiler)) {
+        lheapProfiler_resolve(pService->pHeapProfiler, L);
+    }
+    if (!pService->bSampling) {
+        lua_sethook(L, NULL, 0, 0);
+        return;
+    }
+    if (lua_gethookcount(L) != def_samplerCountStep) {
+        lua_sethook(L, lserviceContext_hook, LUA_MASKCOUNT, def_samplerCountStep);
+    }
+    uint32_t uiTick = lsampler_getTick();
+    if (uiTick != pService->uiSampleTick) {
+        pService->uiSampleTick = uiTick;
+        lsamplerStacks_record(pService->pSampler, L);
+    }
+}
+
+// 分配器里取调用栈不安全(栈可能正在重新分配), 改为装一个计数为1的钩子, 在下一条指令时定位调用点
+static void lserviceContext_heapSample(lserviceContext_tt* pService)
+{
+    if (s_pRunningContext != pService) {
+        return;
+    }
+    spinLock_lock(&pService->runningLock);
+    if (!pService->bDebugAttached) {
+        lua_sethook(pService->pRunningThread ? pService->pRunningThread : pService->pLuaState,
+                    lserviceContext_hook,
+                    LUA_MASKCOUNT,
+                    1);
+    }
+    spinLock_unlock(&pService->runningLock);
+}
+
+// 挂接调试器时钩子归调试器所有, 不装采样钩子
+static inline void lserviceContext_sampleThread(lserviceContext_tt* pService, lua_State* L)
+{
+    if (!pService->bDebugAttached && lua_gethook(L) != lserviceContext_hook) {
+        lua_sethook(L, lserviceContext_hook, LUA_MASKCOUNT, def_samplerCountStep);
+    }
+}
+
+// 只卸载自己的钩子, 调试器的钩子保持不动
+static inline void lserviceContext_unhookThread(lua_State* L)
+{
+    if (lua_gethook(L) == lserviceContext_hook) {
+        lua_sethook(L, NULL, 0, 0);
+    }
+}
+
+// 派发已结束而钩子还没来得及触发时, 丢弃快照请求, 避免下一次派发取到无关的栈
+static inline void lserviceContext_slowLeave(lserviceContext_tt* pService)
+{
+    if (_UnLikely(atomic_load_explicit(&pService->uiSlowRequest, memory_order_relaxed) != 0)) {
+        atomic_store(&pService->uiSlowRequest, 0);
+    }
+}
+
+// 空闲期间走过的节拍不计入
+static inline void lserviceContext_sampleEnter(lserviceContext_tt* pService)
+{
+    if (pService->bSampling) {
+        pService->uiSampleTick = lsampler_getTick();
+    }
+}
+
 static int32_t lserviceContext_callback(lserviceContext_tt* pService, int32_t iEvent,
                                         uint32_t uiSourceID, uint32_t uiToken, void* pBuffer,
                                         size_t nLength)
@@ -287,7 +625,20 @@ static int32_t lserviceContext_callback(lserviceContext_tt* pService, int32_t iE
     lua_pushlightuserdata(L, pBuffer);
     lua_pushinteger(L, nLength);
 
-    int32_t iRet = lua_pcall(L, 5, 0, 1);
+    // 被追踪的派发额外传入traceID, spanID
+    int32_t                       iArgs  = 5;
+    const serviceTraceContext_tt* pTrace = serviceTrace_current();
+    if (_UnLikely(pTrace->uiTraceID != 0)) {
+        lua_pushinteger(L, (lua_Integer)pTrace->uiTraceID);
+        lua_pushinteger(L, (lua_Integer)pTrace->uiSpanID);
+        iArgs = 7;
+    }
+
+    int32_t iRet = lua_pcall(L, iArgs, 0, 1);
+    // 钩子还没来得及触发的采样归到C调用
+    if (_UnLikely(pService->pHeapProfiler != NULL)) {
+        lheapProfiler_resolve(pService->pHeapProfiler, L);
+    }
     if (iRet == LUA_OK) {
         return 0;
     }
@@ -335,6 +686,9 @@ static bool service_callback(int32_t iType, uint32_t uiSourceID, uint32_t uiToke
     }
     lserviceContext_tt* pService = (lserviceContext_tt*)pUserData;
     ++pService->uiCallbackCount;
+    lserviceContext_checkDebug(pService);
+    lserviceContext_sampleEnter(pService);
+    s_pRunningContext = pService;
     if (pService->bProfile) {
         pService->uiProfileTimer = getThreadClock();
         lserviceContext_callback(pService, iType, uiSourceID, uiToken, pBuffer, nLength);
@@ -344,62 +698,100 @@ static bool service_callback(int32_t iType, uint32_t uiSourceID, uint32_t uiToke
     else {
         lserviceContext_callback(pService, iType, uiSourceID, uiToken, pBuffer, nLength);
     }
+    s_pRunningContext = NULL;
+    lserviceContext_slowLeave(pService);
+    lserviceContext_publishMemory(pService);
     return true;
 }
 
- const char *lua_dofunction = "function frog_addLuaState()\n"
-        "local dbg = require('frog_debug')\n"
-        "dbg.startDebugServer('%s', %d)\n"
-        "dbg.addLuaState()\n"
-        "end"
-        "";
+static void service_batchCallback(const serviceBatchEvent_tt* pEvents, int32_t iCount,
+                                  void* pUserData);
 
-
-static void addLuaState(lua_State* L, const char* debug_ip, const char* debug_port)
+static void lserviceContext_batch(lserviceContext_tt* pService, const serviceBatchEvent_tt* pEvents,
+                                  int32_t iCount)
 {
-    if (NULL == debug_ip) {
-        return;
+    lua_State* L    = pService->pLuaState;
+    int32_t    iTop = lua_gettop(L);
+    if (iTop == 0) {
+        lua_pushcfunction(L, traceback);
+        lua_rawgetp(L, LUA_REGISTRYINDEX, lserviceContext_callback);
     }
-
-    if (NULL == debug_port) {
-        return;
+    else {
+        assert(iTop == 2);
     }
-
-    int port = strtol(debug_port, NULL, 10);
-
-    char loadstr[200];
-    sprintf(loadstr, lua_dofunction, debug_ip, port);
-
-    int oldn   = lua_gettop(L);
-    int status = luaL_dostring(L, loadstr);
-    if (status != 0) {
-        const char* ret = lua_tostring(L, -1);
-        lua_settop(L, oldn);            
-        Log(eLog_error, "[ERROR] addLuaState lua_tostring error!! err:%s", ret);
-        return;
+    lua_rawgetp(L, LUA_REGISTRYINDEX, lserviceContext_batch);
+    lua_rawgetp(L, LUA_REGISTRYINDEX, service_batchCallback);
+    for (int32_t i = 0; i < iCount; ++i) {
+        lua_Integer iBase = (lua_Integer)i * 5;
+        lua_pushinteger(L, pEvents[i].iType);
+        lua_rawseti(L, -2, iBase + 1);
+        lua_pushinteger(L, pEvents[i].uiSourceID);
+        lua_rawseti(L, -2, iBase + 2);
+        lua_pushinteger(L, pEvents[i].uiToken);
+        lua_rawseti(L, -2, iBase + 3);
+        lua_pushlightuserdata(L, pEvents[i].pBuffer);
+        lua_rawseti(L, -2, iBase + 4);
+        lua_pushinteger(L, pEvents[i].nLength);
+        lua_rawseti(L, -2, iBase + 5);
+    }
+    lua_pushinteger(L, iCount);
+
+    int32_t iRet = lua_pcall(L, 2, 0, 1);
+    // 与单条派发一致, 批次结束时把未被钩子处理的采样归到C调用
+    if (_UnLikely(pService->pHeapProfiler != NULL)) {
+        lheapProfiler_resolve(pService->pHeapProfiler, L);
+    }
+    if (iRet != LUA_OK) {
+        llog(pService,
+             "%d$lua batch call [count:%d] to Lua API error : %s",
+             eLog_error,
+             iCount,
+             iRet == LUA_ERRMEM ? "not enough memory" : lua_tostring(L, -1));
+        lua_pop(L, 1);
     }
+}
 
-    lua_getglobal(L, "frog_addLuaState");
-    if (!lua_isfunction(L, -1)) {
-        const char* ret = lua_tostring(L, -1);
-        lua_settop(L, oldn);
-        Log(eLog_error, "[ERROR] addLuaState lua_getglobal addLuaState error!! err:%s", ret);
+static void service_batchCallback(const serviceBatchEvent_tt* pEvents, int32_t iCount,
+                                  void* pUserData)
+{
+    if (pUserData == NULL) {
         return;
     }
-
-    status = lua_pcall(L, 0, 0, 0);
-    if (status != 0) {
-        const char* ret = lua_tostring(L, -1);
-        lua_settop(L, oldn);
-        Log(eLog_error, "[ERROR] addLuaState lua_pcall addLuaState error!! err:%s", ret);
-        return;
+    lserviceContext_tt* pService = (lserviceContext_tt*)pUserData;
+    pService->uiCallbackCount += iCount;
+    lserviceContext_checkDebug(pService);
+    lserviceContext_sampleEnter(pService);
+    s_pRunningContext = pService;
+    if (pService->bProfile) {
+        pService->uiProfileTimer = getThreadClock();
+        lserviceContext_batch(pService, pEvents, iCount);
+        uint64_t uiTimer = getThreadClock() - pService->uiProfileTimer;
+        pService->uiProfileCost += uiTimer;
     }
+    else {
+        lserviceContext_batch(pService, pEvents, iCount);
+    }
+    s_pRunningContext = NULL;
+    lserviceContext_slowLeave(pService);
+    lserviceContext_publishMemory(pService);
 }
 
+static void service_idleCallback(void* pUserData)
+{
+    lserviceContext_tt* pService = (lserviceContext_tt*)pUserData;
+    if (pService->gc.iIdleStep > 0 && pService->pLuaState &&
+        lua_gc(pService->pLuaState, LUA_GCISRUNNING)) {
+        s_pRunningContext = pService;
+        lua_gc(pService->pLuaState, LUA_GCSTEP, pService->gc.iIdleStep);
+        s_pRunningContext = NULL;
+        lserviceContext_publishMemory(pService);
+    }
+}
 
 static bool service_startCallback(void* pUserData)
 {
     lserviceContext_tt* pService = (lserviceContext_tt*)pUserData;
+    lserviceContext_checkDebug(pService);
     if (lua_pcall(pService->pLuaState, 1, 0, 1) != LUA_OK) {
         Log(eLog_error,
             "PANIC: unprotected error in call to Lua API error:%s",
@@ -412,16 +804,57 @@ static bool service_startCallback(void* pUserData)
     return true;
 }
 
+// 在监控线程中调用, 给正在运行的协程装上单步计数钩子, 下一条指令即在服务线程中取栈
+// 挂接调试器时钩子归调试器所有, 只记录慢日志不取栈
+static void service_slowCallback(uint32_t uiSlowID, void* pUserData)
+{
+    lserviceContext_tt* pService = (lserviceContext_tt*)pUserData;
+    spinLock_lock(&pService->runningLock);
+    atomic_store(&pService->uiSlowRequest, uiSlowID);
+    if (!pService->bDebugAttached) {
+        lua_sethook(pService->pRunningThread ? pService->pRunningThread : pService->pLuaState,
+                    lserviceContext_hook,
+                    LUA_MASKCOUNT,
+                    1);
+    }
+    spinLock_unlock(&pService->runningLock);
+}
+
 static void service_stopCallback(void* pUserData)
 {
     lserviceContext_tt* pService = (lserviceContext_tt*)pUserData;
+    service_setSlowCallback(pService->pHandle, NULL);
+    if (pService->bSampling) {
+        pService->bSampling = false;
+        lsampler_release();
+    }
+    if (pService->pSampler) {
+        lsamplerStacks_release(pService->pSampler);
+        pService->pSampler = NULL;
+    }
+    if (pService->pHeapProfiler) {
+        lheapProfiler_release(pService->pHeapProfiler);
+        pService->pHeapProfiler = NULL;
+    }
+
     if (pService->pLogFile) {
-        fclose(pService->pLogFile);
+        asyncLog_close(pService->pLogFile);
         pService->pLogFile = NULL;
     }
 
     if (pService->pLuaState) {
-        lua_close(pService->pLuaState);
+        if (pService->pHeap && memHeap_isOwner(pService->pHeap)) {
+            pService->bClosing = true;
+            luaCache_closeState(pService->pLuaState);
+            memHeap_destroy(pService->pHeap);
+        }
+        else {
+            luaCache_closeState(pService->pLuaState);
+            if (pService->pHeap) {
+                memHeap_release(pService->pHeap);
+            }
+        }
+        pService->pHeap     = NULL;
         pService->pLuaState = NULL;
     }
 
@@ -433,10 +866,8 @@ static void service_stopCallback(void* pUserData)
     mem_free(pService);
 }
 
-uint32_t createLuaService(const char* szName, const char* pParam, size_t nLength)
+struct lserviceContext_s* createLuaServiceContext(const char* szName, const char* szModules)
 {
-    eventIO_tt* pEventIO = getEnvEventIO();
-
     char szLoaderFile[MAX_PATH];
     bzero(szLoaderFile, MAX_PATH);
     const char* szLoaderPath    = luaConfig_getServicePath();
@@ -459,12 +890,26 @@ uint32_t createLuaService(const char* szName, const char* pParam, size_t nLength
     pServiceL->uiProfileCost      = 0;
     pServiceL->uiProfileTimer     = 0;
     pServiceL->uiCallbackCount    = 0;
-
-    lua_State* pLuaState = lua_newstate(lua_custom_alloc, NULL);
+    pServiceL->pHeap              = NULL;
+    pServiceL->bHeap              = false;
+    pServiceL->bClosing           = false;
+    pServiceL->nMemory            = 0;
+    pServiceL->nMemoryPeak        = 0;
+    pServiceL->nMemoryQuota       = 0;
+    pServiceL->uiDebugGeneration  = 0;
+    pServiceL->bDebugAttached     = false;
+    pServiceL->bSampling          = false;
+    pServiceL->uiSampleTick       = 0;
+    pServiceL->pSampler           = NULL;
+    pServiceL->pHeapProfiler      = NULL;
+    pServiceL->pRunningThread     = NULL;
+    spinLock_init(&pServiceL->runningLock);
+    atomic_init(&pServiceL->uiSlowRequest, 0);
+    lserviceGc_init(&pServiceL->gc);
+
+    lua_State* pLuaState = lua_newstate(lua_custom_alloc, pServiceL);
     lua_gc(pLuaState, LUA_GCSTOP, 0);
     pServiceL->pLuaState = pLuaState;
-    pServiceL->pHandle   = createService(pEventIO);
-    service_setCallback(pServiceL->pHandle, service_callback);
 
     // lua_atpanic(pLuaState, &lua_panic);
     luaL_openlibs(pLuaState);
@@ -479,9 +924,6 @@ uint32_t createLuaService(const char* szName, const char* pParam, size_t nLength
     lua_pushlightuserdata(pLuaState, pServiceL);
     lua_setfield(pLuaState, LUA_REGISTRYINDEX, "service_context");
 
-    lua_pushcfunction(pLuaState, traceback);
-    Check(lua_gettop(pLuaState) == 1);
-
     // lua loadcache
     lua_getfield(pLuaState, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
     lua_getglobal(pLuaState, "package");
@@ -496,10 +938,70 @@ uint32_t createLuaService(const char* szName, const char* pParam, size_t nLength
     lua_setfield(pLuaState, -2, "loaders");
     lua_pop(pLuaState, 2);
 
+    while (szModules && *szModules) {
+        const char* szEnd   = strchr(szModules, ';');
+        size_t      nLength = szEnd ? (size_t)(szEnd - szModules) : strlen(szModules);
+        if (nLength > 0) {
+            lua_getglobal(pLuaState, "require");
+            lua_pushlstring(pLuaState, szModules, nLength);
+            if (lua_pcall(pLuaState, 1, 0, 0) != LUA_OK) {
+                Log(eLog_error, "preload module error:%s", lua_tostring(pLuaState, -1));
+                lserviceContext_release(pServiceL);
+                return NULL;
+            }
+        }
+        szModules = szEnd ? szEnd + 1 : NULL;
+    }
+
+    lua_pushcfunction(pLuaState, traceback);
+    Check(lua_gettop(pLuaState) == 1);
+
     if (loadfileCache(pLuaState, szLoaderFile) != LUA_OK) {
         Log(eLog_error, "load bootstrap error:%s", lua_tostring(pLuaState, -1));
-        return 0;
+        lserviceContext_release(pServiceL);
+        return NULL;
+    }
+    return pServiceL;
+}
+
+void lserviceContext_release(struct lserviceContext_s* pServiceL)
+{
+    if (pServiceL->pLuaState) {
+        luaCache_closeState(pServiceL->pLuaState);
+        pServiceL->pLuaState = NULL;
     }
+    mem_free(pServiceL);
+}
+
+uint32_t createLuaService(const char* szName, const char* pParam, size_t nLength,
+                          const lserviceOption_tt* pOption)
+{
+    eventIO_tt* pEventIO = getEnvEventIO();
+
+    lserviceContext_tt* pServiceL = lservicePool_take(szName);
+    if (pServiceL == NULL) {
+        pServiceL = createLuaServiceContext(szName, NULL);
+        if (pServiceL == NULL) {
+            return 0;
+        }
+    }
+
+    // 新建与池化两条路径都在库, 预加载模块和入口chunk加载完成后才设置配额
+    if (pOption) {
+        pServiceL->gc           = pOption->gc;
+        pServiceL->nMemoryQuota = pOption->nMemoryQuota;
+        pServiceL->bHeap =
+            pOption->bHeap && eventIO_getNumberOfConcurrentThreads(pEventIO) == 1;
+    }
+
+    lua_State* pLuaState = pServiceL->pLuaState;
+    lserviceGc_apply(pLuaState, &pServiceL->gc);
+    pServiceL->pHandle = createService(pEventIO);
+    service_setCallback(pServiceL->pHandle, service_callback);
+    service_setIdleCallback(pServiceL->pHandle, service_idleCallback);
+    service_setSlowCallback(pServiceL->pHandle, service_slowCallback);
+    lserviceContext_publishMemory(pServiceL);
+
     if (pParam) {
         lua_pushlstring(pLuaState, pParam, nLength);
     }
@@ -507,22 +1009,31 @@ uint32_t createLuaService(const char* szName, const char* pParam, size_t nLength
         lua_pushnil(pLuaState);
     }
 
-    addLuaState(pLuaState, luaConfig_getDebug_ip(), luaConfig_getDebug_port());
     return service_start(
         pServiceL->pHandle, pServiceL, service_startCallback, service_stopCallback);
 }
 
-static int32_t lservice_context_genToken(lua_State* L)
+// 池中预热时还没有service句柄, 预加载模块只能在加载时取得接口, 不能调用
+static lserviceContext_tt* lserviceContext_upvalue(lua_State* L)
 {
     lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    if (_UnLikely(pService->pHandle == NULL)) {
+        luaL_error(L, "service api is not available while preloading");
+    }
+    return pService;
+}
+
+static int32_t lservice_context_genToken(lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     uint32_t            uiToken  = lserviceContext_genToken(pService);
     lua_pushinteger(L, uiToken);
     return 1;
 }
 
-static int32_t lservice_context_send(lua_State* L)
+static int32_t lservice_context_doSend(lua_State* L, bool bPriority)
 {
-    lserviceContext_tt* pService      = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService      = lserviceContext_upvalue(L);
     int32_t             isNum         = 0;
     uint32_t            uiDestination = (uint32_t)lua_tointegerx(L, 1, &isNum);
     if (isNum == 0) {
@@ -582,8 +1093,20 @@ static int32_t lservice_context_send(lua_State* L)
         }
     }
     else {
-        if (!lserviceContext_send(
-                pService, uiDestination, pBuffer, (int32_t)nLength, uiEvent, uiToken)) {
+        bool bOverload = false;
+        if (!lserviceContext_send(pService,
+                                  uiDestination,
+                                  pBuffer,
+                                  (int32_t)nLength,
+                                  uiEvent,
+                                  uiToken,
+                                  bPriority,
+                                  &bOverload)) {
+            if (bOverload) {
+                lua_pushnil(L);
+                lua_pushliteral(L, "overload");
+                return 2;
+            }
             return 0;
         }
     }
@@ -591,9 +1114,87 @@ static int32_t lservice_context_send(lua_State* L)
     return 1;
 }
 
+static int32_t lservice_context_send(lua_State* L)
+{
+    return lservice_context_doSend(L, false);
+}
+
+static int32_t lservice_context_sendPriority(lua_State* L)
+{
+    return lservice_context_doSend(L, true);
+}
+
+// multicast(ids, event, msg [,sz])
+static int32_t lservice_context_multicast(lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    luaL_checktype(L, 1, LUA_TTABLE);
+    uint32_t uiEvent = (uint32_t)luaL_checkinteger(L, 2);
+
+    const char* pBuffer;
+    size_t      nLength = 0;
+
+    int32_t iMsgInputType = lua_type(L, 3);
+    switch (iMsgInputType) {
+    case LUA_TSTRING:
+    {
+        pBuffer = lua_tolstring(L, 3, &nLength);
+    } break;
+    case LUA_TLIGHTUSERDATA:
+    {
+        pBuffer = (const char*)lua_touserdata(L, 3);
+        nLength = luaL_checkinteger(L, 4);
+    } break;
+    default: luaL_error(L, "invalid param %s", lua_typename(L, lua_type(L, 3)));
+    }
+
+    if (nLength > 0xFFFFFF) {
+        llog(pService,
+             "%d$multicast length > 15M [event:%d source:%x8]",
+             eLog_error,
+             uiEvent,
+             service_getID(pService->pHandle));
+        return 0;
+    }
+
+    int32_t   iCount       = (int32_t)lua_rawlen(L, 1);
+    uint32_t* pServiceIDs  = mem_malloc((iCount > 0 ? iCount : 1) * sizeof(uint32_t));
+    int32_t   iServiceSize = 0;
+    int32_t   iSendCount   = 0;
+    for (int32_t i = 1; i <= iCount; ++i) {
+        lua_rawgeti(L, 1, i);
+        uint32_t uiDestination = (uint32_t)lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        if (uiDestination == 0) {
+            continue;
+        }
+        if (uiDestination & 0x80000000) {
+            if (channelSend(uiDestination, pBuffer, (int32_t)nLength, uiEvent, 0)) {
+                ++iSendCount;
+            }
+        }
+        else {
+            pServiceIDs[iServiceSize++] = uiDestination;
+        }
+    }
+
+    if (iServiceSize > 0) {
+        iSendCount += service_multicast(pServiceIDs,
+                                        iServiceSize,
+                                        service_getID(pService->pHandle),
+                                        pBuffer,
+                                        (int32_t)nLength,
+                                        DEF_EVENT_MSG | uiEvent,
+                                        0);
+    }
+    mem_free(pServiceIDs);
+    lua_pushinteger(L, iSendCount);
+    return 1;
+}
+
 static int32_t lservice_context_command(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
 
     int32_t  isNum         = 0;
     uint32_t uiDestination = (uint32_t)lua_tointegerx(L, 1, &isNum);
@@ -645,8 +1246,20 @@ static int32_t lservice_context_command(lua_State* L)
         return 0;
     }
 
-    if (!lserviceContext_send(
-            pService, uiDestination, pBuffer, nLength, DEF_EVENT_COMMAND, uiToken)) {
+    bool bOverload = false;
+    if (!lserviceContext_send(pService,
+                              uiDestination,
+                              pBuffer,
+                              nLength,
+                              DEF_EVENT_COMMAND,
+                              uiToken,
+                              false,
+                              &bOverload)) {
+        if (bOverload) {
+            lua_pushnil(L);
+            lua_pushliteral(L, "overload");
+            return 2;
+        }
         return 0;
     }
     lua_pushinteger(L, uiToken);
@@ -655,7 +1268,7 @@ static int32_t lservice_context_command(lua_State* L)
 
 static int32_t lservice_context_pong(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
 
     int32_t  isNum         = 0;
     uint32_t uiDestination = (uint32_t)lua_tointegerx(L, 1, &isNum);
@@ -681,7 +1294,8 @@ static int32_t lservice_context_pong(lua_State* L)
         }
     }
     else {
-        if (!lserviceContext_send(pService, uiDestination, NULL, 0, DEF_EVENT_MSG_PONG, uiToken)) {
+        if (!lserviceContext_send(
+                pService, uiDestination, NULL, 0, DEF_EVENT_MSG_PONG, uiToken, false, NULL)) {
             return 0;
         }
     }
@@ -691,7 +1305,7 @@ static int32_t lservice_context_pong(lua_State* L)
 
 static int32_t lservice_context_ping(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
 
     int32_t  isNum         = 0;
     uint32_t uiDestination = (uint32_t)lua_tointegerx(L, 1, &isNum);
@@ -717,7 +1331,8 @@ static int32_t lservice_context_ping(lua_State* L)
         }
     }
     else {
-        if (!lserviceContext_send(pService, uiDestination, NULL, 0, DEF_EVENT_MSG_PING, uiToken)) {
+        if (!lserviceContext_send(
+                pService, uiDestination, NULL, 0, DEF_EVENT_MSG_PING, uiToken, false, NULL)) {
             return 0;
         }
     }
@@ -728,7 +1343,7 @@ static int32_t lservice_context_ping(lua_State* L)
 
 static int32_t lservice_context_sendClose(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
 
     int32_t  isNum         = 0;
     uint32_t uiDestination = (uint32_t)lua_tointegerx(L, 1, &isNum);
@@ -757,7 +1372,8 @@ static int32_t lservice_context_sendClose(lua_State* L)
         }
     }
     else {
-        if (!lserviceContext_send(pService, uiDestination, NULL, 0, DEF_EVENT_MSG_CLOSE, uiToken)) {
+        if (!lserviceContext_send(
+                pService, uiDestination, NULL, 0, DEF_EVENT_MSG_CLOSE, uiToken, false, NULL)) {
             return 0;
         }
     }
@@ -767,7 +1383,7 @@ static int32_t lservice_context_sendClose(lua_State* L)
 
 static int32_t lservice_context_yield(lua_State* L)
 {
-    lserviceContext_tt* pService      = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService      = lserviceContext_upvalue(L);
     uint32_t            uiDestination = service_getID(pService->pHandle);
 
     uint32_t uiToken = lserviceContext_genToken(pService);
@@ -780,7 +1396,7 @@ static int32_t lservice_context_yield(lua_State* L)
 
 static int32_t lservice_context_timeout(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
 
     int32_t iCount = lua_gettop(L);
     if (iCount < 1) {
@@ -806,7 +1422,7 @@ static int32_t lservice_context_timeout(lua_State* L)
 
 static int32_t lservice_context_runAfter(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
 
     int32_t iCount = lua_gettop(L);
     if (iCount < 1) {
@@ -836,7 +1452,7 @@ static int32_t lservice_context_runAfter(lua_State* L)
 
 static int32_t lservice_context_runEvery(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
 
     int32_t iCount = lua_gettop(L);
     if (iCount < 2) {
@@ -861,7 +1477,7 @@ static int32_t lservice_context_runEvery(lua_State* L)
 
 static int32_t lservice_context_self(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     if (pService->pHandle) {
         lua_pushinteger(L, service_getID(pService->pHandle));
         return 1;
@@ -871,7 +1487,7 @@ static int32_t lservice_context_self(lua_State* L)
 
 static int32_t lservice_context_status(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     if (pService->pHandle) {
         lua_pushinteger(L, pService->uiProfileCost / 1000000);
         lua_pushinteger(L, pService->uiCallbackCount);
@@ -882,12 +1498,88 @@ static int32_t lservice_context_status(lua_State* L)
         lua_pushinteger(L, 0);
         lua_pushinteger(L, 0);
     }
-    return 3;
+    lua_pushinteger(L, pService->nMemory);
+    lua_pushinteger(L, pService->nMemoryPeak);
+    lua_pushinteger(L, pService->nMemoryQuota);
+    return 6;
+}
+
+// setMailboxLimit(count, bytes [,policy] [,timeoutMs])
+static int32_t lservice_context_setMailboxLimit(lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    static const char* const policyNames[]  = {"reject", "dropOldest", "dropNewest", "block", NULL};
+    static const int32_t     policyValues[] = {DEF_SERVICE_OVERLOAD_REJECT,
+                                               DEF_SERVICE_OVERLOAD_DROP_OLDEST,
+                                               DEF_SERVICE_OVERLOAD_DROP_NEWEST,
+                                               DEF_SERVICE_OVERLOAD_BLOCK};
+
+    lua_Integer iMaxCount = luaL_checkinteger(L, 1);
+    lua_Integer iMaxBytes = luaL_optinteger(L, 2, 0);
+    int32_t     iPolicy   = luaL_checkoption(L, 3, "reject", policyNames);
+    lua_Integer iTimeout  = luaL_optinteger(L, 4, 0);
+    luaL_argcheck(L, iMaxCount >= 0 && iMaxCount <= 0xffffffff, 1, "invalid count");
+    luaL_argcheck(L, iMaxBytes >= 0, 2, "invalid bytes");
+    luaL_argcheck(L, iTimeout >= 0 && iTimeout <= 0xffffffff, 4, "invalid timeout");
+    if (pService->pHandle) {
+        service_setMailboxLimit(pService->pHandle,
+                                (uint32_t)iMaxCount,
+                                (size_t)iMaxBytes,
+                                policyValues[iPolicy],
+                                (uint32_t)iTimeout);
+    }
+    return 0;
+}
+
+static int32_t lservice_context_setGC(lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    lserviceGc_parse(L, 1, &pService->gc);
+    int32_t iMode = lserviceGc_apply(L, &pService->gc);
+    lua_pushstring(L, iMode == LUA_GCGEN ? "generational" : "incremental");
+    return 1;
+}
+
+// setMemoryQuota(bytes), 0表示不限制
+static int32_t lservice_context_setMemoryQuota(lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    lua_Integer         iQuota   = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, iQuota >= 0, 1, "invalid quota");
+    pService->nMemoryQuota = (size_t)iQuota;
+    return 0;
+}
+
+// setBatchCallback(func(events, count)), events为{type, source, token, msg, length, ...}平铺数组
+// 传nil恢复逐个回调
+static int32_t lservice_context_setBatchCallback(lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    if (lua_isnoneornil(L, 1)) {
+        if (pService->pHandle) {
+            service_setBatchCallback(pService->pHandle, NULL);
+        }
+        lua_pushnil(L);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, lserviceContext_batch);
+        lua_pushnil(L);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, service_batchCallback);
+        return 0;
+    }
+
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+    lua_settop(L, 1);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, lserviceContext_batch);
+    lua_newtable(L);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, service_batchCallback);
+    if (pService->pHandle) {
+        service_setBatchCallback(pService->pHandle, service_batchCallback);
+    }
+    return 0;
 }
 
 static int32_t lservice_context_exit(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     if (pService->pHandle) {
         service_stop(pService->pHandle);
     }
@@ -896,7 +1588,7 @@ static int32_t lservice_context_exit(lua_State* L)
 
 static int32_t lservice_context_bindName(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     if (pService->pHandle == NULL) {
         lua_pushboolean(L, 0);
         return 1;
@@ -921,7 +1613,7 @@ static int32_t lservice_context_bindName(lua_State* L)
 
 static int32_t lservice_context_listenPort(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     if (pService->pHandle == NULL) {
         return 0;
     }
@@ -950,7 +1642,7 @@ static int32_t lservice_context_listenPort(lua_State* L)
 
 static int32_t lservice_context_connect(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     if (pService->pHandle == NULL) {
         return 0;
     }
@@ -984,7 +1676,7 @@ static int32_t lservice_context_connect(lua_State* L)
 
 static int32_t lservice_context_localPrint(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
 
     const char* eLevel   = luaL_checkstring(L, 1);
     const char* s        = luaL_checkstring(L, 2);
@@ -996,7 +1688,7 @@ static int32_t lservice_context_localPrint(lua_State* L)
 
 static int32_t lservice_context_remoteWrite(lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
 
     uint32_t uiDestination = (uint32_t)lua_tointeger(L, 1);
 
@@ -1048,7 +1740,7 @@ static int32_t lservice_context_remoteWrite(lua_State* L)
 
 static int32_t lservice_context_remoteWriteReq(struct lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
 
     uint32_t uiDestination = (uint32_t)lua_tointeger(L, 1);
 
@@ -1103,7 +1795,7 @@ static int32_t lservice_context_remoteWriteReq(struct lua_State* L)
 
 static int32_t lservice_context_remoteBind(struct lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     if (lua_type(L, 1) != LUA_TNUMBER) {
         return 0;
     }
@@ -1132,7 +1824,7 @@ static int32_t lservice_context_remoteBind(struct lua_State* L)
 
 static int32_t lservice_context_dnsResolve(struct lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     if (pService->pHandle == NULL) {
         return 0;
     }
@@ -1167,21 +1859,195 @@ static int32_t lservice_context_dnsResolve(struct lua_State* L)
 
 static int32_t lservice_context_setProfile(struct lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     pService->bProfile           = lua_toboolean(L, 1) ? true : false;
     return 0;
 }
 
+// sampleStart([hz]), 重新开始采样并清空之前的数据, 已在采样时只调整频率
+static int32_t lservice_context_sampleStart(struct lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    int32_t             iHz      = (int32_t)luaL_optinteger(L, 1, DEF_SAMPLER_DEFAULT_HZ);
+    lserviceContext_checkDebug(pService);
+    if (!lsampler_acquire(iHz)) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    if (pService->bSampling) {
+        lsampler_release();
+    }
+    else {
+        if (pService->pSampler) {
+            lsamplerStacks_release(pService->pSampler);
+        }
+        pService->pSampler     = createSamplerStacks();
+        pService->bSampling    = true;
+        pService->uiSampleTick = lsampler_getTick();
+    }
+    lserviceContext_sampleThread(pService, pService->pLuaState);
+    lserviceContext_sampleThread(pService, L);
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+static int32_t lservice_context_sampleStop(struct lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    if (pService->bSampling) {
+        pService->bSampling = false;
+        lsampler_release();
+        lserviceContext_unhookThread(pService->pLuaState);
+        lserviceContext_unhookThread(L);
+    }
+    return 0;
+}
+
+// 协程恢复前调用, 给采样开始前创建的协程补上钩子
+static int32_t lservice_context_sampleThread(struct lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    luaL_checktype(L, 1, LUA_TTHREAD);
+    if (pService->bSampling) {
+        lserviceContext_checkDebug(pService);
+        lserviceContext_sampleThread(pService, lua_tothread(L, 1));
+    }
+    return 0;
+}
+
+// 同coroutine.resume, 额外记录正在运行的协程供慢派发取栈, 返回时恢复追踪上下文
+static int32_t lservice_context_resume(struct lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    lua_State*          co       = lua_tothread(L, 1);
+    luaL_argexpected(L, co, 1, "coroutine");
+    int32_t iArgs = lua_gettop(L) - 1;
+    if (!lua_checkstack(co, iArgs)) {
+        lua_pushboolean(L, 0);
+        lua_pushliteral(L, "too many arguments to resume");
+        return 2;
+    }
+    int32_t iStatus = lua_status(co);
+    if (iStatus == LUA_OK && lua_gettop(co) == 0) {
+        lua_pushboolean(L, 0);
+        lua_pushliteral(L, "cannot resume dead coroutine");
+        return 2;
+    }
+    if (iStatus != LUA_OK && iStatus != LUA_YIELD) {
+        lua_pushboolean(L, 0);
+        lua_pushliteral(L, "cannot resume dead coroutine");
+        return 2;
+    }
+    lua_xmove(L, co, iArgs);
+
+    spinLock_lock(&pService->runningLock);
+    lua_State* pPrevThread    = pService->pRunningThread;
+    pService->pRunningThread = co;
+    spinLock_unlock(&pService->runningLock);
+
+    serviceTraceContext_tt* pTrace   = serviceTrace_current();
+    serviceTraceContext_tt  trace    = *pTrace;
+    int32_t                 iResults = 0;
+    iStatus                          = lua_resume(co, L, iArgs, &iResults);
+    *pTrace                          = trace;
+
+    spinLock_lock(&pService->runningLock);
+    pService->pRunningThread = pPrevThread;
+    spinLock_unlock(&pService->runningLock);
+
+    if (iStatus == LUA_OK || iStatus == LUA_YIELD) {
+        if (!lua_checkstack(L, iResults + 1)) {
+            lua_pop(co, iResults);
+            lua_pushboolean(L, 0);
+            lua_pushliteral(L, "too many results to resume");
+            return 2;
+        }
+        lua_pushboolean(L, 1);
+        lua_xmove(co, L, iResults);
+        return iResults + 1;
+    }
+    lua_pushboolean(L, 0);
+    lua_xmove(co, L, 1);
+    return 2;
+}
+
+// sampleDump([prefix]), 返回折叠栈文本和样本数
+static int32_t lservice_context_sampleDump(struct lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    const char*         szPrefix = luaL_optstring(L, 1, NULL);
+    if (pService->pSampler == NULL) {
+        lua_pushliteral(L, "");
+        lua_pushinteger(L, 0);
+        return 2;
+    }
+    lsamplerStacks_push(pService->pSampler, L, szPrefix);
+    lua_pushinteger(L, (lua_Integer)lsamplerStacks_count(pService->pSampler));
+    return 2;
+}
+
+// heapStart([sampleBytes]), 重新开始堆分析并清空之前的数据, 只统计开始之后的分配
+static int32_t lservice_context_heapStart(struct lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    lua_Integer iSampleBytes = luaL_optinteger(L, 1, DEF_HEAP_PROFILER_DEFAULT_SAMPLE);
+    luaL_argcheck(L, iSampleBytes > 0, 1, "sample bytes must be positive");
+    lheapProfiler_tt* pProfiler = pService->pHeapProfiler;
+    pService->pHeapProfiler     = NULL;
+    if (pProfiler) {
+        lheapProfiler_release(pProfiler);
+    }
+    pService->pHeapProfiler = createHeapProfiler((size_t)iSampleBytes);
+    return 0;
+}
+
+static int32_t lservice_context_heapStop(struct lua_State* L)
+{
+    lserviceContext_tt* pService  = lserviceContext_upvalue(L);
+    lheapProfiler_tt*   pProfiler = pService->pHeapProfiler;
+    pService->pHeapProfiler       = NULL;
+    if (pProfiler) {
+        lheapProfiler_release(pProfiler);
+    }
+    return 0;
+}
+
+static int32_t lservice_context_heapSnapshot(struct lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    if (pService->pHeapProfiler == NULL) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+    lheapProfiler_snapshot(pService->pHeapProfiler);
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// heapDump([diff], [count]), 未开始分析时返回nil
+static int32_t lservice_context_heapDump(struct lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    bool                bDiff    = lua_toboolean(L, 1);
+    int32_t             iCount   = (int32_t)luaL_optinteger(L, 2, 0);
+    if (pService->pHeapProfiler == NULL) {
+        return 0;
+    }
+    lheapProfiler_push(pService->pHeapProfiler, L, bDiff, iCount);
+    return 2;
+}
+
 static int32_t lservice_context_setLog(struct lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     pService->bLog               = lua_toboolean(L, 1) ? true : false;
     return 0;
 }
 
 static int32_t lservice_context_log(struct lua_State* L)
 {
-    lserviceContext_tt* pService = (lserviceContext_tt*)lua_touserdata(L, lua_upvalueindex(1));
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
     if (!pService->bLog) {
         return 0;
     }
@@ -1192,15 +2058,123 @@ static int32_t lservice_context_log(struct lua_State* L)
     return 0;
 }
 
+// 批量派发中单条消息出错时由Lua逐条调用, 与单条派发的错误一样总是记录, 不受setLog控制
+static int32_t lservice_context_logCallbackError(struct lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    lua_Integer         iEvent   = luaL_checkinteger(L, 1);
+    lua_Integer         iSource  = luaL_checkinteger(L, 2);
+    lua_Integer         iToken   = luaL_checkinteger(L, 3);
+    const char*         szError  = luaL_checkstring(L, 4);
+    llog(pService,
+         "%d$lua batch call [type:%d source:%08x token:%d] to Lua API error : %s",
+         eLog_error,
+         (int32_t)iEvent,
+         (uint32_t)iSource,
+         (int32_t)iToken,
+         szError);
+    return 0;
+}
+
+static void lservice_openEventLog(void)
+{
+    const char* szBootstrapParam = luaConfig_getBootstrapParam();
+    size_t      nLength          = strlen(luaConfig_getLogPath()) +
+                         (szBootstrapParam ? strlen(szBootstrapParam) : 6);
+    char        tmp[nLength + 16];
+    sprintf(tmp, "%s/%s-event.log", luaConfig_getLogPath(), szBootstrapParam);
+    s_pEventLogFile = asyncLog_open(tmp);
+    asyncLog_setJson(s_pEventLogFile, luaConfig_isLogEventJson());
+}
+
+static int32_t lservice_logFormat(lua_State* L)
+{
+    const char* szFormat   = luaL_checkstring(L, 1);
+    uint32_t    uiFormatID = asyncLog_registerFormat(szFormat);
+    if (uiFormatID == 0) {
+        return luaL_error(L, "log format table full");
+    }
+    lua_pushinteger(L, uiFormatID);
+    return 1;
+}
+
+// level, formatID, ... 参数按原始值写入缓冲, 不在服务线程拼字符串
+static int32_t lservice_context_logStruct(lua_State* L)
+{
+    lserviceContext_tt* pService = lserviceContext_upvalue(L);
+    if (!pService->bLog) {
+        return 0;
+    }
+
+    int32_t  iLevel     = (int32_t)luaL_checkinteger(L, 1);
+    uint32_t uiFormatID = (uint32_t)luaL_checkinteger(L, 2);
+    int32_t  iCount     = lua_gettop(L) - 2;
+    if (iCount > def_logStructMaxArgs) {
+        iCount = def_logStructMaxArgs;
+    }
+
+    luaL_checkstack(L, iCount, NULL);
+    asyncLogArg_tt args[def_logStructMaxArgs];
+    for (int32_t i = 0; i < iCount; ++i) {
+        int32_t         iIndex = i + 3;
+        asyncLogArg_tt* pArg   = &args[i];
+        switch (lua_type(L, iIndex)) {
+        case LUA_TNIL: pArg->eType = eAsyncLogArg_nil; break;
+        case LUA_TBOOLEAN:
+            pArg->eType  = eAsyncLogArg_bool;
+            pArg->bValue = lua_toboolean(L, iIndex) ? true : false;
+            break;
+        case LUA_TNUMBER:
+            if (lua_isinteger(L, iIndex)) {
+                pArg->eType  = eAsyncLogArg_integer;
+                pArg->iValue = lua_tointeger(L, iIndex);
+            }
+            else {
+                pArg->eType  = eAsyncLogArg_number;
+                pArg->fValue = lua_tonumber(L, iIndex);
+            }
+            break;
+        case LUA_TSTRING:
+            pArg->eType       = eAsyncLogArg_string;
+            pArg->str.szValue = lua_tolstring(L, iIndex, &pArg->str.nLength);
+            break;
+        default:
+            // 其他类型转成字符串, 结果留在栈上直到返回
+            pArg->eType       = eAsyncLogArg_string;
+            pArg->str.szValue = luaL_tolstring(L, iIndex, &pArg->str.nLength);
+            break;
+        }
+    }
+
+    callOnce(&s_eventLogOnceFlag, lservice_openEventLog);
+    asyncLog_writeStruct(
+        s_pEventLogFile, uiFormatID, iLevel, service_getID(pService->pHandle), args, iCount);
+    return 0;
+}
+
 static int32_t lservice_create(lua_State* L)
 {
+    lserviceOption_tt  option;
+    lserviceOption_tt* pOption = NULL;
+    if (!lua_isnoneornil(L, 3)) {
+        lserviceGc_init(&option.gc);
+        lserviceGc_parse(L, 3, &option.gc);
+        lua_getfield(L, 3, "memoryQuota");
+        option.nMemoryQuota = (size_t)luaL_optinteger(L, -1, 0);
+        lua_pop(L, 1);
+        lua_getfield(L, 3, "heap");
+        option.bHeap = lua_toboolean(L, -1) ? true : false;
+        lua_pop(L, 1);
+        pOption = &option;
+    }
+
     if (lua_isnoneornil(L, 2)) {
-        lua_pushinteger(L, createLuaService(lua_tostring(L, 1), NULL, 0));
+        lua_pushinteger(L, createLuaService(lua_tostring(L, 1), NULL, 0, pOption));
     }
     else {
         size_t      nLength = 0;
         const char* pParam  = lua_tolstring(L, 2, &nLength);
-        lua_pushinteger(L, createLuaService(lua_tostring(L, 1), pParam, nLength));
+        lua_pushinteger(L, createLuaService(lua_tostring(L, 1), pParam, nLength, pOption));
     }
     return 1;
 }
@@ -1252,8 +2226,6 @@ int32_t lservice_unbindName(lua_State* L)
         return 1;
     }
 
-    uint32_t uiDestination = 0;
-
     int32_t iType = lua_type(L, 1);
     if (iType != LUA_TSTRING) {
         lua_pushboolean(L, 0);
@@ -1261,24 +2233,7 @@ int32_t lservice_unbindName(lua_State* L)
     }
 
     const char* szDestinationName = lua_tostring(L, 1);
-    if (szDestinationName) {
-        uiDestination = serviceCenter_findServiceID(szDestinationName);
-    }
-    else {
-        uiDestination = 0;
-    }
-
-    if (uiDestination == 0) {
-        lua_pushboolean(L, 0);
-        return 1;
-    }
-
-    if (serviceCenter_unbindName(uiDestination)) {
-        lua_pushboolean(L, 0);
-        return 1;
-    }
-
-    lua_pushboolean(L, 1);
+    lua_pushboolean(L, serviceCenter_unbindServiceName(szDestinationName));
     return 1;
 }
 
@@ -1340,6 +2295,24 @@ static int32_t lservice_getClockRealtime(struct lua_State* L)
     return 1;
 }
 
+// 返回当前线程的traceID, spanID, 未追踪时为0
+static int32_t lservice_trace(struct lua_State* L)
+{
+    const serviceTraceContext_tt* pTrace = serviceTrace_current();
+    lua_pushinteger(L, (lua_Integer)pTrace->uiTraceID);
+    lua_pushinteger(L, (lua_Integer)pTrace->uiSpanID);
+    return 2;
+}
+
+// setTrace(traceID, spanID), 之后发出的消息带上该上下文; resume返回时恢复
+static int32_t lservice_setTrace(struct lua_State* L)
+{
+    serviceTraceContext_tt* pTrace = serviceTrace_current();
+    pTrace->uiTraceID              = (uint64_t)luaL_optinteger(L, 1, 0);
+    pTrace->uiSpanID               = (uint64_t)luaL_optinteger(L, 2, 0);
+    return 0;
+}
+
 static int32_t lservice_redirect(lua_State* L)
 {
     uint32_t uiSourceID = (uint32_t)luaL_checkinteger(L, 1);
@@ -1449,11 +2422,16 @@ int32_t luaopen_lruntime_service(lua_State* L)
                                  {"getClockMonotonic", lservice_getClockMonotonic},
                                  {"getClockRealtime", lservice_getClockRealtime},
                                  {"redirect", lservice_redirect},
+                                 {"trace", lservice_trace},
+                                 {"setTrace", lservice_setTrace},
+                                 {"logFormat", lservice_logFormat},
                                  {NULL, NULL}};
 
     luaL_Reg lualib_service_context[] = {{"yield", lservice_context_yield},
                                          {"command", lservice_context_command},
                                          {"send", lservice_context_send},
+                                         {"sendPriority", lservice_context_sendPriority},
+                                         {"multicast", lservice_context_multicast},
                                          {"pong", lservice_context_pong},
                                          {"ping", lservice_context_ping},
                                          {"sendClose", lservice_context_sendClose},
@@ -1470,10 +2448,25 @@ int32_t luaopen_lruntime_service(lua_State* L)
                                          {"connect", lservice_context_connect},
                                          {"dnsResolve", lservice_context_dnsResolve},
                                          {"setProfile", lservice_context_setProfile},
+                                         {"sampleStart", lservice_context_sampleStart},
+                                         {"sampleStop", lservice_context_sampleStop},
+                                         {"sampleThread", lservice_context_sampleThread},
+                                         {"sampleDump", lservice_context_sampleDump},
+                                         {"heapStart", lservice_context_heapStart},
+                                         {"heapStop", lservice_context_heapStop},
+                                         {"heapSnapshot", lservice_context_heapSnapshot},
+                                         {"heapDump", lservice_context_heapDump},
+                                         {"resume", lservice_context_resume},
                                          {"log", lservice_context_log},
+                                         {"logCallbackError", lservice_context_logCallbackError},
+                                         {"logStruct", lservice_context_logStruct},
                                          {"setLog", lservice_context_setLog},
                                          {"self", lservice_context_self},
                                          {"status", lservice_context_status},
+                                         {"setBatchCallback", lservice_context_setBatchCallback},
+                                         {"setMailboxLimit", lservice_context_setMailboxLimit},
+                                         {"setGC", lservice_context_setGC},
+                                         {"setMemoryQuota", lservice_context_setMemoryQuota},
                                          {"exit", lservice_context_exit},
                                          {NULL, NULL}};
 
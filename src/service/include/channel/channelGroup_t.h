@@ -0,0 +1,36 @@
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "channel/channel_t.h"
+#include "service_t.h"
+
+struct channelGroup_s;
+typedef struct channelGroup_s channelGroup_tt;
+
+frService_API channelGroup_tt* createChannelGroup();
+
+frService_API void channelGroup_addref(channelGroup_tt* pHandle);
+
+frService_API void channelGroup_release(channelGroup_tt* pHandle);
+
+frService_API bool channelGroup_add(channelGroup_tt* pHandle, uint32_t uiChannelID);
+
+frService_API bool channelGroup_remove(channelGroup_tt* pHandle, uint32_t uiChannelID);
+
+frService_API void channelGroup_clear(channelGroup_tt* pHandle);
+
+frService_API int32_t channelGroup_getCount(channelGroup_tt* pHandle);
+
+// 引用计数已归零(正在销毁)时返回false
+frService_API bool channelGroup_tryAddref(channelGroup_tt* pHandle);
+
+// 连接关闭时由频道调用, 把自己从组中移除
+frService_API void channelGroup_removeChannel(channelGroup_tt* pHandle, channel_tt* pChannel);
+
+frService_API int32_t channelGroup_broadcast(channelGroup_tt* pHandle, const char* pBuffer,
+                                             int32_t iLength, uint32_t uiFlag, uint32_t uiToken,
+                                             const uint32_t* pExcludeIDs, int32_t iExcludeCount);
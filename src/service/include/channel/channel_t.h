@@ -10,6 +10,7 @@ struct codecStream_s;
 
 struct eventIO_s;
 struct eventConnection_s;
+struct channelGroup_s;
 
 struct channel_s;
 typedef struct channel_s channel_tt;
@@ -53,8 +54,17 @@ frService_API uint32_t channel_getID(channel_tt* pHandle);
 
 frService_API service_tt* channel_getService(channel_tt* pHandle);
 
+frService_API struct codecStream_s* channel_getCodecStream(channel_tt* pHandle);
+
+frService_API struct eventConnection_s* channel_gainConnection(channel_tt* pHandle);
+
 frService_API int32_t channel_getWritePending(channel_tt* pHandle);
 
 frService_API size_t channel_getWritePendingBytes(channel_tt* pHandle);
 
 frService_API size_t channel_getReceiveBufLength(channel_tt* pHandle);
+
+// 记录频道所在的组(不持有引用), 连接关闭后返回false
+frService_API bool channel_attachGroup(channel_tt* pHandle, struct channelGroup_s* pGroup);
+
+frService_API void channel_detachGroup(channel_tt* pHandle, struct channelGroup_s* pGroup);
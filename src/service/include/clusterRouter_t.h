@@ -0,0 +1,25 @@
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "service_t.h"
+
+struct eventIO_s;
+
+// pAllowIPs非空时只接受来自这些地址的节点连接
+frService_API bool clusterRouter_init(struct eventIO_s* pEventIO, int32_t iServerNodeId,
+                                      const char* szListenAddress, const char* const* pAllowIPs,
+                                      int32_t iAllowCount);
+
+frService_API void clusterRouter_clear();
+
+frService_API bool clusterRouter_addPeer(int32_t iNodeId, const char* szAddress);
+
+frService_API bool clusterRouter_isRemote(uint32_t uiServiceID);
+
+frService_API bool clusterRouter_send(uint32_t uiDestinationID, uint32_t uiSourceID,
+                                      const void* pData, int32_t iLength, uint32_t uiFlag,
+                                      uint32_t uiToken);
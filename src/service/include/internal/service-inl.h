@@ -8,33 +8,76 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "latencyHistogram_t.h"
+#include "metrics_t.h"
 #include "queue_t.h"
 #include "spinLock_t.h"
 #include "thread_t.h"
+#include "time_t.h"
 #include "utility_t.h"
 
 #include "eventIO/eventIO_t.h"
+#include "serviceEvent_t.h"
+#include "serviceTrace_t.h"
+#include "service_t.h"
 
 typedef struct serviceEvent_s
 {
-    void*    node[2];
-    uint32_t uiSourceID;
-    uint32_t uiToken;
-    uint32_t uiLength;
-    char     szStorage[];
+    void*                  node[2];
+    uint32_t               uiSourceID;
+    uint32_t               uiToken;
+    uint32_t               uiLength;
+    uint64_t               uiEnqueueTime;
+    serviceTraceContext_tt trace;
+    char                   szStorage[];
 } serviceEvent_tt;
 
+typedef struct serviceShared_s
+{
+    atomic_int iRefCount;
+    int32_t    iLength;
+    char       szBuffer[];
+} serviceShared_tt;
+
+typedef struct serviceMoveBuf_s
+{
+    void*             pBuffer;
+    serviceShared_tt* pShared;
+} serviceMoveBuf_tt;
+
+static inline void serviceShared_release(serviceShared_tt* pShared)
+{
+    if (atomic_fetch_sub(&pShared->iRefCount, 1) == 1) {
+        mem_free(pShared);
+    }
+}
+
+static inline void serviceEvent_releaseMoveBuf(serviceEvent_tt* pEvent)
+{
+    serviceMoveBuf_tt* pMoveBuf = (serviceMoveBuf_tt*)pEvent->szStorage;
+    if (pMoveBuf->pShared) {
+        serviceShared_release(pMoveBuf->pShared);
+    }
+    else {
+        mem_free(pMoveBuf->pBuffer);
+    }
+}
+
 #define DEF_USE_SPINLOCK
 
 struct service_s
 {
     void (*fnStop)(void*);
+    void (*fnIdle)(void*);
+    void (*fnBatch)(const serviceBatchEvent_tt*, int32_t, void*);
+    void (*fnSlow)(uint32_t, void*);
     bool (*fnCallback)(int32_t, uint32_t, uint32_t, void*, size_t, void*);
     void*            pUserData;
     eventIO_tt*      pEventIO;
     eventWatcher_tt* pEventWatcher;
     uint32_t         uiServiceID;
     QUEUE            queuePending;
+    QUEUE            queuePriority;
 #ifdef DEF_USE_SPINLOCK
     spinLock_tt spinLock;
 #else
@@ -42,7 +85,20 @@ struct service_s
 #endif
     atomic_bool bRunning;
     atomic_int  iRefCount;
-    atomic_uint uiQueueSize;
+    atomic_uint   uiQueueSize;
+    atomic_size_t nQueueBytes;
+    atomic_size_t nMemory;
+    atomic_size_t nMemoryPeak;
+    atomic_uint   uiMailboxLimit;
+    atomic_size_t nMailboxByteLimit;
+    atomic_int    iOverloadPolicy;
+    atomic_uint   uiBlockTimeoutMs;
+    atomic_ullong uiProcessed;
+    atomic_ullong uiBusyNs;
+    atomic_ullong uiSendBytes;
+    atomic_ullong uiRecvBytes;
+    latencyHistogram_tt queueLatency;
+    metricsCounter_tt*  pMetricsMessages;
 };
 
 __UNUSED void service_waitFor();
@@ -51,6 +107,20 @@ __UNUSED void service_wakeUp();
 
 __UNUSED int32_t service_waitForCount();
 
+__UNUSED int32_t service_overload(struct service_s* pService, serviceEvent_tt* pEvent);
+
+__UNUSED void service_slow(struct service_s* pService, uint32_t uiSlowID);
+
+__UNUSED bool serviceTrace_sample();
+
+// 单调时钟, 纳秒
+static inline uint64_t service_clockNs()
+{
+    timespec_tt ts;
+    getClockMonotonic(&ts);
+    return (uint64_t)timespec_toNsec(&ts);
+}
+
 static inline void service_notify(struct service_s* pService)
 {
     if (eventWatcher_notify(pService->pEventWatcher)) {
@@ -58,24 +128,97 @@ static inline void service_notify(struct service_s* pService)
     }
 }
 
-static inline bool service_enqueue(struct service_s* pService, serviceEvent_tt* pEvent)
+static inline bool serviceEvent_isPriority(serviceEvent_tt* pEvent)
+{
+    uint32_t uiEvent = pEvent->uiLength >> 24;
+    switch (uiEvent & DEF_EVENT_MASK) {
+    case DEF_EVENT_RUN_AFTER:
+    case DEF_EVENT_RUN_EVERY: return true;
+    case DEF_EVENT_MSG:
+    {
+        switch (uiEvent & DEF_EVENT_MSG_MASK) {
+        case DEF_EVENT_MSG_REPLY:
+        case DEF_EVENT_MSG_PING:
+        case DEF_EVENT_MSG_PONG:
+        case DEF_EVENT_MSG_CLOSE: return true;
+        }
+    } break;
+    }
+    return false;
+}
+
+// 只有服务间消息受邮箱上限约束, 连接/定时器等事件不可丢弃
+static inline bool serviceEvent_isBounded(serviceEvent_tt* pEvent)
+{
+    uint32_t uiType = (pEvent->uiLength >> 24) & DEF_EVENT_MASK;
+    return uiType == DEF_EVENT_MSG || uiType == DEF_EVENT_COMMAND;
+}
+
+// 由连接收到的数据消息, 来源为通道ID
+static inline bool serviceEvent_isIngress(serviceEvent_tt* pEvent)
+{
+    uint32_t uiType = (pEvent->uiLength >> 24) & DEF_EVENT_MASK;
+    return (pEvent->uiSourceID & 0x80000000) &&
+           (uiType == DEF_EVENT_BINARY || uiType == DEF_EVENT_MSG);
+}
+
+static inline bool service_isFull(struct service_s* pService, size_t nLength)
+{
+    uint32_t uiLimit = atomic_load_explicit(&pService->uiMailboxLimit, memory_order_relaxed);
+    if (uiLimit != 0 &&
+        atomic_load_explicit(&pService->uiQueueSize, memory_order_relaxed) >= uiLimit) {
+        return true;
+    }
+    size_t nByteLimit = atomic_load_explicit(&pService->nMailboxByteLimit, memory_order_relaxed);
+    return nByteLimit != 0 &&
+           atomic_load_explicit(&pService->nQueueBytes, memory_order_relaxed) + nLength >
+               nByteLimit;
+}
+
+// 返回DEF_SERVICE_SEND_*, 失败时事件已释放
+static inline int32_t service_enqueueLane(struct service_s* pService, serviceEvent_tt* pEvent,
+                                          bool bPriority)
 {
     if (atomic_load(&pService->bRunning)) {
+        if (serviceEvent_isBounded(pEvent)) {
+            size_t nLength = pEvent->uiLength & 0xFFFFFF;
+            if (!bPriority && service_isFull(pService, nLength)) {
+                int32_t iResult = service_overload(pService, pEvent);
+                if (iResult != 0) {
+                    return iResult > 0 ? DEF_SERVICE_SEND_OK : DEF_SERVICE_SEND_OVERLOAD;
+                }
+            }
+            atomic_fetch_add_explicit(&pService->nQueueBytes, nLength, memory_order_relaxed);
+        }
         atomic_fetch_add(&pService->uiQueueSize, 1);
+        metricsCounter_inc(pService->pMetricsMessages);
+        pEvent->uiEnqueueTime = service_clockNs();
+        pEvent->trace         = *serviceTrace_current();
 #ifdef DEF_USE_SPINLOCK
         spinLock_lock(&pService->spinLock);
 #else
         mutex_lock(&pService->mutex);
 #endif
-        QUEUE_INSERT_TAIL(&pService->queuePending, &pEvent->node);
+        if (bPriority) {
+            QUEUE_INSERT_TAIL(&pService->queuePriority, &pEvent->node);
+        }
+        else {
+            QUEUE_INSERT_TAIL(&pService->queuePending, &pEvent->node);
+        }
 #ifdef DEF_USE_SPINLOCK
         spinLock_unlock(&pService->spinLock);
 #else
         mutex_unlock(&pService->mutex);
 #endif
         service_notify(pService);
-        return true;
+        return DEF_SERVICE_SEND_OK;
     }
     mem_free(pEvent);
-    return false;
-}
\ No newline at end of file
+    return DEF_SERVICE_SEND_STOPPED;
+}
+
+static inline bool service_enqueue(struct service_s* pService, serviceEvent_tt* pEvent)
+{
+    return service_enqueueLane(pService, pEvent, serviceEvent_isPriority(pEvent)) ==
+           DEF_SERVICE_SEND_OK;
+}
@@ -7,10 +7,17 @@
 
 #include "service_t.h"
 
+// 服务ID: bit31保留给非服务ID, bit23-30节点, bit17-22代数, bit0-16槽位下标+1
+#define DEF_SERVICE_NODE_SHIFT 23
+#define DEF_SERVICE_NODE_COUNT 0x100
+#define DEF_SERVICE_NODE_ID(uiServiceID) \
+    ((int32_t)(((uiServiceID) >> DEF_SERVICE_NODE_SHIFT) & (DEF_SERVICE_NODE_COUNT - 1)))
+
 frService_API void serviceCenter_init(int32_t iServerNodeId);
 
 frService_API void serviceCenter_clear();
 
+// 单节点最多同时注册131071个服务, 满时返回0
 frService_API uint32_t serviceCenter_register(struct service_s* pHandle);
 
 frService_API bool serviceCenter_deregister(uint32_t uiServiceID);
@@ -19,6 +26,32 @@ frService_API bool serviceCenter_bindName(uint32_t uiServiceID, const char* szNa
 
 frService_API bool serviceCenter_unbindName(uint32_t uiServiceID);
 
+frService_API bool serviceCenter_unbindServiceName(const char* szName);
+
 frService_API uint32_t serviceCenter_findServiceID(const char* szName);
 
+frService_API int32_t serviceCenter_findServiceIDs(const char* const* pNames, int32_t iCount,
+                                                   uint32_t* pServiceIDs);
+
 frService_API service_tt* serviceCenter_gain(uint32_t uiServiceID);
+
+// 读锁内遍历本节点所有服务
+frService_API void serviceCenter_foreachService(void (*fnService)(service_tt* pService,
+                                                                  void*       pUserData),
+                                                void* pUserData);
+
+// 回调在写锁内执行, 回调中不可再调用serviceCenter
+frService_API void serviceCenter_setNameCallback(void (*fnNameCallback)(uint32_t    uiServiceID,
+                                                                        const char* szName,
+                                                                        bool        bBind));
+
+// 遍历本节点的名字, fnDone非空时在释放读锁前调用, 期间不会有名字变更
+frService_API void serviceCenter_foreachName(void (*fnName)(uint32_t    uiServiceID,
+                                                            const char* szName, void* pUserData),
+                                             void (*fnDone)(void* pUserData), void* pUserData);
+
+frService_API bool serviceCenter_bindRemoteName(uint32_t uiServiceID, const char* szName);
+
+frService_API bool serviceCenter_unbindRemoteName(uint32_t uiServiceID, const char* szName);
+
+frService_API void serviceCenter_clearRemoteNames(int32_t iNodeId);
@@ -13,13 +13,32 @@ frService_API void serviceMonitor_init(uint32_t uiNumberOfConcurrentThreads);
 
 frService_API void serviceMonitor_clear();
 
+// uiSlowBudgetMs: 单次派发的时间预算, 超出后记录慢日志并请求该服务的调用栈快照, 为0关闭
 frService_API bool serviceMonitor_start(uint32_t uiMonitorID, struct eventIO_s* pEventIO,
-                                        uint32_t uiIntervalMs);
+                                        uint32_t uiIntervalMs, uint32_t uiSlowBudgetMs);
 
 frService_API void serviceMonitor_stop();
 
-frService_API int32_t serviceMonitor_enter(uint32_t uiSourceID, uint32_t uiDestinationID);
+frService_API int32_t serviceMonitor_enter(uint32_t uiSourceID, uint32_t uiDestinationID,
+                                           int32_t iEvent);
 
 frService_API void serviceMonitor_leave(int32_t iIndex);
 
 frService_API int32_t serviceMonitor_waitForCount();
+
+typedef struct serviceSlowLog_s
+{
+    uint64_t    uiTime; // 系统时间, 毫秒
+    uint32_t    uiServiceID;
+    uint32_t    uiSourceID;
+    int32_t     iEvent;
+    uint32_t    uiElapsedMs;
+    const char* szStack; // 服务尚未响应快照请求时为NULL
+} serviceSlowLog_tt;
+
+// 在服务线程中调用, 提交uiSlowID对应的调用栈
+frService_API void serviceMonitor_slowSnapshot(uint32_t uiSlowID, const char* szStack);
+
+// 由旧到新遍历最近的慢派发记录, 回调在锁内执行
+frService_API void serviceMonitor_foreachSlowLog(void (*fn)(const serviceSlowLog_tt*, void*),
+                                                 void* pUserData);
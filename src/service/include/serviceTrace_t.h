@@ -0,0 +1,48 @@
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "service_t.h"
+
+// 追踪上下文随服务事件传递, uiTraceID为0表示未被采样
+typedef struct serviceTraceContext_s
+{
+    uint64_t uiTraceID;
+    uint64_t uiSpanID;
+} serviceTraceContext_tt;
+
+// 一次被追踪的派发
+typedef struct serviceSpan_s
+{
+    uint64_t uiTraceID;
+    uint64_t uiSpanID;
+    uint64_t uiParentID;
+    uint64_t uiStartUs; // 系统时间, 微秒
+    uint32_t uiQueueUs; // 邮箱中的等待时间
+    uint32_t uiDurationUs;
+    uint32_t uiServiceID;
+    uint32_t uiSourceID;
+    int32_t  iEvent;
+} serviceSpan_tt;
+
+frService_API void serviceTrace_init(uint32_t uiCapacity);
+
+frService_API void serviceTrace_clear();
+
+// 外部连接进来的消息按该比例开始新的追踪, 单位百万分之一, 为0关闭
+frService_API void serviceTrace_setSampleRate(uint32_t uiPerMillion);
+
+frService_API uint32_t serviceTrace_getSampleRate();
+
+// 当前线程的追踪上下文, 投递事件时写入事件, 派发时由事件恢复
+frService_API serviceTraceContext_tt* serviceTrace_current();
+
+frService_API uint64_t serviceTrace_newID();
+
+frService_API void serviceTrace_record(const serviceSpan_tt* pSpan);
+
+// 以JSON lines追加写入文件并清空缓冲, 返回写入的条数, 失败返回-1
+frService_API int32_t serviceTrace_export(const char* szFileName);
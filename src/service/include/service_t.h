@@ -23,7 +23,17 @@
 #    endif
 #endif
 
+#define DEF_SERVICE_OVERLOAD_REJECT 0
+#define DEF_SERVICE_OVERLOAD_DROP_OLDEST 1
+#define DEF_SERVICE_OVERLOAD_DROP_NEWEST 2
+#define DEF_SERVICE_OVERLOAD_BLOCK 3
+
+#define DEF_SERVICE_SEND_OK 0
+#define DEF_SERVICE_SEND_STOPPED 1
+#define DEF_SERVICE_SEND_OVERLOAD 2
+
 struct eventIO_s;
+struct latencyHistogram_s;
 
 struct service_s;
 struct connector_s;
@@ -42,6 +52,27 @@ frService_API service_tt* createService(struct eventIO_s* pEventIO);
 frService_API void service_setCallback(service_tt* pService, bool (*fn)(int32_t, uint32_t, uint32_t,
                                                                         void*, size_t, void*));
 
+// 邮箱处理空后在服务线程中调用
+frService_API void service_setIdleCallback(service_tt* pService, void (*fn)(void*));
+
+// 派发超出监控的时间预算时在监控线程中调用, 参数为慢日志ID; 回调内只能做线程安全的操作
+frService_API void service_setSlowCallback(service_tt* pService, void (*fn)(uint32_t, void*));
+
+typedef struct serviceBatchEvent_s
+{
+    int32_t  iType;
+    uint32_t uiSourceID;
+    uint32_t uiToken;
+    void*    pBuffer;
+    size_t   nLength;
+} serviceBatchEvent_tt;
+
+// 设置后消息类事件攒批后一次回调, pBuffer只在回调期间有效;
+// accept/connect/定时器/停止事件仍逐个走fnCallback, 并会先冲掉已攒的批次以保证顺序
+frService_API void service_setBatchCallback(service_tt* pService,
+                                            void (*fn)(const serviceBatchEvent_tt*, int32_t,
+                                                       void*));
+
 frService_API void service_addref(service_tt* pService);
 
 frService_API void service_release(service_tt* pService);
@@ -57,8 +88,54 @@ frService_API bool service_sendMove(service_tt* pService, uint32_t uiSourceID, v
 frService_API bool service_send(service_tt* pService, uint32_t uiSourceID, const void* pData,
                                 int32_t iLength, uint32_t uiFlag, uint32_t uiToken);
 
+frService_API bool service_sendPriority(service_tt* pService, uint32_t uiSourceID,
+                                        const void* pData, int32_t iLength, uint32_t uiFlag,
+                                        uint32_t uiToken);
+
+// 同service_send/service_sendPriority, 返回DEF_SERVICE_SEND_*以区分失败原因
+frService_API int32_t service_post(service_tt* pService, uint32_t uiSourceID, const void* pData,
+                                   int32_t iLength, uint32_t uiFlag, uint32_t uiToken,
+                                   bool bPriority);
+
+frService_API int32_t service_multicast(const uint32_t* pServiceIDs, int32_t iCount,
+                                        uint32_t uiSourceID, const void* pData, int32_t iLength,
+                                        uint32_t uiFlag, uint32_t uiToken);
+
 frService_API uint32_t service_queueSize(service_tt* pService);
 
+frService_API size_t service_queueBytes(service_tt* pService);
+
+// uiMaxCount/nMaxBytes 为0表示不限制, 只约束普通通道的服务间消息
+frService_API void service_setMailboxLimit(service_tt* pService, uint32_t uiMaxCount,
+                                           size_t nMaxBytes, int32_t iPolicy,
+                                           uint32_t uiBlockTimeoutMs);
+
+frService_API bool service_isOverload(service_tt* pService);
+
+// 由服务自身的分配器上报, 供监控读取
+frService_API void service_setMemoryUsage(service_tt* pService, size_t nMemory, size_t nMemoryPeak);
+
+frService_API size_t service_getMemoryUsage(service_tt* pService, size_t* pMemoryPeak);
+
+typedef struct serviceStats_s
+{
+    uint64_t uiProcessed; // 已派发的事件数
+    uint64_t uiBusyNs;    // 服务线程处理邮箱的累计时间
+    uint64_t uiSendBytes; // 所属通道的收发字节数
+    uint64_t uiRecvBytes;
+    uint32_t uiQueueSize;
+    size_t   nMemory;
+} serviceStats_tt;
+
+// 只读计数器, 不打断服务的运行
+frService_API void service_getStats(service_tt* pService, serviceStats_tt* pStats);
+
+frService_API void service_addTraffic(service_tt* pService, size_t nSendBytes, size_t nRecvBytes);
+
+// 入队到开始分发的等待时间(微秒)直方图, 累加到调用方的pHistogram中
+frService_API void service_mergeQueueLatency(service_tt*                pService,
+                                             struct latencyHistogram_s* pHistogram);
+
 frService_API uint32_t service_getID(service_tt* pService);
 
 frService_API struct eventIO_s* service_getEventIO(service_tt* pService);
@@ -17,6 +17,8 @@ typedef struct codecStream_s
                        uint32_t);
     int32_t (*fnWriteMove)(struct codecStream_s*, eventConnection_tt*, ioBufVec_tt*, int32_t,
                            uint32_t, uint32_t);
+    eventBufShared_tt* (*fnEncodeShared)(struct codecStream_s*, const char*, int32_t, uint32_t,
+                                         uint32_t);
     bool (*fnReceive)(struct codecStream_s*, struct channel_s*, byteQueue_tt*);
     void (*fnAddref)(struct codecStream_s*);
     void (*fnRelease)(struct codecStream_s*);
@@ -3,6 +3,7 @@
 #include "channel/channelCenter_t.h"
 
 #include "channel/channel_t.h"
+#include "hazardPointer_t.h"
 #include "rwSpinLock_t.h"
 #include "thread_t.h"
 #include "utility_t.h"
@@ -13,11 +14,19 @@
 #define DEF_USE_SPINLOCK
 
 #define def_channelHandleMask 0xfffff
+#define def_channelHandleCapacity 0xfffff
+#define def_channelGenerationMask 0x7ff
+#define def_channelPageShift 10
+#define def_channelPageSize (1 << def_channelPageShift)
+#define def_channelPageMask (def_channelPageSize - 1)
+#define def_channelPageCount ((def_channelHandleCapacity >> def_channelPageShift) + 1)
 
-static inline size_t Min(const size_t a, const size_t b)
+typedef struct channelHandleSlot_s
 {
-    return a < b ? a : b;
-}
+    void* _Atomic pChannelHandle;
+    uint32_t      uiGeneration;
+    int32_t       iNextFreeIndex;
+} channelHandleSlot_tt;
 
 typedef struct channelCenter_s
 {
@@ -26,15 +35,73 @@ typedef struct channelCenter_s
 #else
     rwlock_tt rwlock;
 #endif
-    channel_tt** ppChannelHandleSlot;
-    int32_t      iSequence;
-    int32_t      iChannelHandleSlotCapacity;
-    int32_t*     pChannelHandleSlotIndex;
-    int32_t      iChannelHandleSlotIndexCount;
+    channelHandleSlot_tt* _Atomic* ppChannelHandlePage;
+    int32_t                        iChannelHandleSlotCapacity;
+    int32_t                        iChannelHandleCount;
+    int32_t                        iFreeHeadIndex;
+    int32_t                        iFreeTailIndex;
+    hazardPointer_tt*              pHazardPointer;
 } channelCenter_tt;
 
 static channelCenter_tt* s_pChannelCenter = NULL;
 
+static void channelCenter_reclaim(void* pData)
+{
+    channel_release((channel_tt*)pData);
+}
+
+static inline channelHandleSlot_tt* channelCenter_getSlot(channelCenter_tt* pChannelCenter,
+                                                          int32_t           iIndex)
+{
+    channelHandleSlot_tt* pPage = atomic_load_explicit(
+        &pChannelCenter->ppChannelHandlePage[iIndex >> def_channelPageShift], memory_order_acquire);
+    if (pPage == NULL) {
+        return NULL;
+    }
+    return &pPage[iIndex & def_channelPageMask];
+}
+
+static inline void channelCenter_pushFree(channelCenter_tt* pChannelCenter, int32_t iIndex)
+{
+    channelCenter_getSlot(pChannelCenter, iIndex)->iNextFreeIndex = -1;
+    if (pChannelCenter->iFreeTailIndex == -1) {
+        pChannelCenter->iFreeHeadIndex = iIndex;
+    }
+    else {
+        channelCenter_getSlot(pChannelCenter, pChannelCenter->iFreeTailIndex)->iNextFreeIndex =
+            iIndex;
+    }
+    pChannelCenter->iFreeTailIndex = iIndex;
+}
+
+static bool channelCenter_grow(channelCenter_tt* pChannelCenter)
+{
+    int32_t iFirstIndex = pChannelCenter->iChannelHandleSlotCapacity;
+    if (iFirstIndex >= def_channelHandleCapacity) {
+        return false;
+    }
+
+    channelHandleSlot_tt* pPage = mem_malloc(def_channelPageSize * sizeof(channelHandleSlot_tt));
+    for (int32_t i = 0; i < def_channelPageSize; ++i) {
+        atomic_init(&pPage[i].pChannelHandle, NULL);
+        pPage[i].uiGeneration   = 1;
+        pPage[i].iNextFreeIndex = -1;
+    }
+    atomic_store_explicit(&pChannelCenter->ppChannelHandlePage[iFirstIndex >> def_channelPageShift],
+                          pPage,
+                          memory_order_release);
+
+    int32_t iLastIndex = iFirstIndex + def_channelPageSize;
+    if (iLastIndex > def_channelHandleCapacity) {
+        iLastIndex = def_channelHandleCapacity;
+    }
+    for (int32_t i = iFirstIndex; i < iLastIndex; ++i) {
+        channelCenter_pushFree(pChannelCenter, i);
+    }
+    pChannelCenter->iChannelHandleSlotCapacity = iLastIndex;
+    return true;
+}
+
 void channelCenter_init()
 {
     if (s_pChannelCenter == NULL) {
@@ -44,20 +111,17 @@ void channelCenter_init()
 #else
         rwlock_init(&pChannelCenter->rwlock);
 #endif
-        pChannelCenter->iSequence                  = 1;
-        pChannelCenter->iChannelHandleSlotCapacity = 64;
-        pChannelCenter->ppChannelHandleSlot =
-            mem_malloc(pChannelCenter->iChannelHandleSlotCapacity * sizeof(channel_tt*));
-        bzero(pChannelCenter->ppChannelHandleSlot,
-              pChannelCenter->iChannelHandleSlotCapacity * sizeof(channel_tt*));
-
-        pChannelCenter->iChannelHandleSlotIndexCount = pChannelCenter->iChannelHandleSlotCapacity;
-        pChannelCenter->pChannelHandleSlotIndex =
-            mem_malloc(pChannelCenter->iChannelHandleSlotIndexCount * sizeof(int32_t));
-        for (int32_t i = 0; i < pChannelCenter->iChannelHandleSlotIndexCount; ++i) {
-            pChannelCenter->pChannelHandleSlotIndex[i] =
-                pChannelCenter->iChannelHandleSlotCapacity - i - 1;
+        pChannelCenter->ppChannelHandlePage =
+            mem_malloc(def_channelPageCount * sizeof(channelHandleSlot_tt*));
+        for (int32_t i = 0; i < def_channelPageCount; ++i) {
+            atomic_init(&pChannelCenter->ppChannelHandlePage[i], NULL);
         }
+        pChannelCenter->iChannelHandleSlotCapacity = 0;
+        pChannelCenter->iChannelHandleCount        = 0;
+        pChannelCenter->iFreeHeadIndex             = -1;
+        pChannelCenter->iFreeTailIndex             = -1;
+        pChannelCenter->pHazardPointer             = createHazardPointer(channelCenter_reclaim);
+        channelCenter_grow(pChannelCenter);
 
         s_pChannelCenter = pChannelCenter;
     }
@@ -69,21 +133,22 @@ void channelCenter_clear()
         channelCenter_tt* pChannelCenter = s_pChannelCenter;
         s_pChannelCenter                 = NULL;
 
-        if (pChannelCenter->ppChannelHandleSlot) {
-            for (int32_t i = 0; i < pChannelCenter->iChannelHandleSlotCapacity; ++i) {
-                if (pChannelCenter->ppChannelHandleSlot[i] != NULL) {
-                    channelCenter_deregister(channel_getID(pChannelCenter->ppChannelHandleSlot[i]));
+        for (int32_t i = 0; i < def_channelPageCount; ++i) {
+            channelHandleSlot_tt* pPage = atomic_load(&pChannelCenter->ppChannelHandlePage[i]);
+            if (pPage) {
+                for (int32_t j = 0; j < def_channelPageSize; ++j) {
+                    channel_tt* pChannelHandle = atomic_load(&pPage[j].pChannelHandle);
+                    if (pChannelHandle != NULL) {
+                        channel_release(pChannelHandle);
+                    }
                 }
+                mem_free(pPage);
             }
-            mem_free(pChannelCenter->ppChannelHandleSlot);
-            pChannelCenter->ppChannelHandleSlot = NULL;
-        }
-
-        if (pChannelCenter->pChannelHandleSlotIndex) {
-            mem_free(pChannelCenter->pChannelHandleSlotIndex);
-            pChannelCenter->pChannelHandleSlotIndex = NULL;
         }
+        mem_free(pChannelCenter->ppChannelHandlePage);
+        pChannelCenter->ppChannelHandlePage = NULL;
 
+        hazardPointer_release(pChannelCenter->pHazardPointer);
 #ifndef DEF_USE_SPINLOCK
         rwlock_destroy(&pChannelCenter->rwlock);
 #endif
@@ -100,54 +165,32 @@ uint32_t channelCenter_register(struct channel_s* pHandle)
 #else
         rwlock_wrlock(&pChannelCenter->rwlock);
 #endif
-        if (pChannelCenter->iChannelHandleSlotIndexCount == 0) {
-            if (pChannelCenter->iChannelHandleSlotCapacity == 0xfffff) {
+        if (pChannelCenter->iFreeHeadIndex == -1 && !channelCenter_grow(pChannelCenter)) {
 #ifdef DEF_USE_SPINLOCK
-                rwSpinLock_wrunlock(&pChannelCenter->rwlock);
+            rwSpinLock_wrunlock(&pChannelCenter->rwlock);
 #else
-                rwlock_wrunlock(&pChannelCenter->rwlock);
+            rwlock_wrunlock(&pChannelCenter->rwlock);
 #endif
-                return 0;
-            }
-
-            int32_t iOldChannelHandleSlotCapacity = pChannelCenter->iChannelHandleSlotCapacity;
-            pChannelCenter->iChannelHandleSlotCapacity =
-                (int32_t)Min(iOldChannelHandleSlotCapacity * 2, 0xfffff);
-            int32_t iAddChannelHandleSlotCount =
-                pChannelCenter->iChannelHandleSlotCapacity - iOldChannelHandleSlotCapacity;
-            pChannelCenter->ppChannelHandleSlot =
-                mem_realloc(pChannelCenter->ppChannelHandleSlot,
-                            pChannelCenter->iChannelHandleSlotCapacity * sizeof(channel_tt*));
-            bzero(pChannelCenter->ppChannelHandleSlot + iOldChannelHandleSlotCapacity,
-                  iAddChannelHandleSlotCount * sizeof(channel_tt*));
-
-            mem_free(pChannelCenter->pChannelHandleSlotIndex);
-            pChannelCenter->pChannelHandleSlotIndex =
-                mem_malloc(pChannelCenter->iChannelHandleSlotCapacity * sizeof(int32_t));
-            pChannelCenter->iChannelHandleSlotIndexCount = iAddChannelHandleSlotCount;
+            return 0;
+        }
 
-            for (int32_t i = 0; i < pChannelCenter->iChannelHandleSlotIndexCount; ++i) {
-                pChannelCenter->pChannelHandleSlotIndex[i] =
-                    pChannelCenter->iChannelHandleSlotCapacity - i - 1;
-            }
+        int32_t               iIndex = pChannelCenter->iFreeHeadIndex;
+        channelHandleSlot_tt* pSlot  = channelCenter_getSlot(pChannelCenter, iIndex);
+        pChannelCenter->iFreeHeadIndex = pSlot->iNextFreeIndex;
+        if (pChannelCenter->iFreeHeadIndex == -1) {
+            pChannelCenter->iFreeTailIndex = -1;
         }
+        ++pChannelCenter->iChannelHandleCount;
 
-        --pChannelCenter->iChannelHandleSlotIndexCount;
-        int32_t iIndex =
-            pChannelCenter->pChannelHandleSlotIndex[pChannelCenter->iChannelHandleSlotIndexCount];
         channel_addref(pHandle);
-        pChannelCenter->ppChannelHandleSlot[iIndex] = pHandle;
-        int32_t iSequence                           = pChannelCenter->iSequence << 20;
-        ++pChannelCenter->iSequence;
-        if (pChannelCenter->iSequence == 0x7ff) {
-            pChannelCenter->iSequence = 1;
-        }
+        atomic_store(&pSlot->pChannelHandle, pHandle);
+        uint32_t uiChannelID = (iIndex + 1) | 0x80000000 | (pSlot->uiGeneration << 20);
 #ifdef DEF_USE_SPINLOCK
         rwSpinLock_wrunlock(&pChannelCenter->rwlock);
 #else
         rwlock_wrunlock(&pChannelCenter->rwlock);
 #endif
-        return ((iIndex + 1) | 0x80000000 | iSequence);
+        return uiChannelID;
     }
     return 0;
 }
@@ -157,26 +200,29 @@ bool channelCenter_deregister(uint32_t uiChannelID)
     if (uiChannelID & 0x80000000) {
         channelCenter_tt* pChannelCenter = s_pChannelCenter;
         if (pChannelCenter) {
+            int32_t iIndex = ((uiChannelID & def_channelHandleMask) - 1);
 #ifdef DEF_USE_SPINLOCK
             rwSpinLock_wrlock(&pChannelCenter->rwlock);
 #else
             rwlock_wrlock(&pChannelCenter->rwlock);
 #endif
-            int32_t iIndex = ((uiChannelID & def_channelHandleMask) - 1);
-            if (iIndex < pChannelCenter->iChannelHandleSlotCapacity) {
-                channel_tt* pChannelHandle = pChannelCenter->ppChannelHandleSlot[iIndex];
+            if (iIndex >= 0 && iIndex < pChannelCenter->iChannelHandleSlotCapacity) {
+                channelHandleSlot_tt* pSlot = channelCenter_getSlot(pChannelCenter, iIndex);
+                channel_tt*           pChannelHandle = atomic_load(&pSlot->pChannelHandle);
                 if (pChannelHandle && channel_getID(pChannelHandle) == uiChannelID) {
-                    channel_release(pChannelHandle);
-                    pChannelCenter->ppChannelHandleSlot[iIndex] = NULL;
-                    pChannelCenter
-                        ->pChannelHandleSlotIndex[pChannelCenter->iChannelHandleSlotIndexCount] =
-                        iIndex;
-                    ++(pChannelCenter->iChannelHandleSlotIndexCount);
+                    atomic_store(&pSlot->pChannelHandle, NULL);
+                    pSlot->uiGeneration = (pSlot->uiGeneration + 1) & def_channelGenerationMask;
+                    if (pSlot->uiGeneration == 0) {
+                        pSlot->uiGeneration = 1;
+                    }
+                    channelCenter_pushFree(pChannelCenter, iIndex);
+                    --pChannelCenter->iChannelHandleCount;
 #ifdef DEF_USE_SPINLOCK
                     rwSpinLock_wrunlock(&pChannelCenter->rwlock);
 #else
                     rwlock_wrunlock(&pChannelCenter->rwlock);
 #endif
+                    hazardPointer_retire(pChannelCenter->pHazardPointer, pChannelHandle);
                     return true;
                 }
             }
@@ -196,29 +242,19 @@ channel_tt* channelCenter_gain(uint32_t uiChannelID)
     if (uiChannelID & 0x80000000) {
         channelCenter_tt* pChannelCenter = s_pChannelCenter;
         if (pChannelCenter) {
-#ifdef DEF_USE_SPINLOCK
-            rwSpinLock_rdlock(&pChannelCenter->rwlock);
-#else
-            rwlock_rdlock(&pChannelCenter->rwlock);
-#endif
             int32_t iIndex = ((uiChannelID & def_channelHandleMask) - 1);
-            if (iIndex < pChannelCenter->iChannelHandleSlotCapacity) {
-                channel_tt* pChannelHandle = pChannelCenter->ppChannelHandleSlot[iIndex];
-                if (pChannelHandle && channel_getID(pChannelHandle) == uiChannelID) {
-                    channel_addref(pChannelHandle);
-#ifdef DEF_USE_SPINLOCK
-                    rwSpinLock_rdunlock(&pChannelCenter->rwlock);
-#else
-                    rwlock_rdunlock(&pChannelCenter->rwlock);
-#endif
-                    return pChannelHandle;
+            if (iIndex >= 0) {
+                channelHandleSlot_tt* pSlot = channelCenter_getSlot(pChannelCenter, iIndex);
+                if (pSlot) {
+                    channel_tt* pChannelHandle = hazardPointer_protect(&pSlot->pChannelHandle);
+                    if (pChannelHandle && channel_getID(pChannelHandle) == uiChannelID) {
+                        channel_addref(pChannelHandle);
+                        hazardPointer_clear();
+                        return pChannelHandle;
+                    }
+                    hazardPointer_clear();
                 }
             }
-#ifdef DEF_USE_SPINLOCK
-            rwSpinLock_rdunlock(&pChannelCenter->rwlock);
-#else
-            rwlock_rdunlock(&pChannelCenter->rwlock);
-#endif
         }
     }
 
@@ -234,14 +270,15 @@ uint32_t* channelCenter_getIds(int32_t* pCount)
 #else
         rwlock_rdlock(&pChannelCenter->rwlock);
 #endif
-        *pCount = pChannelCenter->iChannelHandleSlotCapacity -
-                  pChannelCenter->iChannelHandleSlotIndexCount;
+        *pCount = pChannelCenter->iChannelHandleCount;
         if (*pCount > 0) {
             uint32_t* pChannelIDs = mem_malloc(sizeof(uint32_t) * *pCount);
             int32_t   iIndex      = 0;
             for (int32_t i = 0; i < pChannelCenter->iChannelHandleSlotCapacity; ++i) {
-                if (pChannelCenter->ppChannelHandleSlot[i] != NULL) {
-                    pChannelIDs[iIndex] = channel_getID(pChannelCenter->ppChannelHandleSlot[i]);
+                channel_tt* pChannelHandle =
+                    atomic_load(&channelCenter_getSlot(pChannelCenter, i)->pChannelHandle);
+                if (pChannelHandle != NULL) {
+                    pChannelIDs[iIndex] = channel_getID(pChannelHandle);
                     ++iIndex;
                 }
             }
@@ -0,0 +1,468 @@
+
+
+#include "channel/channelGroup_t.h"
+
+#include "eventIO/eventIO_t.h"
+
+#include "channel/channelCenter_t.h"
+#include "channel/channel_t.h"
+
+#include "spinLock_t.h"
+#include "stream/codecStream_t.h"
+#include "thread_t.h"
+#include "utility_t.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEF_USE_SPINLOCK
+
+#define def_encodeCacheCount 4
+
+typedef eventBufShared_tt* (*encodeSharedPtr)(codecStream_tt*, const char*, int32_t, uint32_t,
+                                              uint32_t);
+
+typedef struct channelGroupLoop_s
+{
+    uintptr_t    uiLoopKey;
+    channel_tt** ppChannel;
+    int32_t      iCount;
+    int32_t      iCapacity;
+} channelGroupLoop_tt;
+
+struct channelGroup_s
+{
+#ifdef DEF_USE_SPINLOCK
+    spinLock_tt spinLock;
+#else
+    mutex_tt mutex;
+#endif
+    channelGroupLoop_tt* pLoop;
+    int32_t              iLoopCount;
+    int32_t              iLoopCapacity;
+    int32_t              iCount;
+    atomic_int           iRefCount;
+};
+
+typedef struct channelGroupSend_s
+{
+    eventConnection_tt* pEventConnection;
+    eventBufShared_tt*  pShared;
+} channelGroupSend_tt;
+
+typedef struct channelGroupAsync_s
+{
+    eventAsync_tt       eventAsync;
+    int32_t             iCount;
+    channelGroupSend_tt sends[];
+} channelGroupAsync_tt;
+
+typedef struct channelGroupEncode_s
+{
+    encodeSharedPtr    fnEncodeShared;
+    eventBufShared_tt* pShared;
+} channelGroupEncode_tt;
+
+static inline void channelGroup_lock(channelGroup_tt* pHandle)
+{
+#ifdef DEF_USE_SPINLOCK
+    spinLock_lock(&pHandle->spinLock);
+#else
+    mutex_lock(&pHandle->mutex);
+#endif
+}
+
+static inline void channelGroup_unlock(channelGroup_tt* pHandle)
+{
+#ifdef DEF_USE_SPINLOCK
+    spinLock_unlock(&pHandle->spinLock);
+#else
+    mutex_unlock(&pHandle->mutex);
+#endif
+}
+
+static inline bool channelGroup_find(channelGroup_tt* pHandle, uint32_t uiChannelID,
+                                     int32_t* pLoopIndex, int32_t* pIndex)
+{
+    for (int32_t i = 0; i < pHandle->iLoopCount; ++i) {
+        channelGroupLoop_tt* pLoop = &pHandle->pLoop[i];
+        for (int32_t j = 0; j < pLoop->iCount; ++j) {
+            if (channel_getID(pLoop->ppChannel[j]) == uiChannelID) {
+                *pLoopIndex = i;
+                *pIndex     = j;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static inline bool channelGroup_findChannel(channelGroup_tt* pHandle, channel_tt* pChannel,
+                                            int32_t* pLoopIndex, int32_t* pIndex)
+{
+    for (int32_t i = 0; i < pHandle->iLoopCount; ++i) {
+        channelGroupLoop_tt* pLoop = &pHandle->pLoop[i];
+        for (int32_t j = 0; j < pLoop->iCount; ++j) {
+            if (pLoop->ppChannel[j] == pChannel) {
+                *pLoopIndex = i;
+                *pIndex     = j;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static inline channelGroupLoop_tt* channelGroup_getLoop(channelGroup_tt* pHandle,
+                                                        uintptr_t        uiLoopKey)
+{
+    for (int32_t i = 0; i < pHandle->iLoopCount; ++i) {
+        if (pHandle->pLoop[i].uiLoopKey == uiLoopKey) {
+            return &pHandle->pLoop[i];
+        }
+    }
+
+    if (pHandle->iLoopCount == pHandle->iLoopCapacity) {
+        pHandle->iLoopCapacity = pHandle->iLoopCapacity == 0 ? 4 : pHandle->iLoopCapacity * 2;
+        pHandle->pLoop =
+            mem_realloc(pHandle->pLoop, pHandle->iLoopCapacity * sizeof(channelGroupLoop_tt));
+    }
+
+    channelGroupLoop_tt* pLoop = &pHandle->pLoop[pHandle->iLoopCount++];
+    pLoop->uiLoopKey           = uiLoopKey;
+    pLoop->ppChannel           = NULL;
+    pLoop->iCount              = 0;
+    pLoop->iCapacity           = 0;
+    return pLoop;
+}
+
+static inline bool channelGroup_isExclude(uint32_t uiChannelID, const uint32_t* pExcludeIDs,
+                                          int32_t iExcludeCount)
+{
+    for (int32_t i = 0; i < iExcludeCount; ++i) {
+        if (pExcludeIDs[i] == uiChannelID) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static eventBufShared_tt* channelGroup_encode(channelGroupEncode_tt* pEncode,
+                                              int32_t* pEncodeCount, codecStream_tt* pCodecStream,
+                                              const char* pBuffer, int32_t iLength,
+                                              uint32_t uiFlag, uint32_t uiToken)
+{
+    encodeSharedPtr fnEncodeShared = NULL;
+    if (pCodecStream && pCodecStream->fnWrite) {
+        if (pCodecStream->fnEncodeShared == NULL) {
+            return NULL;
+        }
+        fnEncodeShared = pCodecStream->fnEncodeShared;
+    }
+
+    for (int32_t i = 0; i < *pEncodeCount; ++i) {
+        if (pEncode[i].fnEncodeShared == fnEncodeShared) {
+            return pEncode[i].pShared;
+        }
+    }
+
+    if (*pEncodeCount == def_encodeCacheCount) {
+        return NULL;
+    }
+
+    eventBufShared_tt* pShared = NULL;
+    if (fnEncodeShared) {
+        pShared = fnEncodeShared(pCodecStream, pBuffer, iLength, uiFlag, uiToken);
+    }
+    else {
+        ioBufVec_tt bufVec;
+        bufVec.pBuf    = NULL;
+        bufVec.iLength = iLength;
+        if (iLength > 0) {
+            bufVec.pBuf = mem_malloc(iLength);
+            memcpy(bufVec.pBuf, pBuffer, iLength);
+        }
+        pShared = createEventBufShared(&bufVec, 1);
+    }
+
+    pEncode[*pEncodeCount].fnEncodeShared = fnEncodeShared;
+    pEncode[*pEncodeCount].pShared        = pShared;
+    ++(*pEncodeCount);
+    return pShared;
+}
+
+static void channelGroup_sendInLoop(eventAsync_tt* pEventAsync)
+{
+    channelGroupAsync_tt* pAsync = container_of(pEventAsync, channelGroupAsync_tt, eventAsync);
+    for (int32_t i = 0; i < pAsync->iCount; ++i) {
+        eventConnection_send(pAsync->sends[i].pEventConnection,
+                             createEventBuf_shared(pAsync->sends[i].pShared, NULL, 0));
+        eventBufShared_release(pAsync->sends[i].pShared);
+        eventConnection_release(pAsync->sends[i].pEventConnection);
+    }
+    mem_free(pAsync);
+}
+
+static void channelGroup_sendCancel(eventAsync_tt* pEventAsync)
+{
+    channelGroupAsync_tt* pAsync = container_of(pEventAsync, channelGroupAsync_tt, eventAsync);
+    for (int32_t i = 0; i < pAsync->iCount; ++i) {
+        eventBufShared_release(pAsync->sends[i].pShared);
+        eventConnection_release(pAsync->sends[i].pEventConnection);
+    }
+    mem_free(pAsync);
+}
+
+channelGroup_tt* createChannelGroup()
+{
+    channelGroup_tt* pHandle = mem_malloc(sizeof(channelGroup_tt));
+#ifdef DEF_USE_SPINLOCK
+    spinLock_init(&pHandle->spinLock);
+#else
+    mutex_init(&pHandle->mutex);
+#endif
+    pHandle->pLoop         = NULL;
+    pHandle->iLoopCount    = 0;
+    pHandle->iLoopCapacity = 0;
+    pHandle->iCount        = 0;
+    atomic_init(&pHandle->iRefCount, 1);
+    return pHandle;
+}
+
+void channelGroup_addref(channelGroup_tt* pHandle)
+{
+    atomic_fetch_add(&(pHandle->iRefCount), 1);
+}
+
+void channelGroup_release(channelGroup_tt* pHandle)
+{
+    if (atomic_fetch_sub(&(pHandle->iRefCount), 1) == 1) {
+        channelGroup_clear(pHandle);
+        for (int32_t i = 0; i < pHandle->iLoopCount; ++i) {
+            if (pHandle->pLoop[i].ppChannel) {
+                mem_free(pHandle->pLoop[i].ppChannel);
+            }
+        }
+
+        if (pHandle->pLoop) {
+            mem_free(pHandle->pLoop);
+        }
+#ifndef DEF_USE_SPINLOCK
+        mutex_destroy(&pHandle->mutex);
+#endif
+        mem_free(pHandle);
+    }
+}
+
+bool channelGroup_add(channelGroup_tt* pHandle, uint32_t uiChannelID)
+{
+    channel_tt* pChannel = channelCenter_gain(uiChannelID);
+    if (pChannel == NULL) {
+        return false;
+    }
+
+    eventConnection_tt* pEventConnection = channel_gainConnection(pChannel);
+    if (pEventConnection == NULL) {
+        channel_release(pChannel);
+        return false;
+    }
+    uintptr_t uiLoopKey = eventConnection_getLoopKey(pEventConnection);
+    eventConnection_release(pEventConnection);
+
+    int32_t iLoopIndex = 0;
+    int32_t iIndex     = 0;
+    channelGroup_lock(pHandle);
+    if (channelGroup_find(pHandle, uiChannelID, &iLoopIndex, &iIndex)) {
+        channelGroup_unlock(pHandle);
+        channel_release(pChannel);
+        return false;
+    }
+
+    channelGroupLoop_tt* pLoop = channelGroup_getLoop(pHandle, uiLoopKey);
+    if (pLoop->iCount == pLoop->iCapacity) {
+        pLoop->iCapacity = pLoop->iCapacity == 0 ? 16 : pLoop->iCapacity * 2;
+        pLoop->ppChannel = mem_realloc(pLoop->ppChannel, pLoop->iCapacity * sizeof(channel_tt*));
+    }
+    pLoop->ppChannel[pLoop->iCount++] = pChannel;
+    ++pHandle->iCount;
+    channelGroup_unlock(pHandle);
+
+    // 连接已在加入期间关闭, 撤销加入
+    if (!channel_attachGroup(pChannel, pHandle)) {
+        channelGroup_removeChannel(pHandle, pChannel);
+        return false;
+    }
+    return true;
+}
+
+bool channelGroup_tryAddref(channelGroup_tt* pHandle)
+{
+    int32_t iRefCount = atomic_load(&pHandle->iRefCount);
+    while (iRefCount > 0) {
+        if (atomic_compare_exchange_weak(&pHandle->iRefCount, &iRefCount, iRefCount + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void channelGroup_removeChannel(channelGroup_tt* pHandle, channel_tt* pChannel)
+{
+    int32_t iLoopIndex = 0;
+    int32_t iIndex     = 0;
+    channelGroup_lock(pHandle);
+    if (!channelGroup_findChannel(pHandle, pChannel, &iLoopIndex, &iIndex)) {
+        channelGroup_unlock(pHandle);
+        return;
+    }
+
+    channelGroupLoop_tt* pLoop = &pHandle->pLoop[iLoopIndex];
+    pLoop->ppChannel[iIndex]   = pLoop->ppChannel[--pLoop->iCount];
+    --pHandle->iCount;
+    channelGroup_unlock(pHandle);
+    channel_release(pChannel);
+}
+
+bool channelGroup_remove(channelGroup_tt* pHandle, uint32_t uiChannelID)
+{
+    int32_t iLoopIndex = 0;
+    int32_t iIndex     = 0;
+    channelGroup_lock(pHandle);
+    if (!channelGroup_find(pHandle, uiChannelID, &iLoopIndex, &iIndex)) {
+        channelGroup_unlock(pHandle);
+        return false;
+    }
+
+    channelGroupLoop_tt* pLoop    = &pHandle->pLoop[iLoopIndex];
+    channel_tt*          pChannel = pLoop->ppChannel[iIndex];
+    pLoop->ppChannel[iIndex]      = pLoop->ppChannel[--pLoop->iCount];
+    --pHandle->iCount;
+    channelGroup_unlock(pHandle);
+    channel_detachGroup(pChannel, pHandle);
+    channel_release(pChannel);
+    return true;
+}
+
+void channelGroup_clear(channelGroup_tt* pHandle)
+{
+    channelGroup_lock(pHandle);
+    int32_t      iCount    = 0;
+    channel_tt** ppChannel = NULL;
+    if (pHandle->iCount > 0) {
+        ppChannel = mem_malloc(pHandle->iCount * sizeof(channel_tt*));
+        for (int32_t i = 0; i < pHandle->iLoopCount; ++i) {
+            channelGroupLoop_tt* pLoop = &pHandle->pLoop[i];
+            for (int32_t j = 0; j < pLoop->iCount; ++j) {
+                ppChannel[iCount++] = pLoop->ppChannel[j];
+            }
+            pLoop->iCount = 0;
+        }
+        pHandle->iCount = 0;
+    }
+    channelGroup_unlock(pHandle);
+
+    for (int32_t i = 0; i < iCount; ++i) {
+        channel_detachGroup(ppChannel[i], pHandle);
+        channel_release(ppChannel[i]);
+    }
+
+    if (ppChannel) {
+        mem_free(ppChannel);
+    }
+}
+
+int32_t channelGroup_getCount(channelGroup_tt* pHandle)
+{
+    channelGroup_lock(pHandle);
+    int32_t iCount = pHandle->iCount;
+    channelGroup_unlock(pHandle);
+    return iCount;
+}
+
+int32_t channelGroup_broadcast(channelGroup_tt* pHandle, const char* pBuffer, int32_t iLength,
+                               uint32_t uiFlag, uint32_t uiToken, const uint32_t* pExcludeIDs,
+                               int32_t iExcludeCount)
+{
+    channelGroupEncode_tt encodes[def_encodeCacheCount];
+    int32_t               iEncodeCount = 0;
+    int32_t               iSendCount   = 0;
+    int32_t               iAsyncCount  = 0;
+    int32_t               iDirectCount = 0;
+
+    channelGroup_lock(pHandle);
+    channelGroupAsync_tt* asyncs[pHandle->iLoopCount > 0 ? pHandle->iLoopCount : 1];
+    channel_tt**          ppDirect = NULL;
+
+    for (int32_t i = 0; i < pHandle->iLoopCount; ++i) {
+        channelGroupLoop_tt*  pLoop  = &pHandle->pLoop[i];
+        channelGroupAsync_tt* pAsync = NULL;
+        for (int32_t j = 0; j < pLoop->iCount; ++j) {
+            channel_tt* pChannel = pLoop->ppChannel[j];
+            if (channelGroup_isExclude(channel_getID(pChannel), pExcludeIDs, iExcludeCount)) {
+                continue;
+            }
+
+            eventConnection_tt* pEventConnection = channel_gainConnection(pChannel);
+            if (pEventConnection == NULL) {
+                continue;
+            }
+
+            eventBufShared_tt* pShared = channelGroup_encode(encodes,
+                                                             &iEncodeCount,
+                                                             channel_getCodecStream(pChannel),
+                                                             pBuffer,
+                                                             iLength,
+                                                             uiFlag,
+                                                             uiToken);
+            if (pShared == NULL) {
+                eventConnection_release(pEventConnection);
+                if (ppDirect == NULL) {
+                    ppDirect = mem_malloc(pHandle->iCount * sizeof(channel_tt*));
+                }
+                channel_addref(pChannel);
+                ppDirect[iDirectCount++] = pChannel;
+                continue;
+            }
+
+            if (pAsync == NULL) {
+                pAsync = mem_malloc(sizeof(channelGroupAsync_tt) +
+                                    pLoop->iCount * sizeof(channelGroupSend_tt));
+                pAsync->iCount = 0;
+            }
+            eventBufShared_addref(pShared);
+            pAsync->sends[pAsync->iCount].pEventConnection = pEventConnection;
+            pAsync->sends[pAsync->iCount].pShared          = pShared;
+            ++pAsync->iCount;
+        }
+
+        if (pAsync) {
+            asyncs[iAsyncCount++] = pAsync;
+        }
+    }
+    channelGroup_unlock(pHandle);
+
+    for (int32_t i = 0; i < iEncodeCount; ++i) {
+        eventBufShared_release(encodes[i].pShared);
+    }
+
+    for (int32_t i = 0; i < iAsyncCount; ++i) {
+        iSendCount += asyncs[i]->iCount;
+        eventConnection_runInLoop(asyncs[i]->sends[0].pEventConnection,
+                                  &asyncs[i]->eventAsync,
+                                  channelGroup_sendInLoop,
+                                  channelGroup_sendCancel);
+    }
+
+    for (int32_t i = 0; i < iDirectCount; ++i) {
+        if (channel_send(ppDirect[i], pBuffer, iLength, uiFlag, uiToken) >= 0) {
+            ++iSendCount;
+        }
+        channel_release(ppDirect[i]);
+    }
+
+    if (ppDirect) {
+        mem_free(ppDirect);
+    }
+    return iSendCount;
+}
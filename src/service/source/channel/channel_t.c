@@ -5,6 +5,7 @@
 #include "eventIO/eventIO_t.h"
 
 #include "channel/channelCenter_t.h"
+#include "channel/channelGroup_t.h"
 
 #include "serviceEvent_t.h"
 #include "service_t.h"
@@ -34,8 +35,40 @@ struct channel_s
     _Atomic(eventTimer_tt*)      hDisconnectTimeout;
     atomic_int                   iStatus;
     atomic_int                   iRefCount;
+    spinLock_tt                  groupLock;
+    channelGroup_tt**            ppGroups;
+    int32_t                      iGroupCount;
+    int32_t                      iGroupCapacity;
+    bool                         bGroupClosed;
 };
 
+// 连接关闭后从所在的组中移除, 之后不再允许加入新组
+static void channel_leaveGroups(channel_tt* pChannel)
+{
+    spinLock_lock(&pChannel->groupLock);
+    int32_t           iCount   = 0;
+    channelGroup_tt** ppGroups = pChannel->ppGroups;
+    for (int32_t i = 0; i < pChannel->iGroupCount; ++i) {
+        // 组可能正在销毁, 销毁时会经由channel_detachGroup等待本锁
+        if (channelGroup_tryAddref(ppGroups[i])) {
+            ppGroups[iCount++] = ppGroups[i];
+        }
+    }
+    pChannel->ppGroups       = NULL;
+    pChannel->iGroupCount    = 0;
+    pChannel->iGroupCapacity = 0;
+    pChannel->bGroupClosed   = true;
+    spinLock_unlock(&pChannel->groupLock);
+
+    for (int32_t i = 0; i < iCount; ++i) {
+        channelGroup_removeChannel(ppGroups[i], pChannel);
+        channelGroup_release(ppGroups[i]);
+    }
+    if (ppGroups) {
+        mem_free(ppGroups);
+    }
+}
+
 static inline void eventConnection_onUserFree(void* pUserData)
 {
     channel_tt* pChannel = (channel_tt*)pUserData;
@@ -75,6 +108,7 @@ static inline void eventTimer_onDisconnectTimeout(eventTimer_tt* pHandle, void*
 static inline void eventConnection_onClose(eventConnection_tt* pHandle, void* pData)
 {
     channel_tt*         pChannel = (channel_tt*)pData;
+    channel_leaveGroups(pChannel);
     eventConnection_tt* pConnectionHandle =
         (eventConnection_tt*)atomic_exchange(&pChannel->hConnection, 0);
     if (pConnectionHandle) {
@@ -96,10 +130,17 @@ static inline bool eventConnection_onReceiveCallback(eventConnection_tt* pEventC
 {
     channel_tt* pChannel = (channel_tt*)pData;
     if (pChannel->pCodecStream && pChannel->pCodecStream->fnReceive) {
-        return pChannel->pCodecStream->fnReceive(pChannel->pCodecStream, pChannel, pReadByteQueue);
+        // 编解码器可能留下半包, 只统计本次消费掉的字节
+        size_t nReadable = byteQueue_getBytesReadable(pReadByteQueue);
+        bool   bResult =
+            pChannel->pCodecStream->fnReceive(pChannel->pCodecStream, pChannel, pReadByteQueue);
+        service_addTraffic(
+            pChannel->pService, 0, nReadable - byteQueue_getBytesReadable(pReadByteQueue));
+        return bResult;
     }
     else {
         size_t           nBytesWritten = byteQueue_getBytesReadable(pReadByteQueue);
+        service_addTraffic(pChannel->pService, 0, nBytesWritten);
         serviceEvent_tt* pEvent        = mem_malloc(sizeof(serviceEvent_tt) + nBytesWritten);
         pEvent->uiSourceID             = channel_getID(pChannel);
         pEvent->uiToken                = 0;
@@ -148,7 +189,12 @@ channel_tt* createChannel(eventIO_tt* pEventIO, eventConnection_tt* pEventConnec
     atomic_init(&pHandle->hConnection, pEventConnection);
     atomic_init(&pHandle->hDisconnectTimeout, NULL);
     atomic_init(&pHandle->iRefCount, 1);
-    pHandle->uiID = channelCenter_register(pHandle);
+    spinLock_init(&pHandle->groupLock);
+    pHandle->ppGroups       = NULL;
+    pHandle->iGroupCount    = 0;
+    pHandle->iGroupCapacity = 0;
+    pHandle->bGroupClosed   = false;
+    pHandle->uiID           = channelCenter_register(pHandle);
     atomic_init(&pHandle->iStatus, eStarting);
     return pHandle;
 }
@@ -189,6 +235,10 @@ void channel_release(channel_tt* pHandle)
             }
             pHandle->pCodecStream = NULL;
         }
+
+        if (pHandle->ppGroups) {
+            mem_free(pHandle->ppGroups);
+        }
         mem_free(pHandle);
     }
 }
@@ -296,6 +346,35 @@ service_tt* channel_getService(channel_tt* pHandle)
     return pHandle->pService;
 }
 
+codecStream_tt* channel_getCodecStream(channel_tt* pHandle)
+{
+    return pHandle->pCodecStream;
+}
+
+eventConnection_tt* channel_gainConnection(channel_tt* pHandle)
+{
+    if (atomic_load(&pHandle->iStatus) == eRunning) {
+        eventConnection_tt* pEventConnection =
+            (eventConnection_tt*)atomic_load(&pHandle->hConnection);
+        if (pEventConnection) {
+            eventConnection_addref(pEventConnection);
+            return pEventConnection;
+        }
+    }
+    return NULL;
+}
+
+// 发送字节按编码前的负载统计
+static inline void channel_addSendBytes(channel_tt* pHandle, const ioBufVec_tt* pInBufVec,
+                                        int32_t iCount)
+{
+    size_t nLength = 0;
+    for (int32_t i = 0; i < iCount; ++i) {
+        nLength += pInBufVec[i].iLength;
+    }
+    service_addTraffic(pHandle->pService, nLength, 0);
+}
+
 int32_t channel_sendMove(channel_tt* pHandle, ioBufVec_tt* pInBufVec, int32_t iCount,
                          uint32_t uiFlag, uint32_t uiToken)
 {
@@ -303,6 +382,7 @@ int32_t channel_sendMove(channel_tt* pHandle, ioBufVec_tt* pInBufVec, int32_t iC
         eventConnection_tt* pEventConnection =
             (eventConnection_tt*)atomic_load(&pHandle->hConnection);
         if (pEventConnection) {
+            channel_addSendBytes(pHandle, pInBufVec, iCount);
             if (pHandle->pCodecStream && pHandle->pCodecStream->fnWriteMove) {
                 return pHandle->pCodecStream->fnWriteMove(
                     pHandle->pCodecStream, pEventConnection, pInBufVec, iCount, uiFlag, uiToken);
@@ -327,6 +407,7 @@ int32_t channel_send(channel_tt* pHandle, const char* pBuffer, int32_t iLength,
         eventConnection_tt* pEventConnection =
             (eventConnection_tt*)atomic_load(&pHandle->hConnection);
         if (pEventConnection) {
+            service_addTraffic(pHandle->pService, iLength, 0);
             if (pHandle->pCodecStream && pHandle->pCodecStream->fnWrite) {
                 return pHandle->pCodecStream->fnWrite(
                     pHandle->pCodecStream, pEventConnection, pBuffer, iLength, uiFlag, uiToken);
@@ -345,6 +426,7 @@ int32_t channel_writeMove(channel_tt* pHandle, ioBufVec_tt* pInBufVec, int32_t i
         eventConnection_tt* pEventConnection =
             (eventConnection_tt*)atomic_load(&pHandle->hConnection);
         if (pEventConnection) {
+            channel_addSendBytes(pHandle, pInBufVec, iCount);
             if (uiToken != 0) {
                 return eventConnection_send(
                     pEventConnection,
@@ -370,6 +452,7 @@ int32_t channel_write(channel_tt* pHandle, const char* pBuffer, int32_t iLength,
         eventConnection_tt* pEventConnection =
             (eventConnection_tt*)atomic_load(&pHandle->hConnection);
         if (pEventConnection) {
+            service_addTraffic(pHandle->pService, iLength, 0);
             if (uiToken != 0) {
                 return eventConnection_send(
                     pEventConnection,
@@ -430,3 +513,32 @@ size_t channel_getReceiveBufLength(channel_tt* pHandle)
     }
     return 0;
 }
+
+bool channel_attachGroup(channel_tt* pHandle, channelGroup_tt* pGroup)
+{
+    spinLock_lock(&pHandle->groupLock);
+    if (pHandle->bGroupClosed) {
+        spinLock_unlock(&pHandle->groupLock);
+        return false;
+    }
+    if (pHandle->iGroupCount == pHandle->iGroupCapacity) {
+        pHandle->iGroupCapacity = pHandle->iGroupCapacity == 0 ? 2 : pHandle->iGroupCapacity * 2;
+        pHandle->ppGroups =
+            mem_realloc(pHandle->ppGroups, pHandle->iGroupCapacity * sizeof(channelGroup_tt*));
+    }
+    pHandle->ppGroups[pHandle->iGroupCount++] = pGroup;
+    spinLock_unlock(&pHandle->groupLock);
+    return true;
+}
+
+void channel_detachGroup(channel_tt* pHandle, channelGroup_tt* pGroup)
+{
+    spinLock_lock(&pHandle->groupLock);
+    for (int32_t i = 0; i < pHandle->iGroupCount; ++i) {
+        if (pHandle->ppGroups[i] == pGroup) {
+            pHandle->ppGroups[i] = pHandle->ppGroups[--pHandle->iGroupCount];
+            break;
+        }
+    }
+    spinLock_unlock(&pHandle->groupLock);
+}
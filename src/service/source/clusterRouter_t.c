@@ -0,0 +1,842 @@
+
+
+#include "clusterRouter_t.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "eventIO/eventIO_t.h"
+
+#include "inetAddress_t.h"
+#include "log_t.h"
+#include "spinLock_t.h"
+#include "utility_t.h"
+
+#include "internal/service-inl.h"
+#include "serviceCenter_t.h"
+#include "serviceEvent_t.h"
+#include "serviceTrace_t.h"
+#include "service_t.h"
+
+// frame: [u32 length] { [u32 destination][u32 source][u32 token][u32 flag|length] payload }*
+// destination为0的记录是节点命令, flag为命令: 名字目录命令的payload为名字;
+// 追踪命令的payload为 [u64 traceID][u64 spanID], 作用于同一帧内紧随其后的一条事件
+#define def_clusterNodeCount DEF_SERVICE_NODE_COUNT
+#define def_clusterFrameHead 4
+#define def_clusterEventHead 16
+#define def_clusterTraceHead 16
+#define def_clusterBufferLength 4096
+#define def_clusterPendingMax (32 * 1024 * 1024)
+#define def_clusterReconnectMs 1000
+
+#define def_clusterDirectoryBind 1
+#define def_clusterDirectoryUnbind 2
+#define def_clusterDirectoryReset 3
+#define def_clusterCommandTrace 4
+
+enum enLinkStatus
+{
+    eLinkIdle       = 0,
+    eLinkConnecting = 1,
+    eLinkConnected  = 2,
+};
+
+struct clusterRouter_s;
+
+// 引用: 路由表, 连接(经fnUserFree释放), 排队中的flush各持有一份
+typedef struct clusterLink_s
+{
+    struct clusterRouter_s* pClusterRouter;
+    int32_t                 iNodeId;
+    inetAddress_tt          inetAddr;
+    eventConnection_tt*     pConnection;
+    char*                   pBuffer;
+    size_t                  nLength;
+    size_t                  nCapacity;
+    bool                    bFlushQueued;
+    bool                    bClosed;
+    eventAsync_tt           eventAsync;
+    spinLock_tt             spinLock;
+    atomic_int              iStatus;
+    atomic_int              iRefCount;
+} clusterLink_tt;
+
+// 对端主动连进来的连接, 关闭回调中释放
+typedef struct clusterPeer_s
+{
+    QUEUE                   node;
+    struct clusterRouter_s* pClusterRouter;
+    eventConnection_tt*     pConnection;
+    int32_t                 iNodeId;
+} clusterPeer_tt;
+
+// 引用: s_pClusterRouter, 监听端口, 每条链路和每个对端连接各持有一份
+typedef struct clusterRouter_s
+{
+    eventIO_tt*             pEventIO;
+    eventListenPort_tt*     pListenPort;
+    eventTimer_tt*          pReconnectTimer;
+    int32_t                 iServerNodeId;
+    atomic_int              iRefCount;
+    char**                  ppAllowIPs;
+    int32_t                 iAllowCount;
+    spinLock_tt             spinLock;
+    QUEUE                   queuePeers;
+    clusterLink_tt*         pLinks[def_clusterNodeCount];
+    clusterPeer_tt* _Atomic pPeers[def_clusterNodeCount];
+} clusterRouter_tt;
+
+static clusterRouter_tt* s_pClusterRouter = NULL;
+
+static inline void clusterRouter_writeU32(char* pBuffer, uint32_t uiValue)
+{
+    pBuffer[0] = (char)(uiValue >> 24);
+    pBuffer[1] = (char)(uiValue >> 16);
+    pBuffer[2] = (char)(uiValue >> 8);
+    pBuffer[3] = (char)uiValue;
+}
+
+static inline uint32_t clusterRouter_readU32(const uint8_t* pBuffer)
+{
+    return ((uint32_t)pBuffer[0] << 24) | ((uint32_t)pBuffer[1] << 16) |
+           ((uint32_t)pBuffer[2] << 8) | (uint32_t)pBuffer[3];
+}
+
+static inline void clusterRouter_writeU64(char* pBuffer, uint64_t uiValue)
+{
+    clusterRouter_writeU32(pBuffer, (uint32_t)(uiValue >> 32));
+    clusterRouter_writeU32(pBuffer + 4, (uint32_t)uiValue);
+}
+
+static inline uint64_t clusterRouter_readU64(const uint8_t* pBuffer)
+{
+    return ((uint64_t)clusterRouter_readU32(pBuffer) << 32) | clusterRouter_readU32(pBuffer + 4);
+}
+
+static inline void clusterRouter_addref(clusterRouter_tt* pClusterRouter)
+{
+    atomic_fetch_add(&pClusterRouter->iRefCount, 1);
+}
+
+static void clusterRouter_release(clusterRouter_tt* pClusterRouter)
+{
+    if (atomic_fetch_sub(&pClusterRouter->iRefCount, 1) == 1) {
+        for (int32_t i = 0; i < pClusterRouter->iAllowCount; ++i) {
+            mem_free(pClusterRouter->ppAllowIPs[i]);
+        }
+        if (pClusterRouter->ppAllowIPs) {
+            mem_free(pClusterRouter->ppAllowIPs);
+        }
+        eventIO_release(pClusterRouter->pEventIO);
+        mem_free(pClusterRouter);
+    }
+}
+
+static void clusterRouter_onUserFree(void* pData)
+{
+    clusterRouter_release((clusterRouter_tt*)pData);
+}
+
+static inline void clusterLink_addref(clusterLink_tt* pLink)
+{
+    atomic_fetch_add(&pLink->iRefCount, 1);
+}
+
+static void clusterLink_release(clusterLink_tt* pLink)
+{
+    if (atomic_fetch_sub(&pLink->iRefCount, 1) == 1) {
+        if (pLink->pBuffer) {
+            mem_free(pLink->pBuffer);
+        }
+        clusterRouter_release(pLink->pClusterRouter);
+        mem_free(pLink);
+    }
+}
+
+static void clusterLink_onUserFree(void* pData)
+{
+    clusterLink_release((clusterLink_tt*)pData);
+}
+
+// 返回false时断开连接
+static bool clusterRouter_onDirectory(clusterPeer_tt* pPeer, uint32_t uiCommand,
+                                      uint32_t uiServiceID, const char* szName)
+{
+    clusterRouter_tt* pClusterRouter = pPeer->pClusterRouter;
+    int32_t           iNodeId        = DEF_SERVICE_NODE_ID(uiServiceID);
+    switch (uiCommand) {
+    case def_clusterDirectoryReset:
+        {
+            // 只接受配置过链路的节点, 一个连接只能认领一个节点, 也不能抢占其他连接认领的节点
+            if (iNodeId == pClusterRouter->iServerNodeId ||
+                pClusterRouter->pLinks[iNodeId] == NULL ||
+                (pPeer->iNodeId != -1 && pPeer->iNodeId != iNodeId)) {
+                Log(eLog_error, "cluster reject reset node:%d", iNodeId);
+                return false;
+            }
+            clusterPeer_tt* pExpected = NULL;
+            if (!atomic_compare_exchange_strong(&pClusterRouter->pPeers[iNodeId], &pExpected, pPeer) &&
+                pExpected != pPeer) {
+                Log(eLog_error, "cluster reject reset node:%d already connected", iNodeId);
+                return false;
+            }
+            pPeer->iNodeId = iNodeId;
+            serviceCenter_clearRemoteNames(iNodeId);
+        }
+        break;
+    case def_clusterDirectoryBind:
+    case def_clusterDirectoryUnbind:
+        {
+            // 名字只能属于连接认领的节点
+            if (iNodeId != pPeer->iNodeId) {
+                Log(eLog_error, "cluster reject name:%s service:%08x", szName, uiServiceID);
+                return false;
+            }
+            if (uiCommand == def_clusterDirectoryBind) {
+                serviceCenter_bindRemoteName(uiServiceID, szName);
+            }
+            else {
+                serviceCenter_unbindRemoteName(uiServiceID, szName);
+            }
+        }
+        break;
+    }
+    return true;
+}
+
+// 只接受clusterRouter_send会转发的消息和命令, 其余类型的事件只能由本地产生
+static inline bool clusterRouter_isForwardable(uint32_t uiFlag)
+{
+    uint32_t uiType = uiFlag & DEF_EVENT_MASK;
+    return uiType == DEF_EVENT_MSG || uiType == DEF_EVENT_COMMAND;
+}
+
+static bool clusterRouter_onReceive(eventConnection_tt* pConnection, byteQueue_tt* pReadByteQueue,
+                                    void* pData)
+{
+    uint8_t                szHead[def_clusterEventHead];
+    serviceTraceContext_tt trace = {0, 0};
+    while (byteQueue_getBytesReadable(pReadByteQueue) >= def_clusterFrameHead) {
+        byteQueue_readBytes(pReadByteQueue, szHead, def_clusterFrameHead, true);
+        uint32_t uiFrameLength = clusterRouter_readU32(szHead);
+        if (uiFrameLength > def_clusterPendingMax) {
+            return false;
+        }
+        if (byteQueue_getBytesReadable(pReadByteQueue) < def_clusterFrameHead + uiFrameLength) {
+            return true;
+        }
+        byteQueue_readOffset(pReadByteQueue, def_clusterFrameHead);
+
+        while (uiFrameLength >= def_clusterEventHead) {
+            byteQueue_readBytes(pReadByteQueue, szHead, def_clusterEventHead, false);
+            uint32_t uiDestinationID = clusterRouter_readU32(szHead);
+            uint32_t uiSourceID      = clusterRouter_readU32(szHead + 4);
+            uint32_t uiToken         = clusterRouter_readU32(szHead + 8);
+            uint32_t uiLength        = clusterRouter_readU32(szHead + 12);
+            uint32_t uiPayloadLength = uiLength & 0xFFFFFF;
+            uiFrameLength -= def_clusterEventHead;
+
+            if (uiPayloadLength > uiFrameLength) {
+                return false;
+            }
+            uiFrameLength -= uiPayloadLength;
+
+            if (uiDestinationID == 0 && (uiLength >> 24) == def_clusterCommandTrace) {
+                if (uiPayloadLength != def_clusterTraceHead) {
+                    return false;
+                }
+                byteQueue_readBytes(pReadByteQueue, szHead, def_clusterTraceHead, false);
+                trace.uiTraceID = clusterRouter_readU64(szHead);
+                trace.uiSpanID  = clusterRouter_readU64(szHead + 8);
+                continue;
+            }
+
+            if (uiDestinationID == 0) {
+                char* szName = mem_malloc(uiPayloadLength + 1);
+                if (uiPayloadLength != 0) {
+                    byteQueue_readBytes(pReadByteQueue, szName, uiPayloadLength, false);
+                }
+                szName[uiPayloadLength] = '\0';
+                bool bAccepted = clusterRouter_onDirectory(
+                    (clusterPeer_tt*)pData, uiLength >> 24, uiSourceID, szName);
+                mem_free(szName);
+                if (!bAccepted) {
+                    return false;
+                }
+                continue;
+            }
+
+            // 非法的事件类型视为对端出错, 断开连接; MOVEBUF是本地的缓冲所有权标记, 不能来自网络
+            if (!clusterRouter_isForwardable(uiLength >> 24)) {
+                Log(eLog_error, "cluster receive invalid event flag:%x", uiLength >> 24);
+                return false;
+            }
+            uiLength &= ~((uint32_t)DEF_EVENT_MOVEBUF << 24);
+
+            service_tt* pService = serviceCenter_gain(uiDestinationID);
+            if (pService) {
+                serviceEvent_tt* pEvent = mem_malloc(sizeof(serviceEvent_tt) + uiPayloadLength);
+                pEvent->uiSourceID      = uiSourceID;
+                pEvent->uiToken         = uiToken;
+                pEvent->uiLength        = uiLength;
+                if (uiPayloadLength != 0) {
+                    byteQueue_readBytes(
+                        pReadByteQueue, pEvent->szStorage, uiPayloadLength, false);
+                }
+                // 入队时取当前线程的追踪上下文, 远端带来的上下文临时换进来
+                serviceTraceContext_tt* pContext = serviceTrace_current();
+                serviceTraceContext_tt  saved    = *pContext;
+                *pContext                        = trace;
+                service_enqueue(pService, pEvent);
+                *pContext = saved;
+                service_release(pService);
+            }
+            else if (uiPayloadLength != 0) {
+                byteQueue_readOffset(pReadByteQueue, uiPayloadLength);
+            }
+            trace.uiTraceID = 0;
+            trace.uiSpanID  = 0;
+        }
+
+        if (uiFrameLength != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void clusterRouter_onDisconnect(eventConnection_tt* pConnection, void* pData)
+{
+    eventConnection_forceClose(pConnection);
+}
+
+static void clusterPeer_free(clusterPeer_tt* pPeer)
+{
+    clusterRouter_tt* pClusterRouter = pPeer->pClusterRouter;
+    spinLock_lock(&pClusterRouter->spinLock);
+    QUEUE_REMOVE(&pPeer->node);
+    spinLock_unlock(&pClusterRouter->spinLock);
+    mem_free(pPeer);
+    clusterRouter_release(pClusterRouter);
+}
+
+static void clusterRouter_onClose(eventConnection_tt* pConnection, void* pData)
+{
+    // 对端断开即认为该节点的名字全部失效, 重连后会重新同步
+    clusterPeer_tt*   pPeer          = (clusterPeer_tt*)pData;
+    clusterRouter_tt* pClusterRouter = pPeer->pClusterRouter;
+    if (pPeer->iNodeId >= 0) {
+        clusterPeer_tt* pCurrent = pPeer;
+        if (atomic_compare_exchange_strong(
+                &pClusterRouter->pPeers[pPeer->iNodeId], &pCurrent, NULL)) {
+            serviceCenter_clearRemoteNames(pPeer->iNodeId);
+        }
+    }
+    clusterPeer_free(pPeer);
+    eventConnection_release(pConnection);
+}
+
+static bool clusterRouter_isAllowed(clusterRouter_tt* pClusterRouter,
+                                    eventConnection_tt* pConnection)
+{
+    if (pClusterRouter->iAllowCount == 0) {
+        return true;
+    }
+    inetAddress_tt inetAddr;
+    char           szIP[64];
+    eventConnection_getRemoteAddr(pConnection, &inetAddr);
+    if (!inetAddress_toIPString(&inetAddr, szIP, sizeof(szIP))) {
+        return false;
+    }
+    for (int32_t i = 0; i < pClusterRouter->iAllowCount; ++i) {
+        if (strcmp(szIP, pClusterRouter->ppAllowIPs[i]) == 0) {
+            return true;
+        }
+    }
+    Log(eLog_warning, "cluster reject connection from %s", szIP);
+    return false;
+}
+
+static void clusterRouter_onAccept(eventListenPort_tt* pHandle, eventConnection_tt* pConnection,
+                                   const char* pBuffer, uint32_t uiLength, void* pData)
+{
+    if (pConnection == NULL) {
+        return;
+    }
+    clusterRouter_tt* pClusterRouter = (clusterRouter_tt*)pData;
+    if (!clusterRouter_isAllowed(pClusterRouter, pConnection)) {
+        eventConnection_forceClose(pConnection);
+        eventConnection_release(pConnection);
+        return;
+    }
+    eventConnection_setReceiveCallback(pConnection, clusterRouter_onReceive);
+    eventConnection_setDisconnectCallback(pConnection, clusterRouter_onDisconnect);
+    eventConnection_setCloseCallback(pConnection, clusterRouter_onClose);
+    clusterPeer_tt* pPeer = mem_malloc(sizeof(clusterPeer_tt));
+    pPeer->pClusterRouter = pClusterRouter;
+    pPeer->pConnection    = pConnection;
+    pPeer->iNodeId        = -1;
+    clusterRouter_addref(pClusterRouter);
+    spinLock_lock(&pClusterRouter->spinLock);
+    QUEUE_INSERT_TAIL(&pClusterRouter->queuePeers, &pPeer->node);
+    spinLock_unlock(&pClusterRouter->spinLock);
+    if (!eventConnection_bind(pConnection, true, true, pPeer, NULL)) {
+        clusterPeer_free(pPeer);
+        eventConnection_forceClose(pConnection);
+        eventConnection_release(pConnection);
+    }
+}
+
+static void clusterLink_flushCancel(eventAsync_tt* pEventAsync)
+{
+    clusterLink_tt* pLink = container_of(pEventAsync, clusterLink_tt, eventAsync);
+    spinLock_lock(&pLink->spinLock);
+    pLink->bFlushQueued = false;
+    spinLock_unlock(&pLink->spinLock);
+    clusterLink_release(pLink);
+}
+
+// 合并期间累积的所有事件, 一帧一次写出
+static void clusterLink_flush(eventAsync_tt* pEventAsync)
+{
+    clusterLink_tt*     pLink       = container_of(pEventAsync, clusterLink_tt, eventAsync);
+    eventConnection_tt* pConnection = NULL;
+    ioBufVec_tt         bufVec;
+
+    spinLock_lock(&pLink->spinLock);
+    pLink->bFlushQueued = false;
+    if (pLink->pConnection && pLink->nLength > def_clusterFrameHead) {
+        pConnection = pLink->pConnection;
+        eventConnection_addref(pConnection);
+        bufVec.pBuf      = pLink->pBuffer;
+        bufVec.iLength   = (int32_t)pLink->nLength;
+        pLink->pBuffer   = NULL;
+        pLink->nCapacity = 0;
+        pLink->nLength   = def_clusterFrameHead;
+    }
+    spinLock_unlock(&pLink->spinLock);
+
+    if (pConnection) {
+        clusterRouter_writeU32(bufVec.pBuf, (uint32_t)bufVec.iLength - def_clusterFrameHead);
+        eventConnection_send(pConnection, createEventBuf_move(&bufVec, 1, NULL, 0));
+        eventConnection_release(pConnection);
+    }
+    clusterLink_release(pLink);
+}
+
+// 调用前已在锁内置位bFlushQueued, 排队期间持有链路引用
+static inline void clusterLink_queueFlush(clusterLink_tt* pLink)
+{
+    clusterLink_addref(pLink);
+    eventIO_queueInLoop(pLink->pClusterRouter->pEventIO,
+                        &pLink->eventAsync,
+                        clusterLink_flush,
+                        clusterLink_flushCancel);
+}
+
+static void clusterLink_detach(clusterLink_tt* pLink, eventConnection_tt* pConnection)
+{
+    spinLock_lock(&pLink->spinLock);
+    if (pLink->pConnection == pConnection) {
+        pLink->pConnection = NULL;
+        atomic_store(&pLink->iStatus, eLinkIdle);
+        Log(eLog_warning, "cluster node %d disconnected", pLink->iNodeId);
+    }
+    spinLock_unlock(&pLink->spinLock);
+}
+
+static bool clusterLink_onReceive(eventConnection_tt* pConnection, byteQueue_tt* pReadByteQueue,
+                                  void* pData)
+{
+    byteQueue_reset(pReadByteQueue);
+    return true;
+}
+
+static void clusterLink_onDisconnect(eventConnection_tt* pConnection, void* pData)
+{
+    clusterLink_detach((clusterLink_tt*)pData, pConnection);
+    eventConnection_forceClose(pConnection);
+}
+
+static void clusterLink_onClose(eventConnection_tt* pConnection, void* pData)
+{
+    clusterLink_detach((clusterLink_tt*)pData, pConnection);
+    eventConnection_release(pConnection);
+}
+
+static bool clusterLink_append(clusterLink_tt* pLink, uint32_t uiDestinationID,
+                               uint32_t uiSourceID, const void* pData, int32_t iLength,
+                               uint32_t uiFlag, uint32_t uiToken);
+
+typedef struct clusterLinkSync_s
+{
+    clusterLink_tt*     pLink;
+    eventConnection_tt* pConnection;
+} clusterLinkSync_tt;
+
+static void clusterLink_appendName(uint32_t uiServiceID, const char* szName, void* pUserData)
+{
+    clusterLink_append(((clusterLinkSync_tt*)pUserData)->pLink,
+                       0,
+                       uiServiceID,
+                       szName,
+                       (int32_t)strlen(szName),
+                       def_clusterDirectoryBind,
+                       0);
+}
+
+// 在名字表读锁内执行, 此后的名字变更都会作为增量排在快照之后
+static void clusterLink_onSynced(void* pUserData)
+{
+    clusterLinkSync_tt* pSync = (clusterLinkSync_tt*)pUserData;
+    clusterLink_tt*     pLink = pSync->pLink;
+    spinLock_lock(&pLink->spinLock);
+    if (pLink->pConnection == pSync->pConnection) {
+        atomic_store(&pLink->iStatus, eLinkConnected);
+    }
+    spinLock_unlock(&pLink->spinLock);
+}
+
+static void clusterLink_onConnector(eventConnection_tt* pConnection, void* pData)
+{
+    clusterLink_tt* pLink = (clusterLink_tt*)pData;
+    if (!eventConnection_isConnecting(pConnection)) {
+        eventConnection_release(pConnection);
+        atomic_store(&pLink->iStatus, eLinkIdle);
+        return;
+    }
+
+    eventConnection_setReceiveCallback(pConnection, clusterLink_onReceive);
+    eventConnection_setDisconnectCallback(pConnection, clusterLink_onDisconnect);
+    eventConnection_setCloseCallback(pConnection, clusterLink_onClose);
+    // 沿用connect时设置的pLink及其释放回调
+    if (!eventConnection_bind(pConnection, true, true, NULL, NULL)) {
+        eventConnection_release(pConnection);
+        atomic_store(&pLink->iStatus, eLinkIdle);
+        return;
+    }
+
+    spinLock_lock(&pLink->spinLock);
+    if (pLink->bClosed) {
+        spinLock_unlock(&pLink->spinLock);
+        // 连接的引用在关闭回调中释放
+        eventConnection_forceClose(pConnection);
+        return;
+    }
+    pLink->pConnection = pConnection;
+    spinLock_unlock(&pLink->spinLock);
+    Log(eLog_info, "cluster node %d connected", pLink->iNodeId);
+
+    // 未置为已连接前不会追加名字增量, 对端依次收到Reset和全量快照;
+    // 快照与置为已连接在名字表读锁内完成, 之后的增量变更必然排在快照之后.
+    // 名字回调持有名字表写锁再取链路锁, 这里不能反过来在链路锁内遍历名字表
+    clusterLink_append(pLink,
+                       0,
+                       (uint32_t)pLink->pClusterRouter->iServerNodeId << DEF_SERVICE_NODE_SHIFT,
+                       NULL,
+                       0,
+                       def_clusterDirectoryReset,
+                       0);
+    clusterLinkSync_tt sync;
+    sync.pLink       = pLink;
+    sync.pConnection = pConnection;
+    serviceCenter_foreachName(clusterLink_appendName, clusterLink_onSynced, &sync);
+}
+
+static void clusterLink_connect(clusterLink_tt* pLink)
+{
+    int32_t iStatus = eLinkIdle;
+    if (!atomic_compare_exchange_strong(&pLink->iStatus, &iStatus, eLinkConnecting)) {
+        return;
+    }
+
+    eventConnection_tt* pConnection =
+        createEventConnection(pLink->pClusterRouter->pEventIO, &pLink->inetAddr, true);
+    eventConnection_setConnectorCallback(pConnection, clusterLink_onConnector);
+    clusterLink_addref(pLink);
+    if (!eventConnection_connect(pConnection, pLink, clusterLink_onUserFree)) {
+        clusterLink_release(pLink);
+        eventConnection_release(pConnection);
+        atomic_store(&pLink->iStatus, eLinkIdle);
+    }
+}
+
+static bool clusterLink_append(clusterLink_tt* pLink, uint32_t uiDestinationID,
+                               uint32_t uiSourceID, const void* pData, int32_t iLength,
+                               uint32_t uiFlag, uint32_t uiToken)
+{
+    const serviceTraceContext_tt* pTrace = serviceTrace_current();
+    bool   bTrace       = uiDestinationID != 0 && pTrace->uiTraceID != 0;
+    size_t nEventLength =
+        def_clusterEventHead + iLength +
+        (bTrace ? def_clusterEventHead + def_clusterTraceHead : 0);
+    bool   bFlush       = false;
+
+    spinLock_lock(&pLink->spinLock);
+    size_t nNeedLength = pLink->nLength + nEventLength;
+    if (nNeedLength > def_clusterPendingMax) {
+        spinLock_unlock(&pLink->spinLock);
+        return false;
+    }
+
+    if (nNeedLength > pLink->nCapacity) {
+        size_t nCapacity = pLink->nCapacity == 0 ? def_clusterBufferLength : pLink->nCapacity;
+        while (nCapacity < nNeedLength) {
+            nCapacity *= 2;
+        }
+        pLink->pBuffer   = mem_realloc(pLink->pBuffer, nCapacity);
+        pLink->nCapacity = nCapacity;
+    }
+
+    char* pBuffer = pLink->pBuffer + pLink->nLength;
+    if (bTrace) {
+        clusterRouter_writeU32(pBuffer, 0);
+        clusterRouter_writeU32(pBuffer + 4, 0);
+        clusterRouter_writeU32(pBuffer + 8, 0);
+        clusterRouter_writeU32(pBuffer + 12,
+                               def_clusterTraceHead | def_clusterCommandTrace << 24);
+        clusterRouter_writeU64(pBuffer + def_clusterEventHead, pTrace->uiTraceID);
+        clusterRouter_writeU64(pBuffer + def_clusterEventHead + 8, pTrace->uiSpanID);
+        pBuffer += def_clusterEventHead + def_clusterTraceHead;
+    }
+    clusterRouter_writeU32(pBuffer, uiDestinationID);
+    clusterRouter_writeU32(pBuffer + 4, uiSourceID);
+    clusterRouter_writeU32(pBuffer + 8, uiToken);
+    uiFlag &= ~DEF_EVENT_MOVEBUF;
+    clusterRouter_writeU32(pBuffer + 12, (uint32_t)iLength | uiFlag << 24);
+    pBuffer += def_clusterEventHead;
+    if (iLength != 0) {
+        memcpy(pBuffer, pData, iLength);
+    }
+    pLink->nLength = nNeedLength;
+
+    if (pLink->pConnection && !pLink->bFlushQueued) {
+        pLink->bFlushQueued = true;
+        bFlush              = true;
+    }
+    spinLock_unlock(&pLink->spinLock);
+
+    if (bFlush) {
+        clusterLink_queueFlush(pLink);
+    }
+    return true;
+}
+
+static void clusterRouter_onReconnect(eventTimer_tt* pEventTimer, void* pData)
+{
+    clusterRouter_tt* pClusterRouter = s_pClusterRouter;
+    if (pClusterRouter == NULL) {
+        return;
+    }
+    for (int32_t i = 0; i < def_clusterNodeCount; ++i) {
+        clusterLink_tt* pLink = pClusterRouter->pLinks[i];
+        if (pLink && atomic_load(&pLink->iStatus) == eLinkIdle) {
+            clusterLink_connect(pLink);
+        }
+    }
+}
+
+static void clusterRouter_onNameChanged(uint32_t uiServiceID, const char* szName, bool bBind)
+{
+    clusterRouter_tt* pClusterRouter = s_pClusterRouter;
+    if (pClusterRouter == NULL) {
+        return;
+    }
+    int32_t iLength = (int32_t)strlen(szName);
+    for (int32_t i = 0; i < def_clusterNodeCount; ++i) {
+        clusterLink_tt* pLink = pClusterRouter->pLinks[i];
+        if (pLink && atomic_load(&pLink->iStatus) == eLinkConnected) {
+            clusterLink_append(pLink,
+                               0,
+                               uiServiceID,
+                               szName,
+                               iLength,
+                               bBind ? def_clusterDirectoryBind : def_clusterDirectoryUnbind,
+                               0);
+        }
+    }
+}
+
+bool clusterRouter_init(eventIO_tt* pEventIO, int32_t iServerNodeId, const char* szListenAddress,
+                        const char* const* pAllowIPs, int32_t iAllowCount)
+{
+    if (s_pClusterRouter != NULL) {
+        return false;
+    }
+
+    clusterRouter_tt* pClusterRouter = mem_malloc(sizeof(clusterRouter_tt));
+    pClusterRouter->pEventIO         = pEventIO;
+    pClusterRouter->pListenPort      = NULL;
+    pClusterRouter->pReconnectTimer  = NULL;
+    pClusterRouter->iServerNodeId    = iServerNodeId & (def_clusterNodeCount - 1);
+    pClusterRouter->ppAllowIPs       = NULL;
+    pClusterRouter->iAllowCount      = 0;
+    atomic_init(&pClusterRouter->iRefCount, 1);
+    spinLock_init(&pClusterRouter->spinLock);
+    QUEUE_INIT(&pClusterRouter->queuePeers);
+    for (int32_t i = 0; i < def_clusterNodeCount; ++i) {
+        pClusterRouter->pLinks[i] = NULL;
+        atomic_init(&pClusterRouter->pPeers[i], NULL);
+    }
+    eventIO_addref(pEventIO);
+
+    if (iAllowCount > 0) {
+        pClusterRouter->ppAllowIPs = mem_malloc(sizeof(char*) * iAllowCount);
+        for (int32_t i = 0; i < iAllowCount; ++i) {
+            pClusterRouter->ppAllowIPs[i] = mem_strdup(pAllowIPs[i]);
+        }
+        pClusterRouter->iAllowCount = iAllowCount;
+    }
+
+    if (szListenAddress) {
+        inetAddress_tt inetAddr;
+        if (!inetAddress_init_fromIpPort(&inetAddr, szListenAddress)) {
+            Log(eLog_error, "cluster listen address error:%s", szListenAddress);
+            clusterRouter_release(pClusterRouter);
+            return false;
+        }
+        pClusterRouter->pListenPort = createEventListenPort(pEventIO, &inetAddr, true);
+        eventListenPort_setAcceptCallback(pClusterRouter->pListenPort, clusterRouter_onAccept);
+        clusterRouter_addref(pClusterRouter);
+        if (!eventListenPort_start(
+                pClusterRouter->pListenPort, pClusterRouter, clusterRouter_onUserFree)) {
+            Log(eLog_error, "cluster listen error:%s", szListenAddress);
+            clusterRouter_release(pClusterRouter);
+            eventListenPort_release(pClusterRouter->pListenPort);
+            clusterRouter_release(pClusterRouter);
+            return false;
+        }
+    }
+
+    pClusterRouter->pReconnectTimer = createEventTimer(
+        pEventIO, clusterRouter_onReconnect, false, def_clusterReconnectMs, NULL);
+    eventTimer_start(pClusterRouter->pReconnectTimer);
+    s_pClusterRouter = pClusterRouter;
+    serviceCenter_setNameCallback(clusterRouter_onNameChanged);
+    return true;
+}
+
+void clusterRouter_clear()
+{
+    if (s_pClusterRouter != NULL) {
+        serviceCenter_setNameCallback(NULL);
+        clusterRouter_tt* pClusterRouter = s_pClusterRouter;
+        s_pClusterRouter                 = NULL;
+
+        if (pClusterRouter->pReconnectTimer) {
+            eventTimer_stop(pClusterRouter->pReconnectTimer);
+            eventTimer_release(pClusterRouter->pReconnectTimer);
+            pClusterRouter->pReconnectTimer = NULL;
+        }
+
+        if (pClusterRouter->pListenPort) {
+            eventListenPort_close(pClusterRouter->pListenPort);
+            eventListenPort_release(pClusterRouter->pListenPort);
+            pClusterRouter->pListenPort = NULL;
+        }
+
+        // 连接和排队中的flush持有链路引用, 关闭回调/取消回调执行后才真正释放
+        for (int32_t i = 0; i < def_clusterNodeCount; ++i) {
+            clusterLink_tt* pLink = pClusterRouter->pLinks[i];
+            if (pLink) {
+                pClusterRouter->pLinks[i] = NULL;
+                spinLock_lock(&pLink->spinLock);
+                pLink->bClosed                  = true;
+                eventConnection_tt* pConnection = pLink->pConnection;
+                if (pConnection) {
+                    eventConnection_addref(pConnection);
+                }
+                spinLock_unlock(&pLink->spinLock);
+                if (pConnection) {
+                    eventConnection_forceClose(pConnection);
+                    eventConnection_release(pConnection);
+                }
+                clusterLink_release(pLink);
+            }
+        }
+
+        // 关闭回调会把对端移出队列, 先在锁内取出连接再逐个关闭
+        QUEUE*               pNode        = NULL;
+        int32_t              iPeerCount   = 0;
+        eventConnection_tt** ppConnection = NULL;
+        spinLock_lock(&pClusterRouter->spinLock);
+        QUEUE_FOREACH(pNode, &pClusterRouter->queuePeers)
+        {
+            ++iPeerCount;
+        }
+        if (iPeerCount != 0) {
+            ppConnection = mem_malloc(sizeof(eventConnection_tt*) * iPeerCount);
+            iPeerCount   = 0;
+            QUEUE_FOREACH(pNode, &pClusterRouter->queuePeers)
+            {
+                clusterPeer_tt* pPeer = container_of(pNode, clusterPeer_tt, node);
+                eventConnection_addref(pPeer->pConnection);
+                ppConnection[iPeerCount++] = pPeer->pConnection;
+            }
+        }
+        spinLock_unlock(&pClusterRouter->spinLock);
+        for (int32_t i = 0; i < iPeerCount; ++i) {
+            eventConnection_forceClose(ppConnection[i]);
+            eventConnection_release(ppConnection[i]);
+        }
+        if (ppConnection) {
+            mem_free(ppConnection);
+        }
+        clusterRouter_release(pClusterRouter);
+    }
+}
+
+bool clusterRouter_addPeer(int32_t iNodeId, const char* szAddress)
+{
+    clusterRouter_tt* pClusterRouter = s_pClusterRouter;
+    if (pClusterRouter == NULL || iNodeId < 0 || iNodeId >= def_clusterNodeCount ||
+        iNodeId == pClusterRouter->iServerNodeId || pClusterRouter->pLinks[iNodeId] != NULL) {
+        return false;
+    }
+
+    clusterLink_tt* pLink = mem_malloc(sizeof(clusterLink_tt));
+    if (!inetAddress_init_fromIpPort(&pLink->inetAddr, szAddress)) {
+        Log(eLog_error, "cluster node %d address error:%s", iNodeId, szAddress);
+        mem_free(pLink);
+        return false;
+    }
+    pLink->pClusterRouter = pClusterRouter;
+    pLink->iNodeId        = iNodeId;
+    pLink->pConnection    = NULL;
+    pLink->pBuffer        = NULL;
+    pLink->nLength        = def_clusterFrameHead;
+    pLink->nCapacity      = 0;
+    pLink->bFlushQueued   = false;
+    pLink->bClosed        = false;
+    spinLock_init(&pLink->spinLock);
+    atomic_init(&pLink->iStatus, eLinkIdle);
+    atomic_init(&pLink->iRefCount, 1);
+    clusterRouter_addref(pClusterRouter);
+    pClusterRouter->pLinks[iNodeId] = pLink;
+    clusterLink_connect(pLink);
+    return true;
+}
+
+bool clusterRouter_isRemote(uint32_t uiServiceID)
+{
+    clusterRouter_tt* pClusterRouter = s_pClusterRouter;
+    if (pClusterRouter == NULL || (uiServiceID & 0x80000000)) {
+        return false;
+    }
+    int32_t iNodeId = DEF_SERVICE_NODE_ID(uiServiceID);
+    return iNodeId != pClusterRouter->iServerNodeId && pClusterRouter->pLinks[iNodeId] != NULL;
+}
+
+bool clusterRouter_send(uint32_t uiDestinationID, uint32_t uiSourceID, const void* pData,
+                        int32_t iLength, uint32_t uiFlag, uint32_t uiToken)
+{
+    assert(iLength <= 0xFFFFFF);
+    if (!clusterRouter_isRemote(uiDestinationID)) {
+        return false;
+    }
+    clusterLink_tt* pLink = s_pClusterRouter->pLinks[DEF_SERVICE_NODE_ID(uiDestinationID)];
+    return clusterLink_append(
+        pLink, uiDestinationID, uiSourceID, pData, iLength, uiFlag, uiToken);
+}
@@ -2,7 +2,10 @@
 
 #include "serviceCenter_t.h"
 
-#include "rbtree_t.h"
+#include "hazardPointer_t.h"
+#include "log_t.h"
+#include "hash_t.h"
+#include "metrics_t.h"
 #include "rwSpinLock_t.h"
 #include "service_t.h"
 #include "thread_t.h"
@@ -14,32 +17,32 @@
 
 #define DEF_USE_SPINLOCK
 
-#define def_serviceHandleMask 0xfffff
-
-static inline size_t Min(const size_t a, const size_t b)
-{
-    return a < b ? a : b;
-}
+// 服务ID布局见serviceCenter_t.h: 节点8位(256个节点), 单节点最多同时存活131071个服务;
+// 代数6位, 空闲槽位按FIFO复用, 旧ID要在整表轮转64次(约840万次注册)后才可能重新命中
+#define def_serviceHandleIndexMask 0x1ffff
+#define def_serviceHandleGenerationShift 17
+#define def_serviceHandleGenerationMask 0x3f
+#define def_serviceHandleCapacity 0x1ffff
+#define def_serviceNodeMask 0x7f800000
+#define def_serviceNodeShift DEF_SERVICE_NODE_SHIFT
+#define def_serviceNodeCount DEF_SERVICE_NODE_COUNT
 
 typedef struct service_name_s
 {
-    RB_ENTRY(service_name_s)
-    entry;
-    char*    szName;
-    uint32_t uiServiceID;
+    struct service_name_s*  pHashNext;
+    struct service_name_s*  pServiceNext;
+    struct service_name_s** ppServicePrev;
+    uint32_t                uiHash;
+    uint32_t                uiServiceID;
+    char                    szName[];
 } service_name_tt;
 
-static inline int32_t serviceNameNodeCmp(struct service_name_s* pNode1,
-                                         struct service_name_s* pNode2)
+typedef struct serviceHandleSlot_s
 {
-    int32_t iRet = strcmp(pNode1->szName, pNode2->szName);
-    return (iRet < 0 ? -1 : iRet > 0 ? 1 : 0);
-}
-
-RB_HEAD(service_name_tree_s, service_name_s);
-RB_GENERATE_STATIC(service_name_tree_s, service_name_s, entry, serviceNameNodeCmp)
-
-typedef struct service_name_tree_s service_name_tree_tt;
+    void* _Atomic    pServiceHandle;
+    uint32_t         uiGeneration;
+    service_name_tt* pNameList;
+} serviceHandleSlot_tt;
 
 typedef struct serviceCenter_s
 {
@@ -48,40 +51,232 @@ typedef struct serviceCenter_s
 #else
     rwlock_tt rwlock;
 #endif
-    int32_t              iServerNodeId;
-    uint32_t             uiServerNodeMask;
-    service_tt**         ppServiceHandleSlot;
-    int32_t              iServiceHandleSlotCapacity;
-    int32_t*             pServiceHandleSlotIndex;
-    int32_t              iServiceHandleSlotIndexCount;
-    service_name_tree_tt serviceNameTree;
-
+    int32_t               iServerNodeId;
+    uint32_t              uiServerNodeMask;
+    serviceHandleSlot_tt* pServiceHandleSlot;
+    int32_t*              pServiceHandleSlotIndex;
+    int32_t               iServiceHandleSlotIndexHead;
+    int32_t               iServiceHandleSlotIndexCount;
+    hazardPointer_tt*     pHazardPointer;
+    service_name_tt**     ppNameBucket;
+    uint32_t              uiNameBucketMask;
+    int32_t               iNameCount;
+    service_name_tt**     ppRemoteNameList;
+    void (*fnNameCallback)(uint32_t uiServiceID, const char* szName, bool bBind);
 } serviceCenter_tt;
 
 static serviceCenter_tt* s_pServiceCenter = NULL;
 
+static void serviceCenter_reclaim(void* pData)
+{
+    service_release((service_tt*)pData);
+}
+
+static inline bool serviceCenter_isLocal(serviceCenter_tt* pServiceCenter, uint32_t uiServiceID)
+{
+    return (uiServiceID & 0x80000000) == 0 &&
+           (uiServiceID & def_serviceNodeMask) == pServiceCenter->uiServerNodeMask &&
+           (uiServiceID & def_serviceHandleIndexMask) != 0;
+}
+
+static inline uint32_t serviceCenter_nameHash(const char* szName)
+{
+    return fnv32(szName, FNV_32_HASH_START);
+}
+
+static service_name_tt* serviceCenter_findName(serviceCenter_tt* pServiceCenter,
+                                               const char* szName, uint32_t uiHash)
+{
+    service_name_tt* pNode =
+        pServiceCenter->ppNameBucket[uiHash & pServiceCenter->uiNameBucketMask];
+    while (pNode) {
+        if (pNode->uiHash == uiHash && strcmp(pNode->szName, szName) == 0) {
+            return pNode;
+        }
+        pNode = pNode->pHashNext;
+    }
+    return NULL;
+}
+
+static void serviceCenter_growName(serviceCenter_tt* pServiceCenter)
+{
+    uint32_t          uiNewMask   = (pServiceCenter->uiNameBucketMask << 1) | 1;
+    service_name_tt** ppNewBucket = mem_malloc((uiNewMask + 1) * sizeof(service_name_tt*));
+    bzero(ppNewBucket, (uiNewMask + 1) * sizeof(service_name_tt*));
+    for (uint32_t i = 0; i <= pServiceCenter->uiNameBucketMask; ++i) {
+        service_name_tt* pNode = pServiceCenter->ppNameBucket[i];
+        while (pNode) {
+            service_name_tt* pNext = pNode->pHashNext;
+            pNode->pHashNext       = ppNewBucket[pNode->uiHash & uiNewMask];
+            ppNewBucket[pNode->uiHash & uiNewMask] = pNode;
+            pNode                                  = pNext;
+        }
+    }
+    mem_free(pServiceCenter->ppNameBucket);
+    pServiceCenter->ppNameBucket     = ppNewBucket;
+    pServiceCenter->uiNameBucketMask = uiNewMask;
+}
+
+static inline bool serviceCenter_isRemote(serviceCenter_tt* pServiceCenter, uint32_t uiServiceID)
+{
+    return (uiServiceID & 0x80000000) == 0 &&
+           (uiServiceID & def_serviceNodeMask) != pServiceCenter->uiServerNodeMask &&
+           (uiServiceID & def_serviceHandleIndexMask) != 0;
+}
+
+static service_name_tt* serviceCenter_insertName(serviceCenter_tt* pServiceCenter,
+                                                 const char* szName, uint32_t uiHash,
+                                                 uint32_t uiServiceID, service_name_tt** ppList)
+{
+    if (pServiceCenter->iNameCount > (int32_t)pServiceCenter->uiNameBucketMask) {
+        serviceCenter_growName(pServiceCenter);
+    }
+    size_t           nLength = strlen(szName);
+    service_name_tt* pNode   = mem_malloc(sizeof(service_name_tt) + nLength + 1);
+    memcpy(pNode->szName, szName, nLength + 1);
+    pNode->uiHash      = uiHash;
+    pNode->uiServiceID = uiServiceID;
+
+    service_name_tt** ppBucket =
+        &pServiceCenter->ppNameBucket[uiHash & pServiceCenter->uiNameBucketMask];
+    pNode->pHashNext = *ppBucket;
+    *ppBucket        = pNode;
+
+    pNode->pServiceNext  = *ppList;
+    pNode->ppServicePrev = ppList;
+    if (*ppList) {
+        (*ppList)->ppServicePrev = &pNode->pServiceNext;
+    }
+    *ppList = pNode;
+    ++pServiceCenter->iNameCount;
+    return pNode;
+}
+
+static void serviceCenter_removeName(serviceCenter_tt* pServiceCenter, service_name_tt* pNode)
+{
+    if (pServiceCenter->fnNameCallback &&
+        serviceCenter_isLocal(pServiceCenter, pNode->uiServiceID)) {
+        pServiceCenter->fnNameCallback(pNode->uiServiceID, pNode->szName, false);
+    }
+
+    service_name_tt** ppNode =
+        &pServiceCenter->ppNameBucket[pNode->uiHash & pServiceCenter->uiNameBucketMask];
+    while (*ppNode != pNode) {
+        ppNode = &(*ppNode)->pHashNext;
+    }
+    *ppNode = pNode->pHashNext;
+
+    *pNode->ppServicePrev = pNode->pServiceNext;
+    if (pNode->pServiceNext) {
+        pNode->pServiceNext->ppServicePrev = pNode->ppServicePrev;
+    }
+    --pServiceCenter->iNameCount;
+    mem_free(pNode);
+}
+
+static inline bool serviceCenter_removeNames(serviceCenter_tt* pServiceCenter,
+                                             serviceHandleSlot_tt* pSlot)
+{
+    if (pSlot->pNameList == NULL) {
+        return false;
+    }
+    while (pSlot->pNameList) {
+        serviceCenter_removeName(pServiceCenter, pSlot->pNameList);
+    }
+    return true;
+}
+
+static inline serviceHandleSlot_tt* serviceCenter_liveSlot(serviceCenter_tt* pServiceCenter,
+                                                           uint32_t          uiServiceID)
+{
+    serviceHandleSlot_tt* pSlot =
+        &pServiceCenter->pServiceHandleSlot[(uiServiceID & def_serviceHandleIndexMask) - 1];
+    service_tt* pServiceHandle = atomic_load(&pSlot->pServiceHandle);
+    if (pServiceHandle && service_getID(pServiceHandle) == uiServiceID) {
+        return pSlot;
+    }
+    return NULL;
+}
+
+typedef struct serviceCenterMetrics_s
+{
+    metricsGauge_tt* pServices;
+    metricsGauge_tt* pQueueDepth;
+    metricsGauge_tt* pQueueDepthMax;
+    metricsGauge_tt* pQueueBytes;
+    metricsGauge_tt* pMemory;
+} serviceCenterMetrics_tt;
+
+typedef struct serviceCenterSample_s
+{
+    uint32_t uiServices;
+    uint64_t uiQueueDepth;
+    uint32_t uiQueueDepthMax;
+    uint64_t uiQueueBytes;
+    uint64_t uiMemory;
+} serviceCenterSample_tt;
+
+static serviceCenterMetrics_tt s_serviceCenterMetrics;
+
+static void serviceCenter_sampleService(service_tt* pService, void* pUserData)
+{
+    serviceCenterSample_tt* pSample     = (serviceCenterSample_tt*)pUserData;
+    uint32_t                uiQueueSize = service_queueSize(pService);
+    size_t                  nMemoryPeak = 0;
+    ++pSample->uiServices;
+    pSample->uiQueueDepth += uiQueueSize;
+    if (uiQueueSize > pSample->uiQueueDepthMax) {
+        pSample->uiQueueDepthMax = uiQueueSize;
+    }
+    pSample->uiQueueBytes += service_queueBytes(pService);
+    pSample->uiMemory += service_getMemoryUsage(pService, &nMemoryPeak);
+}
+
+static void serviceCenter_collectMetrics(void* pUserData)
+{
+    serviceCenterMetrics_tt* pMetrics = (serviceCenterMetrics_tt*)pUserData;
+    serviceCenterSample_tt   sample   = {0, 0, 0, 0, 0};
+    serviceCenter_foreachService(serviceCenter_sampleService, &sample);
+    metricsGauge_set(pMetrics->pServices, sample.uiServices);
+    metricsGauge_set(pMetrics->pQueueDepth, (double)sample.uiQueueDepth);
+    metricsGauge_set(pMetrics->pQueueDepthMax, sample.uiQueueDepthMax);
+    metricsGauge_set(pMetrics->pQueueBytes, (double)sample.uiQueueBytes);
+    metricsGauge_set(pMetrics->pMemory, (double)sample.uiMemory);
+}
+
 void serviceCenter_init(int32_t iServerNodeId)
 {
     if (s_pServiceCenter == NULL) {
         serviceCenter_tt* pServiceCenter = mem_malloc(sizeof(serviceCenter_tt));
 
-        pServiceCenter->iServiceHandleSlotCapacity = 64;
-        pServiceCenter->ppServiceHandleSlot =
-            mem_malloc(pServiceCenter->iServiceHandleSlotCapacity * sizeof(service_tt*));
-        bzero(pServiceCenter->ppServiceHandleSlot,
-              pServiceCenter->iServiceHandleSlotCapacity * sizeof(service_tt*));
-        pServiceCenter->iServiceHandleSlotIndexCount = pServiceCenter->iServiceHandleSlotCapacity;
+        pServiceCenter->pServiceHandleSlot =
+            mem_malloc(def_serviceHandleCapacity * sizeof(serviceHandleSlot_tt));
+        for (int32_t i = 0; i < def_serviceHandleCapacity; ++i) {
+            atomic_init(&pServiceCenter->pServiceHandleSlot[i].pServiceHandle, NULL);
+            pServiceCenter->pServiceHandleSlot[i].uiGeneration = 0;
+            pServiceCenter->pServiceHandleSlot[i].pNameList    = NULL;
+        }
         pServiceCenter->pServiceHandleSlotIndex =
-            mem_malloc(pServiceCenter->iServiceHandleSlotIndexCount * sizeof(int32_t));
-        for (int32_t i = 0; i < pServiceCenter->iServiceHandleSlotIndexCount; ++i) {
-            pServiceCenter->pServiceHandleSlotIndex[i] =
-                pServiceCenter->iServiceHandleSlotCapacity - i - 1;
+            mem_malloc(def_serviceHandleCapacity * sizeof(int32_t));
+        for (int32_t i = 0; i < def_serviceHandleCapacity; ++i) {
+            pServiceCenter->pServiceHandleSlotIndex[i] = i;
         }
-
-        RB_INIT(&pServiceCenter->serviceNameTree);
-
-        pServiceCenter->uiServerNodeMask = (iServerNodeId & 0x7ff) << 20;
-        pServiceCenter->iServerNodeId    = iServerNodeId;
+        pServiceCenter->iServiceHandleSlotIndexHead  = 0;
+        pServiceCenter->iServiceHandleSlotIndexCount = def_serviceHandleCapacity;
+        pServiceCenter->pHazardPointer = createHazardPointer(serviceCenter_reclaim);
+
+        pServiceCenter->uiNameBucketMask = 63;
+        pServiceCenter->iNameCount       = 0;
+        pServiceCenter->ppNameBucket =
+            mem_malloc((pServiceCenter->uiNameBucketMask + 1) * sizeof(service_name_tt*));
+        bzero(pServiceCenter->ppNameBucket,
+              (pServiceCenter->uiNameBucketMask + 1) * sizeof(service_name_tt*));
+        pServiceCenter->ppRemoteNameList = NULL;
+        pServiceCenter->fnNameCallback   = NULL;
+
+        pServiceCenter->uiServerNodeMask =
+            (uint32_t)(iServerNodeId & (def_serviceNodeCount - 1)) << def_serviceNodeShift;
+        pServiceCenter->iServerNodeId = iServerNodeId;
 
 #ifdef DEF_USE_SPINLOCK
         rwSpinLock_init(&pServiceCenter->rwlock);
@@ -89,6 +284,18 @@ void serviceCenter_init(int32_t iServerNodeId)
         rwlock_init(&pServiceCenter->rwlock);
 #endif
         s_pServiceCenter = pServiceCenter;
+
+        s_serviceCenterMetrics.pServices =
+            metrics_registerGauge("frog_services", "Services registered on this node");
+        s_serviceCenterMetrics.pQueueDepth =
+            metrics_registerGauge("frog_service_queue_depth", "Messages waiting in all mailboxes");
+        s_serviceCenterMetrics.pQueueDepthMax = metrics_registerGauge(
+            "frog_service_queue_depth_max", "Deepest mailbox on this node");
+        s_serviceCenterMetrics.pQueueBytes = metrics_registerGauge(
+            "frog_service_queue_bytes", "Payload bytes waiting in all mailboxes");
+        s_serviceCenterMetrics.pMemory =
+            metrics_registerGauge("frog_service_memory_bytes", "Memory reported by services");
+        metrics_addCollector(serviceCenter_collectMetrics, &s_serviceCenterMetrics);
     }
 }
 
@@ -102,106 +309,73 @@ uint32_t serviceCenter_register(struct service_s* pServiceHandle)
         rwlock_wrlock(&pServiceCenter->rwlock);
 #endif
         if (pServiceCenter->iServiceHandleSlotIndexCount == 0) {
-            if (pServiceCenter->iServiceHandleSlotCapacity == 0xfffff) {
 #ifdef DEF_USE_SPINLOCK
-                rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+            rwSpinLock_wrunlock(&pServiceCenter->rwlock);
 #else
-                rwlock_wrunlock(&pServiceCenter->rwlock);
+            rwlock_wrunlock(&pServiceCenter->rwlock);
 #endif
-                return 0;
-            }
-
-            int32_t iOldServiceHandleSlotCapacity = pServiceCenter->iServiceHandleSlotCapacity;
-            pServiceCenter->iServiceHandleSlotCapacity =
-                (int32_t)Min(iOldServiceHandleSlotCapacity * 2, 0xfffff);
-            pServiceCenter->ppServiceHandleSlot =
-                mem_realloc(pServiceCenter->ppServiceHandleSlot,
-                            pServiceCenter->iServiceHandleSlotCapacity * sizeof(service_tt*));
-            int32_t iAddServiceHandleSlotCount =
-                pServiceCenter->iServiceHandleSlotCapacity - iOldServiceHandleSlotCapacity;
-
-            mem_free(pServiceCenter->pServiceHandleSlotIndex);
-            pServiceCenter->pServiceHandleSlotIndex =
-                mem_malloc(pServiceCenter->iServiceHandleSlotCapacity * sizeof(int32_t));
-            pServiceCenter->iServiceHandleSlotIndexCount = iAddServiceHandleSlotCount;
-
-            for (int32_t i = 0; i < pServiceCenter->iServiceHandleSlotIndexCount; ++i) {
-                pServiceCenter->pServiceHandleSlotIndex[i] =
-                    pServiceCenter->iServiceHandleSlotCapacity - i - 1;
-            }
+            Log(eLog_error,
+                "serviceCenter_register: %d service handles in use",
+                def_serviceHandleCapacity);
+            return 0;
         }
 
-        --pServiceCenter->iServiceHandleSlotIndexCount;
         int32_t iIndex =
-            pServiceCenter->pServiceHandleSlotIndex[pServiceCenter->iServiceHandleSlotIndexCount];
+            pServiceCenter->pServiceHandleSlotIndex[pServiceCenter->iServiceHandleSlotIndexHead];
+        pServiceCenter->iServiceHandleSlotIndexHead =
+            (pServiceCenter->iServiceHandleSlotIndexHead + 1) % def_serviceHandleCapacity;
+        --pServiceCenter->iServiceHandleSlotIndexCount;
+
+        serviceHandleSlot_tt* pSlot = &pServiceCenter->pServiceHandleSlot[iIndex];
         service_addref(pServiceHandle);
-        pServiceCenter->ppServiceHandleSlot[iIndex] = pServiceHandle;
+        atomic_store(&pSlot->pServiceHandle, pServiceHandle);
+        uint32_t uiServiceID = pServiceCenter->uiServerNodeMask |
+                               (pSlot->uiGeneration << def_serviceHandleGenerationShift) |
+                               (iIndex + 1);
 #ifdef DEF_USE_SPINLOCK
         rwSpinLock_wrunlock(&pServiceCenter->rwlock);
 #else
         rwlock_wrunlock(&pServiceCenter->rwlock);
 #endif
-        return pServiceCenter->uiServerNodeMask | (iIndex + 1);
+        return uiServiceID;
     }
     return 0;
 }
 
-static inline bool serviceCenter_removeName(uint32_t uiServiceID)
-{
-    if (uiServiceID != 0) {
-        serviceCenter_tt* pServiceCenter = s_pServiceCenter;
-        if (pServiceCenter) {
-            service_name_tt* pNode;
-            RB_FOREACH(pNode, service_name_tree_s, &pServiceCenter->serviceNameTree)
-            {
-                if (pNode->uiServiceID == uiServiceID) {
-                    RB_REMOVE(service_name_tree_s, &pServiceCenter->serviceNameTree, pNode);
-                    mem_free(pNode->szName);
-                    mem_free(pNode);
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
-}
-
 bool serviceCenter_deregister(uint32_t uiServiceID)
 {
-    if (uiServiceID != 0) {
-        serviceCenter_tt* pServiceCenter = s_pServiceCenter;
-        if (pServiceCenter) {
-            if (uiServiceID & pServiceCenter->uiServerNodeMask) {
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter && serviceCenter_isLocal(pServiceCenter, uiServiceID)) {
+        int32_t               iIndex = (uiServiceID & def_serviceHandleIndexMask) - 1;
+        serviceHandleSlot_tt* pSlot  = &pServiceCenter->pServiceHandleSlot[iIndex];
 #ifdef DEF_USE_SPINLOCK
-                rwSpinLock_wrlock(&pServiceCenter->rwlock);
+        rwSpinLock_wrlock(&pServiceCenter->rwlock);
 #else
-                rwlock_wrlock(&pServiceCenter->rwlock);
-#endif
-                int32_t iIndex = (uiServiceID & def_serviceHandleMask) - 1;
-                if (iIndex < pServiceCenter->iServiceHandleSlotCapacity) {
-                    service_tt* pServiceHandle = pServiceCenter->ppServiceHandleSlot[iIndex];
-                    if (pServiceHandle && service_getID(pServiceHandle) == uiServiceID) {
-                        serviceCenter_removeName(uiServiceID);
-                        service_release(pServiceHandle);
-                        pServiceCenter->ppServiceHandleSlot[iIndex] = NULL;
-                        pServiceCenter->pServiceHandleSlotIndex
-                            [pServiceCenter->iServiceHandleSlotIndexCount] = iIndex;
-                        ++(pServiceCenter->iServiceHandleSlotIndexCount);
+        rwlock_wrlock(&pServiceCenter->rwlock);
+#endif
+        service_tt* pServiceHandle = atomic_load(&pSlot->pServiceHandle);
+        if (pServiceHandle && service_getID(pServiceHandle) == uiServiceID) {
+            serviceCenter_removeNames(pServiceCenter, pSlot);
+            atomic_store(&pSlot->pServiceHandle, NULL);
+            pSlot->uiGeneration = (pSlot->uiGeneration + 1) & def_serviceHandleGenerationMask;
+            pServiceCenter->pServiceHandleSlotIndex
+                [(pServiceCenter->iServiceHandleSlotIndexHead +
+                  pServiceCenter->iServiceHandleSlotIndexCount) %
+                 def_serviceHandleCapacity] = iIndex;
+            ++(pServiceCenter->iServiceHandleSlotIndexCount);
 #ifdef DEF_USE_SPINLOCK
-                        rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+            rwSpinLock_wrunlock(&pServiceCenter->rwlock);
 #else
-                        rwlock_wrunlock(&pServiceCenter->rwlock);
+            rwlock_wrunlock(&pServiceCenter->rwlock);
 #endif
-                        return true;
-                    }
-                }
+            hazardPointer_retire(pServiceCenter->pHazardPointer, pServiceHandle);
+            return true;
+        }
 #ifdef DEF_USE_SPINLOCK
-                rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+        rwSpinLock_wrunlock(&pServiceCenter->rwlock);
 #else
-                rwlock_wrunlock(&pServiceCenter->rwlock);
+        rwlock_wrunlock(&pServiceCenter->rwlock);
 #endif
-            }
-        }
     }
     return false;
 }
@@ -209,23 +383,43 @@ bool serviceCenter_deregister(uint32_t uiServiceID)
 void serviceCenter_clear()
 {
     if (s_pServiceCenter != NULL) {
+        metrics_removeCollector(serviceCenter_collectMetrics, &s_serviceCenterMetrics);
         serviceCenter_tt* pServiceCenter = s_pServiceCenter;
         s_pServiceCenter                 = NULL;
 
-        if (pServiceCenter->ppServiceHandleSlot) {
-            for (int32_t i = 0; i < pServiceCenter->iServiceHandleSlotCapacity; ++i) {
-                if (pServiceCenter->ppServiceHandleSlot[i] != NULL) {
-                    serviceCenter_deregister(service_getID(pServiceCenter->ppServiceHandleSlot[i]));
+        if (pServiceCenter->pServiceHandleSlot) {
+            for (int32_t i = 0; i < def_serviceHandleCapacity; ++i) {
+                service_tt* pServiceHandle =
+                    atomic_load(&pServiceCenter->pServiceHandleSlot[i].pServiceHandle);
+                if (pServiceHandle != NULL) {
+                    service_release(pServiceHandle);
                 }
             }
-            mem_free(pServiceCenter->ppServiceHandleSlot);
-            pServiceCenter->ppServiceHandleSlot = NULL;
+            mem_free(pServiceCenter->pServiceHandleSlot);
+            pServiceCenter->pServiceHandleSlot = NULL;
         }
 
         if (pServiceCenter->pServiceHandleSlotIndex) {
             mem_free(pServiceCenter->pServiceHandleSlotIndex);
             pServiceCenter->pServiceHandleSlotIndex = NULL;
         }
+
+        for (uint32_t i = 0; i <= pServiceCenter->uiNameBucketMask; ++i) {
+            service_name_tt* pNode = pServiceCenter->ppNameBucket[i];
+            while (pNode) {
+                service_name_tt* pNext = pNode->pHashNext;
+                mem_free(pNode);
+                pNode = pNext;
+            }
+        }
+        mem_free(pServiceCenter->ppNameBucket);
+        pServiceCenter->ppNameBucket = NULL;
+        if (pServiceCenter->ppRemoteNameList) {
+            mem_free(pServiceCenter->ppRemoteNameList);
+            pServiceCenter->ppRemoteNameList = NULL;
+        }
+
+        hazardPointer_release(pServiceCenter->pHazardPointer);
 #ifndef DEF_USE_SPINLOCK
         rwlock_destroy(&pServiceCenter->rwlock);
 #endif
@@ -235,124 +429,328 @@ void serviceCenter_clear()
 
 service_tt* serviceCenter_gain(uint32_t uiServiceID)
 {
-    if (uiServiceID != 0) {
-        serviceCenter_tt* pServiceCenter = s_pServiceCenter;
-        if (pServiceCenter) {
-            if (uiServiceID & pServiceCenter->uiServerNodeMask) {
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter && serviceCenter_isLocal(pServiceCenter, uiServiceID)) {
+        int32_t     iIndex         = (uiServiceID & def_serviceHandleIndexMask) - 1;
+        service_tt* pServiceHandle = hazardPointer_protect(
+            &pServiceCenter->pServiceHandleSlot[iIndex].pServiceHandle);
+        if (pServiceHandle && service_getID(pServiceHandle) == uiServiceID) {
+            service_addref(pServiceHandle);
+            hazardPointer_clear();
+            return pServiceHandle;
+        }
+        hazardPointer_clear();
+    }
+    return NULL;
+}
+
+bool serviceCenter_bindName(uint32_t uiServiceID, const char* szName)
+{
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter && serviceCenter_isLocal(pServiceCenter, uiServiceID)) {
+        uint32_t uiHash = serviceCenter_nameHash(szName);
 #ifdef DEF_USE_SPINLOCK
-                rwSpinLock_rdlock(&pServiceCenter->rwlock);
+        rwSpinLock_wrlock(&pServiceCenter->rwlock);
 #else
-                rwlock_rdlock(&pServiceCenter->rwlock);
+        rwlock_wrlock(&pServiceCenter->rwlock);
 #endif
-                int32_t iIndex = (uiServiceID & def_serviceHandleMask) - 1;
-                if (iIndex < pServiceCenter->iServiceHandleSlotCapacity) {
-                    service_tt* pServiceHandle = pServiceCenter->ppServiceHandleSlot[iIndex];
-                    if (pServiceHandle && service_getID(pServiceHandle) == uiServiceID) {
-                        service_addref(pServiceHandle);
+        serviceHandleSlot_tt* pSlot = serviceCenter_liveSlot(pServiceCenter, uiServiceID);
+        if (pSlot && serviceCenter_findName(pServiceCenter, szName, uiHash) == NULL) {
+            serviceCenter_insertName(
+                pServiceCenter, szName, uiHash, uiServiceID, &pSlot->pNameList);
+            if (pServiceCenter->fnNameCallback) {
+                pServiceCenter->fnNameCallback(uiServiceID, szName, true);
+            }
 #ifdef DEF_USE_SPINLOCK
-                        rwSpinLock_rdunlock(&pServiceCenter->rwlock);
+            rwSpinLock_wrunlock(&pServiceCenter->rwlock);
 #else
-                        rwlock_rdunlock(&pServiceCenter->rwlock);
+            rwlock_wrunlock(&pServiceCenter->rwlock);
 #endif
-                        return pServiceHandle;
-                    }
-                }
+            return true;
+        }
 #ifdef DEF_USE_SPINLOCK
-                rwSpinLock_rdunlock(&pServiceCenter->rwlock);
+        rwSpinLock_wrunlock(&pServiceCenter->rwlock);
 #else
-                rwlock_rdunlock(&pServiceCenter->rwlock);
+        rwlock_wrunlock(&pServiceCenter->rwlock);
 #endif
-            }
-        }
     }
-    return NULL;
+    return false;
 }
 
-bool serviceCenter_bindName(uint32_t uiServiceID, const char* szName)
+bool serviceCenter_unbindName(uint32_t uiServiceID)
 {
-    if (!(uiServiceID & 0x80000000)) {
-        serviceCenter_tt* pServiceCenter = s_pServiceCenter;
-        if (pServiceCenter) {
-            if (uiServiceID & pServiceCenter->uiServerNodeMask) {
-                service_name_tt* pNode = mem_malloc(sizeof(service_name_tt));
-                pNode->szName          = mem_strdup(szName);
-                pNode->uiServiceID     = uiServiceID;
+    bool              bRemove        = false;
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter && serviceCenter_isLocal(pServiceCenter, uiServiceID)) {
 #ifdef DEF_USE_SPINLOCK
-                rwSpinLock_wrlock(&pServiceCenter->rwlock);
+        rwSpinLock_wrlock(&pServiceCenter->rwlock);
 #else
-                rwlock_wrlock(&pServiceCenter->rwlock);
+        rwlock_wrlock(&pServiceCenter->rwlock);
 #endif
-                if (RB_INSERT(service_name_tree_s, &pServiceCenter->serviceNameTree, pNode) ==
-                    NULL) {
+        serviceHandleSlot_tt* pSlot = serviceCenter_liveSlot(pServiceCenter, uiServiceID);
+        if (pSlot) {
+            bRemove = serviceCenter_removeNames(pServiceCenter, pSlot);
+        }
 #ifdef DEF_USE_SPINLOCK
-                    rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+        rwSpinLock_wrunlock(&pServiceCenter->rwlock);
 #else
-                    rwlock_wrunlock(&pServiceCenter->rwlock);
+        rwlock_wrunlock(&pServiceCenter->rwlock);
 #endif
-                    return true;
-                }
+    }
+    return bRemove;
+}
+
+bool serviceCenter_unbindServiceName(const char* szName)
+{
+    bool              bRemove        = false;
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter) {
+        uint32_t uiHash = serviceCenter_nameHash(szName);
 #ifdef DEF_USE_SPINLOCK
-                rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+        rwSpinLock_wrlock(&pServiceCenter->rwlock);
 #else
-                rwlock_wrunlock(&pServiceCenter->rwlock);
+        rwlock_wrlock(&pServiceCenter->rwlock);
 #endif
-                mem_free(pNode);
-            }
+        service_name_tt* pNode = serviceCenter_findName(pServiceCenter, szName, uiHash);
+        if (pNode && serviceCenter_isLocal(pServiceCenter, pNode->uiServiceID)) {
+            serviceCenter_removeName(pServiceCenter, pNode);
+            bRemove = true;
         }
+#ifdef DEF_USE_SPINLOCK
+        rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+#else
+        rwlock_wrunlock(&pServiceCenter->rwlock);
+#endif
     }
-    return false;
+    return bRemove;
 }
 
-bool serviceCenter_unbindName(uint32_t uiServiceID)
+uint32_t serviceCenter_findServiceID(const char* szName)
 {
-    bool bRemove = false;
-    if (uiServiceID != 0) {
-        serviceCenter_tt* pServiceCenter = s_pServiceCenter;
-        if (pServiceCenter) {
+    uint32_t          uiServiceID    = 0;
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter) {
+        uint32_t uiHash = serviceCenter_nameHash(szName);
 #ifdef DEF_USE_SPINLOCK
-            rwSpinLock_wrlock(&pServiceCenter->rwlock);
+        rwSpinLock_rdlock(&pServiceCenter->rwlock);
 #else
-            rwlock_wrlock(&pServiceCenter->rwlock);
+        rwlock_rdlock(&pServiceCenter->rwlock);
 #endif
-            bRemove = serviceCenter_removeName(uiServiceID);
+        service_name_tt* pNode = serviceCenter_findName(pServiceCenter, szName, uiHash);
+        if (pNode) {
+            uiServiceID = pNode->uiServiceID;
+        }
 #ifdef DEF_USE_SPINLOCK
-            rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+        rwSpinLock_rdunlock(&pServiceCenter->rwlock);
 #else
-            rwlock_wrunlock(&pServiceCenter->rwlock);
+        rwlock_rdunlock(&pServiceCenter->rwlock);
 #endif
+    }
+    return uiServiceID;
+}
+
+int32_t serviceCenter_findServiceIDs(const char* const* pNames, int32_t iCount,
+                                     uint32_t* pServiceIDs)
+{
+    int32_t           iFound         = 0;
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter == NULL) {
+        bzero(pServiceIDs, iCount * sizeof(uint32_t));
+        return 0;
+    }
+
+#ifdef DEF_USE_SPINLOCK
+    rwSpinLock_rdlock(&pServiceCenter->rwlock);
+#else
+    rwlock_rdlock(&pServiceCenter->rwlock);
+#endif
+    for (int32_t i = 0; i < iCount; ++i) {
+        service_name_tt* pNode = NULL;
+        if (pNames[i]) {
+            pNode = serviceCenter_findName(
+                pServiceCenter, pNames[i], serviceCenter_nameHash(pNames[i]));
+        }
+        if (pNode) {
+            pServiceIDs[i] = pNode->uiServiceID;
+            ++iFound;
+        }
+        else {
+            pServiceIDs[i] = 0;
         }
     }
-    return bRemove;
+#ifdef DEF_USE_SPINLOCK
+    rwSpinLock_rdunlock(&pServiceCenter->rwlock);
+#else
+    rwlock_rdunlock(&pServiceCenter->rwlock);
+#endif
+    return iFound;
 }
 
-uint32_t serviceCenter_findServiceID(const char* szName)
+void serviceCenter_foreachService(void (*fnService)(service_tt* pService, void* pUserData),
+                                  void* pUserData)
 {
-    uint32_t          uiServiceID    = 0;
     serviceCenter_tt* pServiceCenter = s_pServiceCenter;
     if (pServiceCenter) {
-        service_name_tt dataNode;
-        dataNode.szName = (char*)szName;
 #ifdef DEF_USE_SPINLOCK
         rwSpinLock_rdlock(&pServiceCenter->rwlock);
 #else
         rwlock_rdlock(&pServiceCenter->rwlock);
 #endif
-        service_name_tt* pNode =
-            RB_FIND(service_name_tree_s, &pServiceCenter->serviceNameTree, &dataNode);
-        if (pNode == NULL) {
+        for (int32_t i = 0; i < def_serviceHandleCapacity; ++i) {
+            service_tt* pServiceHandle =
+                atomic_load(&pServiceCenter->pServiceHandleSlot[i].pServiceHandle);
+            if (pServiceHandle) {
+                fnService(pServiceHandle, pUserData);
+            }
+        }
 #ifdef DEF_USE_SPINLOCK
-            rwSpinLock_rdunlock(&pServiceCenter->rwlock);
+        rwSpinLock_rdunlock(&pServiceCenter->rwlock);
 #else
-            rwlock_rdunlock(&pServiceCenter->rwlock);
+        rwlock_rdunlock(&pServiceCenter->rwlock);
 #endif
-            return 0;
+    }
+}
+
+void serviceCenter_setNameCallback(void (*fnNameCallback)(uint32_t uiServiceID, const char* szName,
+                                                         bool bBind))
+{
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter) {
+#ifdef DEF_USE_SPINLOCK
+        rwSpinLock_wrlock(&pServiceCenter->rwlock);
+#else
+        rwlock_wrlock(&pServiceCenter->rwlock);
+#endif
+        pServiceCenter->fnNameCallback = fnNameCallback;
+#ifdef DEF_USE_SPINLOCK
+        rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+#else
+        rwlock_wrunlock(&pServiceCenter->rwlock);
+#endif
+    }
+}
+
+void serviceCenter_foreachName(void (*fnName)(uint32_t uiServiceID, const char* szName,
+                                              void* pUserData),
+                               void (*fnDone)(void* pUserData), void* pUserData)
+{
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter) {
+#ifdef DEF_USE_SPINLOCK
+        rwSpinLock_rdlock(&pServiceCenter->rwlock);
+#else
+        rwlock_rdlock(&pServiceCenter->rwlock);
+#endif
+        for (uint32_t i = 0; i <= pServiceCenter->uiNameBucketMask; ++i) {
+            service_name_tt* pNode = pServiceCenter->ppNameBucket[i];
+            while (pNode) {
+                if (serviceCenter_isLocal(pServiceCenter, pNode->uiServiceID)) {
+                    fnName(pNode->uiServiceID, pNode->szName, pUserData);
+                }
+                pNode = pNode->pHashNext;
+            }
+        }
+        if (fnDone) {
+            fnDone(pUserData);
         }
-        uiServiceID = pNode->uiServiceID;
 #ifdef DEF_USE_SPINLOCK
         rwSpinLock_rdunlock(&pServiceCenter->rwlock);
 #else
         rwlock_rdunlock(&pServiceCenter->rwlock);
 #endif
     }
-    return uiServiceID;
+    else if (fnDone) {
+        fnDone(pUserData);
+    }
+}
+
+bool serviceCenter_bindRemoteName(uint32_t uiServiceID, const char* szName)
+{
+    bool              bBind          = false;
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter && serviceCenter_isRemote(pServiceCenter, uiServiceID)) {
+        uint32_t uiHash = serviceCenter_nameHash(szName);
+#ifdef DEF_USE_SPINLOCK
+        rwSpinLock_wrlock(&pServiceCenter->rwlock);
+#else
+        rwlock_wrlock(&pServiceCenter->rwlock);
+#endif
+        // 本地名字优先, 远端同名则以最新的为准
+        service_name_tt* pNode = serviceCenter_findName(pServiceCenter, szName, uiHash);
+        if (pNode && !serviceCenter_isLocal(pServiceCenter, pNode->uiServiceID)) {
+            serviceCenter_removeName(pServiceCenter, pNode);
+            pNode = NULL;
+        }
+
+        if (pNode == NULL) {
+            if (pServiceCenter->ppRemoteNameList == NULL) {
+                pServiceCenter->ppRemoteNameList =
+                    mem_malloc(def_serviceNodeCount * sizeof(service_name_tt*));
+                bzero(pServiceCenter->ppRemoteNameList,
+                      def_serviceNodeCount * sizeof(service_name_tt*));
+            }
+            serviceCenter_insertName(
+                pServiceCenter,
+                szName,
+                uiHash,
+                uiServiceID,
+                &pServiceCenter->ppRemoteNameList[uiServiceID >> def_serviceNodeShift]);
+            bBind = true;
+        }
+#ifdef DEF_USE_SPINLOCK
+        rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+#else
+        rwlock_wrunlock(&pServiceCenter->rwlock);
+#endif
+    }
+    return bBind;
+}
+
+bool serviceCenter_unbindRemoteName(uint32_t uiServiceID, const char* szName)
+{
+    bool              bRemove        = false;
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter && serviceCenter_isRemote(pServiceCenter, uiServiceID)) {
+        uint32_t uiHash = serviceCenter_nameHash(szName);
+#ifdef DEF_USE_SPINLOCK
+        rwSpinLock_wrlock(&pServiceCenter->rwlock);
+#else
+        rwlock_wrlock(&pServiceCenter->rwlock);
+#endif
+        service_name_tt* pNode = serviceCenter_findName(pServiceCenter, szName, uiHash);
+        if (pNode && pNode->uiServiceID == uiServiceID) {
+            serviceCenter_removeName(pServiceCenter, pNode);
+            bRemove = true;
+        }
+#ifdef DEF_USE_SPINLOCK
+        rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+#else
+        rwlock_wrunlock(&pServiceCenter->rwlock);
+#endif
+    }
+    return bRemove;
+}
+
+void serviceCenter_clearRemoteNames(int32_t iNodeId)
+{
+    serviceCenter_tt* pServiceCenter = s_pServiceCenter;
+    if (pServiceCenter && iNodeId >= 0 && iNodeId < def_serviceNodeCount &&
+        iNodeId != pServiceCenter->iServerNodeId) {
+#ifdef DEF_USE_SPINLOCK
+        rwSpinLock_wrlock(&pServiceCenter->rwlock);
+#else
+        rwlock_wrlock(&pServiceCenter->rwlock);
+#endif
+        if (pServiceCenter->ppRemoteNameList) {
+            while (pServiceCenter->ppRemoteNameList[iNodeId]) {
+                serviceCenter_removeName(pServiceCenter,
+                                         pServiceCenter->ppRemoteNameList[iNodeId]);
+            }
+        }
+#ifdef DEF_USE_SPINLOCK
+        rwSpinLock_wrunlock(&pServiceCenter->rwlock);
+#else
+        rwlock_wrunlock(&pServiceCenter->rwlock);
+#endif
+    }
 }
@@ -4,7 +4,9 @@
 
 #include "eventIO/eventIO_t.h"
 
+#include "log_t.h"
 #include "thread_t.h"
+#include "time_t.h"
 #include "utility_t.h"
 
 #include "internal/service-inl.h"
@@ -15,27 +17,145 @@
 
 #include <stdatomic.h>
 #include <stdlib.h>
+#include <string.h>
 
+#define def_slowLogCapacity 64
+#define def_slowLogPerSecond 10
+#define def_slowCheckMinMs 10
+
+// iVersion为奇数时表示该线程正在派发
 typedef struct monitor_s
 {
     atomic_int iVersion;
     int32_t    iCheckVersion;
+    int32_t    iReportedVersion;
     uint32_t   uiSourceID;
     uint32_t   uiDestinationID;
+    int32_t    iEvent;
+    uint64_t   uiEnterNs;
 } monitor_tt;
 
+typedef struct slowLogEntry_s
+{
+    uint32_t          uiSlowID;
+    serviceSlowLog_tt log;
+} slowLogEntry_tt;
+
 typedef struct serviceMonitor_s
 {
-    uint32_t       uiMonitorID;
-    monitor_tt*    pMonitorSlot;
-    uint32_t       uiMonitorSlotCount;
-    eventTimer_tt* pEventTimer;
-    atomic_bool    bRunning;
-    atomic_int     iIndex;
+    uint32_t        uiMonitorID;
+    monitor_tt*     pMonitorSlot;
+    uint32_t        uiMonitorSlotCount;
+    eventTimer_tt*  pEventTimer;
+    eventTimer_tt*  pSlowTimer;
+    uint64_t        uiSlowBudgetNs;
+    atomic_bool     bRunning;
+    atomic_int      iIndex;
+    mutex_tt        slowMutex;
+    slowLogEntry_tt slowLogs[def_slowLogCapacity];
+    uint32_t        uiNextSlowID;
+    uint64_t        uiSlowWindowMs;
+    uint32_t        uiSlowWindowCount;
+    uint32_t        uiSlowDropped;
 } serviceMonitor_tt;
 
 static serviceMonitor_tt* s_pServiceMonitor = NULL;
 
+static inline uint64_t serviceMonitor_clockNs()
+{
+    timespec_tt ts;
+    getClockMonotonic(&ts);
+    return (uint64_t)timespec_toNsec(&ts);
+}
+
+// 返回0表示被限流
+static uint32_t serviceMonitor_addSlowLog(serviceMonitor_tt* pServiceMonitor,
+                                          const monitor_tt* pSlot, uint32_t uiElapsedMs)
+{
+    timespec_tt ts;
+    getClockRealtime(&ts);
+    uint64_t uiNowMs = (uint64_t)timespec_toMsec(&ts);
+
+    uint32_t uiSlowID = 0;
+    mutex_lock(&pServiceMonitor->slowMutex);
+    if (uiNowMs - pServiceMonitor->uiSlowWindowMs >= 1000) {
+        if (pServiceMonitor->uiSlowDropped > 0) {
+            Log(eLog_warning, "slow dispatch log dropped:%u", pServiceMonitor->uiSlowDropped);
+        }
+        pServiceMonitor->uiSlowWindowMs    = uiNowMs;
+        pServiceMonitor->uiSlowWindowCount = 0;
+        pServiceMonitor->uiSlowDropped     = 0;
+    }
+    if (pServiceMonitor->uiSlowWindowCount < def_slowLogPerSecond) {
+        ++pServiceMonitor->uiSlowWindowCount;
+        uiSlowID = pServiceMonitor->uiNextSlowID++;
+        if (pServiceMonitor->uiNextSlowID == 0) {
+            pServiceMonitor->uiNextSlowID = 1;
+        }
+        slowLogEntry_tt* pEntry = &pServiceMonitor->slowLogs[uiSlowID % def_slowLogCapacity];
+        if (pEntry->log.szStack) {
+            mem_free((void*)pEntry->log.szStack);
+        }
+        pEntry->uiSlowID        = uiSlowID;
+        pEntry->log.uiTime      = uiNowMs;
+        pEntry->log.uiServiceID = pSlot->uiDestinationID;
+        pEntry->log.uiSourceID  = pSlot->uiSourceID;
+        pEntry->log.iEvent      = pSlot->iEvent;
+        pEntry->log.uiElapsedMs = uiElapsedMs;
+        pEntry->log.szStack     = NULL;
+    }
+    else {
+        ++pServiceMonitor->uiSlowDropped;
+    }
+    mutex_unlock(&pServiceMonitor->slowMutex);
+    return uiSlowID;
+}
+
+static void serviceMonitor_slowCheck(eventTimer_tt* pEventTimer, void* pData)
+{
+    serviceMonitor_tt* pServiceMonitor = s_pServiceMonitor;
+    if (pServiceMonitor == NULL || !atomic_load(&(pServiceMonitor->bRunning))) {
+        return;
+    }
+
+    uint64_t uiNowNs = serviceMonitor_clockNs();
+    for (uint32_t i = 0; i < pServiceMonitor->uiMonitorSlotCount; ++i) {
+        monitor_tt* pSlot    = &pServiceMonitor->pMonitorSlot[i];
+        int32_t     iVersion = atomic_load(&pSlot->iVersion);
+        if ((iVersion & 1) == 0 || iVersion == pSlot->iReportedVersion) {
+            continue;
+        }
+        monitor_tt slot = *pSlot;
+        // 读取期间派发已结束则字段可能不完整, 下一轮再看
+        if (atomic_load(&pSlot->iVersion) != iVersion) {
+            continue;
+        }
+        if (slot.uiEnterNs == 0 || slot.uiEnterNs + pServiceMonitor->uiSlowBudgetNs > uiNowNs ||
+            slot.uiDestinationID == 0 || slot.iEvent == DEF_EVENT_SERVICE_STOP) {
+            continue;
+        }
+        pSlot->iReportedVersion = iVersion;
+
+        uint32_t uiElapsedMs = (uint32_t)((uiNowNs - slot.uiEnterNs) / 1000000);
+        uint32_t uiSlowID    = serviceMonitor_addSlowLog(pServiceMonitor, &slot, uiElapsedMs);
+        if (uiSlowID == 0) {
+            continue;
+        }
+        Log(eLog_warning,
+            "slow dispatch service:%08x source:%08x event:0x%02x elapsed:%ums",
+            slot.uiDestinationID,
+            slot.uiSourceID,
+            slot.iEvent,
+            uiElapsedMs);
+
+        service_tt* pServiceHandle = serviceCenter_gain(slot.uiDestinationID);
+        if (pServiceHandle) {
+            service_slow(pServiceHandle, uiSlowID);
+            service_release(pServiceHandle);
+        }
+    }
+}
+
 static void serviceMonitor_check(eventTimer_tt* pEventTimer, void* pData)
 {
     serviceMonitor_tt* pServiceMonitor = s_pServiceMonitor;
@@ -84,17 +204,30 @@ void serviceMonitor_init(uint32_t uiNumberOfConcurrentThreads)
         }
         for (uint32_t i = 0; i < pServiceMonitor->uiMonitorSlotCount; ++i) {
             atomic_init(&(pServiceMonitor->pMonitorSlot[i].iVersion), 0);
-            pServiceMonitor->pMonitorSlot[i].iCheckVersion   = 0;
-            pServiceMonitor->pMonitorSlot[i].uiSourceID      = 0;
-            pServiceMonitor->pMonitorSlot[i].uiDestinationID = 0;
+            pServiceMonitor->pMonitorSlot[i].iCheckVersion    = 0;
+            pServiceMonitor->pMonitorSlot[i].iReportedVersion = 0;
+            pServiceMonitor->pMonitorSlot[i].uiSourceID       = 0;
+            pServiceMonitor->pMonitorSlot[i].uiDestinationID  = 0;
+            pServiceMonitor->pMonitorSlot[i].iEvent           = 0;
+            pServiceMonitor->pMonitorSlot[i].uiEnterNs        = 0;
         }
+        pServiceMonitor->pEventTimer    = NULL;
+        pServiceMonitor->pSlowTimer     = NULL;
+        pServiceMonitor->uiSlowBudgetNs = 0;
         atomic_init(&pServiceMonitor->iIndex, 0);
         atomic_init(&pServiceMonitor->bRunning, false);
+        mutex_init(&pServiceMonitor->slowMutex);
+        memset(pServiceMonitor->slowLogs, 0, sizeof(pServiceMonitor->slowLogs));
+        pServiceMonitor->uiNextSlowID      = 1;
+        pServiceMonitor->uiSlowWindowMs    = 0;
+        pServiceMonitor->uiSlowWindowCount = 0;
+        pServiceMonitor->uiSlowDropped     = 0;
         s_pServiceMonitor = pServiceMonitor;
     }
 }
 
-bool serviceMonitor_start(uint32_t uiMonitorID, struct eventIO_s* pEventIO, uint32_t uiIntervalMs)
+bool serviceMonitor_start(uint32_t uiMonitorID, struct eventIO_s* pEventIO, uint32_t uiIntervalMs,
+                          uint32_t uiSlowBudgetMs)
 {
     serviceMonitor_tt* pServiceMonitor = s_pServiceMonitor;
 
@@ -103,6 +236,16 @@ bool serviceMonitor_start(uint32_t uiMonitorID, struct eventIO_s* pEventIO, uint
         pServiceMonitor->pEventTimer =
             createEventTimer(pEventIO, serviceMonitor_check, false, uiIntervalMs, NULL);
         eventTimer_start(s_pServiceMonitor->pEventTimer);
+        pServiceMonitor->uiSlowBudgetNs = (uint64_t)uiSlowBudgetMs * 1000000;
+        if (uiSlowBudgetMs > 0) {
+            uint32_t uiCheckMs = uiSlowBudgetMs / 2;
+            if (uiCheckMs < def_slowCheckMinMs) {
+                uiCheckMs = def_slowCheckMinMs;
+            }
+            pServiceMonitor->pSlowTimer =
+                createEventTimer(pEventIO, serviceMonitor_slowCheck, false, uiCheckMs, NULL);
+            eventTimer_start(pServiceMonitor->pSlowTimer);
+        }
         atomic_store(&pServiceMonitor->bRunning, true);
         return true;
     }
@@ -123,6 +266,11 @@ void serviceMonitor_stop()
             eventTimer_release(pServiceMonitor->pEventTimer);
             pServiceMonitor->pEventTimer = NULL;
         }
+        if (pServiceMonitor->pSlowTimer) {
+            eventTimer_stop(pServiceMonitor->pSlowTimer);
+            eventTimer_release(pServiceMonitor->pSlowTimer);
+            pServiceMonitor->pSlowTimer = NULL;
+        }
     }
 }
 
@@ -135,11 +283,17 @@ void serviceMonitor_clear()
             mem_free(pServiceMonitor->pMonitorSlot);
             pServiceMonitor->pMonitorSlot = NULL;
         }
+        for (int32_t i = 0; i < def_slowLogCapacity; ++i) {
+            if (pServiceMonitor->slowLogs[i].log.szStack) {
+                mem_free((void*)pServiceMonitor->slowLogs[i].log.szStack);
+            }
+        }
+        mutex_destroy(&pServiceMonitor->slowMutex);
         mem_free(pServiceMonitor);
     }
 }
 
-int32_t serviceMonitor_enter(uint32_t uiSourceID, uint32_t uiDestinationID)
+int32_t serviceMonitor_enter(uint32_t uiSourceID, uint32_t uiDestinationID, int32_t iEvent)
 {
     serviceMonitor_tt* pServiceMonitor = s_pServiceMonitor;
     if (pServiceMonitor == NULL) {
@@ -153,6 +307,10 @@ int32_t serviceMonitor_enter(uint32_t uiSourceID, uint32_t uiDestinationID)
 
     pServiceMonitor->pMonitorSlot[s_iThreadIndex].uiSourceID      = uiSourceID;
     pServiceMonitor->pMonitorSlot[s_iThreadIndex].uiDestinationID = uiDestinationID;
+    pServiceMonitor->pMonitorSlot[s_iThreadIndex].iEvent          = iEvent;
+    if (pServiceMonitor->uiSlowBudgetNs != 0) {
+        pServiceMonitor->pMonitorSlot[s_iThreadIndex].uiEnterNs = serviceMonitor_clockNs();
+    }
     atomic_fetch_add(&(pServiceMonitor->pMonitorSlot[s_iThreadIndex].iVersion), 1);
     return s_iThreadIndex;
 }
@@ -173,3 +331,46 @@ int32_t serviceMonitor_waitForCount()
 {
     return service_waitForCount();
 }
+
+void serviceMonitor_slowSnapshot(uint32_t uiSlowID, const char* szStack)
+{
+    serviceMonitor_tt* pServiceMonitor = s_pServiceMonitor;
+    if (pServiceMonitor == NULL || uiSlowID == 0) {
+        return;
+    }
+
+    uint32_t uiServiceID = 0;
+    mutex_lock(&pServiceMonitor->slowMutex);
+    slowLogEntry_tt* pEntry = &pServiceMonitor->slowLogs[uiSlowID % def_slowLogCapacity];
+    if (pEntry->uiSlowID == uiSlowID && pEntry->log.szStack == NULL) {
+        size_t nLength = strlen(szStack);
+        char*  szCopy  = mem_malloc(nLength + 1);
+        memcpy(szCopy, szStack, nLength + 1);
+        pEntry->log.szStack = szCopy;
+        uiServiceID         = pEntry->log.uiServiceID;
+    }
+    mutex_unlock(&pServiceMonitor->slowMutex);
+
+    if (uiServiceID != 0) {
+        Log(eLog_warning, "slow dispatch service:%08x %s", uiServiceID, szStack);
+    }
+}
+
+void serviceMonitor_foreachSlowLog(void (*fn)(const serviceSlowLog_tt*, void*), void* pUserData)
+{
+    serviceMonitor_tt* pServiceMonitor = s_pServiceMonitor;
+    if (pServiceMonitor == NULL) {
+        return;
+    }
+
+    mutex_lock(&pServiceMonitor->slowMutex);
+    uint32_t uiNextSlowID = pServiceMonitor->uiNextSlowID;
+    for (uint32_t i = 0; i < def_slowLogCapacity; ++i) {
+        slowLogEntry_tt* pEntry =
+            &pServiceMonitor->slowLogs[(uiNextSlowID + i) % def_slowLogCapacity];
+        if (pEntry->uiSlowID != 0) {
+            fn(&pEntry->log, pUserData);
+        }
+    }
+    mutex_unlock(&pServiceMonitor->slowMutex);
+}
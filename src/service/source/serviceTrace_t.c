@@ -0,0 +1,194 @@
+
+
+#include "serviceTrace_t.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_t.h"
+#include "spinLock_t.h"
+#include "time_t.h"
+#include "utility_t.h"
+
+#define def_traceDefaultCapacity 4096
+
+typedef struct serviceTrace_s
+{
+    spinLock_tt     spinLock;
+    serviceSpan_tt* pSpans;
+    uint32_t        uiCapacity;
+    uint32_t        uiHead;
+    uint32_t        uiCount;
+    uint64_t        uiDropped;
+} serviceTrace_tt;
+
+static serviceTrace_tt* s_pServiceTrace = NULL;
+static atomic_uint      s_uiSampleRate  = ATOMIC_VAR_INIT(0);
+
+static _decl_threadLocal serviceTraceContext_tt s_traceContext = {0, 0};
+static _decl_threadLocal uint64_t               s_uiRandom     = 0;
+
+// xorshift64*, 每个线程独立的状态
+static inline uint64_t serviceTrace_random()
+{
+    if (_UnLikely(s_uiRandom == 0)) {
+        timespec_tt ts;
+        getClockMonotonic(&ts);
+        s_uiRandom = (uint64_t)timespec_toNsec(&ts) ^ (uint64_t)(uintptr_t)&s_uiRandom;
+        if (s_uiRandom == 0) {
+            s_uiRandom = 0x9E3779B97F4A7C15ULL;
+        }
+    }
+    s_uiRandom ^= s_uiRandom >> 12;
+    s_uiRandom ^= s_uiRandom << 25;
+    s_uiRandom ^= s_uiRandom >> 27;
+    return s_uiRandom * 0x2545F4914F6CDD1DULL;
+}
+
+void serviceTrace_init(uint32_t uiCapacity)
+{
+    if (s_pServiceTrace != NULL) {
+        return;
+    }
+    if (uiCapacity == 0) {
+        uiCapacity = def_traceDefaultCapacity;
+    }
+    serviceTrace_tt* pServiceTrace = mem_malloc(sizeof(serviceTrace_tt));
+    spinLock_init(&pServiceTrace->spinLock);
+    pServiceTrace->pSpans     = mem_malloc(sizeof(serviceSpan_tt) * uiCapacity);
+    pServiceTrace->uiCapacity = uiCapacity;
+    pServiceTrace->uiHead     = 0;
+    pServiceTrace->uiCount    = 0;
+    pServiceTrace->uiDropped  = 0;
+    s_pServiceTrace           = pServiceTrace;
+}
+
+void serviceTrace_clear()
+{
+    atomic_store(&s_uiSampleRate, 0);
+    if (s_pServiceTrace != NULL) {
+        serviceTrace_tt* pServiceTrace = s_pServiceTrace;
+        s_pServiceTrace                = NULL;
+        mem_free(pServiceTrace->pSpans);
+        mem_free(pServiceTrace);
+    }
+}
+
+void serviceTrace_setSampleRate(uint32_t uiPerMillion)
+{
+    if (uiPerMillion > 1000000) {
+        uiPerMillion = 1000000;
+    }
+    atomic_store_explicit(&s_uiSampleRate, uiPerMillion, memory_order_relaxed);
+}
+
+uint32_t serviceTrace_getSampleRate()
+{
+    return atomic_load_explicit(&s_uiSampleRate, memory_order_relaxed);
+}
+
+bool serviceTrace_sample()
+{
+    uint32_t uiRate = atomic_load_explicit(&s_uiSampleRate, memory_order_relaxed);
+    if (_Likely(uiRate == 0)) {
+        return false;
+    }
+    return serviceTrace_random() % 1000000 < uiRate;
+}
+
+serviceTraceContext_tt* serviceTrace_current()
+{
+    return &s_traceContext;
+}
+
+uint64_t serviceTrace_newID()
+{
+    uint64_t uiID;
+    do {
+        uiID = serviceTrace_random();
+    } while (uiID == 0);
+    return uiID;
+}
+
+void serviceTrace_record(const serviceSpan_tt* pSpan)
+{
+    serviceTrace_tt* pServiceTrace = s_pServiceTrace;
+    if (pServiceTrace == NULL) {
+        return;
+    }
+    spinLock_lock(&pServiceTrace->spinLock);
+    uint32_t uiIndex = pServiceTrace->uiHead + pServiceTrace->uiCount;
+    if (uiIndex >= pServiceTrace->uiCapacity) {
+        uiIndex -= pServiceTrace->uiCapacity;
+    }
+    pServiceTrace->pSpans[uiIndex] = *pSpan;
+    if (pServiceTrace->uiCount == pServiceTrace->uiCapacity) {
+        // 满了覆盖最旧的
+        if (++pServiceTrace->uiHead == pServiceTrace->uiCapacity) {
+            pServiceTrace->uiHead = 0;
+        }
+        ++pServiceTrace->uiDropped;
+    }
+    else {
+        ++pServiceTrace->uiCount;
+    }
+    spinLock_unlock(&pServiceTrace->spinLock);
+}
+
+int32_t serviceTrace_export(const char* szFileName)
+{
+    serviceTrace_tt* pServiceTrace = s_pServiceTrace;
+    if (pServiceTrace == NULL) {
+        return -1;
+    }
+
+    FILE* pFile = fopen(szFileName, "ab");
+    if (pFile == NULL) {
+        Log(eLog_error, "trace export open error:%s", szFileName);
+        return -1;
+    }
+
+    // 先拷出再写文件, 不在锁内做IO
+    serviceSpan_tt* pSpans = mem_malloc(sizeof(serviceSpan_tt) * pServiceTrace->uiCapacity);
+    spinLock_lock(&pServiceTrace->spinLock);
+    uint32_t uiCount   = pServiceTrace->uiCount;
+    uint32_t uiHead    = pServiceTrace->uiHead;
+    uint64_t uiDropped = pServiceTrace->uiDropped;
+    for (uint32_t i = 0; i < uiCount; ++i) {
+        uint32_t uiIndex = uiHead + i;
+        if (uiIndex >= pServiceTrace->uiCapacity) {
+            uiIndex -= pServiceTrace->uiCapacity;
+        }
+        pSpans[i] = pServiceTrace->pSpans[uiIndex];
+    }
+    pServiceTrace->uiHead    = 0;
+    pServiceTrace->uiCount   = 0;
+    pServiceTrace->uiDropped = 0;
+    spinLock_unlock(&pServiceTrace->spinLock);
+
+    if (uiDropped > 0) {
+        Log(eLog_warning, "trace buffer overflow dropped:%llu", (unsigned long long)uiDropped);
+    }
+
+    for (uint32_t i = 0; i < uiCount; ++i) {
+        serviceSpan_tt* pSpan = &pSpans[i];
+        fprintf(pFile,
+                "{\"trace\":\"%016llx\",\"span\":\"%016llx\",\"parent\":\"%016llx\","
+                "\"service\":\"%08x\",\"source\":\"%08x\",\"event\":%d,"
+                "\"start\":%llu,\"queue\":%u,\"duration\":%u}\n",
+                (unsigned long long)pSpan->uiTraceID,
+                (unsigned long long)pSpan->uiSpanID,
+                (unsigned long long)pSpan->uiParentID,
+                pSpan->uiServiceID,
+                pSpan->uiSourceID,
+                pSpan->iEvent,
+                (unsigned long long)pSpan->uiStartUs,
+                pSpan->uiQueueUs,
+                pSpan->uiDurationUs);
+    }
+    fclose(pFile);
+    mem_free(pSpans);
+    return (int32_t)uiCount;
+}
@@ -10,6 +10,7 @@
 
 #include "channel/channelCenter_t.h"
 #include "channel/channel_t.h"
+#include "clusterRouter_t.h"
 #include "serviceCenter_t.h"
 #include "serviceMonitor_t.h"
 
@@ -18,9 +19,28 @@
 #include "internal/listenPort_t.h"
 #include "internal/timerWatcher_t.h"
 #include "serviceEvent_t.h"
+#include "time_t.h"
+
+#define def_servicePriorityBurst 32
+#define def_servicePriorityPoll 64
+#define def_serviceBatchMax 64
+// 长时间不离开邮箱处理的服务按此间隔(纳秒)发布忙碌时间和处理条数
+#define def_serviceAccountNs 50000000ull
 
 static atomic_int s_iWaitforService = ATOMIC_VAR_INIT(0);
 
+static _decl_threadLocal bool s_bServiceThread = false;
+
+// 各服务共用一个投递计数, 只在第一次创建服务时注册
+static metricsCounter_tt* s_pMetricsMessages = NULL;
+static once_flag_tt       s_metricsOnceFlag  = ONCE_FLAG_INIT;
+
+static void service_registerMetrics()
+{
+    s_pMetricsMessages =
+        metrics_registerCounter("frog_service_messages_total", "Messages delivered to services");
+}
+
 void service_waitFor()
 {
     atomic_fetch_add(&s_iWaitforService, 1);
@@ -36,6 +56,130 @@ int32_t service_waitForCount()
     return atomic_load(&s_iWaitforService);
 }
 
+static inline void serviceEvent_free(serviceEvent_tt* pEvent)
+{
+    if ((pEvent->uiLength >> 24) & DEF_EVENT_MOVEBUF) {
+        serviceEvent_releaseMoveBuf(pEvent);
+    }
+    mem_free(pEvent);
+}
+
+// 服务停止后不再派发, 事件持有的定时器/连接在这里释放
+static void serviceEvent_discard(serviceEvent_tt* pEvent)
+{
+    switch ((pEvent->uiLength >> 24) & DEF_EVENT_MASK) {
+    case DEF_EVENT_RUN_AFTER:
+    case DEF_EVENT_RUN_EVERY:
+    {
+        timerWatcher_release(*(timerWatcher_tt**)(pEvent->szStorage));
+    } break;
+    case DEF_EVENT_ACCEPT:
+    case DEF_EVENT_CONNECT:
+    {
+        eventConnection_tt* pEventConnection = *(eventConnection_tt**)(pEvent->szStorage);
+        if (pEventConnection) {
+            eventConnection_forceClose(pEventConnection);
+            eventConnection_release(pEventConnection);
+        }
+    } break;
+    }
+    serviceEvent_free(pEvent);
+}
+
+static void service_discardQueue(service_tt* pService, QUEUE* pQueue)
+{
+    while (!QUEUE_EMPTY(pQueue)) {
+        QUEUE*           pNode  = QUEUE_HEAD(pQueue);
+        serviceEvent_tt* pEvent = container_of(pNode, serviceEvent_tt, node);
+        QUEUE_REMOVE(pNode);
+        if (serviceEvent_isBounded(pEvent)) {
+            atomic_fetch_sub_explicit(
+                &pService->nQueueBytes, pEvent->uiLength & 0xFFFFFF, memory_order_relaxed);
+        }
+        atomic_fetch_sub(&pService->uiQueueSize, 1);
+        serviceEvent_discard(pEvent);
+    }
+}
+
+static inline bool serviceEvent_isStopHead(QUEUE* pQueue)
+{
+    return !QUEUE_EMPTY(pQueue) &&
+           (container_of(QUEUE_HEAD(pQueue), serviceEvent_tt, node)->uiLength >> 24) ==
+               DEF_EVENT_SERVICE_STOP;
+}
+
+// 返回0继续入队, 1事件已丢弃(对发送方视为成功), -1拒绝
+int32_t service_overload(service_tt* pService, serviceEvent_tt* pEvent)
+{
+    switch (atomic_load_explicit(&pService->iOverloadPolicy, memory_order_relaxed)) {
+    case DEF_SERVICE_OVERLOAD_DROP_OLDEST:
+    {
+        serviceEvent_tt* pOldest = NULL;
+        QUEUE*           pNode   = NULL;
+#ifdef DEF_USE_SPINLOCK
+        spinLock_lock(&pService->spinLock);
+#else
+        mutex_lock(&pService->mutex);
+#endif
+        QUEUE_FOREACH(pNode, &pService->queuePending)
+        {
+            serviceEvent_tt* pPending = container_of(pNode, serviceEvent_tt, node);
+            if (serviceEvent_isBounded(pPending)) {
+                QUEUE_REMOVE(pNode);
+                pOldest = pPending;
+                break;
+            }
+        }
+#ifdef DEF_USE_SPINLOCK
+        spinLock_unlock(&pService->spinLock);
+#else
+        mutex_unlock(&pService->mutex);
+#endif
+        if (pOldest) {
+            atomic_fetch_sub(&pService->uiQueueSize, 1);
+            atomic_fetch_sub_explicit(
+                &pService->nQueueBytes, pOldest->uiLength & 0xFFFFFF, memory_order_relaxed);
+            serviceEvent_free(pOldest);
+            return 0;
+        }
+        // 待处理队列已被取走, 退化为丢弃最新
+        serviceEvent_free(pEvent);
+        return 1;
+    } break;
+    case DEF_SERVICE_OVERLOAD_DROP_NEWEST:
+    {
+        serviceEvent_free(pEvent);
+        return 1;
+    } break;
+    case DEF_SERVICE_OVERLOAD_BLOCK:
+    {
+        // 服务线程阻塞会占住工作线程, 只允许外部线程等待
+        if (s_bServiceThread || eventIO_isInLoopThread(pService->pEventIO)) {
+            break;
+        }
+        size_t      nLength     = pEvent->uiLength & 0xFFFFFF;
+        uint32_t    uiTimeoutMs = atomic_load_explicit(&pService->uiBlockTimeoutMs,
+                                                    memory_order_relaxed);
+        timespec_tt tsStart;
+        timespec_tt tsNow;
+        timespec_tt tsSleep = {.iSec = 0, .iNsec = 1000000};
+        getClockMonotonic(&tsStart);
+        while (atomic_load(&pService->bRunning)) {
+            if (!service_isFull(pService, nLength)) {
+                return 0;
+            }
+            getClockMonotonic(&tsNow);
+            if (timespec_subToMs(&tsNow, &tsStart) >= uiTimeoutMs) {
+                break;
+            }
+            sleep_for(&tsSleep);
+        }
+    } break;
+    }
+    mem_free(pEvent);
+    return -1;
+}
+
 static inline bool service_eventCallback(service_tt* pService, serviceEvent_tt* pEvent)
 {
     int32_t iEvent   = pEvent->uiLength >> 24;
@@ -57,7 +201,7 @@ static inline bool service_eventCallback(service_tt* pService, serviceEvent_tt*
                                      pBuffer,
                                      nLength,
                                      pService->pUserData);
-                mem_free(pBuffer);
+                serviceEvent_releaseMoveBuf(pEvent);
             }
             else {
                 pService->fnCallback(iEventMsg | DEF_EVENT_MSG,
@@ -81,7 +225,7 @@ static inline bool service_eventCallback(service_tt* pService, serviceEvent_tt*
                                      pBuffer,
                                      nLength,
                                      pService->pUserData);
-                mem_free(pBuffer);
+                serviceEvent_releaseMoveBuf(pEvent);
             }
             else {
                 pService->fnCallback(iEventMsg | DEF_EVENT_MSG,
@@ -186,7 +330,7 @@ static inline bool service_eventCallback(service_tt* pService, serviceEvent_tt*
             void* pBuffer = *(void**)pEvent->szStorage;
             pService->fnCallback(
                 iType, pEvent->uiSourceID, pEvent->uiToken, pBuffer, nLength, pService->pUserData);
-            mem_free(pBuffer);
+            serviceEvent_releaseMoveBuf(pEvent);
         }
         else {
             pService->fnCallback(iType,
@@ -210,7 +354,7 @@ static inline bool service_eventCallback(service_tt* pService, serviceEvent_tt*
             void* pBuffer = *(void**)pEvent->szStorage;
             pService->fnCallback(
                 iType, pEvent->uiSourceID, pEvent->uiToken, pBuffer, nLength, pService->pUserData);
-            mem_free(pBuffer);
+            serviceEvent_releaseMoveBuf(pEvent);
         }
         else {
             pService->fnCallback(iType,
@@ -245,16 +389,126 @@ static inline bool service_eventCallback(service_tt* pService, serviceEvent_tt*
     return true;
 }
 
+static inline bool serviceEvent_toBatch(serviceEvent_tt* pEvent, serviceBatchEvent_tt* pBatch)
+{
+    int32_t iEvent     = pEvent->uiLength >> 24;
+    int32_t iType      = iEvent & DEF_EVENT_MASK;
+    size_t  nLength    = pEvent->uiLength & 0xFFFFFF;
+    pBatch->uiSourceID = pEvent->uiSourceID;
+    pBatch->uiToken    = pEvent->uiToken;
+    pBatch->pBuffer    = NULL;
+    pBatch->nLength    = 0;
+    switch (iType) {
+    case DEF_EVENT_MSG:
+    {
+        int32_t iEventMsg = iEvent & DEF_EVENT_MSG_MASK;
+        pBatch->iType     = iEventMsg | DEF_EVENT_MSG;
+        if (iEventMsg == DEF_EVENT_MSG_PING || iEventMsg == DEF_EVENT_MSG_PONG ||
+            iEventMsg == DEF_EVENT_MSG_CLOSE) {
+            return true;
+        }
+    } break;
+    case DEF_EVENT_BINARY:
+    case DEF_EVENT_COMMAND:
+    case DEF_EVENT_DNS:
+    {
+        pBatch->iType = iType;
+        if (nLength == 0) {
+            return true;
+        }
+    } break;
+    case DEF_EVENT_YIELD:
+    case DEF_EVENT_SEND_OK:
+    case DEF_EVENT_DISCONNECT:
+    {
+        pBatch->iType = iType;
+        return true;
+    } break;
+    default: return false;
+    }
+
+    pBatch->nLength = nLength;
+    if (iEvent & DEF_EVENT_MOVEBUF) {
+        pBatch->pBuffer = *(void**)pEvent->szStorage;
+    }
+    else {
+        pBatch->pBuffer = pEvent->szStorage;
+    }
+    return true;
+}
+
+static void service_flushBatch(service_tt* pService, serviceEvent_tt** ppEvents,
+                               serviceBatchEvent_tt* pBatch, int32_t iCount)
+{
+    int32_t iThreadIndex =
+        serviceMonitor_enter(pBatch[0].uiSourceID, pService->uiServiceID, pBatch[0].iType);
+    pService->fnBatch(pBatch, iCount, pService->pUserData);
+    serviceMonitor_leave(iThreadIndex);
+    for (int32_t i = 0; i < iCount; ++i) {
+        serviceEvent_free(ppEvents[i]);
+    }
+}
+
+// 被追踪的事件单独派发, 派发期间当前线程带上新的span, 结束后记录耗时
+static bool service_traceCallback(service_tt* pService, serviceEvent_tt* pEvent)
+{
+    serviceSpan_tt span;
+    span.uiTraceID   = pEvent->trace.uiTraceID;
+    span.uiParentID  = pEvent->trace.uiSpanID;
+    span.uiSpanID    = serviceTrace_newID();
+    span.uiServiceID = pService->uiServiceID;
+    span.uiSourceID  = pEvent->uiSourceID;
+    span.iEvent      = (pEvent->uiLength >> 24) & ~DEF_EVENT_MOVEBUF;
+
+    timespec_tt ts;
+    getClockRealtime(&ts);
+    span.uiStartUs     = (uint64_t)ts.iSec * 1000000 + ts.iNsec / 1000;
+    uint64_t uiStartNs = service_clockNs();
+    span.uiQueueUs     = (uint32_t)((uiStartNs - pEvent->uiEnqueueTime) / 1000);
+
+    serviceTraceContext_tt* pContext = serviceTrace_current();
+    pContext->uiTraceID              = span.uiTraceID;
+    pContext->uiSpanID               = span.uiSpanID;
+    bool bRunning                    = service_eventCallback(pService, pEvent);
+    pContext->uiTraceID              = 0;
+    pContext->uiSpanID               = 0;
+
+    span.uiDurationUs = (uint32_t)((service_clockNs() - uiStartNs) / 1000);
+    serviceTrace_record(&span);
+    return bRunning;
+}
+
+// 离开邮箱处理时以及处理中每隔def_serviceAccountNs累计一次, 避免逐条事件写计数
+static inline void service_account(service_tt* pService, uint64_t uiStartNs, uint64_t uiNowNs,
+                                   uint32_t uiProcessed)
+{
+    atomic_fetch_add_explicit(&pService->uiBusyNs, uiNowNs - uiStartNs, memory_order_relaxed);
+    if (uiProcessed > 0) {
+        atomic_fetch_add_explicit(&pService->uiProcessed, uiProcessed, memory_order_relaxed);
+    }
+}
+
 static void doPendingFunctors(eventWatcher_tt* pEventWatcher, void* pData)
 {
     service_tt*      pService = (service_tt*)pData;
     serviceEvent_tt* pEvent   = NULL;
     QUEUE            queuePending;
+    QUEUE            queuePriority;
+    QUEUE            queueIncoming;
     QUEUE*           pNode = NULL;
 
     int32_t iThreadIndex = 0;
+    s_bServiceThread     = true;
     service_wakeUp();
-    bool bRunning = true;
+    bool bRunning    = true;
+    bool bDispatched = false;
+
+    serviceEvent_tt*     pBatchEvents[def_serviceBatchMax];
+    serviceBatchEvent_tt batch[def_serviceBatchMax];
+    int32_t              iBatchCount = 0;
+
+    uint64_t uiStartNs   = service_clockNs();
+    uint32_t uiProcessed = 0;
 
     for (;;) {
 #ifdef DEF_USE_SPINLOCK
@@ -262,13 +516,21 @@ static void doPendingFunctors(eventWatcher_tt* pEventWatcher, void* pData)
 #else
         mutex_lock(&pService->mutex);
 #endif
+        QUEUE_MOVE(&pService->queuePriority, &queuePriority);
         QUEUE_MOVE(&pService->queuePending, &queuePending);
 #ifdef DEF_USE_SPINLOCK
         spinLock_unlock(&pService->spinLock);
 #else
         mutex_unlock(&pService->mutex);
 #endif
-        if (QUEUE_EMPTY(&queuePending)) {
+        if (QUEUE_EMPTY(&queuePending) && QUEUE_EMPTY(&queuePriority)) {
+            // 复位watcher之前服务仍归本线程独占, 空闲工作只在这里做一次
+            if (bDispatched && pService->fnIdle) {
+                bDispatched = false;
+                pService->fnIdle(pService->pUserData);
+                continue;
+            }
+
             if (pService->pEventWatcher) {
                 eventWatcher_reset(pService->pEventWatcher);
             }
@@ -276,20 +538,116 @@ static void doPendingFunctors(eventWatcher_tt* pEventWatcher, void* pData)
             if (atomic_load(&pService->uiQueueSize) > 0) {
                 service_notify(pService);
             }
+            service_account(pService, uiStartNs, service_clockNs(), uiProcessed);
             return;
         }
 
+        int32_t iPriorityRun = 0;
+        int32_t iPendingRun  = 0;
         do {
-            pNode  = QUEUE_HEAD(&queuePending);
+            bool bPriority =
+                !QUEUE_EMPTY(&queuePriority) &&
+                (iPriorityRun < def_servicePriorityBurst || QUEUE_EMPTY(&queuePending));
+            if (!bPriority && serviceEvent_isStopHead(&queuePending)) {
+                // 先派发停止之前入队的优先事件, 停止后回调已无pUserData
+#ifdef DEF_USE_SPINLOCK
+                spinLock_lock(&pService->spinLock);
+#else
+                mutex_lock(&pService->mutex);
+#endif
+                QUEUE_MOVE(&pService->queuePriority, &queueIncoming);
+#ifdef DEF_USE_SPINLOCK
+                spinLock_unlock(&pService->spinLock);
+#else
+                mutex_unlock(&pService->mutex);
+#endif
+                if (!QUEUE_EMPTY(&queueIncoming)) {
+                    QUEUE_ADD(&queuePriority, &queueIncoming);
+                }
+                bPriority = !QUEUE_EMPTY(&queuePriority);
+            }
+            if (bPriority) {
+                pNode = QUEUE_HEAD(&queuePriority);
+                ++iPriorityRun;
+            }
+            else {
+                pNode        = QUEUE_HEAD(&queuePending);
+                iPriorityRun = 0;
+                if (++iPendingRun == def_servicePriorityPoll) {
+                    iPendingRun = 0;
+#ifdef DEF_USE_SPINLOCK
+                    spinLock_lock(&pService->spinLock);
+#else
+                    mutex_lock(&pService->mutex);
+#endif
+                    QUEUE_MOVE(&pService->queuePriority, &queueIncoming);
+#ifdef DEF_USE_SPINLOCK
+                    spinLock_unlock(&pService->spinLock);
+#else
+                    mutex_unlock(&pService->mutex);
+#endif
+                    if (!QUEUE_EMPTY(&queueIncoming)) {
+                        QUEUE_ADD(&queuePriority, &queueIncoming);
+                    }
+                }
+            }
             pEvent = container_of(pNode, serviceEvent_tt, node);
             QUEUE_REMOVE(pNode);
+            if (serviceEvent_isBounded(pEvent)) {
+                atomic_fetch_sub_explicit(
+                    &pService->nQueueBytes, pEvent->uiLength & 0xFFFFFF, memory_order_relaxed);
+            }
             atomic_fetch_sub(&pService->uiQueueSize, 1);
-            iThreadIndex = serviceMonitor_enter(pEvent->uiSourceID, pService->uiServiceID);
+            ++uiProcessed;
             assert(bRunning);
-            bRunning = service_eventCallback(pService, pEvent);
+            bDispatched = true;
+            uint64_t uiNowNs = service_clockNs();
+            latencyHistogram_record(&pService->queueLatency,
+                                    (uiNowNs - pEvent->uiEnqueueTime) / 1000);
+            // 邮箱一直处理不完时也要定期发布, 否则top看到的是0, 处理完时又一次性超过100%
+            if (uiNowNs - uiStartNs >= def_serviceAccountNs) {
+                service_account(pService, uiStartNs, uiNowNs, uiProcessed - 1);
+                uiStartNs   = uiNowNs;
+                uiProcessed = 1;
+            }
+            // 外部连接进来的消息在这里按采样率开始新的追踪
+            bool bTraced = pEvent->trace.uiTraceID != 0;
+            if (!bTraced && serviceEvent_isIngress(pEvent) && serviceTrace_sample()) {
+                pEvent->trace.uiTraceID = serviceTrace_newID();
+                pEvent->trace.uiSpanID  = 0;
+                bTraced                 = true;
+            }
+            if (pService->fnBatch && !bTraced &&
+                serviceEvent_toBatch(pEvent, &batch[iBatchCount])) {
+                pBatchEvents[iBatchCount++] = pEvent;
+                if (iBatchCount == def_serviceBatchMax) {
+                    service_flushBatch(pService, pBatchEvents, batch, iBatchCount);
+                    iBatchCount = 0;
+                }
+                continue;
+            }
+
+            if (iBatchCount > 0) {
+                service_flushBatch(pService, pBatchEvents, batch, iBatchCount);
+                iBatchCount = 0;
+            }
+            iThreadIndex = serviceMonitor_enter(pEvent->uiSourceID,
+                                                pService->uiServiceID,
+                                                (pEvent->uiLength >> 24) & ~DEF_EVENT_MOVEBUF);
+            if (_UnLikely(bTraced)) {
+                bRunning = service_traceCallback(pService, pEvent);
+            }
+            else {
+                bRunning = service_eventCallback(pService, pEvent);
+            }
             mem_free(pEvent);
             serviceMonitor_leave(iThreadIndex);
-        } while (!QUEUE_EMPTY(&queuePending));
+        } while (bRunning && (!QUEUE_EMPTY(&queuePending) || !QUEUE_EMPTY(&queuePriority)));
+
+        if (iBatchCount > 0) {
+            service_flushBatch(pService, pBatchEvents, batch, iBatchCount);
+            iBatchCount = 0;
+        }
 
         if (bRunning) {
             if ((atomic_load(&pService->uiQueueSize) > 0) && (service_waitForCount() > 0)) {
@@ -297,10 +655,33 @@ static void doPendingFunctors(eventWatcher_tt* pEventWatcher, void* pData)
                     eventWatcher_reset(pService->pEventWatcher);
                 }
                 service_notify(pService);
+                service_account(pService, uiStartNs, service_clockNs(), uiProcessed);
                 return;
             }
+            uint64_t uiNowNs = service_clockNs();
+            service_account(pService, uiStartNs, uiNowNs, uiProcessed);
+            uiStartNs   = uiNowNs;
+            uiProcessed = 0;
         }
         else {
+            // 与service_stop竞争入队的事件排在停止事件之后, 不再回调直接丢弃
+            service_discardQueue(pService, &queuePriority);
+            service_discardQueue(pService, &queuePending);
+#ifdef DEF_USE_SPINLOCK
+            spinLock_lock(&pService->spinLock);
+#else
+            mutex_lock(&pService->mutex);
+#endif
+            QUEUE_MOVE(&pService->queuePriority, &queuePriority);
+            QUEUE_MOVE(&pService->queuePending, &queuePending);
+#ifdef DEF_USE_SPINLOCK
+            spinLock_unlock(&pService->spinLock);
+#else
+            mutex_unlock(&pService->mutex);
+#endif
+            service_discardQueue(pService, &queuePriority);
+            service_discardQueue(pService, &queuePending);
+            service_account(pService, uiStartNs, service_clockNs(), uiProcessed);
             return;
         }
     };
@@ -318,11 +699,28 @@ service_tt* createService(eventIO_tt* pEventIO)
     pHandle->pEventIO    = pEventIO;
     pHandle->pUserData   = NULL;
     pHandle->fnStop      = NULL;
+    pHandle->fnIdle      = NULL;
+    pHandle->fnBatch     = NULL;
+    pHandle->fnSlow      = NULL;
     pHandle->fnCallback  = NULL;
     pHandle->uiServiceID = 0;
     atomic_init(&pHandle->iRefCount, 1);
     atomic_init(&pHandle->bRunning, false);
     atomic_init(&pHandle->uiQueueSize, 0);
+    atomic_init(&pHandle->nQueueBytes, 0);
+    atomic_init(&pHandle->nMemory, 0);
+    atomic_init(&pHandle->nMemoryPeak, 0);
+    atomic_init(&pHandle->uiMailboxLimit, 0);
+    atomic_init(&pHandle->nMailboxByteLimit, 0);
+    atomic_init(&pHandle->iOverloadPolicy, DEF_SERVICE_OVERLOAD_REJECT);
+    atomic_init(&pHandle->uiBlockTimeoutMs, 0);
+    atomic_init(&pHandle->uiProcessed, 0);
+    atomic_init(&pHandle->uiBusyNs, 0);
+    atomic_init(&pHandle->uiSendBytes, 0);
+    atomic_init(&pHandle->uiRecvBytes, 0);
+    latencyHistogram_init(&pHandle->queueLatency);
+    callOnce(&s_metricsOnceFlag, service_registerMetrics);
+    pHandle->pMetricsMessages = s_pMetricsMessages;
 
 #ifdef DEF_USE_SPINLOCK
     spinLock_init(&pHandle->spinLock);
@@ -330,6 +728,7 @@ service_tt* createService(eventIO_tt* pEventIO)
     mutex_init(&pHandle->mutex);
 #endif
     QUEUE_INIT(&pHandle->queuePending);
+    QUEUE_INIT(&pHandle->queuePriority);
     pHandle->pEventWatcher = NULL;
     return pHandle;
 }
@@ -340,6 +739,50 @@ void service_setCallback(service_tt* pService,
     pService->fnCallback = fn;
 }
 
+void service_setIdleCallback(service_tt* pService, void (*fn)(void*))
+{
+    pService->fnIdle = fn;
+}
+
+void service_setSlowCallback(service_tt* pService, void (*fn)(uint32_t, void*))
+{
+    // 与监控线程互斥, 置空返回后不会再有回调进行中
+#ifdef DEF_USE_SPINLOCK
+    spinLock_lock(&pService->spinLock);
+#else
+    mutex_lock(&pService->mutex);
+#endif
+    pService->fnSlow = fn;
+#ifdef DEF_USE_SPINLOCK
+    spinLock_unlock(&pService->spinLock);
+#else
+    mutex_unlock(&pService->mutex);
+#endif
+}
+
+void service_slow(service_tt* pService, uint32_t uiSlowID)
+{
+#ifdef DEF_USE_SPINLOCK
+    spinLock_lock(&pService->spinLock);
+#else
+    mutex_lock(&pService->mutex);
+#endif
+    if (pService->fnSlow) {
+        pService->fnSlow(uiSlowID, pService->pUserData);
+    }
+#ifdef DEF_USE_SPINLOCK
+    spinLock_unlock(&pService->spinLock);
+#else
+    mutex_unlock(&pService->mutex);
+#endif
+}
+
+void service_setBatchCallback(service_tt* pService,
+                              void (*fn)(const serviceBatchEvent_tt*, int32_t, void*))
+{
+    pService->fnBatch = fn;
+}
+
 void service_addref(service_tt* pService)
 {
     atomic_fetch_add(&(pService->iRefCount), 1);
@@ -348,6 +791,8 @@ void service_addref(service_tt* pService)
 void service_release(service_tt* pService)
 {
     if (atomic_fetch_sub(&(pService->iRefCount), 1) == 1) {
+        service_discardQueue(pService, &pService->queuePriority);
+        service_discardQueue(pService, &pService->queuePending);
 #ifndef DEF_USE_SPINLOCK
         mutex_destroy(&pService->mutex);
 #endif
@@ -392,6 +837,9 @@ void service_stop(service_tt* pService)
         pEvent->uiLength        = DEF_EVENT_SERVICE_STOP << 24;
         pEvent->uiSourceID      = pService->uiServiceID;
         pEvent->uiToken         = 0;
+        pEvent->uiEnqueueTime   = service_clockNs();
+        pEvent->trace.uiTraceID = 0;
+        pEvent->trace.uiSpanID  = 0;
         atomic_fetch_add(&pService->uiQueueSize, 1);
 #ifdef DEF_USE_SPINLOCK
         spinLock_lock(&pService->spinLock);
@@ -412,11 +860,13 @@ bool service_sendMove(service_tt* pService, uint32_t uiSourceID, void* pData, in
                       uint32_t uiFlag, uint32_t uiToken)
 {
     assert(iLength <= 0xFFFFFF);
-    serviceEvent_tt* pEvent      = mem_malloc(sizeof(serviceEvent_tt) + sizeof(intptr_t));
-    pEvent->uiLength             = iLength | (DEF_EVENT_MOVEBUF | uiFlag) << 24;
-    pEvent->uiSourceID           = uiSourceID;
-    pEvent->uiToken              = uiToken;
-    *(void**)(pEvent->szStorage) = pData;
+    serviceEvent_tt* pEvent = mem_malloc(sizeof(serviceEvent_tt) + sizeof(serviceMoveBuf_tt));
+    serviceMoveBuf_tt* pMoveBuf = (serviceMoveBuf_tt*)pEvent->szStorage;
+    pEvent->uiLength            = iLength | (DEF_EVENT_MOVEBUF | uiFlag) << 24;
+    pEvent->uiSourceID          = uiSourceID;
+    pEvent->uiToken             = uiToken;
+    pMoveBuf->pBuffer           = pData;
+    pMoveBuf->pShared           = NULL;
     if (!service_enqueue(pService, pEvent)) {
         mem_free(pData);
         return false;
@@ -424,10 +874,10 @@ bool service_sendMove(service_tt* pService, uint32_t uiSourceID, void* pData, in
     return true;
 }
 
-bool service_send(service_tt* pService, uint32_t uiSourceID, const void* pData, int32_t iLength,
-                  uint32_t uiFlag, uint32_t uiToken)
+static inline serviceEvent_tt* createServiceEvent(uint32_t uiSourceID, const void* pData,
+                                                  int32_t iLength, uint32_t uiFlag,
+                                                  uint32_t uiToken)
 {
-    assert(iLength <= 0xFFFFFF);
     serviceEvent_tt* pEvent = mem_malloc(sizeof(serviceEvent_tt) + iLength);
     pEvent->uiLength        = iLength | uiFlag << 24;
     pEvent->uiSourceID      = uiSourceID;
@@ -435,7 +885,72 @@ bool service_send(service_tt* pService, uint32_t uiSourceID, const void* pData,
     if (iLength != 0) {
         memcpy(pEvent->szStorage, pData, iLength);
     }
-    return service_enqueue(pService, pEvent);
+    return pEvent;
+}
+
+bool service_sendPriority(service_tt* pService, uint32_t uiSourceID, const void* pData,
+                          int32_t iLength, uint32_t uiFlag, uint32_t uiToken)
+{
+    assert(iLength <= 0xFFFFFF);
+    return service_enqueueLane(pService,
+                               createServiceEvent(uiSourceID, pData, iLength, uiFlag, uiToken),
+                               true) == DEF_SERVICE_SEND_OK;
+}
+
+int32_t service_post(service_tt* pService, uint32_t uiSourceID, const void* pData,
+                     int32_t iLength, uint32_t uiFlag, uint32_t uiToken, bool bPriority)
+{
+    assert(iLength <= 0xFFFFFF);
+    serviceEvent_tt* pEvent = createServiceEvent(uiSourceID, pData, iLength, uiFlag, uiToken);
+    return service_enqueueLane(pService, pEvent, bPriority || serviceEvent_isPriority(pEvent));
+}
+
+bool service_send(service_tt* pService, uint32_t uiSourceID, const void* pData, int32_t iLength,
+                  uint32_t uiFlag, uint32_t uiToken)
+{
+    assert(iLength <= 0xFFFFFF);
+    return service_enqueue(pService,
+                           createServiceEvent(uiSourceID, pData, iLength, uiFlag, uiToken));
+}
+
+int32_t service_multicast(const uint32_t* pServiceIDs, int32_t iCount, uint32_t uiSourceID,
+                          const void* pData, int32_t iLength, uint32_t uiFlag, uint32_t uiToken)
+{
+    assert(iLength <= 0xFFFFFF);
+    serviceShared_tt* pShared = mem_malloc(sizeof(serviceShared_tt) + iLength);
+    atomic_init(&pShared->iRefCount, 1);
+    pShared->iLength = iLength;
+    if (iLength != 0) {
+        memcpy(pShared->szBuffer, pData, iLength);
+    }
+
+    int32_t iSendCount = 0;
+    for (int32_t i = 0; i < iCount; ++i) {
+        service_tt* pService = serviceCenter_gain(pServiceIDs[i]);
+        if (pService == NULL) {
+            if (clusterRouter_send(pServiceIDs[i], uiSourceID, pData, iLength, uiFlag, uiToken)) {
+                ++iSendCount;
+            }
+            continue;
+        }
+        serviceEvent_tt* pEvent = mem_malloc(sizeof(serviceEvent_tt) + sizeof(serviceMoveBuf_tt));
+        serviceMoveBuf_tt* pMoveBuf = (serviceMoveBuf_tt*)pEvent->szStorage;
+        pEvent->uiLength            = iLength | (DEF_EVENT_MOVEBUF | uiFlag) << 24;
+        pEvent->uiSourceID          = uiSourceID;
+        pEvent->uiToken             = uiToken;
+        pMoveBuf->pBuffer           = pShared->szBuffer;
+        pMoveBuf->pShared           = pShared;
+        atomic_fetch_add(&pShared->iRefCount, 1);
+        if (service_enqueue(pService, pEvent)) {
+            ++iSendCount;
+        }
+        else {
+            serviceShared_release(pShared);
+        }
+        service_release(pService);
+    }
+    serviceShared_release(pShared);
+    return iSendCount;
 }
 
 uint32_t service_queueSize(service_tt* pService)
@@ -443,6 +958,64 @@ uint32_t service_queueSize(service_tt* pService)
     return atomic_load(&pService->uiQueueSize);
 }
 
+size_t service_queueBytes(service_tt* pService)
+{
+    return atomic_load(&pService->nQueueBytes);
+}
+
+void service_setMemoryUsage(service_tt* pService, size_t nMemory, size_t nMemoryPeak)
+{
+    atomic_store_explicit(&pService->nMemory, nMemory, memory_order_relaxed);
+    atomic_store_explicit(&pService->nMemoryPeak, nMemoryPeak, memory_order_relaxed);
+}
+
+size_t service_getMemoryUsage(service_tt* pService, size_t* pMemoryPeak)
+{
+    if (pMemoryPeak) {
+        *pMemoryPeak = atomic_load_explicit(&pService->nMemoryPeak, memory_order_relaxed);
+    }
+    return atomic_load_explicit(&pService->nMemory, memory_order_relaxed);
+}
+
+void service_getStats(service_tt* pService, serviceStats_tt* pStats)
+{
+    pStats->uiProcessed = atomic_load_explicit(&pService->uiProcessed, memory_order_relaxed);
+    pStats->uiBusyNs    = atomic_load_explicit(&pService->uiBusyNs, memory_order_relaxed);
+    pStats->uiSendBytes = atomic_load_explicit(&pService->uiSendBytes, memory_order_relaxed);
+    pStats->uiRecvBytes = atomic_load_explicit(&pService->uiRecvBytes, memory_order_relaxed);
+    pStats->uiQueueSize = atomic_load_explicit(&pService->uiQueueSize, memory_order_relaxed);
+    pStats->nMemory     = atomic_load_explicit(&pService->nMemory, memory_order_relaxed);
+}
+
+void service_addTraffic(service_tt* pService, size_t nSendBytes, size_t nRecvBytes)
+{
+    if (nSendBytes > 0) {
+        atomic_fetch_add_explicit(&pService->uiSendBytes, nSendBytes, memory_order_relaxed);
+    }
+    if (nRecvBytes > 0) {
+        atomic_fetch_add_explicit(&pService->uiRecvBytes, nRecvBytes, memory_order_relaxed);
+    }
+}
+
+void service_mergeQueueLatency(service_tt* pService, struct latencyHistogram_s* pHistogram)
+{
+    latencyHistogram_merge(pHistogram, &pService->queueLatency);
+}
+
+void service_setMailboxLimit(service_tt* pService, uint32_t uiMaxCount, size_t nMaxBytes,
+                             int32_t iPolicy, uint32_t uiBlockTimeoutMs)
+{
+    atomic_store(&pService->iOverloadPolicy, iPolicy);
+    atomic_store(&pService->uiBlockTimeoutMs, uiBlockTimeoutMs);
+    atomic_store(&pService->nMailboxByteLimit, nMaxBytes);
+    atomic_store(&pService->uiMailboxLimit, uiMaxCount);
+}
+
+bool service_isOverload(service_tt* pService)
+{
+    return atomic_load(&pService->bRunning) && service_isFull(pService, 0);
+}
+
 uint32_t service_getID(service_tt* pService)
 {
     return pService->uiServiceID;
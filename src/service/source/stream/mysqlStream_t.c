@@ -197,10 +197,11 @@ codecStream_tt* mysqlStreamCreate()
     mysqlStream_tt* pHandle = mem_malloc(sizeof(mysqlStream_tt));
     atomic_init(&pHandle->iRefCount, 1);
     pHandle->uiSeqid           = 1;
-    pHandle->codec.fnReceive   = NULL;
-    pHandle->codec.fnWrite     = mysqlStream_write;
-    pHandle->codec.fnWriteMove = mysqlStream_writeMove;
-    pHandle->codec.fnAddref    = mysqlStream_addref;
-    pHandle->codec.fnRelease   = mysqlStream_release;
+    pHandle->codec.fnReceive      = NULL;
+    pHandle->codec.fnWrite        = mysqlStream_write;
+    pHandle->codec.fnWriteMove    = mysqlStream_writeMove;
+    pHandle->codec.fnEncodeShared = NULL;
+    pHandle->codec.fnAddref       = mysqlStream_addref;
+    pHandle->codec.fnRelease      = mysqlStream_release;
     return &pHandle->codec;
 }
@@ -44,6 +44,16 @@ static int32_t tpackStream_writeMove(codecStream_tt*           pHandle,
     return eventConnection_send(pEventConnection, createEventBuf_move(bufVec, iCount, NULL, 0));
 }
 
+static eventBufShared_tt* tpackStream_encodeShared(codecStream_tt* pHandle,
+                                                   const char* pBuffer, int32_t iLength,
+                                                   uint32_t uiFlag, uint32_t uiToken)
+{
+    const int32_t iBufCount = tpack_encodeBufCount(pBuffer, iLength);
+    ioBufVec_tt   bufVec[iBufCount];
+    tpack_encode(pBuffer, iLength, (uint8_t)uiFlag, uiToken, bufVec);
+    return createEventBufShared(bufVec, iBufCount);
+}
+
 static bool tpackStream_receive(codecStream_tt* pHandle, channel_tt* pChannel,
                                 byteQueue_tt* pReadByteQueue)
 {
@@ -122,10 +132,11 @@ codecStream_tt* tpackStreamCreate()
 {
     tpackStream_tt* pHandle = mem_malloc(sizeof(tpackStream_tt));
     atomic_init(&pHandle->iRefCount, 1);
-    pHandle->codec.fnReceive   = tpackStream_receive;
-    pHandle->codec.fnWrite     = tpackStream_write;
-    pHandle->codec.fnWriteMove = tpackStream_writeMove;
-    pHandle->codec.fnAddref    = tpackStream_addref;
-    pHandle->codec.fnRelease   = tpackStream_release;
+    pHandle->codec.fnReceive      = tpackStream_receive;
+    pHandle->codec.fnWrite        = tpackStream_write;
+    pHandle->codec.fnWriteMove    = tpackStream_writeMove;
+    pHandle->codec.fnEncodeShared = tpackStream_encodeShared;
+    pHandle->codec.fnAddref       = tpackStream_addref;
+    pHandle->codec.fnRelease      = tpackStream_release;
     return &pHandle->codec;
 }
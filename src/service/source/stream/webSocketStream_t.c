@@ -50,6 +50,16 @@ static int32_t webSocketStream_writeMove(codecStream_tt*           pHandle,
     return eventConnection_send(pEventConnection, createEventBuf_move(bufVec, iCount, NULL, 0));
 }
 
+static eventBufShared_tt* webSocketStream_encodeShared(codecStream_tt* pHandle,
+                                                       const char* pBuffer, int32_t iLength,
+                                                       uint32_t uiFlag, uint32_t uiToken)
+{
+    const int32_t iBufCount = webSocket_encodeBufCount(pBuffer, iLength);
+    ioBufVec_tt   bufVec[iBufCount];
+    webSocket_encode(pBuffer, iLength, (uint8_t)uiFlag, bufVec);
+    return createEventBufShared(bufVec, iBufCount);
+}
+
 static bool webSocketStream_receive(codecStream_tt* pHandle, channel_tt* pChannel,
                                     byteQueue_tt* pReadByteQueue)
 {
@@ -127,10 +137,11 @@ codecStream_tt* webSocketStreamCreate()
 {
     webSocketStream_tt* pHandle = mem_malloc(sizeof(webSocketStream_tt));
     atomic_init(&pHandle->iRefCount, 1);
-    pHandle->codec.fnReceive   = webSocketStream_receive;
-    pHandle->codec.fnWrite     = webSocketStream_write;
-    pHandle->codec.fnWriteMove = webSocketStream_writeMove;
-    pHandle->codec.fnAddref    = webSocketStream_addref;
-    pHandle->codec.fnRelease   = webSocketStream_release;
+    pHandle->codec.fnReceive      = webSocketStream_receive;
+    pHandle->codec.fnWrite        = webSocketStream_write;
+    pHandle->codec.fnWriteMove    = webSocketStream_writeMove;
+    pHandle->codec.fnEncodeShared = webSocketStream_encodeShared;
+    pHandle->codec.fnAddref       = webSocketStream_addref;
+    pHandle->codec.fnRelease      = webSocketStream_release;
     return &pHandle->codec;
 }
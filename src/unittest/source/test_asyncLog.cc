@@ -0,0 +1,337 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "platform_t.h"
+#include "asyncLog_t.h"
+#include "fs_t.h"
+#include "log_t.h"
+#include "thread_t.h"
+#include "time_t.h"
+}
+
+#if DEF_PLATFORM == DEF_PLATFORM_LINUX
+
+#	include <dirent.h>
+
+// 写线程每50ms批量写出一次, 没有同步接口, 轮询文件内容直到行数达到预期
+static void sleepMs(int32_t iMs)
+{
+	timespec_tt timeSleep;
+	timeSleep.iSec = 0;
+	timeSleep.iNsec = iMs * 1000000;
+	sleep_for(&timeSleep);
+}
+
+static void readLines(const std::string& szPath, std::vector<std::string>& lines)
+{
+	FILE* pFile = fopen(szPath.c_str(), "rb");
+	if (pFile == NULL) {
+		return;
+	}
+	std::string szLine;
+	int c;
+	while ((c = fgetc(pFile)) != EOF) {
+		if (c == '\n') {
+			lines.push_back(szLine);
+			szLine.clear();
+		}
+		else {
+			szLine.push_back((char)c);
+		}
+	}
+	fclose(pFile);
+}
+
+// 目录下所有以szName开头的文件, 轮转出的文件按名字(时间戳加序号)排序
+static std::vector<std::string> listFiles(const std::string& szDir, const std::string& szName)
+{
+	std::vector<std::string> files;
+	DIR* pDir = opendir(szDir.c_str());
+	if (pDir == NULL) {
+		return files;
+	}
+	struct dirent* pEntry;
+	while ((pEntry = readdir(pDir)) != NULL) {
+		if (strncmp(pEntry->d_name, szName.c_str(), szName.size()) == 0) {
+			files.push_back(szDir + "/" + pEntry->d_name);
+		}
+	}
+	closedir(pDir);
+	return files;
+}
+
+static size_t waitLines(const std::string& szDir, const std::string& szName, size_t nExpect)
+{
+	size_t nCount = 0;
+	for (int32_t i = 0; i < 500; ++i) {
+		nCount = 0;
+		std::vector<std::string> files = listFiles(szDir, szName);
+		for (size_t j = 0; j < files.size(); ++j) {
+			std::vector<std::string> lines;
+			readLines(files[j], lines);
+			nCount += lines.size();
+		}
+		if (nCount >= nExpect) {
+			break;
+		}
+		sleepMs(10);
+	}
+	return nCount;
+}
+
+class asyncLogTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		m_szDir = "test_asyncLog";
+		fs_removeAll(m_szDir.c_str());
+		fs_mkdir(m_szDir.c_str());
+		ASSERT_TRUE(fs_find(m_szDir.c_str()));
+	}
+
+	void TearDown() override
+	{
+		asyncLog_setRotate(0, 0);
+		fs_removeAll(m_szDir.c_str());
+	}
+
+	std::string m_szDir;
+};
+
+TEST_F(asyncLogTest, ring_wrap)
+{
+	// 单条记录128字节, 写出的总量是环大小的数倍, 记录在环尾跨界处被跳过记录隔开
+	asyncLogFile_tt* pFile = asyncLog_open((m_szDir + "/wrap.log").c_str());
+	char szLine[128];
+	uint64_t uiDropped = asyncLog_getDropped();
+	std::vector<int32_t> written;
+	for (int32_t i = 0; i < 8192; ++i) {
+		int32_t iLength = snprintf(szLine, sizeof(szLine), "%08d %0100d", i, i);
+		if (asyncLog_write(pFile, szLine, (size_t)iLength)) {
+			written.push_back(i);
+		}
+		if (i % 512 == 511) {
+			sleepMs(20);
+		}
+	}
+	EXPECT_GT(written.size(), 4096u);
+	EXPECT_EQ(asyncLog_getDropped() - uiDropped, 8192 - written.size());
+	ASSERT_EQ(waitLines(m_szDir, "wrap.log", written.size()), written.size());
+
+	std::vector<std::string> lines;
+	readLines(m_szDir + "/wrap.log", lines);
+	ASSERT_EQ(lines.size(), written.size());
+	for (size_t i = 0; i < lines.size(); ++i) {
+		snprintf(szLine, sizeof(szLine), "%08d %0100d", written[i], written[i]);
+		ASSERT_EQ(lines[i], szLine) << i;
+	}
+	asyncLog_close(pFile);
+}
+
+TEST_F(asyncLogTest, oversize_dropped)
+{
+	asyncLogFile_tt* pFile = asyncLog_open((m_szDir + "/oversize.log").c_str());
+	uint64_t uiDropped = asyncLog_getDropped();
+
+	std::string szLong(128 * 1024, 'x');
+	EXPECT_FALSE(asyncLog_write(pFile, szLong.data(), szLong.size()));
+	EXPECT_EQ(asyncLog_getDropped() - uiDropped, 1u);
+
+	uint32_t uiFormatID = asyncLog_registerFormat("oversize {text}");
+	ASSERT_NE(uiFormatID, 0u);
+	asyncLogArg_tt arg;
+	arg.eType = eAsyncLogArg_string;
+	arg.str.szValue = szLong.data();
+	arg.str.nLength = szLong.size();
+	EXPECT_FALSE(asyncLog_writeStruct(pFile, uiFormatID, 0, 0, &arg, 1));
+	EXPECT_EQ(asyncLog_getDropped() - uiDropped, 2u);
+
+	// 之后的正常记录不受影响
+	EXPECT_TRUE(asyncLog_write(pFile, "short", 5));
+	ASSERT_EQ(waitLines(m_szDir, "oversize.log", 1), 1u);
+	std::vector<std::string> lines;
+	readLines(m_szDir + "/oversize.log", lines);
+	ASSERT_EQ(lines.size(), 1u);
+	EXPECT_EQ(lines[0], "short");
+	asyncLog_close(pFile);
+}
+
+TEST_F(asyncLogTest, rotate_by_size)
+{
+	// 写入前检查大小, 每个文件在越过上限的那一行之后轮转
+	const size_t nRotateBytes = 4096;
+	asyncLog_setRotate(nRotateBytes, 0);
+	asyncLogFile_tt* pFile = asyncLog_open((m_szDir + "/rotate.log").c_str());
+	char szLine[128];
+	const int32_t iCount = 400;
+	for (int32_t i = 0; i < iCount; ++i) {
+		int32_t iLength = snprintf(szLine, sizeof(szLine), "%08d %090d", i, i);
+		ASSERT_TRUE(asyncLog_write(pFile, szLine, (size_t)iLength));
+	}
+	ASSERT_EQ(waitLines(m_szDir, "rotate.log", iCount), (size_t)iCount);
+	asyncLog_setRotate(0, 0);
+
+	std::vector<std::string> files = listFiles(m_szDir, "rotate.log");
+	// 400行每行100字节, 每个文件41行
+	EXPECT_GE(files.size(), 9u);
+	std::vector<bool> seen(iCount, false);
+	for (size_t i = 0; i < files.size(); ++i) {
+		std::vector<std::string> lines;
+		readLines(files[i], lines);
+		EXPECT_LE(lines.size() * 100, nRotateBytes + 100) << files[i];
+		for (size_t j = 0; j < lines.size(); ++j) {
+			int32_t iIndex = atoi(lines[j].c_str());
+			ASSERT_TRUE(iIndex >= 0 && iIndex < iCount);
+			EXPECT_FALSE(seen[iIndex]);
+			seen[iIndex] = true;
+		}
+	}
+	for (int32_t i = 0; i < iCount; ++i) {
+		EXPECT_TRUE(seen[i]) << i;
+	}
+	asyncLog_close(pFile);
+}
+
+static asyncLogArg_tt makeArg(int64_t iValue)
+{
+	asyncLogArg_tt arg;
+	arg.eType = eAsyncLogArg_integer;
+	arg.iValue = iValue;
+	return arg;
+}
+
+static asyncLogArg_tt makeArg(double fValue)
+{
+	asyncLogArg_tt arg;
+	arg.eType = eAsyncLogArg_number;
+	arg.fValue = fValue;
+	return arg;
+}
+
+static asyncLogArg_tt makeArg(const std::string& szValue)
+{
+	asyncLogArg_tt arg;
+	arg.eType = eAsyncLogArg_string;
+	arg.str.szValue = szValue.data();
+	arg.str.nLength = szValue.size();
+	return arg;
+}
+
+static asyncLogArg_tt makeBool(bool bValue)
+{
+	asyncLogArg_tt arg;
+	arg.eType = eAsyncLogArg_bool;
+	arg.bValue = bValue;
+	return arg;
+}
+
+static asyncLogArg_tt makeNil()
+{
+	asyncLogArg_tt arg;
+	arg.eType = eAsyncLogArg_nil;
+	return arg;
+}
+
+// 去掉带时间的行头, 文本行取"service:[...] "之后, JSON行取"fmt"之后
+static std::string stripHead(const std::string& szLine, const std::string& szHeadEnd)
+{
+	size_t nPos = szLine.find(szHeadEnd);
+	if (nPos == std::string::npos) {
+		return "<no head> " + szLine;
+	}
+	return szLine.substr(nPos + szHeadEnd.size());
+}
+
+TEST_F(asyncLogTest, render_text)
+{
+	asyncLogFile_tt* pFile = asyncLog_open((m_szDir + "/text.log").c_str());
+	uint32_t uiFormatID = asyncLog_registerFormat("player {player} enter {scene.id} at {x}");
+	ASSERT_NE(uiFormatID, 0u);
+	EXPECT_EQ(asyncLog_registerFormat("player {player} enter {scene.id} at {x}"), uiFormatID);
+
+	std::string szName("bob \"b\"\n");
+	asyncLogArg_tt args[] = { makeArg(szName), makeArg((int64_t)-42), makeArg(1.5), makeBool(true),
+							  makeNil() };
+	// {name}逐个替换, 多出的参数以空格追加在行尾
+	EXPECT_TRUE(asyncLog_writeStruct(pFile, uiFormatID, eLog_info, 0x2a, args, 5));
+	// 参数不足时剩余的{name}原样保留
+	EXPECT_TRUE(asyncLog_writeStruct(pFile, uiFormatID, eLog_warning, 0x2a, args, 1));
+	// 不是字段的花括号原样输出
+	uint32_t uiBraceID = asyncLog_registerFormat("{} {a b} {{n}}");
+	EXPECT_TRUE(asyncLog_writeStruct(pFile, uiBraceID, eLog_error, 1, args + 1, 1));
+	// 文本中非有限数照常打印
+	asyncLogArg_tt inf = makeArg(std::numeric_limits<double>::infinity());
+	EXPECT_TRUE(asyncLog_writeStruct(pFile, uiBraceID, eLog_error, 1, &inf, 1));
+	// 未注册的格式ID展开为"?", 越界的等级按FATAL
+	EXPECT_TRUE(asyncLog_writeStruct(pFile, 0, 99, 1, args + 1, 1));
+	EXPECT_TRUE(asyncLog_writeStruct(pFile, 0xFFFFFF, eLog_info, 1, NULL, 0));
+	ASSERT_EQ(waitLines(m_szDir, "text.log", 8), 8u);
+
+	std::vector<std::string> lines;
+	readLines(m_szDir + "/text.log", lines);
+	ASSERT_EQ(lines.size(), 8u);
+	// 字符串参数不转义, 其中的换行拆成了两行
+	EXPECT_EQ(lines[0].compare(0, 6, "[INFO "), 0) << lines[0];
+	EXPECT_EQ(stripHead(lines[0], "service:[0000002a] "), "player bob \"b\"");
+	EXPECT_EQ(lines[1], " enter -42 at 1.5 true nil");
+	EXPECT_EQ(lines[2].compare(0, 9, "[WARNING "), 0) << lines[2];
+	EXPECT_EQ(stripHead(lines[2], "service:[0000002a] "), "player bob \"b\"");
+	EXPECT_EQ(lines[3], " enter {scene.id} at {x}");
+	EXPECT_EQ(stripHead(lines[4], "service:[00000001] "), "{} {a b} {-42}");
+	EXPECT_EQ(stripHead(lines[5], "service:[00000001] "), "{} {a b} {inf}");
+	EXPECT_EQ(lines[6].compare(0, 7, "[FATAL "), 0) << lines[6];
+	EXPECT_EQ(stripHead(lines[6], "service:[00000001] "), "? -42");
+	EXPECT_EQ(stripHead(lines[7], "service:[00000001] "), "?");
+	asyncLog_close(pFile);
+}
+
+TEST_F(asyncLogTest, render_json)
+{
+	asyncLogFile_tt* pFile = asyncLog_open((m_szDir + "/json.log").c_str());
+	asyncLog_setJson(pFile, true);
+	uint32_t uiFormatID = asyncLog_registerFormat("player {player} enter {scene.id} at {x}");
+	ASSERT_NE(uiFormatID, 0u);
+
+	std::string szName("a\"b\\c\n\r\t\x01\x1f");
+	szName.push_back('\0');
+	szName += "\xe4\xb8\xad";
+	asyncLogArg_tt args[] = { makeArg(szName), makeArg((int64_t)-42), makeArg(0.1), makeBool(false),
+							  makeNil() };
+	// {name}作为键名, 多出的参数以_N命名
+	EXPECT_TRUE(asyncLog_writeStruct(pFile, uiFormatID, eLog_info, 0x2a, args, 5));
+	// 非有限数写成null
+	asyncLogArg_tt numbers[] = { makeArg(std::numeric_limits<double>::quiet_NaN()), makeArg(std::numeric_limits<double>::infinity()),
+								 makeArg(-std::numeric_limits<double>::infinity()), makeArg(1e300) };
+	EXPECT_TRUE(asyncLog_writeStruct(pFile, uiFormatID, eLog_info, 0x2a, numbers, 4));
+	// 未注册的格式ID
+	EXPECT_TRUE(asyncLog_writeStruct(pFile, 12345678, eLog_error, 1, args + 1, 1));
+	ASSERT_EQ(waitLines(m_szDir, "json.log", 3), 3u);
+
+	std::vector<std::string> lines;
+	readLines(m_szDir + "/json.log", lines);
+	ASSERT_EQ(lines.size(), 3u);
+	EXPECT_EQ(lines[0].compare(0, 9, "{\"time\":\""), 0) << lines[0];
+	EXPECT_NE(lines[0].find("\",\"level\":\"INFO\",\"service\":\"0000002a\",\"fmt\":"),
+			  std::string::npos)
+		<< lines[0];
+	EXPECT_EQ(stripHead(lines[0], ",\"fmt\":"),
+			  "\"player {player} enter {scene.id} at {x}\","
+			  "\"player\":\"a\\\"b\\\\c\\n\\r\\t\\u0001\\u001f\\u0000\xe4\xb8\xad\","
+			  "\"scene.id\":-42,\"x\":0.10000000000000001,\"_4\":false,\"_5\":null}");
+	EXPECT_EQ(stripHead(lines[1], ",\"fmt\":"),
+			  "\"player {player} enter {scene.id} at {x}\","
+			  "\"player\":null,\"scene.id\":null,\"x\":null,\"_4\":1.0000000000000001e+300}");
+	EXPECT_NE(lines[2].find("\"level\":\"ERROR\",\"service\":\"00000001\""), std::string::npos)
+		<< lines[2];
+	EXPECT_EQ(stripHead(lines[2], ",\"fmt\":"), "\"?\",\"_1\":-42}");
+	asyncLog_close(pFile);
+}
+
+#endif
@@ -0,0 +1,536 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+extern "C" {
+#include "platform_t.h"
+#include "utility_t.h"
+#include "time_t.h"
+#include "thread_t.h"
+#include "eventIO/eventIO_t.h"
+#include "eventIO/eventIOThread_t.h"
+#include "service_t.h"
+#include "serviceCenter_t.h"
+#include "serviceEvent_t.h"
+#include "serviceTrace_t.h"
+#include "clusterRouter_t.h"
+}
+
+#if DEF_PLATFORM == DEF_PLATFORM_LINUX
+
+#	include <arpa/inet.h>
+#	include <errno.h>
+#	include <netinet/in.h>
+#	include <signal.h>
+#	include <sys/socket.h>
+#	include <sys/time.h>
+#	include <sys/wait.h>
+#	include <unistd.h>
+
+#	define def_testTraceID 0x1234567890ull
+#	define def_testToken 7
+
+typedef bool (*testCallback)(int32_t, uint32_t, uint32_t, void*, size_t, void*);
+
+static void sleepMs(int32_t iMs)
+{
+	timespec_tt timeSleep;
+	timeSleep.iSec = 0;
+	timeSleep.iNsec = iMs * 1000000;
+	sleep_for(&timeSleep);
+}
+
+struct clusterTestData
+{
+	uint32_t          uiServiceID;
+	std::atomic_bool  bQuit;
+	std::atomic_bool  bReplied;
+	uint32_t          uiToken;
+	size_t            nLength;
+	char              szReply[64];
+};
+
+// 回显服务: 把payload和派发时的traceID一起回复给来源, 收到quit后退出,
+// bind:/unbind:用于在连接建立后产生名字增量
+static bool echoCallback(int32_t iType, uint32_t uiSourceID, uint32_t uiToken, void* pBuffer,
+						 size_t nLength, void* pUserData)
+{
+	clusterTestData* pData = (clusterTestData*)pUserData;
+	if (iType != (DEF_EVENT_MSG | DEF_EVENT_MSG_SEND) || nLength > 32) {
+		return true;
+	}
+	if (nLength == 4 && memcmp(pBuffer, "quit", 4) == 0) {
+		pData->bQuit = true;
+		return true;
+	}
+	char szName[40];
+	if (nLength > 5 && memcmp(pBuffer, "bind:", 5) == 0) {
+		memcpy(szName, (char*)pBuffer + 5, nLength - 5);
+		szName[nLength - 5] = '\0';
+		serviceCenter_bindName(pData->uiServiceID, szName);
+		return true;
+	}
+	if (nLength > 7 && memcmp(pBuffer, "unbind:", 7) == 0) {
+		memcpy(szName, (char*)pBuffer + 7, nLength - 7);
+		szName[nLength - 7] = '\0';
+		serviceCenter_unbindServiceName(szName);
+		return true;
+	}
+	char szReply[40];
+	uint64_t uiTraceID = serviceTrace_current()->uiTraceID;
+	memcpy(szReply, pBuffer, nLength);
+	memcpy(szReply + nLength, &uiTraceID, sizeof(uiTraceID));
+	clusterRouter_send(uiSourceID, pData->uiServiceID, szReply, (int32_t)(nLength + sizeof(uiTraceID)),
+					   DEF_EVENT_MSG | DEF_EVENT_MSG_REPLY, uiToken);
+	return true;
+}
+
+static bool replyCallback(int32_t iType, uint32_t uiSourceID, uint32_t uiToken, void* pBuffer,
+						  size_t nLength, void* pUserData)
+{
+	clusterTestData* pData = (clusterTestData*)pUserData;
+	if (iType != (DEF_EVENT_MSG | DEF_EVENT_MSG_REPLY) || nLength > sizeof(pData->szReply)) {
+		return true;
+	}
+	pData->uiToken = uiToken;
+	pData->nLength = nLength;
+	memcpy(pData->szReply, pBuffer, nLength);
+	pData->bReplied = true;
+	return true;
+}
+
+// 记录收到的第一条事件, 用于检查从网络进来的事件类型
+static bool recordCallback(int32_t iType, uint32_t uiSourceID, uint32_t uiToken, void* pBuffer,
+						   size_t nLength, void* pUserData)
+{
+	clusterTestData* pData = (clusterTestData*)pUserData;
+	if (pData->bReplied || nLength > sizeof(pData->szReply)) {
+		return true;
+	}
+	pData->uiToken = (uint32_t)iType;
+	pData->nLength = nLength;
+	memcpy(pData->szReply, pBuffer, nLength);
+	pData->bReplied = true;
+	return true;
+}
+
+class clusterNode
+{
+public:
+	bool start(int32_t iNodeId, uint16_t uiListenPort, uint16_t uiPeerPort,
+			   const char* const* pAllowIPs, int32_t iAllowCount)
+	{
+		char szAddress[64];
+		serviceCenter_init(iNodeId);
+		m_pEventIO = createEventIO();
+		eventIO_start(m_pEventIO, false);
+		m_pEventIOThread = createEventIOThread(m_pEventIO);
+		eventIOThread_start(m_pEventIOThread, true, NULL, NULL);
+		snprintf(szAddress, sizeof(szAddress), "127.0.0.1:%u", uiListenPort);
+		if (!clusterRouter_init(m_pEventIO, iNodeId, szAddress, pAllowIPs, iAllowCount)) {
+			return false;
+		}
+		snprintf(szAddress, sizeof(szAddress), "127.0.0.1:%u", uiPeerPort);
+		return clusterRouter_addPeer(iNodeId == 1 ? 2 : 1, szAddress);
+	}
+
+	uint32_t startService(testCallback fnCallback, clusterTestData* pData)
+	{
+		m_pService = createService(m_pEventIO);
+		service_setCallback(m_pService, fnCallback);
+		pData->uiServiceID = service_start(m_pService, pData, NULL, NULL);
+		return pData->uiServiceID;
+	}
+
+	// 与lenv_exit的顺序一致: 先停掉网络线程再清理集群路由
+	void stop()
+	{
+		uint32_t uiServiceID = service_getID(m_pService);
+		service_stop(m_pService);
+		for (int32_t i = 0; i < 1000; ++i) {
+			service_tt* pService = serviceCenter_gain(uiServiceID);
+			if (pService == NULL) {
+				break;
+			}
+			service_release(pService);
+			sleepMs(1);
+		}
+		service_release(m_pService);
+		eventIOThread_stop(m_pEventIOThread, true);
+		eventIOThread_join(m_pEventIOThread);
+		clusterRouter_clear();
+		serviceCenter_clear();
+		eventIO_release(m_pEventIO);
+	}
+
+private:
+	eventIO_tt*       m_pEventIO;
+	eventIOThread_tt* m_pEventIOThread;
+	service_tt*       m_pService;
+};
+
+static int32_t runEchoNode(uint16_t uiListenPort, uint16_t uiPeerPort, int32_t iWaitMs)
+{
+	clusterNode node;
+	clusterTestData data;
+	data.bQuit = false;
+	if (!node.start(2, uiListenPort, uiPeerPort, NULL, 0)) {
+		return 2;
+	}
+	serviceCenter_bindName(node.startService(echoCallback, &data), "echo");
+	for (int32_t i = 0; i < iWaitMs && !data.bQuit; ++i) {
+		sleepMs(1);
+	}
+	node.stop();
+	return data.bQuit ? 0 : 1;
+}
+
+static uint32_t waitRemoteName(const char* szName, int32_t iWaitMs)
+{
+	for (int32_t i = 0; i < iWaitMs; ++i) {
+		uint32_t uiServiceID = serviceCenter_findServiceID(szName);
+		if (uiServiceID != 0) {
+			return uiServiceID;
+		}
+		sleepMs(1);
+	}
+	return 0;
+}
+
+static bool waitNameGone(const char* szName, int32_t iWaitMs)
+{
+	for (int32_t i = 0; i < iWaitMs; ++i) {
+		if (serviceCenter_findServiceID(szName) == 0) {
+			return true;
+		}
+		sleepMs(1);
+	}
+	return false;
+}
+
+static bool sendText(uint32_t uiDestinationID, uint32_t uiSourceID, const char* szText,
+					 uint32_t uiToken)
+{
+	return clusterRouter_send(uiDestinationID, uiSourceID, szText, (int32_t)strlen(szText),
+							  DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, uiToken);
+}
+
+static void writeU32(uint8_t* pBuffer, uint32_t uiValue)
+{
+	pBuffer[0] = (uint8_t)(uiValue >> 24);
+	pBuffer[1] = (uint8_t)(uiValue >> 16);
+	pBuffer[2] = (uint8_t)(uiValue >> 8);
+	pBuffer[3] = (uint8_t)uiValue;
+}
+
+// 不经过clusterRouter直接连到节点, 用来发送伪造的帧
+static int rawPeerConnect(uint16_t uiPort)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(uiPort);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	struct timeval timeout = { 3, 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// 发一个只含一条事件的帧, uiDestinationID为0时是名字目录命令
+static bool rawPeerSend(int fd, uint32_t uiDestinationID, uint32_t uiSourceID, uint8_t uiFlag,
+						const char* pPayload, uint32_t uiLength)
+{
+	uint8_t szFrame[64];
+	writeU32(szFrame, 16 + uiLength);
+	writeU32(szFrame + 4, uiDestinationID);
+	writeU32(szFrame + 8, uiSourceID);
+	writeU32(szFrame + 12, 0);
+	writeU32(szFrame + 16, (uint32_t)uiFlag << 24 | uiLength);
+	memcpy(szFrame + 20, pPayload, uiLength);
+	return send(fd, szFrame, 20 + uiLength, 0) == (ssize_t)(20 + uiLength);
+}
+
+// 节点从不向入站连接回写, 读到结束即对端关闭了连接
+static bool waitPeerClosed(int fd)
+{
+	char c;
+	return recv(fd, &c, 1, 0) == 0;
+}
+
+static bool isPeerOpen(int fd)
+{
+	sleepMs(50);
+	char c;
+	return recv(fd, &c, 1, MSG_DONTWAIT) < 0 && errno == EAGAIN;
+}
+
+static uint16_t testPort()
+{
+	return (uint16_t)(20000 + (getpid() % 5000) * 8);
+}
+
+// 对端节点在另一个进程中运行本测试程序的DISABLED_echoNode,
+// 测试进程已有网络线程, fork后必须立即exec
+static pid_t spawnEchoNode(uint16_t uiListenPort, uint16_t uiPeerPort)
+{
+	char szEnv[64];
+	snprintf(szEnv, sizeof(szEnv), "FROG_CLUSTER_ECHO=%u:%u", uiListenPort, uiPeerPort);
+	char* argv[] = { (char*)"unittest", (char*)"--gtest_filter=clusterRouterTest.DISABLED_echoNode",
+					 (char*)"--gtest_also_run_disabled_tests", NULL };
+	char* envp[] = { szEnv, NULL };
+	pid_t pid = fork();
+	if (pid == 0) {
+		execve("/proc/self/exe", argv, envp);
+		_exit(127);
+	}
+	return pid;
+}
+
+TEST(clusterRouterTest, DISABLED_echoNode)
+{
+	unsigned int uiListenPort = 0;
+	unsigned int uiPeerPort = 0;
+	const char* szEnv = getenv("FROG_CLUSTER_ECHO");
+	if (szEnv == NULL || sscanf(szEnv, "%u:%u", &uiListenPort, &uiPeerPort) != 2) {
+		_exit(3);
+	}
+	_exit(runEchoNode((uint16_t)uiListenPort, (uint16_t)uiPeerPort, 10000));
+}
+
+TEST(clusterRouterTest, loopback)
+{
+	uint16_t uiPort = testPort();
+	pid_t pid = spawnEchoNode(uiPort + 1, uiPort);
+	ASSERT_GT(pid, 0);
+
+	clusterNode node;
+	clusterTestData data;
+	data.bReplied = false;
+	ASSERT_TRUE(node.start(1, uiPort, uiPort + 1, NULL, 0));
+	uint32_t uiServiceID = node.startService(replyCallback, &data);
+
+	// 名字目录由对端连上后同步过来
+	uint32_t uiEchoID = waitRemoteName("echo", 5000);
+	EXPECT_EQ(DEF_SERVICE_NODE_ID(uiEchoID), 2);
+	EXPECT_TRUE(clusterRouter_isRemote(uiEchoID));
+
+	// 追踪上下文随消息带到对端
+	serviceTraceContext_tt* pContext = serviceTrace_current();
+	pContext->uiTraceID = def_testTraceID;
+	pContext->uiSpanID = 1;
+	EXPECT_TRUE(clusterRouter_send(uiEchoID, uiServiceID, "ping", 4,
+								   DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, def_testToken));
+	pContext->uiTraceID = 0;
+	pContext->uiSpanID = 0;
+	for (int32_t i = 0; i < 5000 && !data.bReplied; ++i) {
+		sleepMs(1);
+	}
+	ASSERT_TRUE(data.bReplied);
+	EXPECT_EQ(data.uiToken, (uint32_t)def_testToken);
+	ASSERT_EQ(data.nLength, 4 + sizeof(uint64_t));
+	EXPECT_EQ(memcmp(data.szReply, "ping", 4), 0);
+	uint64_t uiTraceID = 0;
+	memcpy(&uiTraceID, data.szReply + 4, sizeof(uiTraceID));
+	EXPECT_EQ(uiTraceID, def_testTraceID);
+
+	EXPECT_TRUE(clusterRouter_send(uiEchoID, uiServiceID, "quit", 4,
+								   DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 0));
+	int iStatus = 0;
+	EXPECT_EQ(waitpid(pid, &iStatus, 0), pid);
+	EXPECT_TRUE(WIFEXITED(iStatus));
+	EXPECT_EQ(WEXITSTATUS(iStatus), 0);
+
+	// 对端退出后其名字全部失效
+	EXPECT_TRUE(waitNameGone("echo", 3000));
+	node.stop();
+}
+
+TEST(clusterRouterTest, reconnect_resync)
+{
+	uint16_t uiPort = testPort() + 4;
+	pid_t pid = spawnEchoNode(uiPort + 1, uiPort);
+	ASSERT_GT(pid, 0);
+
+	clusterNode node;
+	clusterTestData data;
+	data.bReplied = false;
+	ASSERT_TRUE(node.start(1, uiPort, uiPort + 1, NULL, 0));
+	uint32_t uiServiceID = node.startService(replyCallback, &data);
+	uint32_t uiEchoID = waitRemoteName("echo", 5000);
+	ASSERT_NE(uiEchoID, 0u);
+
+	// 全量同步之后的增量
+	EXPECT_TRUE(sendText(uiEchoID, uiServiceID, "bind:late", 0));
+	EXPECT_EQ(waitRemoteName("late", 3000), uiEchoID);
+	EXPECT_TRUE(sendText(uiEchoID, uiServiceID, "unbind:late", 0));
+	EXPECT_TRUE(waitNameGone("late", 3000));
+	EXPECT_TRUE(sendText(uiEchoID, uiServiceID, "bind:stale", 0));
+	EXPECT_EQ(waitRemoteName("stale", 3000), uiEchoID);
+
+	// 对端异常退出, 名字随连接断开清除
+	kill(pid, SIGKILL);
+	int iStatus = 0;
+	EXPECT_EQ(waitpid(pid, &iStatus, 0), pid);
+	EXPECT_TRUE(waitNameGone("echo", 3000));
+	EXPECT_EQ(serviceCenter_findServiceID("stale"), 0u);
+
+	// 重启后重新连上, Reset和全量快照只带回当前的名字
+	pid = spawnEchoNode(uiPort + 1, uiPort);
+	ASSERT_GT(pid, 0);
+	uiEchoID = waitRemoteName("echo", 5000);
+	ASSERT_NE(uiEchoID, 0u);
+	EXPECT_EQ(serviceCenter_findServiceID("stale"), 0u);
+
+	// 本端到对端的链路按重连间隔恢复, 期间的消息先缓存
+	EXPECT_TRUE(sendText(uiEchoID, uiServiceID, "ping", def_testToken));
+	for (int32_t i = 0; i < 5000 && !data.bReplied; ++i) {
+		sleepMs(1);
+	}
+	EXPECT_TRUE(data.bReplied);
+	EXPECT_TRUE(sendText(uiEchoID, uiServiceID, "quit", 0));
+	EXPECT_EQ(waitpid(pid, &iStatus, 0), pid);
+	EXPECT_TRUE(WIFEXITED(iStatus));
+	EXPECT_EQ(WEXITSTATUS(iStatus), 0);
+	node.stop();
+}
+
+TEST(clusterRouterTest, allow_list)
+{
+	uint16_t uiPort = testPort() + 2;
+	pid_t pid = spawnEchoNode(uiPort + 1, uiPort);
+	ASSERT_GT(pid, 0);
+
+	// 对端从127.0.0.1连入, 不在名单内被拒绝, 名字不会同步过来
+	const char* allowIPs[] = { "127.0.0.2" };
+	clusterNode node;
+	clusterTestData data;
+	data.bReplied = false;
+	ASSERT_TRUE(node.start(1, uiPort, uiPort + 1, allowIPs, 1));
+	node.startService(replyCallback, &data);
+	EXPECT_EQ(waitRemoteName("echo", 2500), 0u);
+
+	kill(pid, SIGKILL);
+	int iStatus = 0;
+	EXPECT_EQ(waitpid(pid, &iStatus, 0), pid);
+	node.stop();
+}
+
+TEST(clusterRouterTest, forged_event)
+{
+	// 对端节点不存在, 本端的出站链路一直重连, 不影响入站
+	uint16_t uiPort = testPort() + 6;
+	clusterNode node;
+	clusterTestData data;
+	data.bReplied = false;
+	ASSERT_TRUE(node.start(1, uiPort, uiPort + 1, NULL, 0));
+	uint32_t uiServiceID = node.startService(recordCallback, &data);
+
+	// 网络上来的停止事件和定时器等本地事件直接断开连接
+	const uint8_t forged[] = { DEF_EVENT_SERVICE_STOP, DEF_EVENT_RUN_AFTER,
+							   DEF_EVENT_CONNECT | DEF_EVENT_MOVEBUF };
+	for (size_t i = 0; i < sizeof(forged); ++i) {
+		int fd = rawPeerConnect(uiPort);
+		ASSERT_GE(fd, 0);
+		ASSERT_TRUE(rawPeerSend(fd, uiServiceID, 0, forged[i], "abcdefgh", 8));
+		EXPECT_TRUE(waitPeerClosed(fd)) << (int32_t)forged[i];
+		close(fd);
+	}
+	sleepMs(50);
+	service_tt* pService = serviceCenter_gain(uiServiceID);
+	ASSERT_TRUE(pService != NULL);
+	service_release(pService);
+	EXPECT_FALSE(data.bReplied);
+
+	// 消息上的MOVEBUF被清除, payload按字节交给服务而不是当作指针
+	int fd = rawPeerConnect(uiPort);
+	ASSERT_GE(fd, 0);
+	ASSERT_TRUE(rawPeerSend(fd, uiServiceID, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND | DEF_EVENT_MOVEBUF,
+							"abcdefgh", 8));
+	for (int32_t i = 0; i < 3000 && !data.bReplied; ++i) {
+		sleepMs(1);
+	}
+	close(fd);
+	ASSERT_TRUE(data.bReplied);
+	EXPECT_EQ(data.uiToken, (uint32_t)(DEF_EVENT_MSG | DEF_EVENT_MSG_SEND));
+	ASSERT_EQ(data.nLength, 8u);
+	EXPECT_EQ(memcmp(data.szReply, "abcdefgh", 8), 0);
+	node.stop();
+}
+
+TEST(clusterRouterTest, forged_reset)
+{
+	// 本端只配置了到节点2的链路, 与forged_event错开监听端口
+	uint16_t uiPort = testPort() + 7;
+	clusterNode node;
+	clusterTestData data;
+	data.bReplied = false;
+	ASSERT_TRUE(node.start(1, uiPort, uiPort - 1, NULL, 0));
+	node.startService(recordCallback, &data);
+
+	// 没有配置链路的节点和本节点自己
+	const uint32_t unknown[] = { 5, 1 };
+	for (size_t i = 0; i < 2; ++i) {
+		int fd = rawPeerConnect(uiPort);
+		ASSERT_GE(fd, 0);
+		ASSERT_TRUE(rawPeerSend(fd, 0, unknown[i] << DEF_SERVICE_NODE_SHIFT, 3, "", 0));
+		EXPECT_TRUE(waitPeerClosed(fd)) << unknown[i];
+		close(fd);
+	}
+
+	// 认领节点2之后只能同步节点2的名字
+	int fd = rawPeerConnect(uiPort);
+	ASSERT_GE(fd, 0);
+	ASSERT_TRUE(rawPeerSend(fd, 0, 2 << DEF_SERVICE_NODE_SHIFT, 3, "", 0));
+	ASSERT_TRUE(rawPeerSend(fd, 0, 2 << DEF_SERVICE_NODE_SHIFT | 1, 1, "owned", 5));
+	EXPECT_EQ(waitRemoteName("owned", 3000), (uint32_t)(2 << DEF_SERVICE_NODE_SHIFT | 1));
+	EXPECT_TRUE(isPeerOpen(fd));
+
+	// 其他连接不能抢占节点2, 名字不受影响
+	int other = rawPeerConnect(uiPort);
+	ASSERT_GE(other, 0);
+	ASSERT_TRUE(rawPeerSend(other, 0, 2 << DEF_SERVICE_NODE_SHIFT, 3, "", 0));
+	EXPECT_TRUE(waitPeerClosed(other));
+	close(other);
+	EXPECT_EQ(serviceCenter_findServiceID("owned"), (uint32_t)(2 << DEF_SERVICE_NODE_SHIFT | 1));
+	EXPECT_TRUE(isPeerOpen(fd));
+
+	// 未认领节点的连接不能绑定名字
+	other = rawPeerConnect(uiPort);
+	ASSERT_GE(other, 0);
+	ASSERT_TRUE(rawPeerSend(other, 0, 2 << DEF_SERVICE_NODE_SHIFT | 2, 1, "stray", 5));
+	EXPECT_TRUE(waitPeerClosed(other));
+	close(other);
+	EXPECT_EQ(serviceCenter_findServiceID("stray"), 0u);
+
+	// 同一连接再认领其他节点或绑定其他节点的名字都断开, 断开后节点2的名字失效
+	ASSERT_TRUE(rawPeerSend(fd, 0, 3 << DEF_SERVICE_NODE_SHIFT | 1, 1, "stray", 5));
+	EXPECT_TRUE(waitPeerClosed(fd));
+	close(fd);
+	EXPECT_TRUE(waitNameGone("owned", 3000));
+	EXPECT_EQ(serviceCenter_findServiceID("stray"), 0u);
+
+	// 连接断开后节点2可以重新认领
+	fd = rawPeerConnect(uiPort);
+	ASSERT_GE(fd, 0);
+	ASSERT_TRUE(rawPeerSend(fd, 0, 2 << DEF_SERVICE_NODE_SHIFT, 3, "", 0));
+	ASSERT_TRUE(rawPeerSend(fd, 0, 2 << DEF_SERVICE_NODE_SHIFT | 1, 1, "owned", 5));
+	EXPECT_EQ(waitRemoteName("owned", 3000), (uint32_t)(2 << DEF_SERVICE_NODE_SHIFT | 1));
+	ASSERT_TRUE(rawPeerSend(fd, 0, 4 << DEF_SERVICE_NODE_SHIFT, 3, "", 0));
+	EXPECT_TRUE(waitPeerClosed(fd));
+	close(fd);
+	EXPECT_TRUE(waitNameGone("owned", 3000));
+	node.stop();
+}
+
+#endif
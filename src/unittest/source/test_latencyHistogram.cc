@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+
+// 头文件用C11的stdatomic, C++中以<atomic>里同名的类型和函数代替, 两者布局一致
+using std::atomic_init;
+using std::atomic_load_explicit;
+using std::atomic_store_explicit;
+using std::atomic_uint;
+using std::atomic_ullong;
+using std::memory_order_relaxed;
+static_assert(sizeof(atomic_uint) == sizeof(uint32_t) && sizeof(atomic_ullong) == sizeof(uint64_t),
+			  "atomic layout");
+
+extern "C" {
+#include "latencyHistogram_t.h"
+}
+
+TEST(latencyHistogram, empty)
+{
+	latencyHistogram_tt histogram;
+	latencyHistogram_init(&histogram);
+	EXPECT_EQ(latencyHistogram_count(&histogram), 0u);
+	EXPECT_EQ(latencyHistogram_max(&histogram), 0u);
+	EXPECT_EQ(latencyHistogram_percentile(&histogram, 50.0), 0u);
+	EXPECT_EQ(latencyHistogram_percentile(&histogram, 100.0), 0u);
+}
+
+TEST(latencyHistogram, bucket)
+{
+	// 小于8的值各占一个桶, 之后每个2的幂区间8个桶
+	for (uint64_t i = 0; i < DEF_LATENCY_HISTOGRAM_SUB_COUNT; ++i) {
+		EXPECT_EQ(latencyHistogram_bucket(i), (int32_t)i);
+	}
+	EXPECT_EQ(latencyHistogram_bucket(8), 8);
+	EXPECT_EQ(latencyHistogram_bucket(15), 15);
+	EXPECT_EQ(latencyHistogram_bucket(16), 16);
+	EXPECT_EQ(latencyHistogram_bucket(17), 16);
+	EXPECT_EQ(latencyHistogram_bucket(18), 17);
+	EXPECT_EQ(latencyHistogram_bucket(31), 23);
+	EXPECT_EQ(latencyHistogram_bucket(32), 24);
+	for (uint64_t i = 1; i < 100000; ++i) {
+		EXPECT_LE(latencyHistogram_bucket(i - 1), latencyHistogram_bucket(i));
+	}
+	// 超出范围的值都落在最后一个桶
+	EXPECT_EQ(latencyHistogram_bucket((uint64_t)1 << DEF_LATENCY_HISTOGRAM_MAX_BITS),
+			  DEF_LATENCY_HISTOGRAM_BUCKETS - 1);
+	EXPECT_EQ(latencyHistogram_bucket(UINT64_MAX), DEF_LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+TEST(latencyHistogram, percentile)
+{
+	latencyHistogram_tt histogram;
+	latencyHistogram_init(&histogram);
+	for (uint64_t i = 1; i <= 1000; ++i) {
+		latencyHistogram_record(&histogram, i);
+	}
+	EXPECT_EQ(latencyHistogram_count(&histogram), 1000u);
+	EXPECT_EQ(latencyHistogram_max(&histogram), 1000u);
+
+	// 返回桶上界, 相对误差不超过12.5%
+	const double percentiles[] = { 1.0, 10.0, 50.0, 90.0, 99.0, 99.9 };
+	for (double fPercentile : percentiles) {
+		uint64_t uiExpect = (uint64_t)(fPercentile * 10.0 + 0.5);
+		uint64_t uiValue  = latencyHistogram_percentile(&histogram, fPercentile);
+		EXPECT_GE(uiValue, uiExpect) << fPercentile;
+		EXPECT_LE((double)uiValue, (double)uiExpect * 1.125) << fPercentile;
+	}
+	// 不超过记录到的最大值
+	EXPECT_EQ(latencyHistogram_percentile(&histogram, 100.0), 1000u);
+}
+
+TEST(latencyHistogram, small_values_exact)
+{
+	latencyHistogram_tt histogram;
+	latencyHistogram_init(&histogram);
+	latencyHistogram_record(&histogram, 0);
+	latencyHistogram_record(&histogram, 3);
+	latencyHistogram_record(&histogram, 7);
+	latencyHistogram_record(&histogram, 7);
+	EXPECT_EQ(latencyHistogram_percentile(&histogram, 25.0), 0u);
+	EXPECT_EQ(latencyHistogram_percentile(&histogram, 50.0), 3u);
+	EXPECT_EQ(latencyHistogram_percentile(&histogram, 75.0), 7u);
+	EXPECT_EQ(latencyHistogram_max(&histogram), 7u);
+}
+
+TEST(latencyHistogram, merge)
+{
+	latencyHistogram_tt first;
+	latencyHistogram_tt second;
+	latencyHistogram_tt total;
+	latencyHistogram_init(&first);
+	latencyHistogram_init(&second);
+	latencyHistogram_init(&total);
+	for (int32_t i = 0; i < 90; ++i) {
+		latencyHistogram_record(&first, 10);
+	}
+	for (int32_t i = 0; i < 10; ++i) {
+		latencyHistogram_record(&second, 5000);
+	}
+	latencyHistogram_merge(&total, &first);
+	latencyHistogram_merge(&total, &second);
+	EXPECT_EQ(latencyHistogram_count(&total), 100u);
+	EXPECT_EQ(latencyHistogram_max(&total), 5000u);
+	EXPECT_EQ(latencyHistogram_percentile(&total, 50.0), 10u);
+	EXPECT_EQ(latencyHistogram_percentile(&total, 99.0), 5000u);
+
+	// 合并不改变来源
+	EXPECT_EQ(latencyHistogram_count(&first), 90u);
+	EXPECT_EQ(latencyHistogram_max(&first), 10u);
+
+	// 超出范围的值仍计入max, 分位数止于最后一个桶的上界
+	latencyHistogram_record(&total, (uint64_t)1 << 40);
+	EXPECT_EQ(latencyHistogram_max(&total), (uint64_t)1 << 40);
+	EXPECT_EQ(latencyHistogram_percentile(&total, 100.0),
+			  ((uint64_t)1 << DEF_LATENCY_HISTOGRAM_MAX_BITS) - 1);
+}
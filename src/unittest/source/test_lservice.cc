@@ -0,0 +1,511 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+extern "C" {
+#include "platform_t.h"
+}
+
+#if DEF_PLATFORM == DEF_PLATFORM_LINUX && defined(DEF_TEST_SERVER_BIN)
+
+#	include <ftw.h>
+#	include <signal.h>
+#	include <sys/stat.h>
+#	include <sys/wait.h>
+#	include <unistd.h>
+
+// 每个用例在临时目录中以serverBin启动一个完整的运行时, 进程内的全局状态不能重复初始化;
+// 用例代码写在启动服务的test函数里, 通过result文件返回"ok"或错误信息,
+// 运行时不会随启动服务退出, 拿到结果后直接结束进程
+static const char* s_szConfig =
+	"C_node_id = 1\n"
+	"C_concurrent_threads = 1\n"
+	"C_log_path = \"log\"\n"
+	"C_log_name = \"_log\"\n"
+	"C_log = false\n"
+	"C_profile = false\n"
+	"C_loader_path = \"" DEF_TEST_LUA_LIBRARY "\"\n"
+	"C_service_path = \"service\"\n"
+	"C_bootstrap = \"bootstrap\"\n"
+	"C_debug_attach = false\n"
+	"C_luacache_share = true\n";
+
+static const char* s_szStartUp =
+	"local lenv = require \"lruntime.env\"\n"
+	"lenv.init(\"config.lua\")\n"
+	"lenv.wait()\n"
+	"lenv.exit()\n";
+
+static const char* s_szBootstrapHead =
+	"local serviceCore = require \"serviceCore\"\n"
+	"local lenv = require \"lruntime.env\"\n"
+	"local function test()\n";
+
+static const char* s_szBootstrapTail =
+	"end\n"
+	"serviceCore.start(function()\n"
+	"	local ok, err = pcall(test)\n"
+	"	local f = io.open(\"result.tmp\", \"w\")\n"
+	"	f:write(ok and \"ok\" or tostring(err))\n"
+	"	f:close()\n"
+	"	os.rename(\"result.tmp\", \"result\")\n"
+	"	serviceCore.exit()\n"
+	"end)\n";
+
+static int removePath(const char* szPath, const struct stat* pStat, int iFlag, struct FTW* pFtw)
+{
+	return remove(szPath);
+}
+
+class luaRuntimeTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		char szDir[] = "/tmp/frog_lservice_XXXXXX";
+		ASSERT_NE(mkdtemp(szDir), nullptr);
+		m_szDir = szDir;
+		ASSERT_EQ(mkdir((m_szDir + "/service").c_str(), 0755), 0);
+		ASSERT_EQ(mkdir((m_szDir + "/modules").c_str(), 0755), 0);
+		ASSERT_EQ(symlink(DEF_TEST_RUNTIME_MODULE, (m_szDir + "/modules/lruntime.so").c_str()), 0);
+		writeFile("config.lua", s_szConfig);
+		writeFile("start-up.lua", s_szStartUp);
+	}
+
+	void TearDown() override
+	{
+		nftw(m_szDir.c_str(), removePath, 16, FTW_DEPTH | FTW_PHYS);
+	}
+
+	void writeFile(const std::string& szName, const std::string& szContent)
+	{
+		FILE* pFile = fopen((m_szDir + "/" + szName).c_str(), "w");
+		ASSERT_NE(pFile, nullptr);
+		fwrite(szContent.data(), 1, szContent.size(), pFile);
+		fclose(pFile);
+	}
+
+	void writeService(const std::string& szName, const std::string& szContent)
+	{
+		writeFile("service/" + szName + ".lua", szContent);
+	}
+
+	// 运行启动服务中的用例, 返回result文件的内容
+	std::string run(const std::string& szTest, const std::string& szConfig = "")
+	{
+		writeService("bootstrap", s_szBootstrapHead + szTest + s_szBootstrapTail);
+		if (!szConfig.empty()) {
+			writeFile("config.lua", s_szConfig + szConfig);
+		}
+		std::string szResult = m_szDir + "/result";
+		remove(szResult.c_str());
+
+		pid_t pid = fork();
+		if (pid == 0) {
+			if (chdir(m_szDir.c_str()) == 0) {
+				execl(DEF_TEST_SERVER_BIN, "serverBin", "start-up.lua", (char*)NULL);
+			}
+			_exit(127);
+		}
+		if (pid < 0) {
+			return "fork error";
+		}
+
+		FILE* pFile = NULL;
+		int iStatus = 0;
+		timespec timeSleep = { 0, 10000000 };
+		for (int32_t i = 0; i < 6000 && pFile == NULL; ++i) {
+			if (waitpid(pid, &iStatus, WNOHANG) != 0) {
+				pid = 0;
+				pFile = fopen(szResult.c_str(), "r");
+				break;
+			}
+			nanosleep(&timeSleep, NULL);
+			pFile = fopen(szResult.c_str(), "r");
+		}
+		if (pid != 0) {
+			kill(pid, SIGKILL);
+			waitpid(pid, &iStatus, 0);
+		}
+		if (pFile == NULL) {
+			return pid != 0 ? "timeout" : "no result";
+		}
+
+		szResult.clear();
+		char szBuffer[1024];
+		size_t nRead = 0;
+		while ((nRead = fread(szBuffer, 1, sizeof(szBuffer), pFile)) > 0) {
+			szResult.append(szBuffer, nRead);
+		}
+		fclose(pFile);
+		return szResult;
+	}
+
+	std::string m_szDir;
+};
+
+TEST_F(luaRuntimeTest, bootstrap)
+{
+	EXPECT_EQ(run("assert(serviceCore.self() ~= 0)\n"), "ok");
+	EXPECT_NE(run("error(\"expected failure\")\n").find("expected failure"), std::string::npos);
+}
+
+// 配额耗尽时只有分配失败的调用报错, 服务仍可继续处理消息
+static const char* s_szQuotaService =
+	"local serviceCore = require \"serviceCore\"\n"
+	"local command = {}\n"
+	"function command.fill()\n"
+	"	local t = {}\n"
+	"	local ok, err = pcall(function()\n"
+	"		for i = 1, 10000000 do t[i] = string.rep(\"x\", 64) .. i end\n"
+	"	end)\n"
+	"	t = nil\n"
+	"	collectgarbage()\n"
+	"	return ok and \"filled\" or tostring(err)\n"
+	"end\n"
+	"function command.ping() return \"pong\" end\n"
+	"function command.stop() serviceCore.async(serviceCore.exit) end\n"
+	"serviceCore.start(function()\n"
+	"	serviceCore.eventDispatch(serviceCore.eventCall, function(_, cmd, ...)\n"
+	"		serviceCore.reply(command[cmd](...))\n"
+	"	end)\n"
+	"end)\n";
+
+TEST_F(luaRuntimeTest, memory_quota)
+{
+	writeService("quota", s_szQuotaService);
+	// 新建与池化两条路径: 库和入口chunk加载完成后配额才生效
+	EXPECT_EQ(run("local quota = 256 * 1024\n"
+				  "local function check()\n"
+				  "	local id = serviceCore.createService(\"quota\", nil, { memoryQuota = quota })\n"
+				  "	assert(id ~= 0, \"create failed\")\n"
+				  "	local r = serviceCore.call(id, \"fill\")\n"
+				  "	assert(r == \"not enough memory\", tostring(r))\n"
+				  "	assert(serviceCore.call(id, \"ping\") == \"pong\")\n"
+				  "	local memory = lenv.serviceMemory()[id]\n"
+				  "	assert(memory and memory.peak <= quota, \"peak over quota\")\n"
+				  "	serviceCore.call(id, \"stop\")\n"
+				  "end\n"
+				  "check()\n"
+				  "assert(lenv.servicePool(\"quota\", 1))\n"
+				  "local co = coroutine.running()\n"
+				  "for i = 1, 100000 do\n"
+				  "	if lenv.servicePoolStatus(\"quota\") == 1 then break end\n"
+				  "	serviceCore.yield(function() serviceCore.wakeup(co) end)\n"
+				  "	serviceCore.wait(co)\n"
+				  "end\n"
+				  "assert(lenv.servicePoolStatus(\"quota\") == 1, \"pool not ready\")\n"
+				  "check()\n"
+				  "local _, _, hit = lenv.servicePoolStatus(\"quota\")\n"
+				  "assert(hit == 1, \"pool not used\")\n"),
+			  "ok");
+}
+
+// 废弃的共享Proto在仍引用它的服务关闭后才释放, 期间服务照常运行
+static const char* s_szEchoService =
+	"local serviceCore = require \"serviceCore\"\n"
+	"local command = {}\n"
+	"function command.echo(...) return ... end\n"
+	"function command.stop() serviceCore.async(serviceCore.exit) end\n"
+	"serviceCore.start(function()\n"
+	"	serviceCore.eventDispatch(serviceCore.eventCall, function(_, cmd, ...)\n"
+	"		serviceCore.reply(command[cmd](...))\n"
+	"	end)\n"
+	"end)\n";
+
+TEST_F(luaRuntimeTest, luacache_abandon_shared)
+{
+	writeService("echo", s_szEchoService);
+	EXPECT_EQ(run("local first = serviceCore.createService(\"echo\")\n"
+				  "assert(serviceCore.call(first, \"echo\", 1) == 1)\n"
+				  "assert(lenv.luacacheAbandon(\"all\"))\n"
+				  "local second = serviceCore.createService(\"echo\")\n"
+				  "assert(serviceCore.call(first, \"echo\", 2) == 2)\n"
+				  "serviceCore.call(first, \"stop\")\n"
+				  "collectgarbage()\n"
+				  "assert(serviceCore.call(second, \"echo\", 3) == 3)\n"
+				  "assert(lenv.luacacheAbandon(\"all\"))\n"
+				  "serviceCore.call(second, \"stop\")\n"
+				  "local third = serviceCore.createService(\"echo\")\n"
+				  "assert(serviceCore.call(third, \"echo\", 4) == 4)\n"
+				  "serviceCore.call(third, \"stop\")\n"),
+			  "ok");
+}
+
+// 预加载模块调用服务接口时预热失败, 池清空后仍按普通方式创建; 预热出错时已预热的一并作废
+static const char* s_szPreloadService =
+	"local lservice = require \"lruntime.service\"\n"
+	"lservice.log(\"preload\")\n"
+	"return {}\n";
+
+TEST_F(luaRuntimeTest, service_pool)
+{
+	writeService("echo", s_szEchoService);
+	writeFile("preload.lua", s_szPreloadService);
+	EXPECT_EQ(run("lenv.luacacheOff()\n"
+				  "local co = coroutine.running()\n"
+				  "local function waitPool(ready, capacity)\n"
+				  "	for i = 1, 100000 do\n"
+				  "		local r, c = lenv.servicePoolStatus(\"echo\")\n"
+				  "		if r == ready and c == capacity then return end\n"
+				  "		serviceCore.yield(function() serviceCore.wakeup(co) end)\n"
+				  "		serviceCore.wait(co)\n"
+				  "	end\n"
+				  "	error(\"pool status \" .. table.concat({ lenv.servicePoolStatus(\"echo\") }, \",\"))\n"
+				  "end\n"
+				  "assert(lenv.servicePool(\"echo\", 1, { \"preload\" }))\n"
+				  "waitPool(0, 0)\n"
+				  "local id = serviceCore.createService(\"echo\")\n"
+				  "assert(serviceCore.call(id, \"echo\", 1) == 1)\n"
+				  "serviceCore.call(id, \"stop\")\n"
+				  "assert(lenv.servicePool(\"echo\", 1, { \"serviceCore\" }))\n"
+				  "waitPool(1, 1)\n"
+				  "local f = io.open(\"service/echo.lua\", \"w\")\n"
+				  "f:write(\"this is not lua\")\n"
+				  "f:close()\n"
+				  "assert(lenv.servicePool(\"echo\", 2, { \"serviceCore\" }))\n"
+				  "waitPool(0, 0)\n"),
+			  "ok");
+}
+
+// top读取的计数器: 不给服务发消息, 名字由服务表补上
+TEST_F(luaRuntimeTest, service_stats)
+{
+	writeService("echo", s_szEchoService);
+	EXPECT_EQ(run("assert(serviceCore.bindName(\"stats_bootstrap\"))\n"
+				  "local id = serviceCore.createService(\"echo\")\n"
+				  "for i = 1, 10 do assert(serviceCore.call(id, \"echo\", i) == i) end\n"
+				  "local co = coroutine.running()\n"
+				  "local stats = lenv.serviceStats()\n"
+				  "for i = 1, 1000 do\n"
+				  "	if stats[id] and stats[id].processed >= 10 then break end\n"
+				  "	serviceCore.yield(function() serviceCore.wakeup(co) end)\n"
+				  "	serviceCore.wait(co)\n"
+				  "	stats = lenv.serviceStats()\n"
+				  "end\n"
+				  "local echo = stats[id]\n"
+				  "assert(echo and echo.processed >= 10, \"processed\")\n"
+				  "assert(echo.memory > 0 and echo.busy >= 0 and echo.queue >= 0, \"counters\")\n"
+				  "assert(echo.name == nil, \"echo name\")\n"
+				  "assert(stats[serviceCore.self()].name == \"stats_bootstrap\", \"bootstrap name\")\n"
+				  "serviceCore.call(id, \"stop\")\n"),
+			  "ok");
+}
+
+// 邮箱等待统计在锁外构造, 每个服务一行, total为合并结果
+TEST_F(luaRuntimeTest, service_latency)
+{
+	writeService("echo", s_szEchoService);
+	EXPECT_EQ(run("local id = serviceCore.createService(\"echo\")\n"
+				  "for i = 1, 10 do assert(serviceCore.call(id, \"echo\", i) == i) end\n"
+				  "local services, total = lenv.serviceLatency()\n"
+				  "local latency = services[id]\n"
+				  "assert(latency and latency.count >= 10, \"echo latency\")\n"
+				  "assert(latency.p50 <= latency.p99 and latency.p99 <= latency.max, \"percentile order\")\n"
+				  "assert(services[serviceCore.self()], \"bootstrap latency\")\n"
+				  "assert(total.count >= latency.count and total.max >= latency.max, \"total\")\n"
+				  "serviceCore.call(id, \"stop\")\n"),
+			  "ok");
+}
+
+// 指标接口需要显式配置才开放
+TEST_F(luaRuntimeTest, metrics_listen_opt_in)
+{
+	EXPECT_EQ(run("assert(lenv.metricsListen() == nil)\n"), "ok");
+	EXPECT_EQ(run("assert(lenv.metricsListen() == \"127.0.0.1:9100\")\n",
+				  "C_metrics_listen = \"127.0.0.1:9100\"\n"),
+			  "ok");
+}
+
+// 用假的调试器模块在主线程上装一个lua钩子, 采样开始和停止都不能动它
+static const char* s_szFakeDebugger =
+	"local M = {}\n"
+	"function M.startDebugServer() end\n"
+	"function M.addLuaState() debug.sethook(function() end, \"\", 100000) end\n"
+	"function M.removeLuaState() debug.sethook() end\n"
+	"return M\n";
+
+TEST_F(luaRuntimeTest, sampler_keeps_debugger_hook)
+{
+	writeFile("frog_debug.lua", s_szFakeDebugger);
+	EXPECT_EQ(run("local lservice = require \"lruntime.service\"\n"
+				  "local main = debug.getregistry()[1]\n"
+				  "local hook = debug.gethook(main)\n"
+				  "assert(type(hook) == \"function\", \"debugger not attached\")\n"
+				  "assert(lservice.sampleStart(100))\n"
+				  "assert(debug.gethook(main) == hook, \"sampler replaced debugger hook\")\n"
+				  "lservice.sampleThread(coroutine.create(function() end))\n"
+				  "lservice.sampleStop()\n"
+				  "assert(debug.gethook(main) == hook, \"sampler cleared debugger hook\")\n",
+				  "C_debug_attach = true\n"
+				  "C_debug_ip = \"127.0.0.1\"\n"
+				  "C_debug_port = \"1\"\n"),
+			  "ok");
+}
+
+// 批量派发中出错的消息逐条带traceback记录, 同批的其他消息照常派发
+static const char* s_szBatchService =
+	"local serviceCore = require \"serviceCore\"\n"
+	"local received = {}\n"
+	"local command = {}\n"
+	"function command.received() return table.concat(received, \",\") end\n"
+	"function command.stop() serviceCore.async(serviceCore.exit) end\n"
+	"local function explode(n) error(\"boom \" .. n) end\n"
+	"serviceCore.start(function()\n"
+	"	serviceCore.setBatchDispatch(true)\n"
+	"	serviceCore.eventDispatch(serviceCore.eventSend, function(_, n)\n"
+	"		if n == 3 or n == 7 then explode(n) end\n"
+	"		received[#received + 1] = n\n"
+	"	end)\n"
+	"	serviceCore.eventDispatch(serviceCore.eventCall, function(_, cmd, ...)\n"
+	"		serviceCore.reply(command[cmd](...))\n"
+	"	end)\n"
+	"end)\n";
+
+TEST_F(luaRuntimeTest, batch_dispatch_error)
+{
+	writeService("batch", s_szBatchService);
+	EXPECT_EQ(run("os.execute(\"mkdir -p log\")\n"
+				  "local id = serviceCore.createService(\"batch\")\n"
+				  "for i = 1, 10 do assert(serviceCore.send(id, i)) end\n"
+				  "local r = serviceCore.call(id, \"received\")\n"
+				  "assert(r == \"1,2,4,5,6,8,9,10\", tostring(r))\n"
+				  "local co = coroutine.running()\n"
+				  "local log = \"\"\n"
+				  "for i = 1, 1000 do\n"
+				  "	local f = io.popen(string.format(\"cat log/*-%08x.log 2>/dev/null\", id))\n"
+				  "	log = f:read(\"a\")\n"
+				  "	f:close()\n"
+				  "	if log:find(\"boom 7\", 1, true) then break end\n"
+				  "	serviceCore.yield(function() serviceCore.wakeup(co) end)\n"
+				  "	serviceCore.wait(co)\n"
+				  "end\n"
+				  "local _, errors = log:gsub(\"lua batch call %[type:%d+ source:%x+ token:%d+%]\", \"\")\n"
+				  "assert(errors == 2, log)\n"
+				  "assert(log:find(\"boom 3\", 1, true) and log:find(\"boom 7\", 1, true), log)\n"
+				  "assert(log:find(\"explode\", 1, true), log)\n"
+				  "assert(log:find(\"stack traceback\", 1, true), log)\n"
+				  "serviceCore.call(id, \"stop\")\n"),
+			  "ok");
+}
+
+// 同一个服务里监听并连上三个客户端; 服务端频道先写出自己的序号,
+// 找到各自对端的客户端peer[i], 之后按对端累计收到的内容检查
+static const char* s_szLoopbackChannels =
+	"local function waitFor(f, what)\n"
+	"	for i = 1, 500 do\n"
+	"		if f() then return end\n"
+	"		serviceCore.sleep(10)\n"
+	"	end\n"
+	"	error(\"wait \" .. what)\n"
+	"end\n"
+	"local accepted, received = {}, {}\n"
+	"serviceCore.eventDispatch(serviceCore.eventAccept, function(id)\n"
+	"	assert(serviceCore.remoteBind(id, false, true))\n"
+	"	accepted[#accepted + 1] = id\n"
+	"end)\n"
+	"serviceCore.eventDispatch(serviceCore.eventBinary, function(id, msg, sz)\n"
+	"	received[id] = (received[id] or \"\") .. serviceCore.cbufferToString(msg, sz)\n"
+	"end)\n"
+	"serviceCore.eventDispatch(serviceCore.eventDisconnect, function(id) serviceCore.remoteClose(id) end)\n"
+	"local listen <close> = assert(serviceCore.listenPort(address), \"listen\")\n"
+	// 监听在IO线程中异步开始, 第一个连接失败时稍后重试
+	"local clients = {}\n"
+	"for i = 1, 50 do\n"
+	"	clients[1] = serviceCore.connect(address, 1000)\n"
+	"	if clients[1] then break end\n"
+	"	serviceCore.sleep(10)\n"
+	"end\n"
+	"assert(clients[1], \"connect\")\n"
+	"for i = 2, 3 do clients[i] = assert(serviceCore.connect(address, 1000), \"connect\") end\n"
+	"for i = 1, 3 do assert(serviceCore.remoteBind(clients[i], false, true)) end\n"
+	"waitFor(function() return #accepted == 3 end, \"accept\")\n"
+	"for i = 1, 3 do serviceCore.remoteWrite(accepted[i], tostring(i)) end\n"
+	"local peer = {}\n"
+	"waitFor(function()\n"
+	"	for i = 1, 3 do\n"
+	"		local n = tonumber(received[clients[i]])\n"
+	"		if n then peer[n] = clients[i] end\n"
+	"	end\n"
+	"	return peer[1] and peer[2] and peer[3]\n"
+	"end, \"pair\")\n"
+	"received = {}\n"
+	"local function contents()\n"
+	"	local t = {}\n"
+	"	for i = 1, 3 do t[i] = received[peer[i]] or \"\" end\n"
+	"	return table.concat(t, \"|\")\n"
+	"end\n"
+	"local function waitContents(s)\n"
+	"	waitFor(function() return contents() == s end, \"receive \" .. s)\n"
+	"end\n";
+
+// 组里放服务端的三个频道
+static const char* s_szChannelGroupTest =
+	"local lchannelGroup = require \"lruntime.channelGroup\"\n"
+	// 增删
+	"local group = lchannelGroup.new()\n"
+	"for i = 1, 3 do assert(group:add(accepted[i]), \"add\") end\n"
+	"assert(not group:add(accepted[1]), \"duplicate add\")\n"
+	"assert(not group:add(0), \"add unknown\")\n"
+	"assert(group:count() == 3)\n"
+	"assert(group:remove(accepted[3]) and not group:remove(accepted[3]), \"remove\")\n"
+	"assert(group:count() == 2)\n"
+	"assert(group:broadcast(0, \"r\") == 2)\n"
+	"waitContents(\"r|r|\")\n"
+	"assert(group:add(accepted[3]))\n"
+	// 广播排除单个ID和ID列表
+	"assert(group:broadcast(0, \"a\", accepted[2]) == 2)\n"
+	"waitContents(\"ra|r|a\")\n"
+	"assert(group:broadcast(0, \"b\", { accepted[1], accepted[3] }) == 1)\n"
+	"waitContents(\"ra|rb|a\")\n"
+	"assert(group:broadcast(0, \"c\") == 3)\n"
+	"waitContents(\"rac|rbc|ac\")\n"
+	// 仍在组内的成员关闭: 服务端主动关闭一个, 对端断开一个, 两者都离开组
+	"serviceCore.remoteClose(accepted[1])\n"
+	"serviceCore.remoteClose(peer[2])\n"
+	"waitFor(function() return group:count() == 1 end, \"leave\")\n"
+	"assert(group:broadcast(0, \"d\") == 1)\n"
+	"waitContents(\"rac|rbc|acd\")\n"
+	"group:clear()\n"
+	"assert(group:count() == 0)\n"
+	"assert(group:broadcast(0, \"e\") == 0)\n"
+	"assert(group:add(accepted[3]), \"add after clear\")\n"
+	// 组先于仍在组内的成员释放, 之后成员关闭不再访问组
+	"do local closing <close> = group end\n"
+	"assert(not pcall(group.count, group), \"closed group\")\n"
+	"serviceCore.remoteClose(accepted[3])\n";
+
+TEST_F(luaRuntimeTest, channel_group)
+{
+	char szAddress[64];
+	snprintf(szAddress, sizeof(szAddress), "local address = \"127.0.0.1:%d\"\n",
+			 61000 + (int32_t)(getpid() % 4000));
+	EXPECT_EQ(run(std::string(szAddress) + s_szLoopbackChannels + s_szChannelGroupTest), "ok");
+}
+
+// 频道ID直接写到连接上, 服务ID走服务间组播; 无效的ID不计入发送数
+static const char* s_szMulticastTest =
+	"local texts = {}\n"
+	"serviceCore.eventDispatch(serviceCore.eventText, function(source, msg) texts[#texts + 1] = msg end)\n"
+	"local self = serviceCore.self()\n"
+	"local closed = accepted[3]\n"
+	"serviceCore.remoteClose(closed)\n"
+	"local ids = { accepted[1], 0, self, closed, 0x80000000 | 0x7fffff, (5 << 23) | 1, accepted[2] }\n"
+	"assert(serviceCore.multicastText(ids, \"m\") == 3, \"count\")\n"
+	"waitContents(\"m|m|\")\n"
+	"waitFor(function() return #texts == 1 end, \"text\")\n"
+	"assert(texts[1] == \"m\")\n"
+	"for i = 1, 2 do serviceCore.remoteClose(accepted[i]) end\n";
+
+TEST_F(luaRuntimeTest, multicast_routing)
+{
+	char szAddress[64];
+	snprintf(szAddress, sizeof(szAddress), "local address = \"127.0.0.1:%d\"\n",
+			 61000 + (int32_t)(getpid() % 4000) + 1);
+	EXPECT_EQ(run(std::string(szAddress) + s_szLoopbackChannels + s_szMulticastTest), "ok");
+}
+
+#endif
@@ -0,0 +1,518 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+extern "C" {
+#include "platform_t.h"
+#include "utility_t.h"
+#include "time_t.h"
+#include "thread_t.h"
+#include "eventIO/eventIO_t.h"
+#include "eventIO/eventIOThread_t.h"
+#include "service_t.h"
+#include "serviceCenter_t.h"
+#include "serviceEvent_t.h"
+#include "serviceTrace_t.h"
+#include "clusterRouter_t.h"
+}
+
+#if DEF_PLATFORM == DEF_PLATFORM_LINUX
+#	include <arpa/inet.h>
+#	include <netinet/in.h>
+#	include <sys/socket.h>
+#	include <sys/time.h>
+#	include <unistd.h>
+#endif
+
+static void sleepMs(int32_t iMs)
+{
+	timespec_tt timeSleep;
+	timeSleep.iSec = 0;
+	timeSleep.iNsec = iMs * 1000000;
+	sleep_for(&timeSleep);
+}
+
+struct testServiceData
+{
+	std::atomic_bool bBlocked;
+	std::atomic_bool bRelease;
+	std::atomic_bool bStopped;
+	std::atomic_int  iPriority;
+	std::atomic_int  iPending;
+	std::atomic_int  iAfterStop;
+	int32_t          iOrder[256];
+};
+
+static std::atomic_int s_iNoUserData;
+
+static bool testServiceCallback(int32_t iType, uint32_t uiSourceID, uint32_t uiToken, void* pBuffer,
+								size_t nLength, void* pUserData)
+{
+	testServiceData* pData = (testServiceData*)pUserData;
+	if (pData == NULL) {
+		++s_iNoUserData;
+		return true;
+	}
+	if (pData->bStopped) {
+		++pData->iAfterStop;
+		return true;
+	}
+	if (uiToken == 0) {
+		// 阻塞服务线程, 让测试线程把后续事件一次性排进邮箱
+		pData->bBlocked = true;
+		while (!pData->bRelease) {
+			sleepMs(1);
+		}
+		return true;
+	}
+	if (uiToken == 2) {
+		// 每条都耗时的事件, 放开前邮箱一直处理不完
+		if (!pData->bRelease) {
+			sleepMs(1);
+		}
+		++pData->iPending;
+		return true;
+	}
+	int32_t iIndex = pData->iPriority + pData->iPending;
+	if (iIndex < 256) {
+		pData->iOrder[iIndex] = iType;
+	}
+	if ((iType & DEF_EVENT_MSG_MASK) == DEF_EVENT_MSG_REPLY) {
+		++pData->iPriority;
+	}
+	else {
+		++pData->iPending;
+	}
+	return true;
+}
+
+static void testServiceStop(void* pUserData)
+{
+	testServiceData* pData = (testServiceData*)pUserData;
+	pData->bStopped = true;
+}
+
+// 组播的共享负载: 记录service_multicast在调用线程上的第一次分配, 统计它被释放的次数
+static void* (*s_fnMalloc)(size_t);
+static void* (*s_fnRealloc)(void*, size_t);
+static void (*s_fnFree)(void*);
+static thread_local bool s_bWatchMalloc;
+static std::atomic<char*> s_pShared;
+static std::atomic_int s_iSharedFreed;
+
+static void* watchMalloc(size_t nSize)
+{
+	void* p = s_fnMalloc(nSize);
+	if (s_bWatchMalloc) {
+		s_bWatchMalloc = false;
+		s_pShared = (char*)p;
+	}
+	else if (p == s_pShared) {
+		// 释放后地址被复用, 之后的释放与共享负载无关
+		s_pShared = NULL;
+	}
+	return p;
+}
+
+static void watchFree(void* p)
+{
+	if (p != NULL && p == s_pShared) {
+		++s_iSharedFreed;
+	}
+	s_fnFree(p);
+}
+
+struct multicastData
+{
+	std::atomic_int iReceived;
+	std::atomic_int iFreedBefore;
+	std::atomic_int iNotShared;
+	std::atomic_int iBadPayload;
+};
+
+static bool multicastCallback(int32_t iType, uint32_t uiSourceID, uint32_t uiToken, void* pBuffer,
+							  size_t nLength, void* pUserData)
+{
+	multicastData* pData = (multicastData*)pUserData;
+	if (pData == NULL || (iType & DEF_EVENT_MSG_MASK) != DEF_EVENT_MSG_SEND) {
+		return true;
+	}
+	if (s_iSharedFreed != 0) {
+		++pData->iFreedBefore;
+	}
+	// 各目标拿到的是同一块负载, 不是各自的拷贝
+	char* pShared = s_pShared;
+	if ((char*)pBuffer <= pShared || (char*)pBuffer > pShared + 16) {
+		++pData->iNotShared;
+	}
+	if (uiSourceID != 1 || uiToken != 3 || nLength != 9 || memcmp(pBuffer, "multicast", 9) != 0) {
+		++pData->iBadPayload;
+	}
+	++pData->iReceived;
+	return true;
+}
+
+class serviceTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		serviceCenter_init(1);
+		m_pEventIO = createEventIO();
+		eventIO_start(m_pEventIO, false);
+		m_pEventIOThread = createEventIOThread(m_pEventIO);
+		eventIOThread_start(m_pEventIOThread, true, NULL, NULL);
+		m_pData = new testServiceData();
+		m_pData->bBlocked = false;
+		m_pData->bRelease = false;
+		m_pData->bStopped = false;
+		m_pData->iPriority = 0;
+		m_pData->iPending = 0;
+		m_pData->iAfterStop = 0;
+		s_iNoUserData = 0;
+		m_pService = createService(m_pEventIO);
+		service_setCallback(m_pService, testServiceCallback);
+		m_uiServiceID = service_start(m_pService, m_pData, NULL, testServiceStop);
+	}
+
+	void TearDown() override
+	{
+		service_stop(m_pService);
+		waitStopped();
+		service_release(m_pService);
+		eventIOThread_stop(m_pEventIOThread, true);
+		eventIOThread_join(m_pEventIOThread);
+		clusterRouter_clear();
+		serviceCenter_clear();
+		eventIO_release(m_pEventIO);
+		delete m_pData;
+	}
+
+	void block()
+	{
+		ASSERT_TRUE(service_send(m_pService, 0, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 0));
+		for (int32_t i = 0; i < 1000 && !m_pData->bBlocked; ++i) {
+			sleepMs(1);
+		}
+		ASSERT_TRUE(m_pData->bBlocked);
+	}
+
+	void waitStopped()
+	{
+		waitGone(m_uiServiceID);
+	}
+
+	void waitGone(uint32_t uiServiceID)
+	{
+		for (int32_t i = 0; i < 1000; ++i) {
+			service_tt* pService = serviceCenter_gain(uiServiceID);
+			if (pService == NULL) {
+				return;
+			}
+			service_release(pService);
+			sleepMs(1);
+		}
+	}
+
+	eventIO_tt*       m_pEventIO;
+	eventIOThread_tt* m_pEventIOThread;
+	testServiceData*  m_pData;
+	service_tt*       m_pService;
+	uint32_t          m_uiServiceID;
+};
+
+TEST_F(serviceTest, priority_before_pending)
+{
+	block();
+	for (int32_t i = 0; i < 4; ++i) {
+		ASSERT_TRUE(service_send(m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1));
+	}
+	for (int32_t i = 0; i < 4; ++i) {
+		ASSERT_TRUE(service_send(m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_REPLY, 1));
+	}
+	m_pData->bRelease = true;
+	for (int32_t i = 0; i < 1000 && m_pData->iPriority + m_pData->iPending < 8; ++i) {
+		sleepMs(1);
+	}
+	ASSERT_EQ(m_pData->iPriority + m_pData->iPending, 8);
+	for (int32_t i = 0; i < 4; ++i) {
+		EXPECT_EQ(m_pData->iOrder[i] & DEF_EVENT_MSG_MASK, DEF_EVENT_MSG_REPLY);
+	}
+	for (int32_t i = 4; i < 8; ++i) {
+		EXPECT_EQ(m_pData->iOrder[i] & DEF_EVENT_MSG_MASK, DEF_EVENT_MSG_SEND);
+	}
+}
+
+TEST_F(serviceTest, priority_with_stop)
+{
+	// 优先事件超过一轮突发上限, 停止事件在普通通道队头时优先通道仍有积压
+	block();
+	for (int32_t i = 0; i < 100; ++i) {
+		ASSERT_TRUE(service_sendPriority(
+			m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_REPLY, 1));
+	}
+	service_stop(m_pService);
+	EXPECT_FALSE(service_sendPriority(
+		m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_REPLY, 1));
+	EXPECT_FALSE(service_send(m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1));
+	m_pData->bRelease = true;
+	waitStopped();
+
+	EXPECT_TRUE(m_pData->bStopped);
+	EXPECT_EQ(m_pData->iPriority, 100);
+	EXPECT_EQ(m_pData->iAfterStop, 0);
+	EXPECT_EQ(s_iNoUserData, 0);
+	EXPECT_EQ(service_queueSize(m_pService), 0u);
+}
+
+TEST_F(serviceTest, mailbox_reject)
+{
+	service_setMailboxLimit(m_pService, 4, 0, DEF_SERVICE_OVERLOAD_REJECT, 0);
+	block();
+	for (int32_t i = 0; i < 4; ++i) {
+		EXPECT_EQ(service_post(m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1, false),
+				  DEF_SERVICE_SEND_OK);
+	}
+	EXPECT_TRUE(service_isOverload(m_pService));
+	EXPECT_EQ(service_post(m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1, false),
+			  DEF_SERVICE_SEND_OVERLOAD);
+	// 优先通道不受邮箱上限约束
+	EXPECT_EQ(service_post(m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1, true),
+			  DEF_SERVICE_SEND_OK);
+	EXPECT_EQ(service_queueSize(m_pService), 5u);
+
+	m_pData->bRelease = true;
+	for (int32_t i = 0; i < 1000 && m_pData->iPriority + m_pData->iPending < 5; ++i) {
+		sleepMs(1);
+	}
+	EXPECT_EQ(m_pData->iPending, 5);
+	EXPECT_FALSE(service_isOverload(m_pService));
+
+	service_stop(m_pService);
+	EXPECT_EQ(service_post(m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1, false),
+			  DEF_SERVICE_SEND_STOPPED);
+}
+
+TEST_F(serviceTest, mailbox_drop)
+{
+	char szBuffer[64];
+	memset(szBuffer, 0, sizeof(szBuffer));
+	service_setMailboxLimit(m_pService, 0, 128, DEF_SERVICE_OVERLOAD_DROP_NEWEST, 0);
+	block();
+	EXPECT_TRUE(service_send(m_pService, 1, szBuffer, 64, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1));
+	EXPECT_TRUE(service_send(m_pService, 1, szBuffer, 64, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1));
+	EXPECT_EQ(service_queueBytes(m_pService), 128u);
+	// 丢弃对发送方视为成功
+	EXPECT_EQ(service_post(m_pService, 1, szBuffer, 64, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1, false),
+			  DEF_SERVICE_SEND_OK);
+	EXPECT_EQ(service_queueSize(m_pService), 2u);
+
+	service_setMailboxLimit(m_pService, 0, 128, DEF_SERVICE_OVERLOAD_DROP_OLDEST, 0);
+	EXPECT_TRUE(service_send(m_pService, 1, szBuffer, 64, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1));
+	EXPECT_EQ(service_queueSize(m_pService), 2u);
+	EXPECT_EQ(service_queueBytes(m_pService), 128u);
+
+	m_pData->bRelease = true;
+	for (int32_t i = 0; i < 1000 && m_pData->iPending < 2; ++i) {
+		sleepMs(1);
+	}
+	EXPECT_EQ(m_pData->iPending, 2);
+	EXPECT_EQ(service_queueBytes(m_pService), 0u);
+}
+
+TEST_F(serviceTest, multicast_shared)
+{
+	s_fnMalloc = mem_malloc;
+	s_fnRealloc = mem_realloc;
+	s_fnFree = mem_free;
+	s_pShared = NULL;
+	s_iSharedFreed = 0;
+	set_mem_functions(watchMalloc, s_fnRealloc, watchFree);
+
+	multicastData data;
+	data.iReceived = 0;
+	data.iFreedBefore = 0;
+	data.iNotShared = 0;
+	data.iBadPayload = 0;
+	service_tt* pTargets[2];
+	uint32_t uiTargetIDs[2];
+	for (int32_t i = 0; i < 2; ++i) {
+		pTargets[i] = createService(m_pEventIO);
+		service_setCallback(pTargets[i], multicastCallback);
+		uiTargetIDs[i] = service_start(pTargets[i], &data, NULL, NULL);
+	}
+	service_tt* pStopped = createService(m_pEventIO);
+	service_setCallback(pStopped, multicastCallback);
+	uint32_t uiStoppedID = service_start(pStopped, &data, NULL, NULL);
+	service_stop(pStopped);
+
+	// 邮箱已满的目标: 阻塞中的服务再排一条即达到上限
+	service_setMailboxLimit(m_pService, 1, 0, DEF_SERVICE_OVERLOAD_REJECT, 0);
+	block();
+	ASSERT_TRUE(service_send(m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1));
+
+	// 未配置的节点和频道ID都不是本地服务, 也不经集群发出
+	uint32_t uiRemoteID = (5u << DEF_SERVICE_NODE_SHIFT) | 1;
+	uint32_t uiIDs[] = { uiTargetIDs[0], m_uiServiceID, uiStoppedID, uiRemoteID, 0x80000001u,
+						 uiTargetIDs[1] };
+	s_bWatchMalloc = true;
+	EXPECT_EQ(service_multicast(uiIDs, 6, 1, "multicast", 9, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 3),
+			  2);
+	s_bWatchMalloc = false;
+	ASSERT_NE(s_pShared.load(), nullptr);
+	EXPECT_EQ(service_queueSize(m_pService), 1u);
+
+	m_pData->bRelease = true;
+	for (int32_t i = 0; i < 1000 && (data.iReceived < 2 || s_iSharedFreed == 0); ++i) {
+		sleepMs(1);
+	}
+	sleepMs(10);
+	EXPECT_EQ(data.iReceived, 2);
+	EXPECT_EQ(data.iFreedBefore, 0);
+	EXPECT_EQ(data.iNotShared, 0);
+	EXPECT_EQ(data.iBadPayload, 0);
+	EXPECT_EQ(s_iSharedFreed, 1);
+	set_mem_functions(s_fnMalloc, s_fnRealloc, s_fnFree);
+
+	for (int32_t i = 0; i < 2; ++i) {
+		service_stop(pTargets[i]);
+		waitGone(uiTargetIDs[i]);
+		service_release(pTargets[i]);
+	}
+	waitGone(uiStoppedID);
+	service_release(pStopped);
+}
+
+#if DEF_PLATFORM == DEF_PLATFORM_LINUX
+
+TEST_F(serviceTest, multicast_remote)
+{
+	// 对端节点用一个原始的监听socket代替, 只读出链路上的字节流
+	uint16_t uiPort = (uint16_t)(57000 + (getpid() % 4000));
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	ASSERT_GE(fd, 0);
+	int iReuse = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(uiPort + 1);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	ASSERT_EQ(bind(fd, (struct sockaddr*)&addr, sizeof(addr)), 0);
+	ASSERT_EQ(listen(fd, 1), 0);
+
+	char szAddress[64];
+	snprintf(szAddress, sizeof(szAddress), "127.0.0.1:%u", uiPort);
+	ASSERT_TRUE(clusterRouter_init(m_pEventIO, 1, szAddress, NULL, 0));
+	snprintf(szAddress, sizeof(szAddress), "127.0.0.1:%u", uiPort + 1);
+	ASSERT_TRUE(clusterRouter_addPeer(2, szAddress));
+
+	uint32_t uiRemoteID = (2u << DEF_SERVICE_NODE_SHIFT) | 7;
+	uint32_t uiUnknownID = (3u << DEF_SERVICE_NODE_SHIFT) | 7;
+	uint32_t uiIDs[] = { uiUnknownID, uiRemoteID, m_uiServiceID };
+	EXPECT_EQ(service_multicast(uiIDs, 3, 1, "multicast", 9, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 3),
+			  2);
+
+	// 链路连上后先同步名字目录, 之后是排队中的事件; 事件头不带MOVEBUF标记
+	struct timeval timeout = { 3, 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	int peer = accept(fd, NULL, NULL);
+	ASSERT_GE(peer, 0);
+	setsockopt(peer, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	uint8_t szExpect[16 + 9];
+	uint8_t* p = szExpect;
+	const uint32_t uiHead[] = { uiRemoteID, 1, 3,
+								9 | (uint32_t)(DEF_EVENT_MSG | DEF_EVENT_MSG_SEND) << 24 };
+	for (uint32_t uiValue : uiHead) {
+		p[0] = (uint8_t)(uiValue >> 24);
+		p[1] = (uint8_t)(uiValue >> 16);
+		p[2] = (uint8_t)(uiValue >> 8);
+		p[3] = (uint8_t)uiValue;
+		p += 4;
+	}
+	memcpy(p, "multicast", 9);
+	std::string szStream;
+	bool bFound = false;
+	char szBuffer[4096];
+	while (!bFound) {
+		ssize_t n = recv(peer, szBuffer, sizeof(szBuffer), 0);
+		if (n <= 0) {
+			break;
+		}
+		szStream.append(szBuffer, (size_t)n);
+		bFound = szStream.find(std::string((const char*)szExpect, sizeof(szExpect))) !=
+				 std::string::npos;
+	}
+	EXPECT_TRUE(bFound);
+	close(peer);
+	close(fd);
+
+	for (int32_t i = 0; i < 1000 && m_pData->iPending < 1; ++i) {
+		sleepMs(1);
+	}
+	EXPECT_EQ(m_pData->iPending, 1);
+}
+
+#endif
+
+TEST_F(serviceTest, stop_untraced)
+{
+	// 先派发一条被追踪的消息, 释放的事件内存随后多半会被停止事件复用
+	serviceTrace_init(16);
+	serviceTraceContext_tt* pContext = serviceTrace_current();
+	pContext->uiTraceID = serviceTrace_newID();
+	pContext->uiSpanID = 0;
+	ASSERT_TRUE(service_send(m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 1));
+	pContext->uiTraceID = 0;
+	for (int32_t i = 0; i < 1000 && m_pData->iPending < 1; ++i) {
+		sleepMs(1);
+	}
+	ASSERT_EQ(m_pData->iPending, 1);
+
+	service_stop(m_pService);
+	waitStopped();
+
+	const char* szFileName = "test_service_trace.json";
+	remove(szFileName);
+	EXPECT_EQ(serviceTrace_export(szFileName), 1);
+	remove(szFileName);
+	serviceTrace_clear();
+}
+
+TEST_F(serviceTest, stats_while_saturated)
+{
+	// 一次排入的事件够处理两秒以上, 服务在这期间不会离开邮箱处理
+	for (int32_t i = 0; i < 2000; ++i) {
+		ASSERT_TRUE(service_send(m_pService, 1, NULL, 0, DEF_EVENT_MSG | DEF_EVENT_MSG_SEND, 2));
+	}
+	sleepMs(200);
+	serviceStats_tt first;
+	service_getStats(m_pService, &first);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	EXPECT_GT(first.uiProcessed, 0u);
+	EXPECT_GT(first.uiBusyNs, 0u);
+
+	sleepMs(500);
+	serviceStats_tt second;
+	service_getStats(m_pService, &second);
+	uint64_t uiWallNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+							std::chrono::steady_clock::now() - start)
+							.count();
+	EXPECT_GT(service_queueSize(m_pService), 0u);
+	EXPECT_GT(second.uiProcessed, first.uiProcessed);
+	// 按发布间隔取整, 区间内的忙碌时间接近墙钟时间且不超过它太多
+	uint64_t uiBusyNs = second.uiBusyNs - first.uiBusyNs;
+	EXPECT_GT(uiBusyNs, uiWallNs / 2);
+	EXPECT_LT(uiBusyNs, uiWallNs + 100000000ull);
+
+	m_pData->bRelease = true;
+	for (int32_t i = 0; i < 1000 && m_pData->iPending < 2000; ++i) {
+		sleepMs(1);
+	}
+	EXPECT_EQ(m_pData->iPending, 2000);
+}
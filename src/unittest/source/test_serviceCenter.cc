@@ -0,0 +1,204 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern "C" {
+#include "utility_t.h"
+#include "time_t.h"
+#include "thread_t.h"
+#include "eventIO/eventIO_t.h"
+#include "eventIO/eventIOThread_t.h"
+#include "service_t.h"
+#include "serviceCenter_t.h"
+}
+
+#define def_testNodeId 3
+#define def_testNodeMask (def_testNodeId << DEF_SERVICE_NODE_SHIFT)
+#define def_testCapacity 0x1ffff
+
+static void waitDeregister(uint32_t uiServiceID)
+{
+	timespec_tt timeSleep;
+	timeSleep.iSec = 0;
+	timeSleep.iNsec = 1000000;
+	for (int32_t i = 0; i < 1000; ++i) {
+		service_tt* pService = serviceCenter_gain(uiServiceID);
+		if (pService == NULL) {
+			return;
+		}
+		service_release(pService);
+		sleep_for(&timeSleep);
+	}
+}
+
+class serviceCenterTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		serviceCenter_init(def_testNodeId);
+		m_pEventIO = createEventIO();
+		eventIO_start(m_pEventIO, false);
+		m_pEventIOThread = createEventIOThread(m_pEventIO);
+		eventIOThread_start(m_pEventIOThread, true, NULL, NULL);
+	}
+
+	void TearDown() override
+	{
+		eventIOThread_stop(m_pEventIOThread, true);
+		eventIOThread_join(m_pEventIOThread);
+		serviceCenter_clear();
+		eventIO_release(m_pEventIO);
+	}
+
+	uint32_t startService(service_tt** ppService)
+	{
+		service_tt* pService = createService(m_pEventIO);
+		uint32_t uiServiceID = service_start(pService, NULL, NULL, NULL);
+		*ppService = pService;
+		return uiServiceID;
+	}
+
+	void stopService(service_tt* pService, uint32_t uiServiceID)
+	{
+		service_stop(pService);
+		waitDeregister(uiServiceID);
+		service_release(pService);
+	}
+
+	eventIO_tt* m_pEventIO;
+	eventIOThread_tt* m_pEventIOThread;
+};
+
+TEST_F(serviceCenterTest, id_packing)
+{
+	service_tt* pService1 = NULL;
+	service_tt* pService2 = NULL;
+	uint32_t uiServiceID1 = startService(&pService1);
+	uint32_t uiServiceID2 = startService(&pService2);
+
+	EXPECT_EQ(uiServiceID1, (uint32_t)(def_testNodeMask | 1));
+	EXPECT_EQ(uiServiceID2, (uint32_t)(def_testNodeMask | 2));
+	EXPECT_EQ(uiServiceID1 & 0x80000000, 0u);
+
+	service_tt* pGain = serviceCenter_gain(uiServiceID2);
+	EXPECT_EQ(pGain, pService2);
+	if (pGain) {
+		service_release(pGain);
+	}
+
+	// 其他节点的ID不在本地表中查找
+	uint32_t uiOtherNode = (uiServiceID1 & ~def_testNodeMask) | (4 << DEF_SERVICE_NODE_SHIFT);
+	EXPECT_EQ(serviceCenter_gain(uiOtherNode), nullptr);
+	EXPECT_EQ(serviceCenter_gain(def_testNodeMask), nullptr);
+
+	stopService(pService1, uiServiceID1);
+	stopService(pService2, uiServiceID2);
+}
+
+TEST_F(serviceCenterTest, stale_id)
+{
+	service_tt* pService = NULL;
+	uint32_t uiServiceID = startService(&pService);
+	ASSERT_NE(uiServiceID, 0u);
+	stopService(pService, uiServiceID);
+
+	EXPECT_EQ(serviceCenter_gain(uiServiceID), nullptr);
+	EXPECT_FALSE(serviceCenter_deregister(uiServiceID));
+}
+
+TEST_F(serviceCenterTest, generation_reuse)
+{
+	service_tt* pService = NULL;
+	uint32_t uiOldID = startService(&pService);
+	ASSERT_EQ(uiOldID, (uint32_t)(def_testNodeMask | 1));
+	stopService(pService, uiOldID);
+
+	// 空闲槽位按FIFO复用, 占满其余槽位后才会轮到刚释放的槽位
+	service_tt* pFiller = createService(m_pEventIO);
+	for (int32_t i = 1; i < def_testCapacity; ++i) {
+		ASSERT_NE(serviceCenter_register(pFiller), 0u);
+	}
+
+	uint32_t uiNewID = startService(&pService);
+	EXPECT_EQ(uiNewID, (uint32_t)(def_testNodeMask | (1 << 17) | 1));
+	EXPECT_EQ(serviceCenter_gain(uiOldID), nullptr);
+	service_tt* pGain = serviceCenter_gain(uiNewID);
+	EXPECT_EQ(pGain, pService);
+	if (pGain) {
+		service_release(pGain);
+	}
+
+	// 容量用尽
+	EXPECT_EQ(serviceCenter_register(pFiller), 0u);
+
+	stopService(pService, uiNewID);
+	service_release(pFiller);
+}
+
+TEST_F(serviceCenterTest, name_registry)
+{
+	service_tt* pService1 = NULL;
+	service_tt* pService2 = NULL;
+	uint32_t uiServiceID1 = startService(&pService1);
+	uint32_t uiServiceID2 = startService(&pService2);
+
+	EXPECT_TRUE(serviceCenter_bindName(uiServiceID1, "login"));
+	EXPECT_TRUE(serviceCenter_bindName(uiServiceID1, "login2"));
+	EXPECT_FALSE(serviceCenter_bindName(uiServiceID2, "login"));
+	EXPECT_EQ(serviceCenter_findServiceID("login"), uiServiceID1);
+	EXPECT_EQ(serviceCenter_findServiceID("login2"), uiServiceID1);
+	EXPECT_EQ(serviceCenter_findServiceID("none"), 0u);
+
+	// 超过初始桶数后扩容, 名字仍可查到
+	char szName[32];
+	for (int32_t i = 0; i < 200; ++i) {
+		snprintf(szName, sizeof(szName), "agent%d", i);
+		ASSERT_TRUE(serviceCenter_bindName(uiServiceID2, szName));
+	}
+	for (int32_t i = 0; i < 200; ++i) {
+		snprintf(szName, sizeof(szName), "agent%d", i);
+		ASSERT_EQ(serviceCenter_findServiceID(szName), uiServiceID2);
+	}
+
+	const char* names[] = { "login", "none", "agent7", NULL };
+	uint32_t serviceIDs[4];
+	EXPECT_EQ(serviceCenter_findServiceIDs(names, 4, serviceIDs), 2);
+	EXPECT_EQ(serviceIDs[0], uiServiceID1);
+	EXPECT_EQ(serviceIDs[1], 0u);
+	EXPECT_EQ(serviceIDs[2], uiServiceID2);
+	EXPECT_EQ(serviceIDs[3], 0u);
+
+	EXPECT_TRUE(serviceCenter_unbindServiceName("login2"));
+	EXPECT_EQ(serviceCenter_findServiceID("login2"), 0u);
+	EXPECT_EQ(serviceCenter_findServiceID("login"), uiServiceID1);
+
+	EXPECT_TRUE(serviceCenter_unbindName(uiServiceID1));
+	EXPECT_EQ(serviceCenter_findServiceID("login"), 0u);
+	EXPECT_TRUE(serviceCenter_bindName(uiServiceID2, "login"));
+
+	// 服务注销时一并移除其名字
+	stopService(pService2, uiServiceID2);
+	EXPECT_EQ(serviceCenter_findServiceID("login"), 0u);
+	EXPECT_EQ(serviceCenter_findServiceID("agent7"), 0u);
+	EXPECT_FALSE(serviceCenter_bindName(uiServiceID2, "login"));
+
+	stopService(pService1, uiServiceID1);
+}
+
+TEST_F(serviceCenterTest, remote_name)
+{
+	uint32_t uiRemoteID = (5 << DEF_SERVICE_NODE_SHIFT) | 9;
+	EXPECT_TRUE(serviceCenter_bindRemoteName(uiRemoteID, "gate"));
+	EXPECT_EQ(serviceCenter_findServiceID("gate"), uiRemoteID);
+	EXPECT_FALSE(serviceCenter_unbindServiceName("gate"));
+	EXPECT_FALSE(serviceCenter_bindRemoteName(def_testNodeMask | 1, "local"));
+
+	serviceCenter_clearRemoteNames(5);
+	EXPECT_EQ(serviceCenter_findServiceID("gate"), 0u);
+
+	EXPECT_TRUE(serviceCenter_bindRemoteName(uiRemoteID, "gate"));
+	EXPECT_TRUE(serviceCenter_unbindRemoteName(uiRemoteID, "gate"));
+	EXPECT_EQ(serviceCenter_findServiceID("gate"), 0u);
+}